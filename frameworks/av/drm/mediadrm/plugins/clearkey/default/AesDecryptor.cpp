@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ClearKeyCryptoPlugin"
+#include <utils/Log.h>
+
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+#include "AesDecryptor.h"
+
+namespace clearkeydrm {
+
+namespace {
+
+// EVP takes int sizes, this keeps whole blocks.
+const size_t kMaxUpdateSize = 1 << 30;
+
+bool update(EVP_CIPHER_CTX* context, uint8_t* destination,
+        const uint8_t* source, size_t size) {
+    while (size > 0) {
+        const int updateSize = std::min(size, kMaxUpdateSize);
+        int outSize = 0;
+        if (EVP_DecryptUpdate(context, destination, &outSize, source,
+                updateSize) != 1 || outSize != updateSize) {
+            return false;
+        }
+        source += updateSize;
+        destination += updateSize;
+        size -= updateSize;
+    }
+    return true;
+}
+
+// Sets counter to iv plus blocks, as a big endian 128 bit integer.
+void addToCounter(const Iv iv, uint64_t blocks, Iv counter) {
+    memcpy(counter, iv, kBlockSize);
+    for (int i = kBlockSize - 1; i >= 0 && blocks != 0; --i) {
+        const uint64_t sum = counter[i] + (blocks & 0xff);
+        counter[i] = sum & 0xff;
+        blocks = (blocks >> 8) + (sum >> 8);
+    }
+}
+
+} // namespace
+
+AesDecryptor::AesDecryptor(const android::Vector<uint8_t>& key,
+        size_t parallelThreshold, size_t threadCount)
+    : mStatus(android::ERROR_DRM_DECRYPT),
+      mParallelThreshold(parallelThreshold),
+      mThreadCount(threadCount != 0 ? threadCount : std::min<size_t>(
+              kMaxThreads, std::max(1u, std::thread::hardware_concurrency()))),
+      mCtrContext(EVP_CIPHER_CTX_new()),
+      mCbcContext(EVP_CIPHER_CTX_new()) {
+    if (key.size() != kBlockSize) {
+        android_errorWriteLog(0x534e4554, "63982768");
+        return;
+    }
+    if (mCtrContext == nullptr || mCbcContext == nullptr
+            || EVP_DecryptInit_ex(mCtrContext, EVP_aes_128_ctr(), nullptr,
+                    key.array(), nullptr) != 1
+            || EVP_DecryptInit_ex(mCbcContext, EVP_aes_128_cbc(), nullptr,
+                    key.array(), nullptr) != 1) {
+        ALOGE("Failed to set up the AES key");
+        return;
+    }
+    // Samples are whole blocks, with any trailing partial block left clear.
+    EVP_CIPHER_CTX_set_padding(mCbcContext, 0);
+    mStatus = android::OK;
+}
+
+AesDecryptor::~AesDecryptor() {
+    EVP_CIPHER_CTX_free(mCtrContext);
+    EVP_CIPHER_CTX_free(mCbcContext);
+}
+
+size_t AesDecryptor::getChunkSize(size_t size) const {
+    if (mParallelThreshold == 0 || size < mParallelThreshold || mThreadCount < 2) {
+        return size;
+    }
+    const size_t chunkSize = (size + mThreadCount - 1) / mThreadCount;
+    return (chunkSize + kBlockSize - 1) / kBlockSize * kBlockSize;
+}
+
+bool AesDecryptor::forEachChunk(EVP_CIPHER_CTX* context, size_t size,
+        size_t chunkSize,
+        const std::function<bool(EVP_CIPHER_CTX*, size_t, size_t)>& fn) {
+    if (size == 0) {
+        return true;
+    }
+    if (chunkSize >= size) {
+        return fn(context, 0, size);
+    }
+
+    // The contexts are copied before context is used by this thread.
+    const size_t chunkCount = (size + chunkSize - 1) / chunkSize;
+    std::vector<std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)>>
+            contexts;
+    for (size_t i = 1; i < chunkCount; ++i) {
+        contexts.emplace_back(EVP_CIPHER_CTX_new(), &EVP_CIPHER_CTX_free);
+        if (contexts.back() == nullptr
+                || EVP_CIPHER_CTX_copy(contexts.back().get(), context) != 1) {
+            return false;
+        }
+    }
+
+    std::unique_ptr<bool[]> results(new bool[chunkCount]);
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < chunkCount; ++i) {
+        threads.emplace_back([&, i] {
+            results[i] = fn(contexts[i - 1].get(), i * chunkSize,
+                    std::min(size, (i + 1) * chunkSize));
+        });
+    }
+    results[0] = fn(context, 0, chunkSize);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    return std::all_of(results.get(), results.get() + chunkCount,
+            [](bool result) { return result; });
+}
+
+bool AesDecryptor::decryptCtrRanges(EVP_CIPHER_CTX* context, const Iv iv,
+        const std::vector<Range>& ranges, size_t begin, size_t end) {
+    Iv counter;
+    addToCounter(iv, begin / kBlockSize, counter);
+    if (EVP_DecryptInit_ex(context, nullptr, nullptr, nullptr, counter) != 1) {
+        return false;
+    }
+
+    size_t position = 0;
+    for (const Range& range : ranges) {
+        const size_t rangeEnd = position + range.size;
+        if (rangeEnd > begin) {
+            const size_t from = std::max(begin, position) - position;
+            const size_t to = std::min(end, rangeEnd) - position;
+            if (!update(context, range.destination + from, range.source + from,
+                    to - from)) {
+                return false;
+            }
+        }
+        position = rangeEnd;
+        if (position >= end) {
+            break;
+        }
+    }
+    return true;
+}
+
+android::status_t AesDecryptor::decryptCtr(const Iv iv,
+        const uint8_t* source, uint8_t* destination,
+        const SubSample* subSamples, size_t numSubSamples,
+        size_t* bytesDecryptedOut) {
+    if (mStatus != android::OK) {
+        return mStatus;
+    }
+
+    // The encrypted bytes are decrypted after the clear bytes have been
+    // copied, so that the CTR stream can be split at any block.
+    mRanges.clear();
+    size_t offset = 0;
+    size_t encryptedSize = 0;
+    for (size_t i = 0; i < numSubSamples; ++i) {
+        const SubSample& subSample = subSamples[i];
+
+        if (subSample.mNumBytesOfClearData > 0) {
+            memcpy(destination + offset, source + offset,
+                    subSample.mNumBytesOfClearData);
+            offset += subSample.mNumBytesOfClearData;
+        }
+
+        if (subSample.mNumBytesOfEncryptedData > 0) {
+            mRanges.push_back({source + offset, destination + offset,
+                    subSample.mNumBytesOfEncryptedData});
+            offset += subSample.mNumBytesOfEncryptedData;
+            encryptedSize += subSample.mNumBytesOfEncryptedData;
+        }
+    }
+
+    if (!forEachChunk(mCtrContext, encryptedSize, getChunkSize(encryptedSize),
+            [this, iv](EVP_CIPHER_CTX* context, size_t begin, size_t end) {
+                return decryptCtrRanges(context, iv, mRanges, begin, end);
+            })) {
+        return android::ERROR_DRM_DECRYPT;
+    }
+
+    *bytesDecryptedOut = offset;
+    return android::OK;
+}
+
+bool AesDecryptor::decryptCbc(const Iv iv, const uint8_t* source,
+        uint8_t* destination, size_t size) {
+    // Each chunk is chained to the ciphertext block before it, which is saved
+    // first as it may be decrypted in place.
+    const size_t chunkSize = getChunkSize(size);
+    const size_t chunkCount = size == 0 ? 0 : (size + chunkSize - 1) / chunkSize;
+    mChunkIvs.resize(chunkCount * kBlockSize);
+    for (size_t i = 0; i < chunkCount; ++i) {
+        memcpy(&mChunkIvs[i * kBlockSize],
+                i == 0 ? iv : source + i * chunkSize - kBlockSize, kBlockSize);
+    }
+
+    return forEachChunk(mCbcContext, size, chunkSize,
+            [this, chunkSize, source, destination](EVP_CIPHER_CTX* context,
+                    size_t begin, size_t end) {
+                return EVP_DecryptInit_ex(context, nullptr, nullptr, nullptr,
+                        &mChunkIvs[begin / chunkSize * kBlockSize]) == 1
+                        && update(context, destination + begin, source + begin,
+                                end - begin);
+            });
+}
+
+android::status_t AesDecryptor::decryptCbcs(const Iv iv,
+        const Pattern& pattern, const uint8_t* source, uint8_t* destination,
+        const SubSample* subSamples, size_t numSubSamples,
+        size_t* bytesDecryptedOut) {
+    if (mStatus != android::OK) {
+        return mStatus;
+    }
+
+    const bool hasPattern = pattern.mEncryptBlocks != 0 && pattern.mSkipBlocks != 0;
+    const size_t stride = pattern.mEncryptBlocks + pattern.mSkipBlocks;
+    size_t offset = 0;
+    for (size_t i = 0; i < numSubSamples; ++i) {
+        const SubSample& subSample = subSamples[i];
+
+        if (subSample.mNumBytesOfClearData > 0) {
+            memcpy(destination + offset, source + offset,
+                    subSample.mNumBytesOfClearData);
+            offset += subSample.mNumBytesOfClearData;
+        }
+
+        if (subSample.mNumBytesOfEncryptedData == 0) {
+            continue;
+        }
+
+        const uint8_t* encrypted = source + offset;
+        uint8_t* decrypted = destination + offset;
+        const size_t blocks = subSample.mNumBytesOfEncryptedData / kBlockSize;
+        const size_t encryptedSize = blocks * kBlockSize;
+        if (!hasPattern) {
+            if (!decryptCbc(iv, encrypted, decrypted, encryptedSize)) {
+                return android::ERROR_DRM_DECRYPT;
+            }
+        } else {
+            // The encrypted blocks of the pattern are one CBC chain, so they
+            // are gathered and decrypted in one call rather than a few blocks
+            // at a time, and the clear blocks are copied as they are.
+            mPatternBlocks.clear();
+            for (size_t block = 0; block < blocks; block += stride) {
+                const size_t encryptBlocks = std::min<size_t>(
+                        pattern.mEncryptBlocks, blocks - block);
+                const size_t skipBlocks = std::min<size_t>(
+                        pattern.mSkipBlocks, blocks - block - encryptBlocks);
+                mPatternBlocks.insert(mPatternBlocks.end(),
+                        encrypted + block * kBlockSize,
+                        encrypted + (block + encryptBlocks) * kBlockSize);
+                memcpy(decrypted + (block + encryptBlocks) * kBlockSize,
+                        encrypted + (block + encryptBlocks) * kBlockSize,
+                        skipBlocks * kBlockSize);
+            }
+            if (!decryptCbc(iv, mPatternBlocks.data(), mPatternBlocks.data(),
+                    mPatternBlocks.size())) {
+                return android::ERROR_DRM_DECRYPT;
+            }
+            const uint8_t* block = mPatternBlocks.data();
+            for (size_t first = 0; first < blocks; first += stride) {
+                const size_t encryptBlocks = std::min<size_t>(
+                        pattern.mEncryptBlocks, blocks - first);
+                memcpy(decrypted + first * kBlockSize, block,
+                        encryptBlocks * kBlockSize);
+                block += encryptBlocks * kBlockSize;
+            }
+        }
+
+        // A trailing partial block is not encrypted.
+        if (subSample.mNumBytesOfEncryptedData > encryptedSize) {
+            memcpy(decrypted + encryptedSize, encrypted + encryptedSize,
+                    subSample.mNumBytesOfEncryptedData - encryptedSize);
+        }
+        offset += subSample.mNumBytesOfEncryptedData;
+    }
+
+    *bytesDecryptedOut = offset;
+    return android::OK;
+}
+
+} // namespace clearkeydrm
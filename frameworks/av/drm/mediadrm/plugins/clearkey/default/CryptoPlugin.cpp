@@ -31,9 +31,9 @@ using android::status_t;
 
 // Returns negative values for error code and positive values for the size of
 // decrypted data.  In theory, the output size can be larger than the input
-// size, but in practice this will never happen for AES-CTR.
+// size, but in practice this will never happen for AES-CTR or AES-CBC.
 ssize_t CryptoPlugin::decrypt(bool secure, const KeyId keyId, const Iv iv,
-                              Mode mode, const Pattern &/* pattern */, const void* srcPtr,
+                              Mode mode, const Pattern &pattern, const void* srcPtr,
                               const SubSample* subSamples, size_t numSubSamples,
                               void* dstPtr, AString* errorDetailMsg) {
     if (secure) {
@@ -62,10 +62,10 @@ ssize_t CryptoPlugin::decrypt(bool secure, const KeyId keyId, const Iv iv,
             }
         }
         return static_cast<ssize_t>(offset);
-    } else if (mode == kMode_AES_CTR) {
+    } else if (mode == kMode_AES_CTR || mode == kMode_AES_CBC) {
         size_t bytesDecrypted;
-        status_t res = mSession->decrypt(keyId, iv, srcPtr, dstPtr, subSamples,
-                                         numSubSamples, &bytesDecrypted);
+        status_t res = mSession->decrypt(keyId, iv, mode, pattern, srcPtr, dstPtr,
+                                         subSamples, numSubSamples, &bytesDecrypted);
         if (res == android::OK) {
             return static_cast<ssize_t>(bytesDecrypted);
         } else {
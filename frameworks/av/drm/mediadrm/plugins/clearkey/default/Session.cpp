@@ -23,7 +23,6 @@
 
 #include "Session.h"
 
-#include "AesCtrDecryptor.h"
 #include "InitDataParser.h"
 #include "JsonWebKey.h"
 
@@ -54,6 +53,7 @@ status_t Session::provideKeyResponse(const Vector<uint8_t>& response) {
             const KeyMap::key_type& keyId = keys.keyAt(i);
             const KeyMap::value_type& key = keys.valueAt(i);
             mKeyMap.add(keyId, key);
+            mDecryptors.erase(keyId);
         }
         return android::OK;
     } else {
@@ -62,21 +62,31 @@ status_t Session::provideKeyResponse(const Vector<uint8_t>& response) {
 }
 
 status_t Session::decrypt(
-        const KeyId keyId, const Iv iv, const void* source,
-        void* destination, const SubSample* subSamples,
+        const KeyId keyId, const Iv iv, Mode mode, const Pattern& pattern,
+        const void* source, void* destination, const SubSample* subSamples,
         size_t numSubSamples, size_t* bytesDecryptedOut) {
     Mutex::Autolock lock(mMapLock);
 
     Vector<uint8_t> keyIdVector;
     keyIdVector.appendArray(keyId, kBlockSize);
-    if (mKeyMap.indexOfKey(keyIdVector) < 0) {
-        return android::ERROR_DRM_NO_LICENSE;
+    auto decryptor = mDecryptors.find(keyIdVector);
+    if (decryptor == mDecryptors.end()) {
+        if (mKeyMap.indexOfKey(keyIdVector) < 0) {
+            return android::ERROR_DRM_NO_LICENSE;
+        }
+        decryptor = mDecryptors.emplace(keyIdVector, std::make_unique<AesDecryptor>(
+                mKeyMap.valueFor(keyIdVector))).first;
     }
 
-    const Vector<uint8_t>& key = mKeyMap.valueFor(keyIdVector);
-    AesCtrDecryptor decryptor;
-    return decryptor.decrypt(
-            key, iv,
+    if (mode == android::CryptoPlugin::kMode_AES_CBC) {
+        return decryptor->second->decryptCbcs(
+                iv, pattern,
+                reinterpret_cast<const uint8_t*>(source),
+                reinterpret_cast<uint8_t*>(destination), subSamples,
+                numSubSamples, bytesDecryptedOut);
+    }
+    return decryptor->second->decryptCtr(
+            iv,
             reinterpret_cast<const uint8_t*>(source),
             reinterpret_cast<uint8_t*>(destination), subSamples,
             numSubSamples, bytesDecryptedOut);
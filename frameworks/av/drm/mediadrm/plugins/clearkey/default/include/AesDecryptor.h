@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CLEARKEY_AES_DECRYPTOR_H_
+#define CLEARKEY_AES_DECRYPTOR_H_
+
+#include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/MediaErrors.h>
+#include <openssl/evp.h>
+#include <utils/Errors.h>
+#include <utils/Vector.h>
+
+#include <functional>
+#include <vector>
+
+#include "ClearKeyTypes.h"
+
+namespace clearkeydrm {
+
+// Decrypts the samples of one AES-128 key, for the cenc (AES-CTR) and cbcs
+// (AES-CBC with an optional encryption pattern) schemes.
+//
+// The key is expanded once, on construction, into EVP contexts that are only
+// given the IV of each sample, and EVP uses the AES instructions of the CPU
+// when it has them. Samples of at least parallelThreshold encrypted bytes are
+// split across threadCount threads (by default as many as there are CPUs, up
+// to kMaxThreads), a parallelThreshold of 0 disables this.
+//
+// An AesDecryptor is not thread safe.
+class AesDecryptor {
+public:
+    static constexpr size_t kDefaultParallelThreshold = 1024 * 1024;
+    static constexpr size_t kMaxThreads = 4;
+
+    explicit AesDecryptor(const android::Vector<uint8_t>& key,
+            size_t parallelThreshold = kDefaultParallelThreshold,
+            size_t threadCount = 0);
+    ~AesDecryptor();
+
+    // Returns OK if the key is usable.
+    android::status_t initCheck() const { return mStatus; }
+
+    // cenc: the encrypted bytes of all the subsamples are a single CTR stream.
+    android::status_t decryptCtr(const Iv iv, const uint8_t* source,
+            uint8_t* destination, const SubSample* subSamples,
+            size_t numSubSamples, size_t* bytesDecryptedOut);
+
+    // cbcs: the CBC chain restarts from the IV at each subsample, only the
+    // mEncryptBlocks first blocks of every mEncryptBlocks + mSkipBlocks are
+    // encrypted (all of them without a pattern), and a trailing partial block
+    // is clear.
+    android::status_t decryptCbcs(const Iv iv, const Pattern& pattern,
+            const uint8_t* source, uint8_t* destination,
+            const SubSample* subSamples, size_t numSubSamples,
+            size_t* bytesDecryptedOut);
+
+private:
+    // Encrypted bytes of a sample, in stream order.
+    struct Range {
+        const uint8_t* source;
+        uint8_t* destination;
+        size_t size;
+    };
+
+    // Returns the block aligned size of the chunks a sample of size encrypted
+    // bytes is split into, which is size if it is not split.
+    size_t getChunkSize(size_t size) const;
+
+    // Calls fn(context, begin, end) for the chunks covering [0, size), with
+    // the chunks after the first on their own threads and copies of context.
+    // Returns false if any call did.
+    bool forEachChunk(EVP_CIPHER_CTX* context, size_t size, size_t chunkSize,
+            const std::function<bool(EVP_CIPHER_CTX*, size_t, size_t)>& fn);
+
+    static bool decryptCtrRanges(EVP_CIPHER_CTX* context, const Iv iv,
+            const std::vector<Range>& ranges, size_t begin, size_t end);
+    bool decryptCbc(const Iv iv, const uint8_t* source, uint8_t* destination,
+            size_t size);
+
+    android::status_t mStatus;
+    const size_t mParallelThreshold;
+    const size_t mThreadCount;
+    EVP_CIPHER_CTX* mCtrContext;
+    EVP_CIPHER_CTX* mCbcContext;
+
+    // Scratch buffers, kept to avoid allocating for every sample.
+    std::vector<Range> mRanges;
+    std::vector<uint8_t> mPatternBlocks;
+    std::vector<uint8_t> mChunkIvs;
+
+    DISALLOW_EVIL_CONSTRUCTORS(AesDecryptor);
+};
+
+} // namespace clearkeydrm
+
+#endif // CLEARKEY_AES_DECRYPTOR_H_
@@ -29,6 +29,8 @@ typedef uint8_t KeyId[kBlockSize];
 typedef uint8_t Iv[kBlockSize];
 
 typedef android::CryptoPlugin::SubSample SubSample;
+typedef android::CryptoPlugin::Pattern Pattern;
+typedef android::CryptoPlugin::Mode Mode;
 
 typedef android::KeyedVector<android::Vector<uint8_t>,
         android::Vector<uint8_t> > KeyMap;
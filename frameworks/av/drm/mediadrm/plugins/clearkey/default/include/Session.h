@@ -24,6 +24,10 @@
 #include <utils/String8.h>
 #include <utils/Vector.h>
 
+#include <map>
+#include <memory>
+
+#include "AesDecryptor.h"
 #include "ClearKeyTypes.h"
 #include "Utils.h"
 
@@ -46,8 +50,8 @@ public:
             const android::Vector<uint8_t>& response);
 
     android::status_t decrypt(
-            const KeyId keyId, const Iv iv, const void* source,
-            void* destination, const SubSample* subSamples,
+            const KeyId keyId, const Iv iv, Mode mode, const Pattern& pattern,
+            const void* source, void* destination, const SubSample* subSamples,
             size_t numSubSamples, size_t* bytesDecryptedOut);
 
 private:
@@ -57,6 +61,8 @@ private:
 
     android::Mutex mMapLock;
     KeyMap mKeyMap;
+    // Decryptors of the keys used so far, which hold their expanded keys.
+    std::map<android::Vector<uint8_t>, std::unique_ptr<AesDecryptor>> mDecryptors;
 };
 
 } // namespace clearkeydrm
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <openssl/aes.h>
+#include <string.h>
+
+#include <vector>
+
+#include <utils/Vector.h>
+
+#include "AesDecryptor.h"
+
+namespace clearkeydrm {
+
+namespace {
+
+const uint8_t kKey[kBlockSize] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+    0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+const Iv kIv = {
+    0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+    0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff
+};
+
+// Video samples: a clear slice header in front of each encrypted slice.
+std::vector<SubSample> subSamplesOf(size_t sampleSize) {
+    const size_t kSlices = 4;
+    std::vector<SubSample> subSamples;
+    for (size_t i = 0; i < kSlices; ++i) {
+        subSamples.push_back({32, static_cast<uint32_t>(sampleSize / kSlices - 32)});
+    }
+    return subSamples;
+}
+
+void setBytesProcessed(benchmark::State& state) {
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+} // namespace
+
+// What decrypting a cenc sample cost before AesDecryptor: the key expanded for
+// every sample, and each subsample through the low level CTR API.
+static void BM_CtrLowLevel(benchmark::State& state) {
+    const std::vector<SubSample> subSamples = subSamplesOf(state.range(0));
+    std::vector<uint8_t> source(state.range(0)), destination(state.range(0));
+    for (auto _ : state) {
+        AES_KEY key;
+        AES_set_encrypt_key(kKey, kBlockSize * 8, &key);
+        Iv iv;
+        memcpy(iv, kIv, kBlockSize);
+        uint8_t previousEncryptedCounter[kBlockSize] = {};
+        uint32_t blockOffset = 0;
+        size_t offset = 0;
+        for (const SubSample& subSample : subSamples) {
+            memcpy(&destination[offset], &source[offset], subSample.mNumBytesOfClearData);
+            offset += subSample.mNumBytesOfClearData;
+            AES_ctr128_encrypt(&source[offset], &destination[offset],
+                    subSample.mNumBytesOfEncryptedData, &key, iv,
+                    previousEncryptedCounter, &blockOffset);
+            offset += subSample.mNumBytesOfEncryptedData;
+        }
+        benchmark::DoNotOptimize(destination.data());
+    }
+    setBytesProcessed(state);
+}
+BENCHMARK(BM_CtrLowLevel)->Arg(64 * 1024)->Arg(1024 * 1024)->Arg(4 * 1024 * 1024);
+
+// range(1) is the parallel threshold, 0 decrypts on the calling thread only.
+static void BM_Ctr(benchmark::State& state) {
+    android::Vector<uint8_t> key;
+    key.appendArray(kKey, kBlockSize);
+    AesDecryptor decryptor(key, state.range(1));
+    const std::vector<SubSample> subSamples = subSamplesOf(state.range(0));
+    std::vector<uint8_t> source(state.range(0)), destination(state.range(0));
+    size_t bytesDecrypted;
+    for (auto _ : state) {
+        decryptor.decryptCtr(kIv, source.data(), destination.data(), subSamples.data(),
+                subSamples.size(), &bytesDecrypted);
+    }
+    setBytesProcessed(state);
+}
+BENCHMARK(BM_Ctr)
+        ->Args({64 * 1024, 0})
+        ->Args({1024 * 1024, 0})
+        ->Args({4 * 1024 * 1024, 0})
+        ->Args({4 * 1024 * 1024, AesDecryptor::kDefaultParallelThreshold})
+        ->UseRealTime();
+
+// cbcs with the usual 1:9 pattern, every encrypted block decrypted one at a
+// time with the low level CBC API.
+static void BM_CbcsLowLevel(benchmark::State& state) {
+    const std::vector<SubSample> subSamples = subSamplesOf(state.range(0));
+    std::vector<uint8_t> source(state.range(0)), destination(state.range(0));
+    for (auto _ : state) {
+        AES_KEY key;
+        AES_set_decrypt_key(kKey, kBlockSize * 8, &key);
+        size_t offset = 0;
+        for (const SubSample& subSample : subSamples) {
+            memcpy(&destination[offset], &source[offset], subSample.mNumBytesOfClearData);
+            offset += subSample.mNumBytesOfClearData;
+            Iv iv;
+            memcpy(iv, kIv, kBlockSize);
+            const size_t blocks = subSample.mNumBytesOfEncryptedData / kBlockSize;
+            for (size_t block = 0; block < blocks; block += 10) {
+                AES_cbc_encrypt(&source[offset + block * kBlockSize],
+                        &destination[offset + block * kBlockSize], kBlockSize, &key, iv,
+                        AES_DECRYPT);
+                const size_t skipBlocks = std::min<size_t>(9, blocks - block - 1);
+                memcpy(&destination[offset + (block + 1) * kBlockSize],
+                        &source[offset + (block + 1) * kBlockSize], skipBlocks * kBlockSize);
+            }
+            offset += subSample.mNumBytesOfEncryptedData;
+        }
+        benchmark::DoNotOptimize(destination.data());
+    }
+    setBytesProcessed(state);
+}
+BENCHMARK(BM_CbcsLowLevel)->Arg(64 * 1024)->Arg(4 * 1024 * 1024);
+
+static void BM_Cbcs(benchmark::State& state) {
+    android::Vector<uint8_t> key;
+    key.appendArray(kKey, kBlockSize);
+    AesDecryptor decryptor(key, 0 /* parallelThreshold */);
+    const Pattern pattern = {1, 9};
+    const std::vector<SubSample> subSamples = subSamplesOf(state.range(0));
+    std::vector<uint8_t> source(state.range(0)), destination(state.range(0));
+    size_t bytesDecrypted;
+    for (auto _ : state) {
+        decryptor.decryptCbcs(kIv, pattern, source.data(), destination.data(),
+                subSamples.data(), subSamples.size(), &bytesDecrypted);
+    }
+    setBytesProcessed(state);
+}
+BENCHMARK(BM_Cbcs)->Arg(64 * 1024)->Arg(4 * 1024 * 1024);
+
+} // namespace clearkeydrm
+
+BENCHMARK_MAIN();
@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <openssl/aes.h>
+#include <string.h>
+
+#include <random>
+#include <vector>
+
+#include <utils/Vector.h>
+
+#include "AesDecryptor.h"
+
+namespace clearkeydrm {
+
+using namespace android;
+
+namespace {
+
+const uint8_t kKey[kBlockSize] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+    0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+const Iv kIv = {
+    0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+    0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff
+};
+
+// A counter that wraps around all of its 128 bits within the first blocks.
+const Iv kWrappingIv = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfd
+};
+
+Vector<uint8_t> keyVector() {
+    Vector<uint8_t> key;
+    key.appendArray(kKey, kBlockSize);
+    return key;
+}
+
+std::vector<uint8_t> randomBytes(size_t size) {
+    std::mt19937 generator(size);
+    std::vector<uint8_t> bytes(size);
+    for (uint8_t& byte : bytes) {
+        byte = generator();
+    }
+    return bytes;
+}
+
+size_t totalSize(const std::vector<SubSample>& subSamples) {
+    size_t size = 0;
+    for (const SubSample& subSample : subSamples) {
+        size += subSample.mNumBytesOfClearData + subSample.mNumBytesOfEncryptedData;
+    }
+    return size;
+}
+
+// Encrypts the way cenc does, one block at a time with the low level API.
+std::vector<uint8_t> encryptCtr(const Iv iv, const std::vector<uint8_t>& clear,
+        const std::vector<SubSample>& subSamples) {
+    AES_KEY key;
+    AES_set_encrypt_key(kKey, kBlockSize * 8, &key);
+    Iv counter;
+    memcpy(counter, iv, kBlockSize);
+    uint8_t keyStream[kBlockSize];
+    size_t keyStreamOffset = kBlockSize;
+
+    std::vector<uint8_t> encrypted(clear);
+    size_t offset = 0;
+    for (const SubSample& subSample : subSamples) {
+        offset += subSample.mNumBytesOfClearData;
+        for (size_t i = 0; i < subSample.mNumBytesOfEncryptedData; ++i, ++offset) {
+            if (keyStreamOffset == kBlockSize) {
+                AES_encrypt(counter, keyStream, &key);
+                for (int j = kBlockSize - 1; j >= 0 && ++counter[j] == 0; --j) {}
+                keyStreamOffset = 0;
+            }
+            encrypted[offset] ^= keyStream[keyStreamOffset++];
+        }
+    }
+    return encrypted;
+}
+
+// Encrypts the way cbcs does, one block at a time with the low level API.
+std::vector<uint8_t> encryptCbcs(const Iv iv, const Pattern& pattern,
+        const std::vector<uint8_t>& clear, const std::vector<SubSample>& subSamples) {
+    AES_KEY key;
+    AES_set_encrypt_key(kKey, kBlockSize * 8, &key);
+
+    std::vector<uint8_t> encrypted(clear);
+    size_t offset = 0;
+    for (const SubSample& subSample : subSamples) {
+        offset += subSample.mNumBytesOfClearData;
+        uint8_t chain[kBlockSize];
+        memcpy(chain, iv, kBlockSize);
+        const size_t blocks = subSample.mNumBytesOfEncryptedData / kBlockSize;
+        const size_t stride = pattern.mEncryptBlocks + pattern.mSkipBlocks;
+        for (size_t block = 0; block < blocks; ++block) {
+            if (pattern.mEncryptBlocks != 0 && pattern.mSkipBlocks != 0
+                    && block % stride >= pattern.mEncryptBlocks) {
+                continue;
+            }
+            uint8_t* data = &encrypted[offset + block * kBlockSize];
+            for (size_t i = 0; i < kBlockSize; ++i) {
+                data[i] ^= chain[i];
+            }
+            AES_encrypt(data, data, &key);
+            memcpy(chain, data, kBlockSize);
+        }
+        offset += subSample.mNumBytesOfEncryptedData;
+    }
+    return encrypted;
+}
+
+const std::vector<SubSample> kSubSamples = {
+    {0, 100}, {13, 31}, {7, 0}, {0, 5}, {20, 48}, {3, 1000},
+};
+
+const std::vector<SubSample> kLargeSubSamples = {
+    {100, 300000}, {5, 700003}, {0, 16}, {40, 1200000},
+};
+
+} // namespace
+
+TEST(AesDecryptorTest, RejectsBadKeys) {
+    Vector<uint8_t> emptyKey;
+    EXPECT_EQ(ERROR_DRM_DECRYPT, AesDecryptor(emptyKey).initCheck());
+
+    Vector<uint8_t> longKey(keyVector());
+    longKey.appendArray(kKey, kBlockSize);
+    AesDecryptor decryptor(longKey);
+    EXPECT_EQ(ERROR_DRM_DECRYPT, decryptor.initCheck());
+
+    uint8_t buffer[kBlockSize] = {};
+    const SubSample subSample = {0, kBlockSize};
+    size_t bytesDecrypted = 0;
+    EXPECT_EQ(ERROR_DRM_DECRYPT, decryptor.decryptCtr(
+            kIv, buffer, buffer, &subSample, 1, &bytesDecrypted));
+    EXPECT_EQ(0u, bytesDecrypted);
+}
+
+TEST(AesDecryptorTest, DecryptsCtrAcrossSubSamples) {
+    const std::vector<uint8_t> clear = randomBytes(totalSize(kSubSamples));
+    const std::vector<uint8_t> encrypted = encryptCtr(kIv, clear, kSubSamples);
+
+    AesDecryptor decryptor(keyVector());
+    ASSERT_EQ(OK, decryptor.initCheck());
+    std::vector<uint8_t> decrypted(clear.size());
+    size_t bytesDecrypted = 0;
+    // Twice, the second time with the key schedule of the first.
+    for (int i = 0; i < 2; ++i) {
+        ASSERT_EQ(OK, decryptor.decryptCtr(kIv, encrypted.data(), decrypted.data(),
+                kSubSamples.data(), kSubSamples.size(), &bytesDecrypted));
+        EXPECT_EQ(clear.size(), bytesDecrypted);
+        EXPECT_EQ(clear, decrypted);
+    }
+}
+
+TEST(AesDecryptorTest, DecryptsCtrInParallel) {
+    for (const uint8_t* iv : {kIv, kWrappingIv}) {
+        const std::vector<uint8_t> clear = randomBytes(totalSize(kLargeSubSamples));
+        const std::vector<uint8_t> encrypted = encryptCtr(iv, clear, kLargeSubSamples);
+
+        // Chunks of about 550000 bytes, which start within subsamples and blocks.
+        AesDecryptor decryptor(keyVector(), 4096 /* parallelThreshold */, 4 /* threadCount */);
+        std::vector<uint8_t> decrypted(clear.size());
+        size_t bytesDecrypted = 0;
+        ASSERT_EQ(OK, decryptor.decryptCtr(iv, encrypted.data(), decrypted.data(),
+                kLargeSubSamples.data(), kLargeSubSamples.size(), &bytesDecrypted));
+        EXPECT_EQ(clear.size(), bytesDecrypted);
+        EXPECT_EQ(clear, decrypted);
+    }
+}
+
+TEST(AesDecryptorTest, DecryptsCbcs) {
+    const Pattern patterns[] = {
+        {1, 9},  // the usual cbcs pattern
+        {2, 3},  // the last pattern of 100 and 1000 bytes has fewer encrypted blocks
+        {0, 0},  // every block encrypted
+        {5, 0},  // no pattern either
+    };
+    for (const Pattern& pattern : patterns) {
+        SCOPED_TRACE(testing::Message() << pattern.mEncryptBlocks << ":" << pattern.mSkipBlocks);
+        const std::vector<uint8_t> clear = randomBytes(totalSize(kSubSamples));
+        const std::vector<uint8_t> encrypted = encryptCbcs(kIv, pattern, clear, kSubSamples);
+        ASSERT_NE(clear, encrypted);
+
+        AesDecryptor decryptor(keyVector());
+        std::vector<uint8_t> decrypted(clear.size());
+        size_t bytesDecrypted = 0;
+        ASSERT_EQ(OK, decryptor.decryptCbcs(kIv, pattern, encrypted.data(), decrypted.data(),
+                kSubSamples.data(), kSubSamples.size(), &bytesDecrypted));
+        EXPECT_EQ(clear.size(), bytesDecrypted);
+        EXPECT_EQ(clear, decrypted);
+    }
+}
+
+TEST(AesDecryptorTest, DecryptsCbcsInParallelInPlace) {
+    for (const Pattern& pattern : {Pattern{1, 9}, Pattern{0, 0}}) {
+        const std::vector<uint8_t> clear = randomBytes(totalSize(kLargeSubSamples));
+        std::vector<uint8_t> buffer = encryptCbcs(kIv, pattern, clear, kLargeSubSamples);
+
+        AesDecryptor decryptor(keyVector(), 4096 /* parallelThreshold */, 3 /* threadCount */);
+        size_t bytesDecrypted = 0;
+        ASSERT_EQ(OK, decryptor.decryptCbcs(kIv, pattern, buffer.data(), buffer.data(),
+                kLargeSubSamples.data(), kLargeSubSamples.size(), &bytesDecrypted));
+        EXPECT_EQ(clear.size(), bytesDecrypted);
+        EXPECT_EQ(clear, buffer);
+    }
+}
+
+} // namespace clearkeydrm
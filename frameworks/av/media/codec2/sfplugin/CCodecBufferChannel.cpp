@@ -194,6 +194,27 @@ status_t CCodecBufferChannel::queueInputBufferInternal(
         sp<MediaCodecBuffer> buffer,
         std::shared_ptr<C2LinearBlock> encryptedBlock,
         size_t blockSize) {
+    std::list<std::unique_ptr<C2Work>> items;
+    PreparedInput prepared;
+    status_t err = prepareInputWork(buffer, encryptedBlock, blockSize, &items, &prepared);
+    if (err != OK) {
+        return err;
+    }
+    c2_status_t c2err = queueWork(&items);
+    if (c2err == C2_OK) {
+        releasePreparedInput(prepared);
+    }
+
+    feedInputBufferIfAvailableInternal();
+    return c2err;
+}
+
+status_t CCodecBufferChannel::prepareInputWork(
+        sp<MediaCodecBuffer> buffer,
+        std::shared_ptr<C2LinearBlock> encryptedBlock,
+        size_t blockSize,
+        std::list<std::unique_ptr<C2Work>> *works,
+        PreparedInput *prepared) {
     int64_t timeUs;
     CHECK(buffer->meta()->findInt64("timeUs", &timeUs));
 
@@ -302,41 +323,48 @@ status_t CCodecBufferChannel::queueInputBufferInternal(
         work->worklets.emplace_back(new C2Worklet);
         items.push_back(std::move(work));
     }
-    c2_status_t err = C2_OK;
-    if (!items.empty()) {
-        {
-            Mutexed<PipelineWatcher>::Locked watcher(mPipelineWatcher);
-            PipelineWatcher::Clock::time_point now = PipelineWatcher::Clock::now();
-            for (const std::unique_ptr<C2Work> &work : items) {
-                watcher->onWorkQueued(
-                        work->input.ordinal.frameIndex.peeku(),
-                        std::vector(work->input.buffers),
-                        now);
-            }
+    prepared->buffer = buffer;
+    prepared->copy = copy;
+    works->splice(works->end(), items);
+    return OK;
+}
+
+c2_status_t CCodecBufferChannel::queueWork(std::list<std::unique_ptr<C2Work>> *items) {
+    if (items->empty()) {
+        return C2_OK;
+    }
+    {
+        Mutexed<PipelineWatcher>::Locked watcher(mPipelineWatcher);
+        PipelineWatcher::Clock::time_point now = PipelineWatcher::Clock::now();
+        for (const std::unique_ptr<C2Work> &work : *items) {
+            watcher->onWorkQueued(
+                    work->input.ordinal.frameIndex.peeku(),
+                    std::vector(work->input.buffers),
+                    now);
         }
-        err = mComponent->queue(&items);
     }
+    c2_status_t err = mComponent->queue(items);
     if (err != C2_OK) {
         Mutexed<PipelineWatcher>::Locked watcher(mPipelineWatcher);
-        for (const std::unique_ptr<C2Work> &work : items) {
+        for (const std::unique_ptr<C2Work> &work : *items) {
             watcher->onWorkDone(work->input.ordinal.frameIndex.peeku());
         }
-    } else {
-        Mutexed<Input>::Locked input(mInput);
-        bool released = false;
-        if (buffer) {
-            released = input->buffers->releaseBuffer(buffer, nullptr, true);
-        } else if (copy) {
-            released = input->extraBuffers.releaseSlot(copy, nullptr, true);
-        }
-        ALOGV("[%s] queueInputBuffer: buffer%s %sreleased",
-              mName, (buffer == nullptr) ? "(copy)" : "", released ? "" : "not ");
     }
-
-    feedInputBufferIfAvailableInternal();
     return err;
 }
 
+void CCodecBufferChannel::releasePreparedInput(const PreparedInput &prepared) {
+    Mutexed<Input>::Locked input(mInput);
+    bool released = false;
+    if (prepared.buffer) {
+        released = input->buffers->releaseBuffer(prepared.buffer, nullptr, true);
+    } else if (prepared.copy) {
+        released = input->extraBuffers.releaseSlot(prepared.copy, nullptr, true);
+    }
+    ALOGV("[%s] queueInputBuffer: buffer%s %sreleased",
+          mName, (prepared.buffer == nullptr) ? "(copy)" : "", released ? "" : "not ");
+}
+
 status_t CCodecBufferChannel::setParameters(std::vector<std::unique_ptr<C2Param>> &params) {
     QueueGuard guard(mSync);
     if (!guard.isRunning()) {
@@ -526,6 +554,43 @@ status_t CCodecBufferChannel::queueInputBuffer(const sp<MediaCodecBuffer> &buffe
     return queueInputBufferInternal(buffer);
 }
 
+status_t CCodecBufferChannel::queueInputBuffers(
+        const std::vector<sp<MediaCodecBuffer>> &buffers, size_t *numQueued) {
+    *numQueued = 0;
+    QueueGuard guard(mSync);
+    if (!guard.isRunning()) {
+        ALOGD("[%s] No more buffers should be queued at current state.", mName);
+        return -ENOSYS;
+    }
+
+    // The works of all the buffers up to the first bad one go to the
+    // component in a single queue() call.
+    status_t err = OK;
+    std::list<std::unique_ptr<C2Work>> items;
+    std::vector<PreparedInput> prepared;
+    prepared.reserve(buffers.size());
+    for (const sp<MediaCodecBuffer> &buffer : buffers) {
+        PreparedInput input;
+        err = prepareInputWork(buffer, nullptr, 0, &items, &input);
+        if (err != OK) {
+            break;
+        }
+        prepared.push_back(input);
+    }
+    c2_status_t c2err = queueWork(&items);
+    if (c2err == C2_OK) {
+        for (const PreparedInput &input : prepared) {
+            releasePreparedInput(input);
+        }
+        *numQueued = prepared.size();
+    } else {
+        err = c2err;
+    }
+
+    feedInputBufferIfAvailableInternal();
+    return err;
+}
+
 status_t CCodecBufferChannel::queueSecureInputBuffer(
         const sp<MediaCodecBuffer> &buffer, bool secure, const uint8_t *key,
         const uint8_t *iv, CryptoPlugin::Mode mode, CryptoPlugin::Pattern pattern,
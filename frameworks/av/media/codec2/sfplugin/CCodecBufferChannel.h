@@ -61,6 +61,8 @@ public:
     void setDescrambler(const sp<IDescrambler> &descrambler) override;
 
     virtual status_t queueInputBuffer(const sp<MediaCodecBuffer> &buffer) override;
+    virtual status_t queueInputBuffers(
+            const std::vector<sp<MediaCodecBuffer>> &buffers, size_t *numQueued) override;
     virtual status_t queueSecureInputBuffer(
             const sp<MediaCodecBuffer> &buffer,
             bool secure,
@@ -242,6 +244,19 @@ private:
     status_t queueInputBufferInternal(sp<MediaCodecBuffer> buffer,
                                       std::shared_ptr<C2LinearBlock> encryptedBlock = nullptr,
                                       size_t blockSize = 0);
+
+    // An input buffer whose work is prepared, to be released once the work is queued.
+    struct PreparedInput {
+        sp<MediaCodecBuffer> buffer;
+        sp<Codec2Buffer> copy;
+    };
+    status_t prepareInputWork(sp<MediaCodecBuffer> buffer,
+                              std::shared_ptr<C2LinearBlock> encryptedBlock,
+                              size_t blockSize,
+                              std::list<std::unique_ptr<C2Work>> *works,
+                              PreparedInput *prepared);
+    c2_status_t queueWork(std::list<std::unique_ptr<C2Work>> *items);
+    void releasePreparedInput(const PreparedInput &prepared);
     bool handleWork(
             std::unique_ptr<C2Work> work, const sp<AMessage> &outputFormat,
             const C2StreamInitDataInfo::output *initData);
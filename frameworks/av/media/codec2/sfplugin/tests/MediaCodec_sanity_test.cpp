@@ -17,6 +17,10 @@
 #include <stdlib.h>
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
 
 #include <binder/ProcessState.h>
 #include <gtest/gtest.h>
@@ -450,4 +454,264 @@ INSTANTIATE_TEST_CASE_P(InputSizes, MediaCodecByteBufferTest, ::testing::Values(
         COLOR_FormatYUV420PackedSemiPlanar,
         COLOR_FormatYUV420Flexible));
 
+// an encoded audio frame, or the codec config
+struct EncodedFrame {
+    std::vector<uint8_t> data;
+    int64_t timeUs;
+    bool csd;
+};
+
+const static int32_t kAudioSampleRate = 48000;
+const static int32_t kAudioChannelCount = 2;
+const static size_t kAudioBatchSize = 16;
+
+// Encodes seconds of a 1 kHz tone, and returns the encoded frames in order.
+static void encodeTone(
+        const sp<ALooper> &looper, const char *encoderName, const char *mime,
+        int32_t seconds, std::vector<EncodedFrame> *frames) {
+    sp<MediaCodec> encoder = MediaCodec::CreateByComponentName(looper, encoderName);
+    ASSERT_NE(encoder, nullptr);
+    sp<AMessage> cfg = new AMessage;
+    cfg->setString("mime", mime);
+    cfg->setInt32("sample-rate", kAudioSampleRate);
+    cfg->setInt32("channel-count", kAudioChannelCount);
+    cfg->setInt32("bitrate", 128000);
+    ASSERT_EQ(encoder->configure(cfg, nullptr, nullptr, MediaCodec::CONFIGURE_FLAG_ENCODE), OK);
+    ASSERT_EQ(encoder->start(), OK);
+
+    const size_t frameSize = kAudioChannelCount * sizeof(int16_t);
+    const size_t numSamples = kAudioSampleRate * seconds;
+    size_t samplesQueued = 0;
+    bool inputEos = false;
+    bool outputEos = false;
+    while (!outputEos) {
+        size_t ix;
+        sp<MediaCodecBuffer> buf;
+        if (!inputEos && encoder->dequeueInputBuffer(&ix, 10000) == OK) {
+            ASSERT_EQ(encoder->getInputBuffer(ix, &buf), OK);
+            size_t samples = std::min({ buf->capacity() / frameSize, (size_t)1024,
+                                        numSamples - samplesQueued });
+            int16_t *pcm = (int16_t *)buf->base();
+            for (size_t i = 0; i < samples; ++i) {
+                int16_t value = 8192 * sin(2 * M_PI * 1000 * (samplesQueued + i)
+                        / kAudioSampleRate);
+                for (int32_t c = 0; c < kAudioChannelCount; ++c) {
+                    *pcm++ = value;
+                }
+            }
+            int64_t timeUs = samplesQueued * 1000000ll / kAudioSampleRate;
+            samplesQueued += samples;
+            inputEos = samplesQueued == numSamples;
+            ASSERT_EQ(encoder->queueInputBuffer(ix, 0, samples * frameSize, timeUs,
+                                                inputEos ? BUFFER_FLAG_END_OF_STREAM : 0), OK);
+        }
+
+        size_t offset, size;
+        int64_t ts;
+        uint32_t flags;
+        status_t err = encoder->dequeueOutputBuffer(&ix, &offset, &size, &ts, &flags, 10000);
+        if (err == -EAGAIN || err == INFO_FORMAT_CHANGED || err == INFO_OUTPUT_BUFFERS_CHANGED) {
+            continue;
+        }
+        ASSERT_EQ(err, OK);
+        ASSERT_EQ(encoder->getOutputBuffer(ix, &buf), OK);
+        if (size > 0) {
+            frames->push_back({ std::vector<uint8_t>(buf->data(), buf->data() + size), ts,
+                                (flags & BUFFER_FLAG_CODEC_CONFIG) != 0 });
+        }
+        outputEos = (flags & BUFFER_FLAG_END_OF_STREAM) != 0;
+        ASSERT_EQ(encoder->releaseOutputBuffer(ix), OK);
+    }
+    encoder->release();
+}
+
+// Decodes the frames through MediaCodec, with up to batchSize buffers in
+// flight per round. The buffers of a round are queued and dequeued with one
+// call each if batch, or one buffer per call if not. Returns the decoded PCM
+// data and the frames decoded per second.
+static void decodeFrames(
+        const sp<MediaCodec> &codec, const std::vector<EncodedFrame> &frames, size_t batchSize,
+        bool batch, std::vector<uint8_t> *pcm, double *framesPerSec) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    size_t next = 0;
+    bool outputEos = false;
+    while (!outputEos) {
+        std::vector<MediaCodec::BufferBatchEntry> entries;
+        size_t ix;
+        sp<MediaCodecBuffer> buf;
+        while (next + entries.size() < frames.size() && entries.size() < batchSize
+                && codec->dequeueInputBuffer(&ix, entries.empty() ? 10000 : 0) == OK) {
+            size_t frameIx = next + entries.size();
+            const EncodedFrame &frame = frames[frameIx];
+            ASSERT_EQ(codec->getInputBuffer(ix, &buf), OK);
+            ASSERT_GE(buf->capacity(), frame.data.size());
+            memcpy(buf->base(), frame.data.data(), frame.data.size());
+            uint32_t flags = frame.csd ? (uint32_t)BUFFER_FLAG_CODEC_CONFIG : 0u;
+            if (frameIx + 1 == frames.size()) {
+                flags |= BUFFER_FLAG_END_OF_STREAM;
+            }
+            entries.push_back({ ix, 0, frame.data.size(), frame.timeUs, flags });
+        }
+        if (batch) {
+            size_t numQueued;
+            ASSERT_EQ(codec->queueInputBuffers(entries, &numQueued), OK);
+            ASSERT_EQ(numQueued, entries.size());
+        } else {
+            for (const MediaCodec::BufferBatchEntry &entry : entries) {
+                ASSERT_EQ(codec->queueInputBuffer(entry.index, entry.offset, entry.size,
+                                                  entry.presentationTimeUs, entry.flags), OK);
+            }
+        }
+        next += entries.size();
+
+        std::vector<MediaCodec::BufferBatchEntry> outputs;
+        status_t err = OK;
+        if (batch) {
+            err = codec->dequeueOutputBuffers(&outputs, batchSize, 10000);
+        } else {
+            MediaCodec::BufferBatchEntry entry;
+            while (outputs.size() < batchSize
+                    && (err = codec->dequeueOutputBuffer(
+                            &entry.index, &entry.offset, &entry.size, &entry.presentationTimeUs,
+                            &entry.flags, outputs.empty() ? 10000 : 0)) == OK) {
+                outputs.push_back(entry);
+            }
+            if (!outputs.empty()) {
+                err = OK;
+            }
+        }
+        if (err == -EAGAIN || err == INFO_FORMAT_CHANGED || err == INFO_OUTPUT_BUFFERS_CHANGED) {
+            continue;
+        }
+        ASSERT_EQ(err, OK);
+        for (const MediaCodec::BufferBatchEntry &output : outputs) {
+            ASSERT_EQ(codec->getOutputBuffer(output.index, &buf), OK);
+            pcm->insert(pcm->end(), buf->data(), buf->data() + output.size);
+            outputEos = outputEos || (output.flags & BUFFER_FLAG_END_OF_STREAM);
+            ASSERT_EQ(codec->releaseOutputBuffer(output.index), OK);
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    *framesPerSec = std::count_if(frames.begin(), frames.end(),
+                                  [](const EncodedFrame &frame) { return !frame.csd; })
+            / elapsed.count();
+}
+
+struct AudioCodecNames {
+    const char *encoder;
+    const char *decoder;
+    const char *mime;
+};
+
+class MediaCodecBatchTest : public MediaCodecSanityTest,
+        public ::testing::WithParamInterface<AudioCodecNames> {
+public:
+    void configureDecoder() {
+        codec = MediaCodec::CreateByComponentName(looper, GetParam().decoder);
+        ASSERT_NE(codec, nullptr);
+        cfg->setString("mime", GetParam().mime);
+        cfg->setInt32("sample-rate", kAudioSampleRate);
+        cfg->setInt32("channel-count", kAudioChannelCount);
+        ASSERT_EQ(codec->configure(cfg, nullptr, nullptr, 0), OK);
+    }
+};
+
+TEST_P(MediaCodecBatchTest, TestBatchMatchesSingle) {
+    std::vector<EncodedFrame> frames;
+    ASSERT_NO_FATAL_FAILURE(encodeTone(looper, GetParam().encoder, GetParam().mime, 10, &frames));
+    ASSERT_FALSE(frames.empty());
+
+    ASSERT_NO_FATAL_FAILURE(configureDecoder());
+    ASSERT_EQ(codec->start(), OK);
+    std::vector<uint8_t> singlePcm;
+    double singleFramesPerSec;
+    ASSERT_NO_FATAL_FAILURE(decodeFrames(
+            codec, frames, kAudioBatchSize, false, &singlePcm, &singleFramesPerSec));
+    ASSERT_EQ(codec->stop(), OK);
+
+    ASSERT_EQ(codec->configure(cfg, nullptr, nullptr, 0), OK);
+    ASSERT_EQ(codec->start(), OK);
+    std::vector<uint8_t> batchPcm;
+    double batchFramesPerSec;
+    ASSERT_NO_FATAL_FAILURE(decodeFrames(
+            codec, frames, kAudioBatchSize, true, &batchPcm, &batchFramesPerSec));
+
+    EXPECT_FALSE(singlePcm.empty());
+    EXPECT_EQ(singlePcm, batchPcm);
+
+    RecordProperty("singleFramesPerSec", (int)singleFramesPerSec);
+    RecordProperty("batchFramesPerSec", (int)batchFramesPerSec);
+}
+
+// Measures how many frames per second go through MediaCodec and the codec
+// buffer channel, one buffer per call and in batches of increasing size.
+TEST_P(MediaCodecBatchTest, TestBatchThroughput) {
+    std::vector<EncodedFrame> frames;
+    ASSERT_NO_FATAL_FAILURE(encodeTone(looper, GetParam().encoder, GetParam().mime, 30, &frames));
+    ASSERT_FALSE(frames.empty());
+
+    ASSERT_NO_FATAL_FAILURE(configureDecoder());
+    for (size_t batchSize : { (size_t)1, (size_t)4, kAudioBatchSize }) {
+        if (batchSize > 1) {
+            ASSERT_EQ(codec->configure(cfg, nullptr, nullptr, 0), OK);
+        }
+        ASSERT_EQ(codec->start(), OK);
+        std::vector<uint8_t> pcm;
+        double framesPerSec;
+        ASSERT_NO_FATAL_FAILURE(
+                decodeFrames(codec, frames, batchSize, batchSize > 1, &pcm, &framesPerSec));
+        ASSERT_EQ(codec->stop(), OK);
+        EXPECT_FALSE(pcm.empty());
+
+        RecordProperty("framesPerSecBatch" + std::to_string(batchSize), (int)framesPerSec);
+    }
+}
+
+TEST_P(MediaCodecBatchTest, TestBatchStopsAtBadIndex) {
+    std::vector<EncodedFrame> frames;
+    ASSERT_NO_FATAL_FAILURE(encodeTone(looper, GetParam().encoder, GetParam().mime, 1, &frames));
+    ASSERT_GE(frames.size(), 4u);
+    ASSERT_TRUE(frames[0].csd);
+
+    ASSERT_NO_FATAL_FAILURE(configureDecoder());
+    ASSERT_EQ(codec->start(), OK);
+
+    // the codec config and two frames, then an index the codec does not have
+    std::vector<MediaCodec::BufferBatchEntry> entries;
+    sp<MediaCodecBuffer> buf;
+    for (size_t i = 0; i < 3; ++i) {
+        size_t ix;
+        ASSERT_EQ(codec->dequeueInputBuffer(&ix, 1000000), OK);
+        ASSERT_EQ(codec->getInputBuffer(ix, &buf), OK);
+        memcpy(buf->base(), frames[i].data.data(), frames[i].data.size());
+        entries.push_back({ ix, 0, frames[i].data.size(), frames[i].timeUs,
+                            frames[i].csd ? (uint32_t)BUFFER_FLAG_CODEC_CONFIG : 0u });
+    }
+    entries.push_back({ 1000, 0, frames[3].data.size(), frames[3].timeUs, 0 });
+    size_t numQueued;
+    EXPECT_EQ(codec->queueInputBuffers(entries, &numQueued), -ERANGE);
+    EXPECT_EQ(numQueued, 3u);
+
+    // the queued frames still decode
+    std::vector<MediaCodec::BufferBatchEntry> outputs;
+    size_t decoded = 0;
+    for (int tries = 0; tries < 100 && decoded == 0; ++tries) {
+        status_t err = codec->dequeueOutputBuffers(&outputs, kAudioBatchSize, 10000);
+        if (err == -EAGAIN || err == INFO_FORMAT_CHANGED || err == INFO_OUTPUT_BUFFERS_CHANGED) {
+            continue;
+        }
+        ASSERT_EQ(err, OK);
+        for (const MediaCodec::BufferBatchEntry &output : outputs) {
+            decoded += output.size;
+            ASSERT_EQ(codec->releaseOutputBuffer(output.index), OK);
+        }
+    }
+    EXPECT_GT(decoded, 0u);
+}
+
+INSTANTIATE_TEST_CASE_P(AudioCodecs, MediaCodecBatchTest, ::testing::Values(
+        AudioCodecNames{ "c2.android.aac.encoder", "c2.android.aac.decoder", MIMETYPE_AUDIO_AAC },
+        AudioCodecNames{ "c2.android.opus.encoder", "c2.android.opus.decoder",
+                         MIMETYPE_AUDIO_OPUS }));
+
 } // namespace android
@@ -38,13 +38,41 @@
 
 #include <arpa/inet.h>
 #include <inttypes.h>
+#include <algorithm>
 #include <vector>
 
 namespace android {
 
+// Reads the source through a couple of windows kept in memory, so that the many
+// small reads mkvparser makes while parsing, and the reads of the blocks of a
+// cluster, don't each go to the data source.
 struct DataSourceBaseReader : public mkvparser::IMkvReader {
     explicit DataSourceBaseReader(DataSourceHelper *source)
-        : mSource(source) {
+        : mSource(source),
+          mReadAhead(false),
+          mUseCount(0) {
+    }
+
+    // Reading ahead waits for data that may not be there yet in a live stream,
+    // so it is off until enabled.
+    void setReadAhead(bool readAhead) {
+        Mutex::Autolock autoLock(mLock);
+        mReadAhead = readAhead;
+    }
+
+    // Reads the range, typically a whole cluster, into a window ahead of the
+    // reads within it. A length that is not known reads as much as fits.
+    void prefetch(long long position, long long length) {
+        Mutex::Autolock autoLock(mLock);
+        if (!mReadAhead || position < 0) {
+            return;
+        }
+        if (length <= 0 || length > kMaxReadAheadSize) {
+            length = kMaxReadAheadSize;
+        }
+        if (findWindow_l(position, length) == NULL) {
+            fillWindow_l(position, length);
+        }
     }
 
     virtual int Read(long long position, long length, unsigned char* buffer) {
@@ -55,6 +83,19 @@ struct DataSourceBaseReader : public mkvparser::IMkvReader {
             return 0;
         }
 
+        Mutex::Autolock autoLock(mLock);
+        if (mReadAhead && length <= kMaxReadAheadSize) {
+            Window *window = findWindow_l(position, length);
+            if (window == NULL) {
+                fillWindow_l(position, std::max(length, kReadAheadSize));
+                window = findWindow_l(position, length);
+            }
+            if (window != NULL) {
+                memcpy(buffer, window->mData.data() + (position - window->mOffset), length);
+                return 0;
+            }
+        }
+
         ssize_t n = mSource->readAt(position, buffer, length);
 
         if (n <= 0) {
@@ -89,8 +130,65 @@ struct DataSourceBaseReader : public mkvparser::IMkvReader {
     }
 
 private:
+    enum {
+        kNumWindows = 2,  // one each for audio and video reading apart
+    };
+    static constexpr long kReadAheadSize = 128 * 1024;
+    static constexpr long kMaxReadAheadSize = 512 * 1024;
+
+    struct Window {
+        Window() : mOffset(0), mSize(0), mLastUse(0) {}
+
+        long long mOffset;
+        long long mSize;
+        uint64_t mLastUse;
+        std::vector<uint8_t> mData;  // kept from fill to fill
+    };
+
     DataSourceHelper *mSource;
 
+    Mutex mLock;
+    bool mReadAhead;
+    uint64_t mUseCount;
+    Window mWindows[kNumWindows];
+
+    Window *findWindow_l(long long position, long long length) {
+        for (Window &window : mWindows) {
+            if (position >= window.mOffset
+                    && position + length <= window.mOffset + window.mSize) {
+                window.mLastUse = ++mUseCount;
+                return &window;
+            }
+        }
+        return NULL;
+    }
+
+    // Refills the least recently used window. At the end of the source the
+    // window holds what there is.
+    void fillWindow_l(long long position, long long length) {
+        off64_t size;
+        if (mSource->getSize(&size) == OK) {
+            if (position >= size) {
+                return;
+            }
+            length = std::min<long long>(length, size - position);
+        }
+
+        Window *window = &mWindows[0];
+        for (Window &candidate : mWindows) {
+            if (candidate.mLastUse < window->mLastUse) {
+                window = &candidate;
+            }
+        }
+        if (window->mData.size() < (size_t)length) {
+            window->mData.resize(length);
+        }
+        ssize_t n = mSource->readAt(position, window->mData.data(), length);
+        window->mOffset = position;
+        window->mSize = n > 0 ? n : 0;
+        window->mLastUse = ++mUseCount;
+    }
+
     DataSourceBaseReader(const DataSourceBaseReader &);
     DataSourceBaseReader &operator=(const DataSourceBaseReader &);
 };
@@ -388,6 +486,7 @@ void BlockIterator::advance_l() {
             CHECK(!nextCluster->EOS());
 
             mCluster = nextCluster;
+            mExtractor->prefetchCluster_l(mCluster);
 
             res = mCluster->Parse(pos, len);
             ALOGV("Parse (2) returned %ld", res);
@@ -401,6 +500,7 @@ void BlockIterator::advance_l() {
                 break;
             }
 
+            mExtractor->indexCluster_l(mCluster);
             mBlockEntryIndex = 0;
             continue;
         }
@@ -494,6 +594,8 @@ void BlockIterator::seek(
         return;
     }
 
+    // The Cues are loaded in full on the first seek, and seeks after it search
+    // what was loaded.
     const mkvparser::CuePoint* pCP;
     mkvparser::Tracks const *pTracks = pSegment->GetTracks();
     while (!pCues->DoneParsing()) {
@@ -511,11 +613,7 @@ void BlockIterator::seek(
                 track.mCuePoints.push_back(pCP);
             }
         }
-
-        if (pCP->GetTime(pSegment) >= seekTimeNs) {
-            ALOGV("Parsed past relevant Cue");
-            break;
-        }
+        mExtractor->indexCuePoint_l(pCP);
     }
 
     const mkvparser::CuePoint::TrackPosition *pTP = NULL;
@@ -547,6 +645,7 @@ void BlockIterator::seek(
 
     CHECK(mCluster);
     CHECK(!mCluster->EOS());
+    mExtractor->prefetchCluster_l(mCluster);
 
     // mBlockEntryIndex starts at 0 but m_block starts at 1
     CHECK_GT(pTP->m_block, 0);
@@ -584,7 +683,8 @@ int64_t BlockIterator::blockTimeUs() const {
 }
 
 void BlockIterator::seekwithoutcue_l(int64_t seekTimeUs, int64_t *actualFrameTimeUs) {
-    mCluster = mExtractor->mSegment->FindCluster(seekTimeUs * 1000ll);
+    mCluster = mExtractor->findCluster_l(seekTimeUs * 1000ll);
+    mExtractor->prefetchCluster_l(mCluster);
     const long status = mCluster->GetFirst(mBlockEntry);
     if (status < 0) {  // error
         ALOGE("get last blockenry failed!");
@@ -1325,7 +1425,8 @@ static const char *MKVFourCC2MIME(uint32_t fourcc) {
 
 
 MatroskaExtractor::MatroskaExtractor(DataSourceHelper *source)
-    : mDataSource(source),
+    : mClusterIndexValid(true),
+      mDataSource(source),
       mReader(new DataSourceBaseReader(mDataSource)),
       mSegment(NULL),
       mExtractedThumbnails(false),
@@ -1337,6 +1438,7 @@ MatroskaExtractor::MatroskaExtractor(DataSourceHelper *source)
             & (DataSourceBase::kWantsPrefetching
                 | DataSourceBase::kIsCachingDataSource))
         && mDataSource->getSize(&size) != OK;
+    mReader->setReadAhead(!mIsLiveStreaming);
 
     mkvparser::EBMLHeader ebmlHeader;
     long long pos;
@@ -1479,6 +1581,85 @@ bool MatroskaExtractor::isLiveStreaming() const {
     return mIsLiveStreaming;
 }
 
+void MatroskaExtractor::addClusterPosition_l(int64_t timeNs, int64_t pos) {
+    if (!mClusterIndexValid || timeNs < 0 || pos < 0) {
+        return;
+    }
+
+    std::vector<ClusterPosition>::iterator it = std::lower_bound(
+            mClusterIndex.begin(), mClusterIndex.end(), pos,
+            [](const ClusterPosition &entry, int64_t value) { return entry.mPos < value; });
+    if (it != mClusterIndex.end() && it->mPos == pos) {
+        // The earliest time known for a cluster is the closest to its start.
+        if (timeNs >= it->mTimeNs) {
+            return;
+        }
+        it->mTimeNs = timeNs;
+    } else {
+        it = mClusterIndex.insert(it, ClusterPosition{timeNs, pos});
+    }
+
+    if ((it != mClusterIndex.begin() && (it - 1)->mTimeNs > it->mTimeNs)
+            || (it + 1 != mClusterIndex.end() && (it + 1)->mTimeNs < it->mTimeNs)) {
+        ALOGW("cluster times out of order, not indexing clusters");
+        mClusterIndex.clear();
+        mClusterIndexValid = false;
+    }
+}
+
+void MatroskaExtractor::indexCuePoint_l(const mkvparser::CuePoint *cuePoint) {
+    const long long timeNs = cuePoint->GetTime(mSegment);
+    for (size_t i = 0; i < mTracks.size(); ++i) {
+        const mkvparser::Track *track = mTracks.itemAt(i).getTrack();
+        const mkvparser::CuePoint::TrackPosition *position =
+                track != NULL ? cuePoint->Find(track) : NULL;
+        if (position != NULL) {
+            addClusterPosition_l(timeNs, position->m_pos);
+        }
+    }
+}
+
+void MatroskaExtractor::indexCluster_l(const mkvparser::Cluster *cluster) {
+    if (cluster == NULL || cluster->EOS()) {
+        return;
+    }
+    addClusterPosition_l(cluster->GetTime(), cluster->GetPosition());
+}
+
+void MatroskaExtractor::prefetchCluster_l(const mkvparser::Cluster *cluster) {
+    if (cluster == NULL || cluster->EOS()) {
+        return;
+    }
+    mReader->prefetch(cluster->m_element_start, cluster->GetElementSize());
+}
+
+// Returns the cluster to walk from to reach timeNs: the later of the one the
+// loaded clusters give and the one the cluster index gives, so that a seek
+// does not walk the clusters the index already knows about.
+const mkvparser::Cluster *MatroskaExtractor::findCluster_l(int64_t timeNs) {
+    const mkvparser::Cluster *cluster = mSegment->FindCluster(timeNs);
+
+    std::vector<ClusterPosition>::const_iterator it = std::upper_bound(
+            mClusterIndex.begin(), mClusterIndex.end(), timeNs,
+            [](int64_t value, const ClusterPosition &entry) { return value < entry.mTimeNs; });
+    if (it == mClusterIndex.begin()) {
+        return cluster;
+    }
+    --it;
+    if (cluster != NULL && !cluster->EOS() && cluster->GetTime() <= timeNs
+            && cluster->GetPosition() >= it->mPos) {
+        return cluster;
+    }
+
+    const mkvparser::Cluster *indexed = mSegment->FindOrPreloadCluster(it->mPos);
+    if (indexed == NULL || indexed->EOS()) {
+        return cluster;
+    }
+    ALOGV("seeking from indexed cluster @%lld for %lld ns",
+            (long long)it->mPos, (long long)timeNs);
+    return indexed;
+}
+
 static int bytesForSize(size_t size) {
     // use at most 28 bits (4 times 7)
     CHECK(size <= 0xfffffff);
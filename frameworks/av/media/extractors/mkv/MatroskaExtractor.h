@@ -26,6 +26,8 @@
 #include <utils/Vector.h>
 #include <utils/threads.h>
 
+#include <vector>
+
 namespace android {
 
 struct AMessage;
@@ -81,9 +83,21 @@ private:
         const mkvparser::CuePoint::TrackPosition *find(long long timeNs) const;
     };
 
+    // A cluster known from the Cues or from having been parsed, with a time no
+    // earlier than its start.
+    struct ClusterPosition {
+        int64_t mTimeNs;
+        int64_t mPos;  // relative to the segment, as in the Cues
+    };
+
     Mutex mLock;
     Vector<TrackInfo> mTracks;
 
+    // Clusters seen so far in this session, ordered by position and by time.
+    // Cleared for good if the two orders ever disagree.
+    std::vector<ClusterPosition> mClusterIndex;
+    bool mClusterIndexValid;
+
     DataSourceHelper *mDataSource;
     DataSourceBaseReader *mReader;
     mkvparser::Segment *mSegment;
@@ -106,6 +120,12 @@ private:
             AMediaFormat *meta);
     bool isLiveStreaming() const;
 
+    void addClusterPosition_l(int64_t timeNs, int64_t pos);
+    void indexCuePoint_l(const mkvparser::CuePoint *cuePoint);
+    void indexCluster_l(const mkvparser::Cluster *cluster);
+    void prefetchCluster_l(const mkvparser::Cluster *cluster);
+    const mkvparser::Cluster *findCluster_l(int64_t timeNs);
+
     MatroskaExtractor(const MatroskaExtractor &);
     MatroskaExtractor &operator=(const MatroskaExtractor &);
 };
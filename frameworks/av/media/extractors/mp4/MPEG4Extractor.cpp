@@ -212,6 +212,7 @@ private:
         size_t size;
         uint32_t duration;
         int32_t compositionOffset;
+        bool isSync;  // known to be a sync sample from its sample flags
         uint8_t iv[16];
         Vector<uint32_t> clearsizes;
         Vector<uint32_t> encryptedsizes;
@@ -5784,6 +5785,9 @@ status_t MPEG4Source::parseTrackFragmentRun(off64_t offset, off64_t size) {
         kSampleCompositionTimeOffsetPresent = 0x800,
     };
 
+    // See 14496-12 8.8.3.1, the sample_is_non_sync_sample bit of sample flags.
+    static constexpr uint32_t kSampleIsNonSyncSample = 0x10000;
+
     uint32_t flags;
     if (!mDataSource->getUInt32(offset, &flags)) {
         return ERROR_MALFORMED;
@@ -5948,6 +5952,14 @@ status_t MPEG4Source::parseTrackFragmentRun(off64_t offset, off64_t size) {
         tmp.size = sampleSize;
         tmp.duration = sampleDuration;
         tmp.compositionOffset = sampleCtsOffset;
+        if ((flags & kFirstSampleFlagsPresent) && i == 0) {
+            tmp.isSync = !(firstSampleFlags & kSampleIsNonSyncSample);
+        } else if ((flags & kSampleFlagsPresent) || (mTrackFragmentHeaderInfo.mFlags
+                & TrackFragmentHeaderInfo::kDefaultSampleFlagsPresent)) {
+            tmp.isSync = !(sampleFlags & kSampleIsNonSyncSample);
+        } else {
+            tmp.isSync = false;
+        }
         memset(tmp.iv, 0, sizeof(tmp.iv));
         if (mCurrentSamples.add(tmp) < 0) {
             ALOGW("b/123389881 failed saving sample(n=%zu)", mCurrentSamples.size());
@@ -6595,7 +6607,7 @@ media_status_t MPEG4Source::fragmentedRead(
         }
 
         mCurrentTime += smpl->duration;
-        isSyncSample = (mCurrentSampleIndex == 0);
+        isSyncSample = (mCurrentSampleIndex == 0) || smpl->isSync;
 
         status_t err = mBufferGroup->acquire_buffer(&mBuffer);
 
@@ -826,6 +826,117 @@ TEST_P(ExtractorFunctionalityTest, MonkeySeekTest) {
     }
 }
 
+// Seeks the track and reads the sample it lands on
+media_status_t readAfterSeek(MediaTrackHelper *track, int64_t seekTimeUs, int64_t *timeUs,
+                             vector<uint8_t> *data) {
+    MediaTrackHelper::ReadOptions options(
+            CMediaTrackReadOptions::SEEK_PREVIOUS_SYNC | CMediaTrackReadOptions::SEEK, seekTimeUs);
+    MediaBufferHelper *buffer = nullptr;
+    media_status_t status = track->read(&buffer, &options);
+    if (status != AMEDIA_OK || !buffer) return status;
+
+    if (!AMediaFormat_getInt64(buffer->meta_data(), AMEDIAFORMAT_KEY_TIME_US, timeUs)) {
+        *timeUs = kUndefined;
+    }
+    const uint8_t *sample = (const uint8_t *)buffer->data() + buffer->range_offset();
+    data->assign(sample, sample + buffer->range_length());
+    buffer->release();
+    return AMEDIA_OK;
+}
+
+// Validates that a seek lands on the same sample whatever the extractor read or
+// sought before. The Matroska extractor indexes the clusters it comes across and
+// reads them ahead, which must not change where seeks land.
+TEST_P(ExtractorFunctionalityTest, SeekConsistencyTest) {
+    if (mDisableTest) return;
+    if (mExtractorName != MKV) return;
+
+    ALOGV("Validates %s Extractor seeks after other seeks", mContainer.c_str());
+    string inputFileName = gEnv->getRes() + get<1>(GetParam());
+
+    int32_t status = setDataSource(inputFileName);
+    ASSERT_EQ(status, 0) << "SetDataSource failed for" << mContainer << "extractor";
+
+    status = createExtractor();
+    ASSERT_EQ(status, 0) << "Extractor creation failed for" << mContainer << "extractor";
+
+    int32_t numTracks = mExtractor->countTracks();
+    ASSERT_EQ(numTracks, mNumTracks)
+            << "Extractor reported wrong number of track for the given clip";
+
+    for (int32_t idx = 0; idx < numTracks; idx++) {
+        AMediaFormat *trackMeta = AMediaFormat_new();
+        ASSERT_NE(trackMeta, nullptr) << "AMediaFormat_new returned null AMediaformat";
+        status = mExtractor->getTrackMetaData(trackMeta, idx, 0);
+        ASSERT_EQ(OK, (media_status_t)status) << "Failed to get trackMetaData";
+        int64_t clipDuration = 0;
+        AMediaFormat_getInt64(trackMeta, AMEDIAFORMAT_KEY_DURATION, &clipDuration);
+        AMediaFormat_delete(trackMeta);
+        ASSERT_GT(clipDuration, 0) << "Invalid clip duration ";
+
+        // Where each seek lands in an extractor that has not sought before
+        vector<int64_t> seekTimesUs;
+        vector<int64_t> expectedTimesUs;
+        vector<vector<uint8_t>> expectedData;
+        for (int32_t seekCount = 1; seekCount <= kMaxCount; seekCount++) {
+            int64_t seekTimeUs = clipDuration * seekCount / (kMaxCount + 1);
+            MediaExtractorPluginHelper *extractor =
+                    new MatroskaExtractor(new DataSourceHelper(mDataSource->wrap()));
+            MediaTrackHelper *track = extractor->getTrack(idx);
+            ASSERT_NE(track, nullptr) << "Failed to get track for index " << idx;
+            CMediaTrack *cTrack = wrap(track);
+            ASSERT_NE(cTrack, nullptr) << "Failed to get track wrapper for index " << idx;
+            MediaBufferGroup *bufferGroup = new MediaBufferGroup();
+            status = cTrack->start(track, bufferGroup->wrap());
+            ASSERT_EQ(OK, (media_status_t)status) << "Failed to start the track";
+
+            int64_t timeUs = kUndefined;
+            vector<uint8_t> data;
+            if (readAfterSeek(track, seekTimeUs, &timeUs, &data) == AMEDIA_OK) {
+                seekTimesUs.push_back(seekTimeUs);
+                expectedTimesUs.push_back(timeUs);
+                expectedData.push_back(data);
+            }
+
+            status = cTrack->stop(track);
+            ASSERT_EQ(OK, status) << "Failed to stop the track";
+            delete bufferGroup;
+            delete track;
+            delete extractor;
+        }
+        ASSERT_GT(seekTimesUs.size(), 0) << "No seek succeeded on track " << idx;
+
+        // The same seeks backwards then forwards in one extractor, each one after
+        // the extractor has seen more of the file
+        MediaTrackHelper *track = mExtractor->getTrack(idx);
+        ASSERT_NE(track, nullptr) << "Failed to get track for index " << idx;
+        CMediaTrack *cTrack = wrap(track);
+        ASSERT_NE(cTrack, nullptr) << "Failed to get track wrapper for index " << idx;
+        MediaBufferGroup *bufferGroup = new MediaBufferGroup();
+        status = cTrack->start(track, bufferGroup->wrap());
+        ASSERT_EQ(OK, (media_status_t)status) << "Failed to start the track";
+
+        vector<size_t> order;
+        for (size_t i = seekTimesUs.size(); i > 0; i--) order.push_back(i - 1);
+        for (size_t i = 0; i < seekTimesUs.size(); i++) order.push_back(i);
+        for (size_t i : order) {
+            int64_t timeUs = kUndefined;
+            vector<uint8_t> data;
+            ASSERT_EQ(AMEDIA_OK, readAfterSeek(track, seekTimesUs[i], &timeUs, &data))
+                    << "Seek to " << seekTimesUs[i] << " failed";
+            EXPECT_EQ(expectedTimesUs[i], timeUs)
+                    << "Seek to " << seekTimesUs[i] << " landed on a different sample";
+            EXPECT_TRUE(expectedData[i] == data)
+                    << "Seek to " << seekTimesUs[i] << " read different sample data";
+        }
+
+        status = cTrack->stop(track);
+        ASSERT_EQ(OK, status) << "Failed to stop the track";
+        delete bufferGroup;
+        delete track;
+    }
+}
+
 // Tests extractors for invalid tracks
 TEST_P(ExtractorFunctionalityTest, SanityTest) {
     if (mDisableTest) return;
@@ -0,0 +1,343 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "NBLog"
+//#define LOG_NDEBUG 0
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include <media/nblog/BinaryLog.h>
+#include <media/nblog/Entry.h>
+#include <media/nblog/Events.h>
+#include <media/nblog/Reader.h>
+#include <utils/Log.h>
+
+namespace android {
+namespace NBLog {
+
+// ---------------------------------------------------------------------------
+
+SnapshotMerger::SnapshotMerger(const std::vector<const Snapshot *> &snapshots)
+{
+    mHeap.reserve(snapshots.size());
+    for (size_t i = 0; i < snapshots.size(); ++i) {
+        if (snapshots[i] == nullptr) {
+            continue;
+        }
+        Cursor cursor;
+        cursor.record.timestamp = 0;
+        cursor.record.author = i;
+        cursor.record.end = snapshots[i]->begin();
+        cursor.snapshotEnd = snapshots[i]->end();
+        if (advance(cursor)) {
+            mHeap.push_back(cursor);
+        }
+    }
+    for (size_t i = mHeap.size() / 2; i > 0; --i) {
+        siftDown(i - 1);
+    }
+}
+
+bool SnapshotMerger::advance(Cursor &cursor)
+{
+    LogRecord &record = cursor.record;
+    EntryIterator it = record.end;
+    if (!(it != cursor.snapshotEnd)) {
+        return false;
+    }
+    record.begin = it;
+    switch (it->type) {
+    case EVENT_FMT_START: {
+        ++it;
+        if (it != cursor.snapshotEnd && it->type == EVENT_FMT_TIMESTAMP) {
+            record.timestamp = it.payload<int64_t>();
+        }
+        // Snapshot::end() is aligned to entries that cannot be part of a format entry,
+        // so a format entry is never truncated by the end of a snapshot.
+        while (it != cursor.snapshotEnd && it->type != EVENT_FMT_END) {
+            ++it;
+        }
+        if (it != cursor.snapshotEnd) {
+            ++it;
+        }
+        record.end = it;
+        return true;
+    }
+    case EVENT_HISTOGRAM_ENTRY_TS:
+    case EVENT_AUDIO_STATE:
+        record.timestamp = it.payload<HistTsEntry>().ts;
+        break;
+    case EVENT_OVERRUN:
+    case EVENT_UNDERRUN:
+        record.timestamp = it.payload<int64_t>();
+        break;
+    default:
+        // Keep the timestamp of the previous record.
+        break;
+    }
+    record.end = it.next();
+    return true;
+}
+
+bool SnapshotMerger::before(const Cursor &a, const Cursor &b)
+{
+    return a.record.timestamp < b.record.timestamp ||
+            (a.record.timestamp == b.record.timestamp && a.record.author < b.record.author);
+}
+
+void SnapshotMerger::siftDown(size_t index)
+{
+    const size_t size = mHeap.size();
+    Cursor cursor = mHeap[index];
+    for (;;) {
+        size_t child = 2 * index + 1;
+        if (child >= size) {
+            break;
+        }
+        if (child + 1 < size && before(mHeap[child + 1], mHeap[child])) {
+            ++child;
+        }
+        if (!before(mHeap[child], cursor)) {
+            break;
+        }
+        mHeap[index] = mHeap[child];
+        index = child;
+    }
+    mHeap[index] = cursor;
+}
+
+size_t SnapshotMerger::merge(const std::function<void(const LogRecord &)> &onRecord)
+{
+    size_t count = 0;
+    while (!mHeap.empty()) {
+        Cursor &top = mHeap[0];
+        // The runner-up is the smaller child of the top. Nothing moves in the heap while the
+        // top emits its batch, so the pointer stays valid.
+        const Cursor *next = nullptr;
+        if (mHeap.size() > 2) {
+            next = before(mHeap[1], mHeap[2]) ? &mHeap[1] : &mHeap[2];
+        } else if (mHeap.size() > 1) {
+            next = &mHeap[1];
+        }
+        bool exhausted = false;
+        do {
+            onRecord(top.record);
+            ++count;
+            if (!advance(top)) {
+                exhausted = true;
+                break;
+            }
+        } while (next == nullptr || !before(*next, top));
+
+        if (exhausted) {
+            mHeap[0] = mHeap.back();
+            mHeap.pop_back();
+        }
+        if (!mHeap.empty()) {
+            siftDown(0);
+        }
+    }
+    return count;
+}
+
+// ---------------------------------------------------------------------------
+
+namespace {
+
+// All supported ABIs are little endian, so integers are written in native byte order.
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "NBLog binary log is little endian");
+
+// Size of the buffer accumulating the log before it is written to the file descriptor.
+constexpr size_t kWriteBufferSize = 64 * 1024;
+
+// Size of the fixed part of a record: timestamp, author and length.
+constexpr size_t kRecordHeaderSize = sizeof(int64_t) + 2 * sizeof(uint32_t);
+
+class BufferedWriter {
+public:
+    explicit BufferedWriter(int fd) : mFd(fd) { mBuffer.reserve(kWriteBufferSize); }
+
+    template <typename T>
+    void append(const T &value)
+    {
+        append(&value, sizeof(value));
+    }
+
+    void append(const void *data, size_t size)
+    {
+        if (mBuffer.size() + size > kWriteBufferSize) {
+            flush();
+        }
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        mBuffer.insert(mBuffer.end(), bytes, bytes + size);
+    }
+
+    status_t flush()
+    {
+        const uint8_t *data = mBuffer.data();
+        size_t remaining = mBuffer.size();
+        while (mStatus == NO_ERROR && remaining > 0) {
+            const ssize_t written = TEMP_FAILURE_RETRY(write(mFd, data, remaining));
+            if (written < 0) {
+                mStatus = -errno;
+                ALOGW("%s: write failed: %s", __func__, strerror(errno));
+                break;
+            }
+            data += written;
+            remaining -= written;
+        }
+        mBuffer.clear();
+        return mStatus;
+    }
+
+    status_t status() const { return mStatus; }
+
+private:
+    const int mFd;
+    std::vector<uint8_t> mBuffer;
+    status_t mStatus = NO_ERROR;
+};
+
+template <typename T>
+bool read(const uint8_t *&data, const uint8_t *end, T *value)
+{
+    if (static_cast<size_t>(end - data) < sizeof(*value)) {
+        return false;
+    }
+    memcpy(value, data, sizeof(*value));
+    data += sizeof(*value);
+    return true;
+}
+
+// Checks that [begin, end) is a sequence of well formed entries.
+bool isValidEntrySequence(const uint8_t *begin, const uint8_t *end)
+{
+    if (begin == end) {
+        return false;
+    }
+    while (begin != end) {
+        if (static_cast<size_t>(end - begin) < Entry::kOverhead) {
+            return false;
+        }
+        const EntryIterator it(begin);
+        const size_t entrySize = it->length + Entry::kOverhead;
+        if (static_cast<size_t>(end - begin) < entrySize || !it.hasConsistentLength()) {
+            return false;
+        }
+        begin += entrySize;
+    }
+    return true;
+}
+
+}   // namespace
+
+status_t writeBinaryLog(int fd, const std::vector<std::string> &names,
+                        const std::vector<const Snapshot *> &snapshots, size_t *numRecords)
+{
+    if (fd < 0 || names.size() != snapshots.size()) {
+        return BAD_VALUE;
+    }
+    BufferedWriter writer(fd);
+    writer.append(kBinaryLogMagic, sizeof(kBinaryLogMagic));
+    writer.append(kBinaryLogVersion);
+    writer.append(static_cast<uint32_t>(names.size()));
+    for (const std::string &name : names) {
+        writer.append(static_cast<uint32_t>(name.size()));
+        writer.append(name.data(), name.size());
+    }
+
+    SnapshotMerger merger(snapshots);
+    const size_t count = merger.merge([&writer](const LogRecord &record) {
+        if (writer.status() != NO_ERROR) {
+            return;
+        }
+        const uint32_t length = record.end - record.begin;
+        writer.append(record.timestamp);
+        writer.append(static_cast<uint32_t>(record.author));
+        writer.append(length);
+        writer.append(static_cast<const uint8_t *>(record.begin), length);
+    });
+    const status_t status = writer.flush();
+    if (numRecords != nullptr) {
+        *numRecords = status == NO_ERROR ? count : 0;
+    }
+    return status;
+}
+
+status_t readBinaryLog(const uint8_t *data, size_t size, std::vector<std::string> *names,
+                       const std::function<void(const LogRecord &)> &onRecord)
+{
+    if (data == nullptr || names == nullptr) {
+        return BAD_VALUE;
+    }
+    const uint8_t *const end = data + size;
+    char magic[sizeof(kBinaryLogMagic)];
+    uint32_t version;
+    uint32_t numAuthors;
+    if (!read(data, end, &magic) || memcmp(magic, kBinaryLogMagic, sizeof(magic)) != 0) {
+        ALOGW("%s: not a binary NBLog", __func__);
+        return BAD_VALUE;
+    }
+    if (!read(data, end, &version) || version != kBinaryLogVersion) {
+        ALOGW("%s: unsupported version", __func__);
+        return BAD_VALUE;
+    }
+    if (!read(data, end, &numAuthors)) {
+        return BAD_VALUE;
+    }
+    names->clear();
+    for (uint32_t i = 0; i < numAuthors; ++i) {
+        uint32_t length;
+        if (!read(data, end, &length) || static_cast<size_t>(end - data) < length) {
+            return BAD_VALUE;
+        }
+        names->emplace_back(reinterpret_cast<const char *>(data), length);
+        data += length;
+    }
+
+    while (data != end) {
+        if (static_cast<size_t>(end - data) < kRecordHeaderSize) {
+            ALOGW("%s: truncated record header", __func__);
+            return BAD_VALUE;
+        }
+        LogRecord record;
+        uint32_t author;
+        uint32_t length;
+        read(data, end, &record.timestamp);
+        read(data, end, &author);
+        read(data, end, &length);
+        if (author >= numAuthors || static_cast<size_t>(end - data) < length
+                || !isValidEntrySequence(data, data + length)) {
+            ALOGW("%s: malformed record", __func__);
+            return BAD_VALUE;
+        }
+        record.author = author;
+        record.begin = EntryIterator(data);
+        record.end = EntryIterator(data + length);
+        onRecord(record);
+        data += length;
+    }
+    return NO_ERROR;
+}
+
+}   // namespace NBLog
+}   // namespace android
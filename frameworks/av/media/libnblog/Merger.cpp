@@ -18,13 +18,13 @@
 //#define LOG_NDEBUG 0
 
 #include <memory>
-#include <queue>
 #include <stddef.h>
 #include <stdint.h>
 #include <vector>
 
 #include <audio_utils/fifo.h>
 #include <json/json.h>
+#include <media/nblog/BinaryLog.h>
 #include <media/nblog/Merger.h>
 #include <media/nblog/PerformanceAnalysis.h>
 #include <media/nblog/ReportPerformance.h>
@@ -59,20 +59,6 @@ void Merger::addReader(const sp<Reader> &reader)
     mReaders.push_back(reader);
 }
 
-// items placed in priority queue during merge
-// composed by a timestamp and the index of the snapshot where the timestamp came from
-struct MergeItem
-{
-    int64_t ts;
-    int index;
-    MergeItem(int64_t ts, int index): ts(ts), index(index) {}
-};
-
-bool operator>(const struct MergeItem &i1, const struct MergeItem &i2)
-{
-    return i1.ts > i2.ts || (i1.ts == i2.ts && i1.index > i2.index);
-}
-
 // Merge registered readers, sorted by timestamp, and write data to a single FIFO in local memory
 void Merger::merge()
 {
@@ -80,39 +66,28 @@ void Merger::merge()
                       // and bypass compiler warnings about member variables not being used.
     const int nLogs = mReaders.size();
     std::vector<std::unique_ptr<Snapshot>> snapshots(nLogs);
-    std::vector<EntryIterator> offsets;
-    offsets.reserve(nLogs);
+    std::vector<const Snapshot *> snapshotPtrs(nLogs);
     for (int i = 0; i < nLogs; ++i) {
         snapshots[i] = mReaders[i]->getSnapshot();
-        offsets.push_back(snapshots[i]->begin());
+        snapshotPtrs[i] = snapshots[i].get();
     }
-    // initialize offsets
-    // TODO custom heap implementation could allow to update top, improving performance
-    // for bursty buffers
-    std::priority_queue<MergeItem, std::vector<MergeItem>, std::greater<MergeItem>> timestamps;
-    for (int i = 0; i < nLogs; ++i)
-    {
-        if (offsets[i] != snapshots[i]->end()) {
-            std::unique_ptr<AbstractEntry> abstractEntry = AbstractEntry::buildEntry(offsets[i]);
-            if (abstractEntry == nullptr) {
-                continue;
+    SnapshotMerger merger(snapshotPtrs);
+    merger.merge([this](const LogRecord &record) {
+        switch (record.begin->type) {
+        case EVENT_FMT_START:
+            FormatEntry(record.begin).copyWithAuthor(mFifoWriter, record.author);
+            break;
+        case EVENT_HISTOGRAM_ENTRY_TS:
+        case EVENT_AUDIO_STATE:
+            HistogramEntry(record.begin).copyWithAuthor(mFifoWriter, record.author);
+            break;
+        default:
+            for (EntryIterator it = record.begin; it != record.end; ++it) {
+                it.copyTo(mFifoWriter);
             }
-            timestamps.emplace(abstractEntry->timestamp(), i);
-        }
-    }
-
-    while (!timestamps.empty()) {
-        int index = timestamps.top().index;     // find minimum timestamp
-        // copy it to the log, increasing offset
-        offsets[index] = AbstractEntry::buildEntry(offsets[index])->
-            copyWithAuthor(mFifoWriter, index);
-        // update data structures
-        timestamps.pop();
-        if (offsets[index] != snapshots[index]->end()) {
-            int64_t ts = AbstractEntry::buildEntry(offsets[index])->timestamp();
-            timestamps.emplace(ts, index);
+            break;
         }
-    }
+    });
 }
 
 const std::vector<sp<Reader>>& Merger::getReaders() const
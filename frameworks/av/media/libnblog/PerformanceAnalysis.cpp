@@ -204,7 +204,7 @@ void PerformanceAnalysis::logTsEntry(timestamp ts) {
     // if the current histogram has spanned its maximum time interval.
     if (mHists.empty() ||
         deltaMs(mHists[0].first, ts) >= kMaxLength.HistTimespanMs) {
-        mHists.emplace_front(ts, std::map<int, int>());
+        mHists.emplace_front(ts, Hist());
         // When memory is full, delete oldest histogram
         // TODO: use a circular buffer
         if (mHists.size() >= kMaxLength.Hists) {
@@ -212,7 +212,7 @@ void PerformanceAnalysis::logTsEntry(timestamp ts) {
         }
     }
     // add current time intervals to histogram
-    ++mHists[0].second[diffJiffy];
+    mHists[0].second.add(diffJiffy);
     // update previous timestamp
     mBufferPeriod.mPrevTs = ts;
 }
@@ -354,11 +354,11 @@ void PerformanceAnalysis::reportPerformance(String8 *body, int author, log_hash_
     // histogram which stores .1 precision ms counts instead of Jiffy multiple counts
     std::map<double, int> buckets;
     for (const auto &shortHist: mHists) {
-        for (const auto &countPair : shortHist.second) {
-            const double ms = static_cast<double>(countPair.first) / kJiffyPerMs;
-            buckets[logRound(ms, mBufferPeriod.mMean)] += countPair.second;
-            elapsedMs += ms * countPair.second;
-        }
+        shortHist.second.forEach([&](int jiffy, uint32_t count) {
+            const double ms = static_cast<double>(jiffy) / kJiffyPerMs;
+            buckets[logRound(ms, mBufferPeriod.mMean)] += count;
+            elapsedMs += ms * count;
+        });
     }
 
     static const int SIZE = 128;
@@ -233,11 +233,18 @@ void DumpReader::dump(int fd, size_t indent)
     if (snapshot == nullptr) {
         return;
     }
+    dumpEntries(fd, snapshot->begin(), snapshot->end(), indent);
+}
+
+void DumpReader::dumpEntries(int fd, EntryIterator begin, EntryIterator end, size_t indent,
+        const char *author)
+{
+    if (fd < 0) return;
     String8 timestamp, body;
 
     // TODO all logged types should have a printable format.
     // TODO can we make the printing generic?
-    for (EntryIterator it = snapshot->begin(); it != snapshot->end(); ++it) {
+    for (EntryIterator it = begin; it != end; ++it) {
         switch (it->type) {
         case EVENT_FMT_START:
             it = handleFormat(FormatEntry(it), &timestamp, &body);
@@ -280,7 +287,12 @@ void DumpReader::dump(int fd, size_t indent)
             break;
         }
         if (!body.isEmpty()) {
-            dprintf(fd, "%.*s%s %s\n", (int)indent, "", timestamp.string(), body.string());
+            if (author != nullptr) {
+                dprintf(fd, "%.*s%s %s: %s\n", (int)indent, "", timestamp.string(), author,
+                        body.string());
+            } else {
+                dprintf(fd, "%.*s%s %s\n", (int)indent, "", timestamp.string(), body.string());
+            }
             body.clear();
         }
         timestamp.clear();
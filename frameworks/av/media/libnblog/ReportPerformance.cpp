@@ -30,7 +30,9 @@
 #include <sys/time.h>
 #include <utility>
 #include <json/json.h>
+#ifdef __ANDROID__
 #include <media/MediaMetricsItem.h>
+#endif
 #include <media/nblog/Events.h>
 #include <media/nblog/PerformanceAnalysis.h>
 #include <media/nblog/ReportPerformance.h>
@@ -150,6 +152,11 @@ void dumpRetro(int fd, const std::map<int, PerformanceData>& threadDataMap)
 
 bool sendToMediaMetrics(const PerformanceData& data)
 {
+#ifndef __ANDROID__
+    // media metrics are not available on host, e.g. to nblog_decode
+    (void)data;
+    return false;
+#else
     // See documentation for these metrics here:
     // docs.google.com/document/d/11--6dyOXVOpacYQLZiaOY5QVtQjUyqNx2zT9cCzLKYE/edit?usp=sharing
     static constexpr char kThreadType[] = "android.media.audiothread.type";
@@ -208,6 +215,7 @@ bool sendToMediaMetrics(const PerformanceData& data)
         return item->selfrecord();
     }
     return false;
+#endif
 }
 
 //------------------------------------------------------------------------------
@@ -260,13 +268,14 @@ void writeToFile(const std::deque<std::pair<timestamp, Hist>> &hists,
     // by a comma, and each histogram is separated by a newline.
     for (auto hist = hists.begin(); hist != hists.end(); ++hist) {
         hfs << hist->first << ", ";
-        for (auto bucket = hist->second.begin(); bucket != hist->second.end(); ++bucket) {
-            hfs << bucket->first / static_cast<double>(kJiffyPerMs)
-                << ", " << bucket->second;
-            if (std::next(bucket) != end(hist->second)) {
+        bool first = true;
+        hist->second.forEach([&](int jiffy, uint32_t count) {
+            if (!first) {
                 hfs << ", ";
             }
-        }
+            hfs << jiffy / static_cast<double>(kJiffyPerMs) << ", " << count;
+            first = false;
+        });
         if (std::next(hist) != end(hists)) {
             hfs << "\n";
         }
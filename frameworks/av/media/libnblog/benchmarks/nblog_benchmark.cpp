@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <memory>
+#include <new>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <media/nblog/BinaryLog.h>
+#include <media/nblog/NBLog.h>
+#include <media/nblog/ReportPerformance.h>
+#include <utils/Timers.h>
+
+using namespace android;
+
+namespace {
+
+// Same as MediaLogService::kMaxSize, the largest FIFO a writer can register.
+constexpr size_t kWriterBufferSize = 0x10000;
+// Number of mixer cycles a writer logs each time it is scheduled.
+constexpr int kCyclesPerBurst = 8;
+constexpr log_hash_t kHash = 0x1234;
+
+// A set of writers logging like FastMixer threads do on every cycle: a format entry, the
+// work time and a histogram timestamp. Writers are scheduled in bursts, so their logs
+// interleave in time like those of concurrent threads.
+class SimulatedMixers {
+public:
+    explicit SimulatedMixers(int numWriters) {
+        for (int i = 0; i < numWriters; ++i) {
+            void *memory = calloc(1, NBLog::Timeline::sharedSize(kWriterBufferSize));
+            mShared.emplace_back(new (memory) NBLog::Shared(), &free);
+            mWriters.push_back(new NBLog::Writer(mShared.back().get(), kWriterBufferSize));
+            mReaders.push_back(new NBLog::Reader(mShared.back().get(), kWriterBufferSize,
+                    "FastMixer " + std::to_string(i)));
+            mNames.push_back(mReaders.back()->name());
+        }
+        // Fill the FIFOs about halfway, a typical amount of data in a dump.
+        const int cycles = kWriterBufferSize / 2 / kBytesPerCycle;
+        for (int burst = 0; burst < cycles / kCyclesPerBurst; ++burst) {
+            for (const auto &writer : mWriters) {
+                for (int cycle = 0; cycle < kCyclesPerBurst; ++cycle) {
+                    writer->logFormat("cycle %d", kHash, burst * kCyclesPerBurst + cycle);
+                    writer->log<NBLog::EVENT_WORK_TIME>(1000000 /*ns*/);
+                    writer->logEventHistTs(NBLog::EVENT_HISTOGRAM_ENTRY_TS, kHash);
+                }
+            }
+        }
+        for (const auto &reader : mReaders) {
+            mSnapshots.push_back(reader->getSnapshot(false /*flush*/));
+            mSnapshotPtrs.push_back(mSnapshots.back().get());
+        }
+    }
+
+    const std::vector<const NBLog::Snapshot *> &snapshots() const { return mSnapshotPtrs; }
+    const std::vector<std::string> &names() const { return mNames; }
+
+private:
+    // Approximate size of the entries logged per cycle.
+    static constexpr int kBytesPerCycle = 80;
+
+    std::vector<std::unique_ptr<NBLog::Shared, decltype(&free)>> mShared;
+    std::vector<sp<NBLog::Writer>> mWriters;
+    std::vector<sp<NBLog::Reader>> mReaders;
+    std::vector<std::string> mNames;
+    std::vector<std::unique_ptr<NBLog::Snapshot>> mSnapshots;
+    std::vector<const NBLog::Snapshot *> mSnapshotPtrs;
+};
+
+} // namespace
+
+static void BM_MergeSnapshots(benchmark::State &state) {
+    const SimulatedMixers mixers(state.range(0));
+    size_t records = 0;
+    for (auto _ : state) {
+        NBLog::SnapshotMerger merger(mixers.snapshots());
+        records += merger.merge([](const NBLog::LogRecord &record) {
+            benchmark::DoNotOptimize(record.timestamp);
+        });
+    }
+    state.SetItemsProcessed(records);
+}
+
+static void BM_WriteBinaryLog(benchmark::State &state) {
+    const SimulatedMixers mixers(state.range(0));
+    const int fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        state.SkipWithError("cannot open /dev/null");
+        return;
+    }
+    size_t records = 0;
+    for (auto _ : state) {
+        size_t numRecords;
+        if (NBLog::writeBinaryLog(fd, mixers.names(), mixers.snapshots(), &numRecords)
+                != NO_ERROR) {
+            state.SkipWithError("writeBinaryLog failed");
+            break;
+        }
+        records += numRecords;
+    }
+    close(fd);
+    state.SetItemsProcessed(records);
+}
+
+static void BM_HistAdd(benchmark::State &state) {
+    ReportPerformance::Hist hist;
+    int jiffy = 0;
+    for (auto _ : state) {
+        hist.add(jiffy);
+        jiffy = (jiffy + 7) % 300;
+    }
+    benchmark::DoNotOptimize(hist);
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_MergeSnapshots)->RangeMultiplier(2)->Range(1, 32);
+BENCHMARK(BM_WriteBinaryLog)->RangeMultiplier(2)->Range(1, 32);
+BENCHMARK(BM_HistAdd);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_MEDIA_NBLOG_BINARYLOG_H
+#define ANDROID_MEDIA_NBLOG_BINARYLOG_H
+
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <media/nblog/Entry.h>
+#include <utils/Errors.h>
+
+namespace android {
+namespace NBLog {
+
+class Snapshot;
+
+// A record is the unit of merging: a complete format entry (EVENT_FMT_START up to and
+// including EVENT_FMT_END), or any other single entry.
+// Entries without a timestamp of their own (e.g. EVENT_WORK_TIME) take the timestamp of the
+// previous record of the same author, so that they stay next to the event they belong to.
+struct LogRecord {
+    int64_t       timestamp;
+    size_t        author;     // index of the snapshot the record comes from
+    EntryIterator begin;
+    EntryIterator end;        // one past the last entry of the record
+};
+
+// Merges the records of several snapshots by timestamp.
+//
+// The snapshots are kept in a binary min-heap keyed by the timestamp of their next record.
+// Instead of popping and pushing one record at a time, the snapshot at the top of the heap
+// emits all its records that precede the next snapshot in the heap, then the top is replaced
+// and sifted down once. Writers log in bursts, so most records are emitted without touching
+// the heap at all.
+//
+// Records with equal timestamps are ordered by author. The snapshots must outlive the merger.
+class SnapshotMerger {
+public:
+    explicit SnapshotMerger(const std::vector<const Snapshot *> &snapshots);
+
+    // Calls onRecord for each record in timestamp order and returns the number of records.
+    size_t merge(const std::function<void(const LogRecord &)> &onRecord);
+
+private:
+    struct Cursor {
+        LogRecord record;         // next record
+        EntryIterator snapshotEnd;
+    };
+
+    // Fills cursor.record with the record starting at cursor.record.end.
+    // Returns false if the snapshot is exhausted.
+    static bool advance(Cursor &cursor);
+    static bool before(const Cursor &a, const Cursor &b);
+    void siftDown(size_t index);
+
+    std::vector<Cursor> mHeap;
+};
+
+// Binary export of merged logs, written by "dumpsys media.log -b" and read by nblog_decode.
+//
+// All integers are little endian.
+//   header:  char magic[4] = "NBLB", uint32 version, uint32 numAuthors
+//   authors: numAuthors times { uint32 nameLength, char name[nameLength] }
+//   records: until end of file { int64 timestamp, uint32 author, uint32 length,
+//                                uint8 entries[length] }
+// The entries of a record are copied verbatim from the writer's FIFO, see class Entry.
+// Records are sorted by timestamp.
+constexpr char kBinaryLogMagic[4] = {'N', 'B', 'L', 'B'};
+constexpr uint32_t kBinaryLogVersion = 1;
+
+// Merges the snapshots and writes them to fd. names[i] is the name of the author of
+// snapshots[i]. Returns the number of records written in *numRecords if not null.
+status_t writeBinaryLog(int fd, const std::vector<std::string> &names,
+                        const std::vector<const Snapshot *> &snapshots,
+                        size_t *numRecords = nullptr);
+
+// Parses a binary log held in memory. Calls onRecord for each record; LogRecord::begin and
+// LogRecord::end point into data. Returns BAD_VALUE if the log is malformed, in which case
+// the records before the malformed one have been reported.
+status_t readBinaryLog(const uint8_t *data, size_t size, std::vector<std::string> *names,
+                       const std::function<void(const LogRecord &)> &onRecord);
+
+}   // namespace NBLog
+}   // namespace android
+
+#endif  // ANDROID_MEDIA_NBLOG_BINARYLOG_H
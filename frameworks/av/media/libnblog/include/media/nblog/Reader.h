@@ -115,9 +115,15 @@ public:
     DumpReader(const sp<IMemory>& iMemory, size_t size, const std::string &name)
         : Reader(iMemory, size, name) {}
     void dump(int fd, size_t indent = 0);
+
+    // Prints the entries in [begin, end), which must start and end on record boundaries.
+    // If author is not null, it is printed after the timestamp of each line.
+    static void dumpEntries(int fd, EntryIterator begin, EntryIterator end, size_t indent = 0,
+                            const char *author = nullptr);
 private:
-    void handleAuthor(const AbstractEntry& fmtEntry __unused, String8* body __unused) {}
-    EntryIterator handleFormat(const FormatEntry &fmtEntry, String8 *timestamp, String8 *body);
+    static void handleAuthor(const AbstractEntry& fmtEntry __unused, String8* body __unused) {}
+    static EntryIterator handleFormat(const FormatEntry &fmtEntry, String8 *timestamp,
+                                      String8 *body);
 
     static void    appendInt(String8 *body, const void *data);
     static void    appendFloat(String8 *body, const void *data);
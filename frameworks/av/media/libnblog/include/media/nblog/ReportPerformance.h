@@ -17,8 +17,11 @@
 #ifndef ANDROID_MEDIA_REPORTPERFORMANCE_H
 #define ANDROID_MEDIA_REPORTPERFORMANCE_H
 
+#include <algorithm>
+#include <array>
 #include <deque>
 #include <map>
+#include <stdint.h>
 #include <vector>
 
 namespace android {
@@ -47,8 +50,52 @@ constexpr int kSecPerMin = 60;
 
 constexpr int kJiffyPerMs = 10; // time unit for histogram as a multiple of milliseconds
 
-// stores a histogram: key: observed buffer period (multiple of jiffy). value: count
-using Hist = std::map<int, int>;
+// stores a histogram of observed buffer periods, with one bucket per jiffy up to
+// kNumBuckets. Longer periods, such as stalls, go to overflow buckets which each cover twice
+// the range of the previous one and remember the sum of their periods, so that no period is
+// clamped. The buckets are fixed so that adding a sample never allocates.
+class Hist {
+public:
+    static constexpr int kLog2NumBuckets = 9;
+    static constexpr int kNumBuckets = 1 << kLog2NumBuckets; // up to 51.1 ms
+    // [512, 1024), [1024, 2048) ... jiffies, up to INT_MAX.
+    static constexpr int kNumOverflowBuckets = 31 - kLog2NumBuckets;
+
+    void add(int jiffy) {
+        if (jiffy < kNumBuckets) {
+            mCounts[std::max(0, jiffy)]++;
+            return;
+        }
+        Overflow &bucket = mOverflow[31 - __builtin_clz(jiffy) - kLog2NumBuckets];
+        bucket.count++;
+        bucket.sum += jiffy;
+    }
+
+    // Calls f(jiffy, count) for each non empty bucket, in increasing jiffy order.
+    // Overflow buckets are reported at the mean period of their samples.
+    template <typename F>
+    void forEach(F f) const {
+        for (int i = 0; i < kNumBuckets; i++) {
+            if (mCounts[i] != 0) {
+                f(i, mCounts[i]);
+            }
+        }
+        for (const Overflow &bucket : mOverflow) {
+            if (bucket.count != 0) {
+                f(static_cast<int>(bucket.sum / bucket.count), bucket.count);
+            }
+        }
+    }
+
+private:
+    struct Overflow {
+        uint32_t count = 0;
+        uint64_t sum = 0;
+    };
+
+    std::array<uint32_t, kNumBuckets> mCounts{};
+    std::array<Overflow, kNumOverflowBuckets> mOverflow{};
+};
 
 using msInterval = double;
 using jiffyInterval = double;
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <media/nblog/BinaryLog.h>
+#include <media/nblog/NBLog.h>
+
+using namespace android;
+
+namespace {
+
+constexpr size_t kWriterBufferSize = 0x4000;
+constexpr log_hash_t kHash = 0x1234;
+
+struct Record {
+    int64_t timestamp;
+    size_t author;
+    std::vector<uint8_t> entries;
+
+    bool operator==(const Record &other) const {
+        return timestamp == other.timestamp && author == other.author &&
+                entries == other.entries;
+    }
+};
+
+Record toRecord(const NBLog::LogRecord &record) {
+    const uint8_t *begin = reinterpret_cast<const uint8_t *>(&*record.begin);
+    return {record.timestamp, record.author,
+            std::vector<uint8_t>(begin, begin + (record.end - record.begin))};
+}
+
+class BinaryLogTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        for (int i = 0; i < 2; ++i) {
+            void *memory = calloc(1, NBLog::Timeline::sharedSize(kWriterBufferSize));
+            mShared.emplace_back(new (memory) NBLog::Shared(), &free);
+            mWriters.push_back(new NBLog::Writer(mShared.back().get(), kWriterBufferSize));
+            mReaders.push_back(new NBLog::Reader(mShared.back().get(), kWriterBufferSize,
+                    "writer " + std::to_string(i)));
+            mNames.push_back(mReaders.back()->name());
+        }
+        // Interleave the writers, and log work times which have no timestamp of their own.
+        for (int cycle = 0; cycle < 20; ++cycle) {
+            for (const auto &writer : mWriters) {
+                writer->logFormat("cycle %d", kHash, cycle);
+                writer->log<NBLog::EVENT_WORK_TIME>(1000000 /*ns*/);
+                writer->logEventHistTs(NBLog::EVENT_HISTOGRAM_ENTRY_TS, kHash);
+            }
+        }
+        for (const auto &reader : mReaders) {
+            mSnapshots.push_back(reader->getSnapshot(false /*flush*/));
+            mSnapshotPtrs.push_back(mSnapshots.back().get());
+        }
+
+        NBLog::SnapshotMerger merger(mSnapshotPtrs);
+        merger.merge([this](const NBLog::LogRecord &record) {
+            mExpected.push_back(toRecord(record));
+        });
+        ASSERT_FALSE(mExpected.empty());
+
+        FILE *file = tmpfile();
+        ASSERT_NE(nullptr, file);
+        size_t numRecords = 0;
+        ASSERT_EQ(NO_ERROR, NBLog::writeBinaryLog(fileno(file), mNames, mSnapshotPtrs,
+                &numRecords));
+        EXPECT_EQ(mExpected.size(), numRecords);
+        const off_t size = lseek(fileno(file), 0, SEEK_END);
+        mLog.resize(size);
+        ASSERT_EQ(size, pread(fileno(file), mLog.data(), size, 0));
+        fclose(file);
+
+        mHeaderSize = 3 * sizeof(uint32_t);
+        for (const auto &name : mNames) {
+            mHeaderSize += sizeof(uint32_t) + name.size();
+        }
+    }
+
+    status_t read(const std::vector<uint8_t> &log, size_t size, std::vector<Record> *records) {
+        std::vector<std::string> names;
+        return NBLog::readBinaryLog(log.data(), size, &names,
+                [&](const NBLog::LogRecord &record) { records->push_back(toRecord(record)); });
+    }
+
+    std::vector<std::unique_ptr<NBLog::Shared, decltype(&free)>> mShared;
+    std::vector<sp<NBLog::Writer>> mWriters;
+    std::vector<sp<NBLog::Reader>> mReaders;
+    std::vector<std::string> mNames;
+    std::vector<std::unique_ptr<NBLog::Snapshot>> mSnapshots;
+    std::vector<const NBLog::Snapshot *> mSnapshotPtrs;
+
+    std::vector<Record> mExpected;  // as merged in memory
+    std::vector<uint8_t> mLog;      // as written to a file
+    size_t mHeaderSize = 0;
+};
+
+} // namespace
+
+TEST_F(BinaryLogTest, RoundTrip) {
+    std::vector<std::string> names;
+    std::vector<Record> records;
+    ASSERT_EQ(NO_ERROR, NBLog::readBinaryLog(mLog.data(), mLog.size(), &names,
+            [&](const NBLog::LogRecord &record) { records.push_back(toRecord(record)); }));
+    EXPECT_EQ(mNames, names);
+    EXPECT_EQ(mExpected, records);
+    for (size_t i = 1; i < records.size(); ++i) {
+        EXPECT_LE(records[i - 1].timestamp, records[i].timestamp) << "record " << i;
+    }
+}
+
+TEST_F(BinaryLogTest, RejectsBadHeader) {
+    std::vector<Record> records;
+    EXPECT_EQ(BAD_VALUE, read(mLog, 0, &records));
+
+    std::vector<uint8_t> log = mLog;
+    log[0] = 'X';
+    EXPECT_EQ(BAD_VALUE, read(log, log.size(), &records));
+
+    log = mLog;
+    log[sizeof(NBLog::kBinaryLogMagic)]++;  // version
+    EXPECT_EQ(BAD_VALUE, read(log, log.size(), &records));
+
+    log = mLog;
+    const uint32_t badNameLength = UINT32_MAX;
+    memcpy(&log[3 * sizeof(uint32_t)], &badNameLength, sizeof(badNameLength));
+    EXPECT_EQ(BAD_VALUE, read(log, log.size(), &records));
+    EXPECT_TRUE(records.empty());
+}
+
+TEST_F(BinaryLogTest, RejectsTruncatedLog) {
+    // Offsets at which the log can end, after the header and after each record.
+    std::vector<size_t> boundaries = {mHeaderSize};
+    for (const Record &record : mExpected) {
+        boundaries.push_back(boundaries.back() + sizeof(int64_t) + 2 * sizeof(uint32_t) +
+                record.entries.size());
+    }
+    ASSERT_EQ(mLog.size(), boundaries.back());
+
+    size_t complete = 0;  // number of records that fit before size
+    for (size_t size = 0; size < mLog.size(); ++size) {
+        while (complete + 1 < boundaries.size() && boundaries[complete + 1] <= size) {
+            ++complete;
+        }
+        // Copy so that reads past size are caught by the sanitizers.
+        const std::vector<uint8_t> truncated(mLog.begin(), mLog.begin() + size);
+        std::vector<Record> records;
+        const status_t status = read(truncated, truncated.size(), &records);
+        const bool atBoundary = size >= mHeaderSize && boundaries[complete] == size;
+        EXPECT_EQ(atBoundary ? NO_ERROR : BAD_VALUE, status) << "size " << size;
+        ASSERT_EQ(size < mHeaderSize ? 0 : complete, records.size()) << "size " << size;
+        EXPECT_TRUE(std::equal(records.begin(), records.end(), mExpected.begin()));
+    }
+}
+
+TEST_F(BinaryLogTest, RejectsMalformedRecord) {
+    const size_t authorOffset = mHeaderSize + sizeof(int64_t);
+    const size_t lengthOffset = authorOffset + sizeof(uint32_t);
+    uint32_t length;
+    memcpy(&length, &mLog[lengthOffset], sizeof(length));
+
+    std::vector<Record> records;
+    std::vector<uint8_t> log = mLog;
+    const uint32_t badAuthor = mNames.size();
+    memcpy(&log[authorOffset], &badAuthor, sizeof(badAuthor));
+    EXPECT_EQ(BAD_VALUE, read(log, log.size(), &records));
+
+    // A length past the end of the log, and one that cuts the last entry of the record.
+    for (const uint32_t badLength : {UINT32_MAX, length - 1}) {
+        log = mLog;
+        memcpy(&log[lengthOffset], &badLength, sizeof(badLength));
+        EXPECT_EQ(BAD_VALUE, read(log, log.size(), &records)) << badLength;
+    }
+
+    // An entry whose trailing length does not match its header.
+    log = mLog;
+    log[lengthOffset + sizeof(uint32_t) + length - 1] ^= 0xff;
+    EXPECT_EQ(BAD_VALUE, read(log, log.size(), &records));
+    EXPECT_TRUE(records.empty());
+}
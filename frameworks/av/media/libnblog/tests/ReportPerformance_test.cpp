@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <limits.h>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <media/nblog/ReportPerformance.h>
+
+using namespace android::ReportPerformance;
+
+namespace {
+
+std::vector<std::pair<int, uint32_t>> buckets(const Hist &hist) {
+    std::vector<std::pair<int, uint32_t>> result;
+    hist.forEach([&](int jiffy, uint32_t count) { result.emplace_back(jiffy, count); });
+    return result;
+}
+
+} // namespace
+
+TEST(HistTest, CountsPeriodsPerJiffy) {
+    Hist hist;
+    hist.add(0);
+    hist.add(-3);  // clock adjustments are counted as zero
+    hist.add(200);
+    hist.add(200);
+    hist.add(Hist::kNumBuckets - 1);
+    const std::vector<std::pair<int, uint32_t>> expected = {
+        {0, 2}, {200, 2}, {Hist::kNumBuckets - 1, 1}};
+    EXPECT_EQ(expected, buckets(hist));
+}
+
+TEST(HistTest, KeepsLongPeriods) {
+    Hist hist;
+    hist.add(100);
+    // 60 ms and 70 ms stalls share an overflow bucket, reported at their mean.
+    hist.add(600);
+    hist.add(700);
+    // A 2 s stall and the longest representable period get buckets of their own.
+    hist.add(20000);
+    hist.add(INT_MAX);
+    const std::vector<std::pair<int, uint32_t>> expected = {
+        {100, 1}, {650, 2}, {20000, 1}, {INT_MAX, 1}};
+    EXPECT_EQ(expected, buckets(hist));
+}
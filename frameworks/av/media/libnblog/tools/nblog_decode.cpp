@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Decodes a binary log exported with "adb exec-out dumpsys media.log -b > log.nblog".
+//
+// usage: nblog_decode [-s] [file]
+//   -s    only print the number of records and the time span of each writer
+// Reads from stdin if no file is given.
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include <media/nblog/BinaryLog.h>
+#include <media/nblog/Reader.h>
+
+using namespace android;
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-s] [file]\n", name);
+    fprintf(stderr, "    -s    print a summary of each writer instead of the entries\n");
+}
+
+static bool readAll(FILE *file, std::vector<uint8_t> *data)
+{
+    uint8_t buffer[64 * 1024];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data->insert(data->end(), buffer, buffer + count);
+    }
+    return !ferror(file);
+}
+
+int main(int argc, char **argv)
+{
+    bool summary = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "s")) != -1) {
+        switch (opt) {
+        case 's':
+            summary = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argc - optind > 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    FILE *file = stdin;
+    if (optind < argc) {
+        file = fopen(argv[optind], "rb");
+        if (file == nullptr) {
+            fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+            return 1;
+        }
+    }
+    std::vector<uint8_t> data;
+    const bool ok = readAll(file, &data);
+    if (file != stdin) {
+        fclose(file);
+    }
+    if (!ok) {
+        fprintf(stderr, "read error\n");
+        return 1;
+    }
+
+    struct WriterSummary {
+        size_t records = 0;
+        int64_t first = 0;
+        int64_t last = 0;
+    };
+    std::vector<std::string> names;
+    std::vector<WriterSummary> summaries;
+    const status_t status = NBLog::readBinaryLog(data.data(), data.size(), &names,
+            [&](const NBLog::LogRecord &record) {
+        if (!summary) {
+            NBLog::DumpReader::dumpEntries(STDOUT_FILENO, record.begin, record.end,
+                    0 /*indent*/, names[record.author].c_str());
+            return;
+        }
+        if (summaries.size() < names.size()) {
+            summaries.resize(names.size());
+        }
+        WriterSummary &writer = summaries[record.author];
+        if (writer.records++ == 0) {
+            writer.first = record.timestamp;
+        }
+        writer.last = record.timestamp;
+    });
+
+    if (summary) {
+        summaries.resize(names.size());
+        for (size_t i = 0; i < names.size(); ++i) {
+            const WriterSummary &writer = summaries[i];
+            printf("%s: %zu records, %.3f s span\n", names[i].c_str(), writer.records,
+                    (writer.last - writer.first) * 1e-9);
+        }
+    }
+    if (status != NO_ERROR) {
+        fprintf(stderr, "malformed log\n");
+        return 1;
+    }
+    return 0;
+}
@@ -71,6 +71,12 @@ static const int64_t kInitialDelayTimeUs     = 700000LL;
 static const int64_t kMaxMetadataSize = 0x4000000LL;   // 64MB max per-frame metadata size
 static const int64_t kMaxCttsOffsetTimeUs = 30 * 60 * 1000000LL;  // 30 minutes
 static const size_t kESDSScratchBufferSize = 10;  // kMaxAtomSize in Mpeg4Extractor 64MB
+// A fragment longer than this many fragment durations is written without
+// waiting any further for a sync sample of the lead track or for other tracks.
+static const int64_t kMaxFragmentDurationFactor = 4;
+// Sample flags, see 14496-12 8.8.3.1: sample_depends_on and sample_is_non_sync_sample
+static const uint32_t kSyncSampleFlags = 0x02000000;
+static const uint32_t kNonSyncSampleFlags = 0x01010000;
 
 static const char kMetaKey_Version[]    = "com.android.version";
 static const char kMetaKey_Manufacturer[]      = "com.android.manufacturer";
@@ -155,7 +161,9 @@ public:
     bool isHevc() const { return mIsHevc; }
     bool isHeic() const { return mIsHeic; }
     bool isAudio() const { return mIsAudio; }
+    bool isVideo() const { return mIsVideo; }
     bool isMPEG4() const { return mIsMPEG4; }
+    int32_t getTimeScale() const { return mTimeScale; }
     bool usePrefix() const { return mIsAvc || mIsHevc || mIsHeic; }
     bool isExifData(MediaBufferBase *buffer, uint32_t *tiffHdrOffset) const;
     void addChunkOffset(off64_t offset);
@@ -329,6 +337,7 @@ private:
     int64_t mEstimatedTrackSizeBytes;
     int64_t mMdatSizeBytes;
     int32_t mTimeScale;
+    uint32_t mNumSamples;  // also counted when the sample tables are not kept
 
     pthread_t mThread;
 
@@ -544,6 +553,8 @@ void MPEG4Writer::initInternal(int fd, bool isFirstSession) {
     mHasRefs = false;
     mPreAllocFirstTime = true;
     mPrevAllTracksTotalMetaDataSizeEstimate = 0;
+    mFragmentSequenceNumber = 0;
+    mHasInitMoovBox = false;
 
     // Following variables only need to be set for the first recording session.
     // And they will stay the same for all the recording sessions.
@@ -557,6 +568,7 @@ void MPEG4Writer::initInternal(int fd, bool isFirstSession) {
         mAreGeoTagsAvailable = false;
         mSwitchPending = false;
         mIsFileSizeLimitExplicitlyRequested = false;
+        mFragmentDurationUs = 0;
     }
 
     // Verify mFd is seekable
@@ -607,7 +619,7 @@ status_t MPEG4Writer::Track::dump(
     snprintf(buffer, SIZE, "       reached EOS: %s\n",
             mReachedEOS? "true": "false");
     result.append(buffer);
-    snprintf(buffer, SIZE, "       frames encoded : %d\n", mStszTableEntries->count());
+    snprintf(buffer, SIZE, "       frames encoded : %d\n", mNumSamples);
     result.append(buffer);
     snprintf(buffer, SIZE, "       duration encoded : %" PRId64 " us\n", mTrackDurationUs);
     result.append(buffer);
@@ -906,6 +918,20 @@ status_t MPEG4Writer::start(MetaData *param) {
         (mMaxFileSizeLimitBytes != 0 &&
          mMaxFileSizeLimitBytes >= kMinStreamableFileSizeInBytes);
 
+    /*
+     * A fragmented file is written front to back: the moov box describing the
+     * tracks, followed by moof and mdat box pairs each with the tables and the
+     * data of its samples. Nothing is reserved up front, and nothing is left
+     * to write on stop() but the last fragment.
+     */
+    if (isFragmented()) {
+        if (mHasFileLevelMeta) {
+            ALOGE("Image tracks can not be written to a fragmented file");
+            return ERROR_UNSUPPORTED;
+        }
+        mStreamableFile = false;
+    }
+
     /*
      * mWriteBoxToMemory is true if the amount of data in a file-level meta or
      * moov box is smaller than the reserved free space at the beginning of a
@@ -998,7 +1024,9 @@ status_t MPEG4Writer::start(MetaData *param) {
 
     mOffset = mMdatOffset;
     seekOrPostError(mFd, mMdatOffset, SEEK_SET);
-    write("\x00\x00\x00\x01mdat????????", 16);
+    if (!isFragmented()) {
+        write("\x00\x00\x00\x01mdat????????", 16);
+    }
 
     /* Confirm whether the writing of the initial file atoms, ftyp and free,
      * are written to the file properly by posting kWhatNoIOErrorSoFar to the
@@ -1248,6 +1276,16 @@ status_t MPEG4Writer::reset(bool stopSource) {
         return err;
     }
 
+    // The moov box and all the fragments were written by the writer thread.
+    if (isFragmented()) {
+        CHECK(mBoxes.empty());
+        status_t errRelease = release();
+        if (err == OK) {
+            err = errRelease;
+        }
+        return err;
+    }
+
     // Fix up the size of the 'mdat' chunk.
     seekOrPostError(mFd, mMdatOffset + 8, SEEK_SET);
     uint64_t size = mOffset - mMdatOffset;
@@ -1387,24 +1425,28 @@ void MPEG4Writer::writeMoovBox(int64_t durationUs) {
         writeUdtaBox();
     }
     writeMoovLevelMetaBox();
-    // Loop through all the tracks to get the global time offset if there is
-    // any ctts table appears in a video track.
-    int64_t minCttsOffsetTimeUs = kMaxCttsOffsetTimeUs;
-    for (List<Track *>::iterator it = mTracks.begin();
-        it != mTracks.end(); ++it) {
-        if (!(*it)->isHeic()) {
-            minCttsOffsetTimeUs =
-                std::min(minCttsOffsetTimeUs, (*it)->getMinCttsOffsetTimeUs());
+    // The composition offsets of a fragmented file are only known fragment by
+    // fragment, they are written as they are and the movie start is not moved.
+    if (!isFragmented()) {
+        // Loop through all the tracks to get the global time offset if there is
+        // any ctts table appears in a video track.
+        int64_t minCttsOffsetTimeUs = kMaxCttsOffsetTimeUs;
+        for (List<Track *>::iterator it = mTracks.begin();
+            it != mTracks.end(); ++it) {
+            if (!(*it)->isHeic()) {
+                minCttsOffsetTimeUs =
+                    std::min(minCttsOffsetTimeUs, (*it)->getMinCttsOffsetTimeUs());
+            }
         }
-    }
-    ALOGI("Adjust the moov start time from %lld us -> %lld us", (long long)mStartTimestampUs,
-          (long long)(mStartTimestampUs + minCttsOffsetTimeUs - kMaxCttsOffsetTimeUs));
-    // Adjust movie start time.
-    mStartTimestampUs += minCttsOffsetTimeUs - kMaxCttsOffsetTimeUs;
+        ALOGI("Adjust the moov start time from %lld us -> %lld us", (long long)mStartTimestampUs,
+              (long long)(mStartTimestampUs + minCttsOffsetTimeUs - kMaxCttsOffsetTimeUs));
+        // Adjust movie start time.
+        mStartTimestampUs += minCttsOffsetTimeUs - kMaxCttsOffsetTimeUs;
 
-    // Add mStartTimeOffsetBFramesUs(-ve or zero) to the start offset of tracks.
-    mStartTimeOffsetBFramesUs = minCttsOffsetTimeUs - kMaxCttsOffsetTimeUs;
-    ALOGV("mStartTimeOffsetBFramesUs :%" PRId32, mStartTimeOffsetBFramesUs);
+        // Add mStartTimeOffsetBFramesUs(-ve or zero) to the start offset of tracks.
+        mStartTimeOffsetBFramesUs = minCttsOffsetTimeUs - kMaxCttsOffsetTimeUs;
+        ALOGV("mStartTimeOffsetBFramesUs :%" PRId32, mStartTimeOffsetBFramesUs);
+    }
 
     for (List<Track *>::iterator it = mTracks.begin();
         it != mTracks.end(); ++it) {
@@ -1412,6 +1454,9 @@ void MPEG4Writer::writeMoovBox(int64_t durationUs) {
             (*it)->writeTrackHeader();
         }
     }
+    if (isFragmented()) {
+        writeMvexBox();
+    }
     endBox();  // moov
 }
 
@@ -1443,6 +1488,9 @@ void MPEG4Writer::writeFtypBox(MetaData *param) {
         if (mHasMoovBox) {
             writeFourcc("isom");
             writeFourcc("mp42");
+            if (isFragmented()) {
+                writeFourcc("iso6");
+            }
         }
     }
 
@@ -1482,6 +1530,19 @@ status_t MPEG4Writer::setInterleaveDuration(uint32_t durationUs) {
     return OK;
 }
 
+status_t MPEG4Writer::setFragmentDuration(int64_t durationUs) {
+    if (mStarted) {
+        ALOGE("Fragment duration can not be changed once started");
+        return INVALID_OPERATION;
+    }
+    if (durationUs < 0) {
+        ALOGE("Invalid fragment duration: %lld us", (long long)durationUs);
+        return BAD_VALUE;
+    }
+    mFragmentDurationUs = durationUs;
+    return OK;
+}
+
 void MPEG4Writer::lock() {
     mLock.lock();
 }
@@ -2042,6 +2103,7 @@ MPEG4Writer::Track::Track(
       mTrackId(aTrackId),
       mTrackDurationUs(0),
       mEstimatedTrackSizeBytes(0),
+      mNumSamples(0),
       mSamplesHaveSameSize(true),
       mStszTableEntries(new ListTableEntries<uint32_t, 1>(1000)),
       mCo64TableEntries(new ListTableEntries<off64_t, 1>(1000)),
@@ -2127,6 +2189,7 @@ void MPEG4Writer::Track::resetInternal() {
     mTrackDurationUs = 0;
     mEstimatedTrackSizeBytes = 0;
     mSamplesHaveSameSize = false;
+    mNumSamples = 0;
     if (mStszTableEntries != NULL) {
         delete mStszTableEntries;
         mStszTableEntries = new ListTableEntries<uint32_t, 1>(1000);
@@ -2181,12 +2244,18 @@ void MPEG4Writer::Track::updateTrackSizeEstimate() {
 
 void MPEG4Writer::Track::addOneStscTableEntry(
         size_t chunkId, size_t sampleId) {
+    if (mOwner->isFragmented()) {
+        return;
+    }
     mStscTableEntries->add(htonl(chunkId));
     mStscTableEntries->add(htonl(sampleId));
     mStscTableEntries->add(htonl(1));
 }
 
 void MPEG4Writer::Track::addOneStssTableEntry(size_t sampleId) {
+    if (mOwner->isFragmented()) {
+        return;
+    }
     mStssTableEntries->add(htonl(sampleId));
 }
 
@@ -2194,12 +2263,15 @@ void MPEG4Writer::Track::addOneSttsTableEntry(size_t sampleCount, int32_t delta)
     if (delta == 0) {
         ALOGW("0-duration samples found: %zu", sampleCount);
     }
+    if (mOwner->isFragmented()) {
+        return;
+    }
     mSttsTableEntries->add(htonl(sampleCount));
     mSttsTableEntries->add(htonl(delta));
 }
 
 void MPEG4Writer::Track::addOneCttsTableEntry(size_t sampleCount, int32_t sampleOffset) {
-    if (!mIsVideo) {
+    if (!mIsVideo || mOwner->isFragmented()) {
         return;
     }
     mCttsTableEntries->add(htonl(sampleCount));
@@ -2601,6 +2673,22 @@ void MPEG4Writer::writeChunkToFile(Chunk* chunk) {
     ALOGV("writeChunkToFile: %" PRId64 " from %s track",
         chunk->mTimeStampUs, chunk->mTrack->getTrackType());
 
+    if (isFragmented()) {
+        // Held until they go in a fragment.
+        for (List<ChunkInfo>::iterator it = mChunkInfos.begin();
+             it != mChunkInfos.end(); ++it) {
+            if (it->mTrack == chunk->mTrack) {
+                for (List<MediaBuffer *>::iterator sampleIt = chunk->mSamples.begin();
+                     sampleIt != chunk->mSamples.end(); ++sampleIt) {
+                    it->mFragmentSamples.push_back(*sampleIt);
+                }
+                break;
+            }
+        }
+        chunk->mSamples.clear();
+        return;
+    }
+
     int32_t isFirstSample = true;
     while (!chunk->mSamples.empty()) {
         List<MediaBuffer *>::iterator it = chunk->mSamples.begin();
@@ -2639,12 +2727,248 @@ void MPEG4Writer::writeAllChunks() {
         ++outstandingChunks;
     }
 
+    if (isFragmented()) {
+        // The track threads are done, all the samples held go in the last
+        // fragment.
+        for (List<ChunkInfo>::iterator it = mChunkInfos.begin();
+             it != mChunkInfos.end(); ++it) {
+            it->mNumFragmentSamples = it->mFragmentSamples.size();
+        }
+        mLock.unlock();
+        writeFragmentToFile();
+        mLock.lock();
+    }
+
     sendSessionSummary();
 
     mChunkInfos.clear();
     ALOGD("%zu chunks are written in the last batch", outstandingChunks);
 }
 
+bool MPEG4Writer::findFragmentToWrite_l() {
+    ALOGV("findFragmentToWrite_l");
+
+    // A track is done once its last chunk has been taken in.
+    auto isDone = [](ChunkInfo &info) {
+        return info.mTrack->reachedEOS() && info.mChunks.empty();
+    };
+
+    // Fragments are cut on the first video track, or else on the first track.
+    ChunkInfo *lead = NULL;
+    for (List<ChunkInfo>::iterator it = mChunkInfos.begin();
+         it != mChunkInfos.end(); ++it) {
+        if (!isDone(*it) &&
+                (lead == NULL || (!lead->mTrack->isVideo() && it->mTrack->isVideo()))) {
+            lead = &*it;
+        }
+    }
+    if (lead == NULL || lead->mFragmentSamples.size() < 2) {
+        return false;
+    }
+
+    // The fragment ends right before the lead track's latest sample.
+    int64_t firstTimeUs, lastTimeUs;
+    MediaBuffer *last = *--lead->mFragmentSamples.end();
+    CHECK((*lead->mFragmentSamples.begin())->meta_data().findInt64(
+            kKeyDecodingTime, &firstTimeUs));
+    CHECK(last->meta_data().findInt64(kKeyDecodingTime, &lastTimeUs));
+    if (lastTimeUs - firstTimeUs < mFragmentDurationUs) {
+        return false;
+    }
+    const bool overdue =
+            lastTimeUs - firstTimeUs >= kMaxFragmentDurationFactor * mFragmentDurationUs;
+    int32_t isSync = false;
+    if (!overdue && lead->mTrack->isVideo() &&
+            !(last->meta_data().findInt32(kKeyIsSyncFrame, &isSync) && isSync)) {
+        return false;
+    }
+
+    // The latest sample of each track stays behind, its duration is only
+    // known from the one after it. Every track still running must have a
+    // sample in the fragment, as a track missing from a fragment is taken to
+    // have ended; once the moov box is out, an overdue fragment goes without.
+    for (List<ChunkInfo>::iterator it = mChunkInfos.begin();
+         it != mChunkInfos.end(); ++it) {
+        size_t numSamples = it->mFragmentSamples.size();
+        if (isDone(*it)) {
+            it->mNumFragmentSamples = numSamples;
+        } else if (numSamples >= 2) {
+            it->mNumFragmentSamples = numSamples - 1;
+        } else if (overdue && mHasInitMoovBox) {
+            it->mNumFragmentSamples = 0;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+void MPEG4Writer::writeFragmentToFile() {
+    ALOGV("writeFragmentToFile");
+
+    if (!mHasInitMoovBox) {
+        // All the tracks have their codec specific data by the time they have
+        // samples for the first fragment.
+        writeMoovBox(0 /* durationUs */);
+        mHasInitMoovBox = true;
+        ALOGI("MOOV atom was written to the file");
+    }
+
+    size_t numSamples = 0;
+    for (List<ChunkInfo>::iterator it = mChunkInfos.begin();
+         it != mChunkInfos.end(); ++it) {
+        numSamples += it->mNumFragmentSamples;
+    }
+    if (numSamples == 0) {
+        return;
+    }
+
+    // The data offset of each track run is only known once the moof box has
+    // been written, like the size of a box.
+    List<off64_t> dataOffsetPositions;
+    List<uint64_t> dataSizes;
+    uint64_t mdatDataSize = 0;
+    const off64_t moofOffset = mOffset;
+    beginBox("moof");
+    beginBox("mfhd");
+    writeInt32(0);  // version=0, flags=0
+    writeInt32(++mFragmentSequenceNumber);
+    endBox();  // mfhd
+    for (List<ChunkInfo>::iterator it = mChunkInfos.begin();
+         it != mChunkInfos.end(); ++it) {
+        if (it->mNumFragmentSamples > 0) {
+            off64_t dataOffsetPosition;
+            uint64_t dataSize;
+            writeTrafBox(&*it, &dataOffsetPosition, &dataSize);
+            dataOffsetPositions.push_back(dataOffsetPosition);
+            dataSizes.push_back(dataSize);
+            mdatDataSize += dataSize;
+        }
+    }
+    endBox();  // moof
+
+    const bool useLargeMdatSize = mdatDataSize + 8 > UINT32_MAX;
+    int64_t dataOffset = mOffset - moofOffset + (useLargeMdatSize ? 16 : 8);
+    List<uint64_t>::iterator sizeIt = dataSizes.begin();
+    for (List<off64_t>::iterator it = dataOffsetPositions.begin();
+         it != dataOffsetPositions.end(); ++it, ++sizeIt) {
+        int32_t x = htonl(dataOffset);
+        seekOrPostError(mFd, *it, SEEK_SET);
+        writeOrPostError(mFd, &x, 4);
+        dataOffset += *sizeIt;
+    }
+    seekOrPostError(mFd, mOffset, SEEK_SET);
+
+    if (useLargeMdatSize) {
+        writeInt32(1);
+        writeFourcc("mdat");
+        writeInt64(mdatDataSize + 16);
+    } else {
+        writeInt32(mdatDataSize + 8);
+        writeFourcc("mdat");
+    }
+    const off64_t mdatDataOffset = mOffset;
+    for (List<ChunkInfo>::iterator it = mChunkInfos.begin();
+         it != mChunkInfos.end(); ++it) {
+        for (; it->mNumFragmentSamples > 0; --it->mNumFragmentSamples) {
+            List<MediaBuffer *>::iterator sampleIt = it->mFragmentSamples.begin();
+            size_t bytesWritten;
+            addSample_l(*sampleIt, it->mTrack->usePrefix(), 0 /* tiffHdrOffset */,
+                    &bytesWritten);
+            (*sampleIt)->release();
+            (*sampleIt) = NULL;
+            it->mFragmentSamples.erase(sampleIt);
+        }
+    }
+    if ((uint64_t)(mOffset - mdatDataOffset) != mdatDataSize) {
+        ALOGE("Fragment %u has %" PRId64 " bytes of data instead of %" PRIu64,
+                mFragmentSequenceNumber, mOffset - mdatDataOffset, mdatDataSize);
+    }
+    ALOGV("Fragment %u: %zu samples, %" PRIu64 " bytes of data",
+            mFragmentSequenceNumber, numSamples, mdatDataSize);
+}
+
+void MPEG4Writer::writeTrafBox(ChunkInfo *info, off64_t *dataOffsetPosition, uint64_t *dataSize) {
+    Track *track = info->mTrack;
+    const bool isVideo = track->isVideo();
+    const int64_t timeScale = track->getTimeScale();
+    auto toTicks = [timeScale](int64_t timeUs) {
+        return (timeUs * timeScale + 500000LL) / 1000000LL;
+    };
+    size_t prefixSize = 0;
+    if (track->usePrefix()) {
+        prefixSize = useNalLengthFour() ? 4 : 2;
+    }
+
+    List<MediaBuffer *>::iterator it = info->mFragmentSamples.begin();
+    int64_t decodingTimeUs;
+    CHECK((*it)->meta_data().findInt64(kKeyDecodingTime, &decodingTimeUs));
+
+    beginBox("traf");
+
+    beginBox("tfhd");
+    writeInt32(0x020000);  // version=0, flags=default-base-is-moof
+    writeInt32(track->getTrackId().getId());
+    endBox();  // tfhd
+
+    beginBox("tfdt");
+    writeInt32(0x01000000);  // version=1, flags=0
+    writeInt64(toTicks(decodingTimeUs));
+    endBox();  // tfdt
+
+    beginBox("trun");
+    // data-offset, sample-duration, sample-size and sample-flags present, and
+    // for video sample-composition-time-offset, signed as of version 1.
+    writeInt32(isVideo ? 0x01000f01 : 0x00000701);
+    writeInt32(info->mNumFragmentSamples);
+    *dataOffsetPosition = mOffset;
+    writeInt32(0);  // data_offset
+    *dataSize = 0;
+    for (size_t i = 0; i < info->mNumFragmentSamples; ++i) {
+        MediaBuffer *sample = *it;
+        int64_t durationTicks = info->mLastSampleDurationTicks;
+        int64_t nextDecodingTimeUs = decodingTimeUs;
+        if (++it != info->mFragmentSamples.end()) {
+            CHECK((*it)->meta_data().findInt64(kKeyDecodingTime, &nextDecodingTimeUs));
+            durationTicks = toTicks(nextDecodingTimeUs) - toTicks(decodingTimeUs);
+            info->mLastSampleDurationTicks = durationTicks;
+        }
+        int32_t isSync = false;
+        sample->meta_data().findInt32(kKeyIsSyncFrame, &isSync);
+        size_t sampleSize = sample->range_length() + prefixSize;
+
+        writeInt32(durationTicks);
+        writeInt32(sampleSize);
+        writeInt32(!isVideo || isSync ? kSyncSampleFlags : kNonSyncSampleFlags);
+        if (isVideo) {
+            int64_t timeUs;
+            CHECK(sample->meta_data().findInt64(kKeyTime, &timeUs));
+            writeInt32(toTicks(timeUs) - toTicks(decodingTimeUs));
+        }
+        *dataSize += sampleSize;
+        decodingTimeUs = nextDecodingTimeUs;
+    }
+    endBox();  // trun
+
+    endBox();  // traf
+}
+
+void MPEG4Writer::writeMvexBox() {
+    beginBox("mvex");
+    for (List<Track *>::iterator it = mTracks.begin();
+         it != mTracks.end(); ++it) {
+        beginBox("trex");
+        writeInt32(0);  // version=0, flags=0
+        writeInt32((*it)->getTrackId().getId());
+        writeInt32(1);  // default_sample_description_index
+        writeInt32(0);  // default_sample_duration
+        writeInt32(0);  // default_sample_size
+        writeInt32(0);  // default_sample_flags
+        endBox();  // trex
+    }
+    endBox();  // mvex
+}
+
 bool MPEG4Writer::findChunkToWrite(Chunk *chunk) {
     ALOGV("findChunkToWrite");
 
@@ -2715,6 +3039,15 @@ void MPEG4Writer::threadFunc() {
             if (mIsRealTimeRecording) {
                 mLock.lock();
             }
+
+            // Fragments are always written without holding the lock, as the
+            // moov box written ahead of the first one gets the tracks' start
+            // times and offsets through methods that acquire it.
+            if (isFragmented() && findFragmentToWrite_l()) {
+                mLock.unlock();
+                writeFragmentToFile();
+                mLock.lock();
+            }
         }
     }
 
@@ -2733,6 +3066,8 @@ status_t MPEG4Writer::startWriterThread() {
         info.mTrack = *it;
         info.mPrevChunkTimestampUs = 0;
         info.mMaxInterChunkDurUs = 0;
+        info.mNumFragmentSamples = 0;
+        info.mLastSampleDurationTicks = 0;
         mChunkInfos.push_back(info);
     }
 
@@ -3258,8 +3593,12 @@ void MPEG4Writer::Track::dumpTimeStamps() {
 
 status_t MPEG4Writer::Track::threadEntry() {
     int32_t count = 0;
-    const int64_t interleaveDurationUs = mOwner->interleaveDuration();
+    // A fragmented file's samples all go through the writer thread, one by one,
+    // to be put in fragments.
+    const bool isFragmented = mOwner->isFragmented();
+    const int64_t interleaveDurationUs = isFragmented ? 0 : mOwner->interleaveDuration();
     const bool hasMultipleTracks = (mOwner->numTracks() > 1);
+    const bool writeSamplesDirectly = !hasMultipleTracks && !isFragmented;
     int64_t chunkTimestampUs = 0;
     int32_t nChunks = 0;
     int32_t nActualFrames = 0;        // frames containing non-CSD data (non-0 length)
@@ -3492,7 +3831,7 @@ status_t MPEG4Writer::Track::threadEntry() {
         }
 ////////////////////////////////////////////////////////////////////////////////
         if (!mIsHeic) {
-            if (mStszTableEntries->count() == 0) {
+            if (mNumSamples == 0) {
                 mFirstSampleTimeRealUs = systemTime() / 1000;
                 if (timestampUs < 0 && mFirstSampleStartOffsetUs == 0) {
                     mFirstSampleStartOffsetUs = -timestampUs;
@@ -3586,7 +3925,7 @@ status_t MPEG4Writer::Track::threadEntry() {
                     break;
                 }
 
-                if (mStszTableEntries->count() == 0) {
+                if (mNumSamples == 0) {
                     // Force the first ctts table entry to have one single entry
                     // so that we can do adjustment for the initial track start
                     // time offset easily in writeCttsBox().
@@ -3604,7 +3943,7 @@ status_t MPEG4Writer::Track::threadEntry() {
                 }
 
                 // Update ctts time offset range
-                if (mStszTableEntries->count() == 0) {
+                if (mNumSamples == 0) {
                     mMinCttsOffsetTicks = currCttsOffsetTimeTicks;
                     mMaxCttsOffsetTicks = currCttsOffsetTimeTicks;
                 } else {
@@ -3670,9 +4009,14 @@ status_t MPEG4Writer::Track::threadEntry() {
                     timestampUs += deltaUs;
                 }
             }
-            mStszTableEntries->add(htonl(sampleSize));
+            // A fragmented file's sample tables are in its fragments, and are
+            // not kept for the moov box.
+            if (!mOwner->isFragmented()) {
+                mStszTableEntries->add(htonl(sampleSize));
+            }
+            ++mNumSamples;
 
-            if (mStszTableEntries->count() > 2) {
+            if (mNumSamples > 2) {
 
                 // Force the first sample to have its own stts entry so that
                 // we can adjust its value later to maintain the A/V sync.
@@ -3684,7 +4028,7 @@ status_t MPEG4Writer::Track::threadEntry() {
                 }
             }
             if (mSamplesHaveSameSize) {
-                if (mStszTableEntries->count() >= 2 && previousSampleSize != sampleSize) {
+                if (mNumSamples >= 2 && previousSampleSize != sampleSize) {
                     mSamplesHaveSameSize = false;
                 }
                 previousSampleSize = sampleSize;
@@ -3696,7 +4040,7 @@ status_t MPEG4Writer::Track::threadEntry() {
             lastTimestampUs = timestampUs;
 
             if (isSync != 0) {
-                addOneStssTableEntry(mStszTableEntries->count());
+                addOneStssTableEntry(mNumSamples);
             }
 
             if (mTrackingProgressStatus) {
@@ -3706,7 +4050,7 @@ status_t MPEG4Writer::Track::threadEntry() {
                 trackProgressStatus(timestampUs);
             }
         }
-        if (!hasMultipleTracks) {
+        if (writeSamplesDirectly) {
             size_t bytesWritten;
             off64_t offset = mOwner->addSample_l(
                     copy, usePrefix, tiffHdrOffset, &bytesWritten);
@@ -3723,6 +4067,13 @@ status_t MPEG4Writer::Track::threadEntry() {
             continue;
         }
 
+        if (isFragmented) {
+            copy->meta_data().setInt64(kKeyDecodingTime, timestampUs);
+            copy->meta_data().setInt64(kKeyTime, mIsVideo ?
+                    timestampUs + cttsOffsetTimeUs - kMaxCttsOffsetTimeUs : timestampUs);
+            copy->meta_data().setInt32(kKeyIsSyncFrame, isSync);
+        }
+
         mChunkSamples.push_back(copy);
         if (mIsHeic) {
             bufferChunk(0 /*timestampUs*/);
@@ -3760,7 +4111,7 @@ status_t MPEG4Writer::Track::threadEntry() {
     mOwner->trackProgressStatus(mTrackId.getId(), -1, err);
 
     // Add final entries only for non-empty tracks.
-    if (mStszTableEntries->count() > 0) {
+    if (mNumSamples > 0) {
         if (mIsHeic) {
             if (!mChunkSamples.empty()) {
                 bufferChunk(0);
@@ -3768,8 +4119,8 @@ status_t MPEG4Writer::Track::threadEntry() {
             }
         } else {
             // Last chunk
-            if (!hasMultipleTracks) {
-                addOneStscTableEntry(1, mStszTableEntries->count());
+            if (writeSamplesDirectly) {
+                addOneStscTableEntry(1, mNumSamples);
             } else if (!mChunkSamples.empty()) {
                 addOneStscTableEntry(++nChunks, mChunkSamples.size());
                 bufferChunk(timestampUs);
@@ -3778,7 +4129,7 @@ status_t MPEG4Writer::Track::threadEntry() {
             // We don't really know how long the last frame lasts, since
             // there is no frame time after it, just repeat the previous
             // frame's duration.
-            if (mStszTableEntries->count() == 1) {
+            if (mNumSamples == 1) {
                 if (lastSampleDurationUs >= 0) {
                     addOneSttsTableEntry(sampleCount, lastSampleDurationTicks);
                 } else {
@@ -3813,7 +4164,7 @@ status_t MPEG4Writer::Track::threadEntry() {
     sendTrackSummary(hasMultipleTracks);
 
     ALOGI("Received total/0-length (%d/%d) buffers and encoded %d frames. - %s",
-            count, nZeroLengthFrames, mStszTableEntries->count(), trackName);
+            count, nZeroLengthFrames, mNumSamples, trackName);
     if (mIsAudio) {
         ALOGI("Audio track drift time: %" PRId64 " us", mOwner->getDriftTimeUs());
     }
@@ -3834,26 +4185,28 @@ bool MPEG4Writer::Track::isTrackMalFormed() {
         mOwner->mStartMeta->findInt32(kKeyEmptyTrackMalFormed, &emptyTrackMalformed) &&
         emptyTrackMalformed) {
         // MediaRecorder(sets kKeyEmptyTrackMalFormed by default) report empty tracks as malformed.
-        if (!mIsHeic && mStszTableEntries->count() == 0) {  // no samples written
+        if (!mIsHeic && mNumSamples == 0) {  // no samples written
             ALOGE("The number of recorded samples is 0");
             mIsMalformed = true;
             return true;
         }
-        if (mIsVideo && mStssTableEntries->count() == 0) {  // no sync frames for video
+        // no sync frames for video
+        if (mIsVideo && mStssTableEntries->count() == 0 && !mOwner->isFragmented()) {
             ALOGE("There are no sync frames for video track");
             mIsMalformed = true;
             return true;
         }
     } else {
         // Through MediaMuxer, empty tracks can be added. No sync frames for video.
-        if (mIsVideo && mStszTableEntries->count() > 0 && mStssTableEntries->count() == 0) {
+        if (mIsVideo && mNumSamples > 0 && mStssTableEntries->count() == 0 &&
+                !mOwner->isFragmented()) {
             ALOGE("There are no sync frames for video track");
             mIsMalformed = true;
             return true;
         }
     }
     // Don't check for CodecSpecificData when track is empty.
-    if (mStszTableEntries->count() > 0 && OK != checkCodecSpecificData()) {
+    if (mNumSamples > 0 && OK != checkCodecSpecificData()) {
         // No codec specific data.
         mIsMalformed = true;
         return true;
@@ -3881,7 +4234,7 @@ void MPEG4Writer::Track::sendTrackSummary(bool hasMultipleTracks) {
 
     mOwner->notify(MEDIA_RECORDER_TRACK_EVENT_INFO,
                     trackNum | MEDIA_RECORDER_TRACK_INFO_ENCODED_FRAMES,
-                    mStszTableEntries->count());
+                    mNumSamples);
 
     {
         // The system delay time excluding the requested initial delay that
@@ -4102,7 +4455,7 @@ int64_t MPEG4Writer::Track::getMinCttsOffsetTimeUs() {
 void MPEG4Writer::Track::writeStblBox() {
     mOwner->beginBox("stbl");
     // Add subboxes for only non-empty and well-formed tracks.
-    if (mStszTableEntries->count() > 0 && !isTrackMalFormed()) {
+    if (mNumSamples > 0 && !isTrackMalFormed()) {
         mOwner->beginBox("stsd");
         mOwner->writeInt32(0);               // version=0, flags=0
         mOwner->writeInt32(1);               // entry count
@@ -4114,10 +4467,14 @@ void MPEG4Writer::Track::writeStblBox() {
             writeMetadataFourCCBox();
         }
         mOwner->endBox();  // stsd
+        // A fragmented file's tables are left empty, its samples are all in
+        // the fragments. An empty stss box would mark no sample as sync.
         writeSttsBox();
         if (mIsVideo) {
             writeCttsBox();
-            writeStssBox();
+            if (!mOwner->isFragmented()) {
+                writeStssBox();
+            }
         }
         writeStszBox();
         writeStscBox();
@@ -4418,7 +4775,8 @@ void MPEG4Writer::Track::writeTkhdBox(uint32_t now) {
     mOwner->writeInt32(now);           // modification time
     mOwner->writeInt32(mTrackId.getId()); // track id starts with 1
     mOwner->writeInt32(0);             // reserved
-    int64_t trakDurationUs = getDurationUs();
+    // The duration of a fragmented file is not known when its moov box is written.
+    int64_t trakDurationUs = mOwner->isFragmented() ? 0 : getDurationUs();
     int32_t mvhdTimeScale = mOwner->getTimeScale();
     int32_t tkhdDuration =
         (trakDurationUs * mvhdTimeScale + 5E5) / 1E6;
@@ -4507,7 +4865,9 @@ void MPEG4Writer::Track::writeEdtsBox() {
     ALOGV("movieStartOffsetBFramesUs:%" PRId32, movieStartOffsetBFramesUs);
 
     // This media/track's real duration (sum of duration of all samples in this track).
-    uint32_t tkhdDurationTicks = (mTrackDurationUs * mvhdTimeScale + 5E5) / 1E6;
+    // Not known yet for a fragmented file, in which an edit of 0 lasts to the end.
+    uint32_t tkhdDurationTicks = mOwner->isFragmented() ? 0 :
+            (mTrackDurationUs * mvhdTimeScale + 5E5) / 1E6;
     ALOGV("mTrackDurationUs:%" PRId64 "us", mTrackDurationUs);
 
     int64_t movieStartTimeUs = mOwner->getStartTimestampUs();
@@ -4536,7 +4896,8 @@ void MPEG4Writer::Track::writeEdtsBox() {
             int32_t firstSampleOffsetTicks =
                     (mFirstSampleStartOffsetUs * mvhdTimeScale + 5E5) / 1E6;
             // samples before 0 don't count in for duration, hence subtract firstSampleOffsetTicks.
-            addOneElstTableEntry(tkhdDurationTicks - firstSampleOffsetTicks, mediaTime, 1, 0);
+            addOneElstTableEntry(tkhdDurationTicks > 0 ?
+                    tkhdDurationTicks - firstSampleOffsetTicks : 0, mediaTime, 1, 0);
         } else {
             // Track starting at zero.
             ALOGV("No edit list entry required for this track");
@@ -4621,7 +4982,7 @@ void MPEG4Writer::Track::writeEdtsBox() {
 }
 
 void MPEG4Writer::Track::writeMdhdBox(uint32_t now) {
-    int64_t trakDurationUs = getDurationUs();
+    int64_t trakDurationUs = mOwner->isFragmented() ? 0 : getDurationUs();
     int64_t mdhdDuration = (trakDurationUs * mTimeScale + 5E5) / 1E6;
     mOwner->beginBox("mdhd");
 
@@ -22,6 +22,8 @@
 #include <inttypes.h>
 #include <stdlib.h>
 
+#include <algorithm>
+
 #include <C2Buffer.h>
 
 #include "include/SoftwareRenderer.h"
@@ -651,6 +653,7 @@ MediaCodec::MediaCodec(
       mDequeueInputReplyID(0),
       mDequeueOutputTimeoutGeneration(0),
       mDequeueOutputReplyID(0),
+      mDequeueOutputMaxBuffers(0),
       mTunneledInputWidth(0),
       mTunneledInputHeight(0),
       mTunneled(false),
@@ -1619,6 +1622,29 @@ status_t MediaCodec::queueInputBuffer(
     return PostAndAwaitResponse(msg, &response);
 }
 
+status_t MediaCodec::queueInputBuffers(
+        const std::vector<BufferBatchEntry> &buffers, size_t *numQueued) {
+    *numQueued = 0;
+
+    sp<AMessage> msg = new AMessage(kWhatQueueInputBuffers, this);
+    sp<WrapperObject<std::vector<BufferBatchEntry>>> obj{
+        new WrapperObject<std::vector<BufferBatchEntry>>{buffers}};
+    msg->setObject("buffers", obj);
+
+    sp<AMessage> response;
+    status_t err = msg->postAndAwaitResponse(&response);
+    if (err != OK) {
+        return err;
+    }
+    if (!response->findSize("numQueued", numQueued)) {
+        *numQueued = 0;
+    }
+    if (!response->findInt32("err", &err)) {
+        err = OK;
+    }
+    return err;
+}
+
 status_t MediaCodec::queueSecureInputBuffer(
         size_t index,
         size_t offset,
@@ -1764,6 +1790,33 @@ status_t MediaCodec::dequeueOutputBuffer(
     return OK;
 }
 
+status_t MediaCodec::dequeueOutputBuffers(
+        std::vector<BufferBatchEntry> *buffers,
+        size_t maxBuffers,
+        int64_t timeoutUs) {
+    buffers->clear();
+    if (maxBuffers == 0) {
+        return BAD_VALUE;
+    }
+
+    sp<AMessage> msg = new AMessage(kWhatDequeueOutputBuffer, this);
+    msg->setInt64("timeoutUs", timeoutUs);
+    msg->setSize("maxBuffers", maxBuffers);
+
+    sp<AMessage> response;
+    status_t err;
+    if ((err = PostAndAwaitResponse(msg, &response)) != OK) {
+        return err;
+    }
+
+    sp<RefBase> obj;
+    CHECK(response->findObject("buffers", &obj));
+    *buffers = std::move(
+            static_cast<WrapperObject<std::vector<BufferBatchEntry>> *>(obj.get())->value);
+
+    return OK;
+}
+
 status_t MediaCodec::renderOutputBufferAndRelease(size_t index) {
     sp<AMessage> msg = new AMessage(kWhatReleaseOutputBuffer, this);
     msg->setSize("index", index);
@@ -2149,27 +2202,51 @@ bool MediaCodec::handleDequeueOutputBuffer(const sp<AReplyToken> &replyID, bool
             return true;
         }
 
-        ssize_t index = dequeuePortBuffer(kPortIndexOutput);
+        if (mDequeueOutputMaxBuffers == 0) {
+            BufferBatchEntry entry = dequeueOutputBufferEntry();
+            response->setSize("index", entry.index);
+            response->setSize("offset", entry.offset);
+            response->setSize("size", entry.size);
+            response->setInt64("timeUs", entry.presentationTimeUs);
+            response->setInt32("flags", entry.flags);
+        } else {
+            // Hands out the buffers available at once, up to the next format change.
+            sp<WrapperObject<std::vector<BufferBatchEntry>>> buffers{
+                new WrapperObject<std::vector<BufferBatchEntry>>{
+                    std::vector<BufferBatchEntry>()}};
+            do {
+                buffers->value.push_back(dequeueOutputBufferEntry());
+                info = peekNextPortBuffer(kPortIndexOutput);
+            } while (info != nullptr
+                    && buffers->value.size() < mDequeueOutputMaxBuffers
+                    && info->mData->format() == mOutputFormat);
+            response->setObject("buffers", buffers);
+        }
+        response->postReply(replyID);
+    }
 
-        response->setSize("index", index);
-        response->setSize("offset", buffer->offset());
-        response->setSize("size", buffer->size());
+    return true;
+}
 
-        int64_t timeUs;
-        CHECK(buffer->meta()->findInt64("timeUs", &timeUs));
+MediaCodec::BufferBatchEntry MediaCodec::dequeueOutputBufferEntry() {
+    BufferInfo *info = peekNextPortBuffer(kPortIndexOutput);
+    CHECK(info != nullptr);
+    const sp<MediaCodecBuffer> &buffer = info->mData;
 
-        statsBufferReceived(timeUs);
+    BufferBatchEntry entry;
+    entry.index = dequeuePortBuffer(kPortIndexOutput);
+    entry.offset = buffer->offset();
+    entry.size = buffer->size();
 
-        response->setInt64("timeUs", timeUs);
+    CHECK(buffer->meta()->findInt64("timeUs", &entry.presentationTimeUs));
 
-        int32_t flags;
-        CHECK(buffer->meta()->findInt32("flags", &flags));
+    statsBufferReceived(entry.presentationTimeUs);
 
-        response->setInt32("flags", flags);
-        response->postReply(replyID);
-    }
+    int32_t flags;
+    CHECK(buffer->meta()->findInt32("flags", &flags));
+    entry.flags = flags;
 
-    return true;
+    return entry;
 }
 
 void MediaCodec::onMessageReceived(const sp<AMessage> &msg) {
@@ -3328,6 +3405,35 @@ void MediaCodec::onMessageReceived(const sp<AMessage> &msg) {
             break;
         }
 
+        case kWhatQueueInputBuffers:
+        {
+            sp<AReplyToken> replyID;
+            CHECK(msg->senderAwaitsResponse(&replyID));
+
+            if (!isExecuting()) {
+                PostReplyWithError(replyID, INVALID_OPERATION);
+                break;
+            } else if (mFlags & kFlagStickyError) {
+                PostReplyWithError(replyID, getStickyError());
+                break;
+            }
+
+            sp<RefBase> obj;
+            CHECK(msg->findObject("buffers", &obj));
+            size_t numQueued = 0;
+            status_t err = onQueueInputBuffers(
+                    static_cast<WrapperObject<std::vector<BufferBatchEntry>> *>(obj.get())->value,
+                    &numQueued);
+
+            sp<AMessage> response = new AMessage;
+            response->setSize("numQueued", numQueued);
+            if (err != OK) {
+                response->setInt32("err", mReleasedByResourceManager ? DEAD_OBJECT : err);
+            }
+            response->postReply(replyID);
+            break;
+        }
+
         case kWhatDequeueOutputBuffer:
         {
             sp<AReplyToken> replyID;
@@ -3339,6 +3445,15 @@ void MediaCodec::onMessageReceived(const sp<AMessage> &msg) {
                 break;
             }
 
+            if (mFlags & kFlagDequeueOutputPending) {
+                // only one dequeue may be pending, keep its maxBuffers
+                PostReplyWithError(replyID, INVALID_OPERATION);
+                break;
+            }
+            if (!msg->findSize("maxBuffers", &mDequeueOutputMaxBuffers)) {
+                mDequeueOutputMaxBuffers = 0;
+            }
+
             if (handleDequeueOutputBuffer(replyID, true /* new request */)) {
                 break;
             }
@@ -4072,6 +4187,103 @@ status_t MediaCodec::onQueueInputBuffer(const sp<AMessage> &msg) {
     return err;
 }
 
+status_t MediaCodec::onQueueInputBuffers(
+        const std::vector<BufferBatchEntry> &entries, size_t *numQueued) {
+    *numQueued = 0;
+
+    if (!mLeftover.empty() || hasCryptoOrDescrambler()) {
+        // These need all of onQueueInputBuffer(), one buffer at a time.
+        AString errorDetailMsg;
+        for (const BufferBatchEntry &entry : entries) {
+            sp<AMessage> msg = new AMessage(kWhatQueueInputBuffer, this);
+            msg->setSize("index", entry.index);
+            msg->setSize("offset", entry.offset);
+            msg->setSize("size", entry.size);
+            msg->setInt64("timeUs", entry.presentationTimeUs);
+            msg->setInt32("flags", entry.flags);
+            msg->setPointer("errorDetailMsg", &errorDetailMsg);
+
+            status_t err;
+            if (!mLeftover.empty()) {
+                mLeftover.push_back(msg);
+                err = handleLeftover(entry.index);
+            } else {
+                err = onQueueInputBuffer(msg);
+            }
+            if (err != OK) {
+                return err;
+            }
+            ++*numQueued;
+        }
+        return OK;
+    }
+
+    // Checks the buffers up to the first bad one, the ones before it are
+    // still queued.
+    status_t err = OK;
+    std::vector<sp<MediaCodecBuffer>> buffers;
+    buffers.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const BufferBatchEntry &entry = entries[i];
+        if (entry.index >= mPortBuffers[kPortIndexInput].size()) {
+            err = -ERANGE;
+            break;
+        }
+
+        const BufferInfo &info = mPortBuffers[kPortIndexInput][entry.index];
+        const sp<MediaCodecBuffer> &buffer = info.mData;
+        if (buffer == nullptr || !info.mOwnedByClient) {
+            err = -EACCES;
+            break;
+        }
+        if (std::find(buffers.begin(), buffers.end(), buffer) != buffers.end()) {
+            ALOGE("[%s] input buffer %zu queued twice", mComponentName.c_str(), entry.index);
+            err = -EINVAL;
+            break;
+        }
+        if (entry.offset + entry.size > buffer->capacity()) {
+            err = -EINVAL;
+            break;
+        }
+
+        buffer->setRange(entry.offset, entry.size);
+        buffer->meta()->setInt64("timeUs", entry.presentationTimeUs);
+        if (entry.flags & BUFFER_FLAG_EOS) {
+            buffer->meta()->setInt32("eos", true);
+        }
+        if (entry.flags & BUFFER_FLAG_CODECCONFIG) {
+            buffer->meta()->setInt32("csd", true);
+        }
+        buffers.push_back(buffer);
+    }
+
+    size_t numBuffersQueued = 0;
+    if (!buffers.empty()) {
+        status_t queueErr = mBufferChannel->queueInputBuffers(buffers, &numBuffersQueued);
+        if (queueErr != OK) {
+            mediametrics_setInt32(mMetricsHandle, kCodecQueueInputBufferError, queueErr);
+            ALOGW("Log queueInputBuffers error: %d", queueErr);
+            err = queueErr;
+        }
+    }
+
+    {
+        // synchronization boundary for getBufferAndFormat
+        Mutex::Autolock al(mBufferLock);
+        for (size_t i = 0; i < numBuffersQueued; ++i) {
+            BufferInfo *info = &mPortBuffers[kPortIndexInput][entries[i].index];
+            info->mOwnedByClient = false;
+            info->mData.clear();
+        }
+    }
+    for (size_t i = 0; i < numBuffersQueued; ++i) {
+        statsBufferSent(entries[i].presentationTimeUs);
+    }
+
+    *numQueued = numBuffersQueued;
+    return err;
+}
+
 status_t MediaCodec::handleLeftover(size_t index) {
     if (mLeftover.empty()) {
         return OK;
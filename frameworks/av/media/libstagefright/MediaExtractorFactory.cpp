@@ -33,9 +33,14 @@
 #include <private/android_filesystem_config.h>
 #include <cutils/properties.h>
 #include <utils/String8.h>
+#include <utils/Timers.h>
 
 #include <dirent.h>
 #include <dlfcn.h>
+#include <inttypes.h>
+
+#include <atomic>
+#include <string_view>
 
 namespace android {
 
@@ -109,8 +114,13 @@ struct ExtractorPlugin : public RefBase {
     String8 libPath;
     String8 uuidString;
 
+    // Time spent in the sniff function, for dump()
+    std::atomic<uint32_t> sniffCount;
+    std::atomic<int64_t> sniffTimeUs;
+
     ExtractorPlugin(ExtractorDef definition, void *handle, String8 &path)
-        : def(definition), libHandle(handle), libPath(path) {
+        : def(definition), libHandle(handle), libPath(path),
+          sniffCount(0), sniffTimeUs(0) {
         for (size_t i = 0; i < sizeof ExtractorDef::extractor_uuid; i++) {
             uuidString.appendFormat("%02x", def.extractor_uuid.b[i]);
         }
@@ -128,6 +138,125 @@ std::shared_ptr<std::list<sp<ExtractorPlugin>>> MediaExtractorFactory::gPlugins;
 bool MediaExtractorFactory::gPluginsRegistered = false;
 bool MediaExtractorFactory::gIgnoreVersion = false;
 
+// The start of a source, read once and shared by all the sniffers. Most of
+// them only look at the first few kilobytes, through many small reads that
+// would each go to the source otherwise. Reads beyond it go to the source.
+struct SniffDataSource : public DataSource {
+    // Large enough for the sniffers of the common formats, and a single read
+    // of the IDataSource shared memory of a remote source.
+    static const size_t kWindowSize = 64 * 1024;
+
+    explicit SniffDataSource(const sp<DataSource> &source)
+        : mSource(source), mWindowSize(0) {
+        // Sources that cache data themselves are read as they are.
+        if (source->flags() & (kIsCachingDataSource | kIsHTTPBasedSource)) {
+            return;
+        }
+        size_t windowSize = kWindowSize;
+        off64_t size;
+        if (source->getSize(&size) == OK && size >= 0 && (uint64_t)size < windowSize) {
+            windowSize = size;
+        }
+        mWindow.reset(new (std::nothrow) uint8_t[windowSize]);
+        if (mWindow == nullptr) {
+            return;
+        }
+        ssize_t n = source->readAt(0, mWindow.get(), windowSize);
+        if (n > 0) {
+            mWindowSize = n;
+        }
+    }
+
+    virtual status_t initCheck() const { return mSource->initCheck(); }
+
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        if (offset >= 0 && (uint64_t)offset + size <= mWindowSize) {
+            memcpy(data, mWindow.get() + offset, size);
+            return size;
+        }
+        return mSource->readAt(offset, data, size);
+    }
+
+    virtual status_t getSize(off64_t *size) { return mSource->getSize(size); }
+    virtual uint32_t flags() { return mSource->flags(); }
+    virtual String8 toString() { return mSource->toString(); }
+    virtual String8 getUri() { return mSource->getUri(); }
+    virtual String8 getMIMEType() const { return mSource->getMIMEType(); }
+
+    size_t windowSize() const { return mWindowSize; }
+
+    // Identifies the content sniffed, along with the size of the source.
+    size_t windowHash() const {
+        return std::hash<std::string_view>()(
+                std::string_view((const char *)mWindow.get(), mWindowSize));
+    }
+
+private:
+    sp<DataSource> mSource;
+    std::unique_ptr<uint8_t[]> mWindow;
+    size_t mWindowSize;
+};
+
+// The plugins that recognized recently sniffed content. The same file tends
+// to be opened several times in a row, to be scanned, for its thumbnail and
+// to be played; its verdict is checked with the plugin that gave it alone.
+struct SniffVerdict {
+    size_t windowHash;
+    off64_t sourceSize;
+    sp<ExtractorPlugin> plugin;
+};
+
+static const size_t kMaxSniffVerdicts = 64;
+static Mutex gSniffVerdictMutex;
+static std::list<SniffVerdict> gSniffVerdicts;  // most recently used first
+static std::atomic<uint32_t> gSniffVerdictHits(0);
+
+static sp<ExtractorPlugin> findSniffVerdict(size_t windowHash, off64_t sourceSize) {
+    Mutex::Autolock autoLock(gSniffVerdictMutex);
+    for (auto it = gSniffVerdicts.begin(); it != gSniffVerdicts.end(); ++it) {
+        if (it->windowHash == windowHash && it->sourceSize == sourceSize) {
+            gSniffVerdicts.splice(gSniffVerdicts.begin(), gSniffVerdicts, it);
+            return gSniffVerdicts.front().plugin;
+        }
+    }
+    return NULL;
+}
+
+static void addSniffVerdict(
+        size_t windowHash, off64_t sourceSize, const sp<ExtractorPlugin> &plugin) {
+    Mutex::Autolock autoLock(gSniffVerdictMutex);
+    for (auto it = gSniffVerdicts.begin(); it != gSniffVerdicts.end(); ++it) {
+        if (it->windowHash == windowHash && it->sourceSize == sourceSize) {
+            gSniffVerdicts.erase(it);
+            break;
+        }
+    }
+    gSniffVerdicts.push_front({windowHash, sourceSize, plugin});
+    if (gSniffVerdicts.size() > kMaxSniffVerdicts) {
+        gSniffVerdicts.pop_back();
+    }
+}
+
+static void *sniffWithPlugin(
+        const sp<ExtractorPlugin> &plugin, const sp<DataSource> &source,
+        float *confidence, void **meta, FreeMetaFunc *freeMeta) {
+    ALOGV("sniffing %s", plugin->def.extractor_name);
+    const nsecs_t startNs = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    void *creator = NULL;
+    if (plugin->def.def_version == EXTRACTORDEF_VERSION_NDK_V1) {
+        creator = (void*) plugin->def.u.v2.sniff(
+                source->wrap(), confidence, meta, freeMeta);
+    } else if (plugin->def.def_version == EXTRACTORDEF_VERSION_NDK_V2) {
+        creator = (void*) plugin->def.u.v3.sniff(
+                source->wrap(), confidence, meta, freeMeta);
+    }
+
+    plugin->sniffCount++;
+    plugin->sniffTimeUs += (systemTime(SYSTEM_TIME_MONOTONIC) - startNs) / 1000;
+    return creator;
+}
+
 // static
 void *MediaExtractorFactory::sniff(
         const sp<DataSource> &source, float *confidence, void **meta,
@@ -144,21 +273,42 @@ void *MediaExtractorFactory::sniff(
         plugins = gPlugins;
     }
 
+    sp<SniffDataSource> sniffSource = new SniffDataSource(source);
+    const bool hasWindow = sniffSource->windowSize() > 0;
+    size_t windowHash = 0;
+    off64_t sourceSize = -1;
+    if (hasWindow) {
+        windowHash = sniffSource->windowHash();
+        if (source->getSize(&sourceSize) != OK) {
+            sourceSize = -1;
+        }
+
+        sp<ExtractorPlugin> cached = findSniffVerdict(windowHash, sourceSize);
+        if (cached != NULL) {
+            void *creator = sniffWithPlugin(cached, sniffSource, confidence, meta, freeMeta);
+            if (creator) {
+                ALOGV("sniffed %s again", cached->def.extractor_name);
+                gSniffVerdictHits++;
+                plugin = cached;
+                *creatorVersion = cached->def.def_version;
+                return creator;
+            }
+            if (*meta != nullptr && *freeMeta != nullptr) {
+                (*freeMeta)(*meta);
+            }
+            *confidence = 0.0f;
+            *meta = nullptr;
+        }
+    }
+
     void *bestCreator = NULL;
     for (auto it = plugins->begin(); it != plugins->end(); ++it) {
-        ALOGV("sniffing %s", (*it)->def.extractor_name);
         float newConfidence;
         void *newMeta = nullptr;
         FreeMetaFunc newFreeMeta = nullptr;
 
-        void *curCreator = NULL;
-        if ((*it)->def.def_version == EXTRACTORDEF_VERSION_NDK_V1) {
-            curCreator = (void*) (*it)->def.u.v2.sniff(
-                    source->wrap(), &newConfidence, &newMeta, &newFreeMeta);
-        } else if ((*it)->def.def_version == EXTRACTORDEF_VERSION_NDK_V2) {
-            curCreator = (void*) (*it)->def.u.v3.sniff(
-                    source->wrap(), &newConfidence, &newMeta, &newFreeMeta);
-        }
+        void *curCreator = sniffWithPlugin(
+                *it, sniffSource, &newConfidence, &newMeta, &newFreeMeta);
 
         if (curCreator) {
             if (newConfidence > *confidence) {
@@ -179,6 +329,9 @@ void *MediaExtractorFactory::sniff(
         }
     }
 
+    if (bestCreator && hasWindow) {
+        addSniffVerdict(windowHash, sourceSize, plugin);
+    }
     return bestCreator;
 }
 
@@ -365,6 +518,9 @@ status_t MediaExtractorFactory::dump(int fd, const Vector<String16>&) {
                         (*it)->uuidString.c_str(),
                         (*it)->def.extractor_version,
                         (*it)->libPath.c_str());
+                const uint32_t sniffCount = (*it)->sniffCount;
+                const int64_t sniffTimeUs = (*it)->sniffTimeUs;
+                out.appendFormat(", sniffed(%u in %" PRId64 " us)", sniffCount, sniffTimeUs);
                 if ((*it)->def.def_version == EXTRACTORDEF_VERSION_NDK_V2) {
                     out.append(", supports: ");
                     for (size_t i = 0;; i++) {
@@ -377,6 +533,11 @@ status_t MediaExtractorFactory::dump(int fd, const Vector<String16>&) {
                 }
                 out.append("\n");
             }
+            {
+                Mutex::Autolock autoLock(gSniffVerdictMutex);
+                out.appendFormat("Recent sniff verdicts: %zu, reused %u times\n",
+                        gSniffVerdicts.size(), (uint32_t)gSniffVerdictHits);
+            }
             out.append("\n");
         } else {
             out.append("  (no plugins registered)\n");
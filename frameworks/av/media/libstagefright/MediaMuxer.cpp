@@ -40,17 +40,25 @@
 
 namespace android {
 
+// Fragment duration of the fragmented mp4 files, unless set otherwise.
+static const int64_t kDefaultFragmentDurationUs = 2000000LL;
+
 static bool isMp4Format(MediaMuxer::OutputFormat format) {
     return format == MediaMuxer::OUTPUT_FORMAT_MPEG_4 ||
            format == MediaMuxer::OUTPUT_FORMAT_THREE_GPP ||
-           format == MediaMuxer::OUTPUT_FORMAT_HEIF;
+           format == MediaMuxer::OUTPUT_FORMAT_HEIF ||
+           format == MediaMuxer::OUTPUT_FORMAT_MPEG_4_FRAGMENTED;
 }
 
 MediaMuxer::MediaMuxer(int fd, OutputFormat format)
     : mFormat(format),
       mState(UNINITIALIZED) {
     if (isMp4Format(format)) {
-        mWriter = new MPEG4Writer(fd);
+        sp<MPEG4Writer> writer = new MPEG4Writer(fd);
+        if (format == OUTPUT_FORMAT_MPEG_4_FRAGMENTED) {
+            writer->setFragmentDuration(kDefaultFragmentDurationUs);
+        }
+        mWriter = writer;
     } else if (format == OUTPUT_FORMAT_WEBM) {
         mWriter = new WebmWriter(fd);
     } else if (format == OUTPUT_FORMAT_OGG) {
@@ -143,6 +151,24 @@ status_t MediaMuxer::setLocation(int latitude, int longitude) {
     return static_cast<MPEG4Writer*>(mWriter.get())->setGeoData(latitude, longitude);
 }
 
+status_t MediaMuxer::setFragmentDuration(int64_t durationUs) {
+    Mutex::Autolock autoLock(mMuxerLock);
+    if (mState != INITIALIZED) {
+        ALOGE("setFragmentDuration() must be called before start().");
+        return INVALID_OPERATION;
+    }
+    if (mFormat != OUTPUT_FORMAT_MPEG_4_FRAGMENTED) {
+        ALOGE("setFragmentDuration() is only supported for fragmented .mp4 output.");
+        return INVALID_OPERATION;
+    }
+    if (durationUs <= 0) {
+        ALOGE("setFragmentDuration() get invalid duration");
+        return -EINVAL;
+    }
+
+    return static_cast<MPEG4Writer*>(mWriter.get())->setFragmentDuration(durationUs);
+}
+
 status_t MediaMuxer::start() {
     Mutex::Autolock autoLock(mMuxerLock);
     if (mState == INITIALIZED) {
@@ -23,6 +23,9 @@
 
 #include <sys/time.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "ALooper.h"
 
 #include "AHandler.h"
@@ -33,6 +36,36 @@ namespace android {
 
 ALooperRoster gLooperRoster;
 
+struct ALooper::Impl {
+    // mImpl is where the List<Event> used to be, see ALooper.h
+    static_assert(sizeof(Impl *) == sizeof(List<Event>), "the layout of ALooper has changed");
+
+    struct QueuedEvent {
+        Event mEvent;
+        // orders the events due at the same time by when they were posted
+        uint64_t mSeq;
+
+        // the heap below keeps the event that is due last on top
+        bool operator<(const QueuedEvent &other) const {
+            return mEvent.mWhenUs > other.mEvent.mWhenUs
+                    || (mEvent.mWhenUs == other.mEvent.mWhenUs && mSeq > other.mSeq);
+        }
+    };
+
+    // a binary heap with the next event due first, see std::push_heap.
+    // Guarded by mLock.
+    std::vector<QueuedEvent> mEventQueue;
+    uint64_t mNextEventSeq = 0;
+
+    // A thread in awaitResponse(), woken up by the reply to its token or by stop().
+    // Guarded by mRepliesLock.
+    struct Waiter {
+        AReplyToken *mReplyToken;
+        Condition *mCondition;
+    };
+    std::vector<Waiter> mAwaitingReplies;
+};
+
 struct ALooper::LooperThread : public Thread {
     LooperThread(ALooper *looper, bool canCallJava)
         : Thread(canCallJava),
@@ -70,7 +103,8 @@ int64_t ALooper::GetNowUs() {
 }
 
 ALooper::ALooper()
-    : mRunningLocally(false) {
+    : mImpl(new Impl),
+      mRunningLocally(false) {
     // clean up stale AHandlers. Doing it here instead of in the destructor avoids
     // the side effect of objects being deleted from the unregister function recursively.
     gLooperRoster.unregisterStaleHandlers();
@@ -78,6 +112,7 @@ ALooper::ALooper()
 
 ALooper::~ALooper() {
     stop();
+    delete mImpl;
     // stale AHandlers are now cleaned up in the constructor of the next ALooper to come along
 }
 
@@ -153,7 +188,9 @@ status_t ALooper::stop() {
     mQueueChangedCondition.signal();
     {
         Mutex::Autolock autoLock(mRepliesLock);
-        mRepliesCondition.broadcast();
+        for (const Impl::Waiter &waiter : mImpl->mAwaitingReplies) {
+            waiter.mCondition->signal();
+        }
     }
 
     if (!runningLocally && !thread->isCurrentThread()) {
@@ -177,20 +214,13 @@ void ALooper::post(const sp<AMessage> &msg, int64_t delayUs) {
         whenUs = GetNowUs();
     }
 
-    List<Event>::iterator it = mEventQueue.begin();
-    while (it != mEventQueue.end() && (*it).mWhenUs <= whenUs) {
-        ++it;
-    }
-
-    Event event;
-    event.mWhenUs = whenUs;
-    event.mMessage = msg;
-
-    if (it == mEventQueue.begin()) {
+    std::vector<Impl::QueuedEvent> &queue = mImpl->mEventQueue;
+    if (queue.empty() || whenUs < queue.front().mEvent.mWhenUs) {
         mQueueChangedCondition.signal();
     }
 
-    mEventQueue.insert(it, event);
+    queue.push_back({{whenUs, msg}, mImpl->mNextEventSeq++});
+    std::push_heap(queue.begin(), queue.end());
 }
 
 bool ALooper::loop() {
@@ -201,11 +231,12 @@ bool ALooper::loop() {
         if (mThread == NULL && !mRunningLocally) {
             return false;
         }
-        if (mEventQueue.empty()) {
+        std::vector<Impl::QueuedEvent> &queue = mImpl->mEventQueue;
+        if (queue.empty()) {
             mQueueChangedCondition.wait(mLock);
             return true;
         }
-        int64_t whenUs = (*mEventQueue.begin()).mWhenUs;
+        int64_t whenUs = queue.front().mEvent.mWhenUs;
         int64_t nowUs = GetNowUs();
 
         if (whenUs > nowUs) {
@@ -218,8 +249,9 @@ bool ALooper::loop() {
             return true;
         }
 
-        event = *mEventQueue.begin();
-        mEventQueue.erase(mEventQueue.begin());
+        std::pop_heap(queue.begin(), queue.end());
+        event = std::move(queue.back().mEvent);
+        queue.pop_back();
     }
 
     event.mMessage->deliver();
@@ -242,23 +274,35 @@ status_t ALooper::awaitResponse(const sp<AReplyToken> &replyToken, sp<AMessage>
     // return status in case we want to handle an interrupted wait
     Mutex::Autolock autoLock(mRepliesLock);
     CHECK(replyToken != NULL);
+    status_t err = OK;
+    Condition condition;
+    mImpl->mAwaitingReplies.push_back({replyToken.get(), &condition});
     while (!replyToken->retrieveReply(response)) {
         {
             Mutex::Autolock autoLock(mLock);
             if (mThread == NULL) {
-                return -ENOENT;
+                err = -ENOENT;
+                break;
             }
         }
-        mRepliesCondition.wait(mRepliesLock);
+        condition.wait(mRepliesLock);
     }
-    return OK;
+    std::vector<Impl::Waiter> &waiters = mImpl->mAwaitingReplies;
+    waiters.erase(std::find_if(waiters.begin(), waiters.end(), [&](const Impl::Waiter &waiter) {
+        return waiter.mCondition == &condition;
+    }));
+    return err;
 }
 
 status_t ALooper::postReply(const sp<AReplyToken> &replyToken, const sp<AMessage> &reply) {
     Mutex::Autolock autoLock(mRepliesLock);
     status_t err = replyToken->setReply(reply);
     if (err == OK) {
-        mRepliesCondition.broadcast();
+        for (const Impl::Waiter &waiter : mImpl->mAwaitingReplies) {
+            if (waiter.mReplyToken == replyToken.get()) {
+                waiter.mCondition->signal();
+            }
+        }
     }
     return err;
 }
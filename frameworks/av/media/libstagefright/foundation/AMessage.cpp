@@ -41,6 +41,160 @@ namespace android {
 
 extern ALooperRoster gLooperRoster;
 
+namespace {
+
+// The pool would hide use-after-free of AMessages from the sanitizers.
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(hwaddress_sanitizer)
+#define AMESSAGE_NO_POOL
+#endif
+#endif
+#ifdef __SANITIZE_ADDRESS__
+#define AMESSAGE_NO_POOL
+#endif
+
+// Freed AMessages are kept in a per-thread cache. A thread whose cache is full
+// hands half of it over to a shared freelist, which threads with an empty cache
+// take from, so that messages freed on a looper thread are reused by the threads
+// posting to it. Both are bounded, anything beyond goes back to the heap.
+const size_t kMaxCachedPerThread = 16;
+const size_t kBatchSize = kMaxCachedPerThread / 2;
+const size_t kMaxCachedShared = 64;
+
+struct FreeBlock {
+    FreeBlock *mNext;
+};
+
+struct SharedFreeList {
+    SharedFreeList() : mHead(NULL), mCount(0) {}
+
+    Mutex mLock;
+    FreeBlock *mHead;
+    size_t mCount;
+};
+
+SharedFreeList &sharedFreeList() {
+    // never destroyed, as threads may still free messages after static destructors ran
+    static SharedFreeList *list = new SharedFreeList;
+    return *list;
+}
+
+// Trivially destructible, so that it remains usable by the destructors of other
+// thread_locals after ThreadCacheFlusher flushed it.
+struct ThreadCache {
+    FreeBlock *mHead;
+    size_t mCount;
+    bool mRegistered;
+    bool mExited;
+};
+
+thread_local ThreadCache tCache;
+
+// Returns a list of blocks to the shared freelist when there is room, to the heap otherwise.
+void releaseBlocks(FreeBlock *list) {
+    {
+        SharedFreeList &shared = sharedFreeList();
+        Mutex::Autolock autoLock(shared.mLock);
+        while (list != NULL && shared.mCount < kMaxCachedShared) {
+            FreeBlock *block = list;
+            list = list->mNext;
+            block->mNext = shared.mHead;
+            shared.mHead = block;
+            ++shared.mCount;
+        }
+    }
+    while (list != NULL) {
+        FreeBlock *block = list;
+        list = list->mNext;
+        ::operator delete(block);
+    }
+}
+
+void spillBlocks(ThreadCache *cache, size_t count) {
+    FreeBlock *list = NULL;
+    for (; count > 0 && cache->mHead != NULL; --count) {
+        FreeBlock *block = cache->mHead;
+        cache->mHead = block->mNext;
+        --cache->mCount;
+        block->mNext = list;
+        list = block;
+    }
+    releaseBlocks(list);
+}
+
+struct ThreadCacheFlusher {
+    ~ThreadCacheFlusher() {
+        spillBlocks(&tCache, tCache.mCount);
+        tCache.mExited = true;
+    }
+};
+
+thread_local ThreadCacheFlusher tCacheFlusher;
+
+// Makes sure the cache is flushed when this thread exits.
+void registerCache(ThreadCache *cache) {
+    if (!cache->mRegistered) {
+        (void)&tCacheFlusher;  // constructs the flusher of this thread
+        cache->mRegistered = true;
+    }
+}
+
+bool refillBlocks(ThreadCache *cache) {
+    registerCache(cache);
+    SharedFreeList &shared = sharedFreeList();
+    Mutex::Autolock autoLock(shared.mLock);
+    for (size_t i = 0; i < kBatchSize && shared.mHead != NULL; ++i) {
+        FreeBlock *block = shared.mHead;
+        shared.mHead = block->mNext;
+        --shared.mCount;
+        block->mNext = cache->mHead;
+        cache->mHead = block;
+        ++cache->mCount;
+    }
+    return cache->mHead != NULL;
+}
+
+}  // namespace
+
+// static
+void *AMessage::operator new(size_t size) {
+#ifndef AMESSAGE_NO_POOL
+    ThreadCache *cache = &tCache;
+    if (size == sizeof(AMessage) && !cache->mExited
+            && (cache->mHead != NULL || refillBlocks(cache))) {
+        FreeBlock *block = cache->mHead;
+        cache->mHead = block->mNext;
+        --cache->mCount;
+        return block;
+    }
+#endif
+    return ::operator new(size);
+}
+
+// static
+void AMessage::operator delete(void *ptr, size_t size) {
+#ifndef AMESSAGE_NO_POOL
+    if (ptr != NULL && size == sizeof(AMessage)) {
+        FreeBlock *block = static_cast<FreeBlock *>(ptr);
+        ThreadCache *cache = &tCache;
+        if (cache->mExited) {
+            block->mNext = NULL;
+            releaseBlocks(block);
+            return;
+        }
+        registerCache(cache);
+        if (cache->mCount >= kMaxCachedPerThread) {
+            spillBlocks(cache, kBatchSize);
+        }
+        block->mNext = cache->mHead;
+        cache->mHead = block;
+        ++cache->mCount;
+        return;
+    }
+#endif
+    ::operator delete(ptr);
+}
+
 status_t AReplyToken::setReply(const sp<AMessage> &reply) {
     if (mReplied) {
         ALOGE("trying to post a duplicate reply");
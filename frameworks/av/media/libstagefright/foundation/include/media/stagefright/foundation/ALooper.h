@@ -74,7 +74,11 @@ private:
 
     AString mName;
 
-    List<Event> mEventQueue;
+    // The pending events and the threads waiting for a reply, see ALooper.cpp.
+    // This takes the place of a List<Event>, which is also a single pointer,
+    // so that the layout of ALooper is unchanged.
+    struct Impl;
+    Impl *mImpl;
 
     struct LooperThread;
     sp<LooperThread> mThread;
@@ -83,6 +87,7 @@ private:
     // use a separate lock for reply handling, as it is always on another thread
     // use a central lock, however, to avoid creating a mutex for each reply
     Mutex mRepliesLock;
+    // no longer used, each waiting thread has its own condition in mImpl
     Condition mRepliesCondition;
 
     // START --- methods used only by AMessage
@@ -63,6 +63,11 @@ struct AMessage : public RefBase {
     AMessage();
     AMessage(uint32_t what, const sp<const AHandler> &handler);
 
+    // AMessages are recycled through a small per-thread cache instead of going
+    // back to the heap each time, as nearly every message posted is a new one.
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+
 #ifndef __ANDROID_VNDK__
     // Construct an AMessage from a parcel.
     // nestingAllowed determines how many levels AMessage can be nested inside
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AHandler.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+
+namespace android {
+
+namespace {
+
+enum {
+    kWhatCount,
+    kWhatReply,
+};
+
+// Counts the messages delivered, and replies to those that await one.
+struct CountingHandler : public AHandler {
+    CountingHandler() : mCount(0) {}
+
+    void waitFor(int64_t count) {
+        Mutex::Autolock autoLock(mLock);
+        while (mCount < count) {
+            mCondition.wait(mLock);
+        }
+    }
+
+protected:
+    virtual void onMessageReceived(const sp<AMessage> &msg) {
+        if (msg->what() == kWhatReply) {
+            sp<AReplyToken> replyID;
+            CHECK(msg->senderAwaitsResponse(&replyID));
+            (new AMessage)->postReply(replyID);
+            return;
+        }
+        Mutex::Autolock autoLock(mLock);
+        if (++mCount % kSignalEvery == 0) {
+            mCondition.signal();
+        }
+    }
+
+private:
+    static const int64_t kSignalEvery = 64;
+
+    Mutex mLock;
+    Condition mCondition;
+    int64_t mCount;
+};
+
+struct LooperFixture {
+    explicit LooperFixture(bool start = true) {
+        mLooper = new ALooper;
+        mLooper->setName("ALooperBenchmark");
+        mHandler = new CountingHandler;
+        mLooper->registerHandler(mHandler);
+        if (start) {
+            mLooper->start();
+        }
+    }
+
+    ~LooperFixture() {
+        mLooper->unregisterHandler(mHandler->id());
+        mLooper->stop();
+    }
+
+    sp<ALooper> mLooper;
+    sp<CountingHandler> mHandler;
+};
+
+// A pseudo random delay of up to a second, the same from run to run.
+int64_t nextDelayUs(uint32_t *seed) {
+    *seed = *seed * 1103515245 + 12345;
+    return (*seed >> 8) % 1000000;
+}
+
+}  // namespace
+
+// Throughput of messages posted by one thread and delivered on the looper
+// thread, with a few items each as is typical. Includes allocating and freeing
+// the messages.
+static void BM_PostDeliver(benchmark::State& state) {
+    LooperFixture fixture;
+    int64_t posted = 0;
+    for (auto _ : state) {
+        for (int64_t i = 0; i < 64; ++i) {
+            sp<AMessage> msg = new AMessage(kWhatCount, fixture.mHandler);
+            msg->setInt64("timeUs", i);
+            msg->setInt32("generation", 1);
+            msg->post();
+        }
+        posted += 64;
+        fixture.mHandler->waitFor(posted);
+    }
+    state.SetItemsProcessed(posted);
+}
+BENCHMARK(BM_PostDeliver)->UseRealTime();
+
+// Latency of a round trip to the looper thread and back.
+static void BM_PostAndAwaitResponse(benchmark::State& state) {
+    LooperFixture fixture;
+    for (auto _ : state) {
+        sp<AMessage> response;
+        (new AMessage(kWhatReply, fixture.mHandler))->postAndAwaitResponse(&response);
+    }
+}
+BENCHMARK(BM_PostAndAwaitResponse)->UseRealTime();
+
+// Cost of posting a delayed message into a queue of range(0) pending ones.
+static void BM_PostDelayed(benchmark::State& state) {
+    const int64_t kBatch = 256;
+    sp<AMessage> msg;
+    uint32_t seed = 1;
+    for (auto _ : state) {
+        state.PauseTiming();
+        {
+            // the looper is not started, nothing is delivered
+            LooperFixture fixture(false /* start */);
+            msg = new AMessage(kWhatCount, fixture.mHandler);
+            for (int64_t i = 0; i < state.range(0); ++i) {
+                msg->post(nextDelayUs(&seed));
+            }
+            state.ResumeTiming();
+            for (int64_t i = 0; i < kBatch; ++i) {
+                msg->post(nextDelayUs(&seed));
+            }
+            state.PauseTiming();
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * kBatch);
+}
+BENCHMARK(BM_PostDelayed)->Arg(16)->Arg(256)->Arg(4096);
+
+// Allocating and freeing messages on the same thread.
+static void BM_NewMessage(benchmark::State& state) {
+    for (auto _ : state) {
+        sp<AMessage> msg = new AMessage;
+        benchmark::DoNotOptimize(msg.get());
+    }
+}
+BENCHMARK(BM_NewMessage);
+
+}  // namespace android
+
+BENCHMARK_MAIN();
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ALooper_test"
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/AHandler.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+
+#include <thread>
+#include <vector>
+
+namespace android {
+
+namespace {
+
+// Records the order messages are delivered in, and replies to those that await one.
+struct RecordingHandler : public AHandler {
+    enum {
+        kWhatIgnoreReply = 'igno',
+    };
+
+    std::vector<uint32_t> waitFor(size_t count) {
+        Mutex::Autolock autoLock(mLock);
+        while (mDelivered.size() < count) {
+            mCondition.wait(mLock);
+        }
+        return mDelivered;
+    }
+
+protected:
+    virtual void onMessageReceived(const sp<AMessage> &msg) {
+        sp<AReplyToken> replyID;
+        if (msg->what() != kWhatIgnoreReply && msg->senderAwaitsResponse(&replyID)) {
+            sp<AMessage> response = new AMessage;
+            response->setInt32("what", msg->what());
+            response->postReply(replyID);
+        }
+        Mutex::Autolock autoLock(mLock);
+        mDelivered.push_back(msg->what());
+        mCondition.signal();
+    }
+
+private:
+    Mutex mLock;
+    Condition mCondition;
+    std::vector<uint32_t> mDelivered;
+};
+
+}  // namespace
+
+class ALooperTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        mLooper = new ALooper;
+        mLooper->setName("ALooperTest");
+        mHandler = new RecordingHandler;
+        mLooper->registerHandler(mHandler);
+    }
+
+    virtual void TearDown() {
+        mLooper->unregisterHandler(mHandler->id());
+        mLooper->stop();
+    }
+
+    sp<ALooper> mLooper;
+    sp<RecordingHandler> mHandler;
+};
+
+TEST_F(ALooperTest, DeliversByDueTime) {
+    // queued before the looper starts, so that they are all pending at once
+    const int64_t kDelaysUs[] = { 30000, 10000, 0, 20000, 10000, 0 };
+    for (size_t i = 0; i < sizeof(kDelaysUs) / sizeof(kDelaysUs[0]); ++i) {
+        ASSERT_EQ(OK, (new AMessage(i, mHandler))->post(kDelaysUs[i]));
+    }
+    ASSERT_EQ(OK, mLooper->start());
+
+    // messages due at the same time are delivered in the order they were posted
+    const std::vector<uint32_t> expected = { 2, 5, 1, 4, 3, 0 };
+    EXPECT_EQ(expected, mHandler->waitFor(expected.size()));
+}
+
+TEST_F(ALooperTest, KeepsPostingOrder) {
+    ASSERT_EQ(OK, mLooper->start());
+    const size_t kNumMessages = 1000;
+    for (size_t i = 0; i < kNumMessages; ++i) {
+        ASSERT_EQ(OK, (new AMessage(i, mHandler))->post());
+    }
+    const std::vector<uint32_t> delivered = mHandler->waitFor(kNumMessages);
+    ASSERT_EQ(kNumMessages, delivered.size());
+    for (size_t i = 0; i < kNumMessages; ++i) {
+        EXPECT_EQ(i, delivered[i]);
+    }
+}
+
+TEST_F(ALooperTest, RepliesToEachSender) {
+    ASSERT_EQ(OK, mLooper->start());
+    const size_t kNumThreads = 4;
+    const size_t kNumMessages = 100;
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < kNumThreads; ++t) {
+        threads.emplace_back([this, t] {
+            for (size_t i = 0; i < kNumMessages; ++i) {
+                const uint32_t what = t * kNumMessages + i;
+                sp<AMessage> response;
+                ASSERT_EQ(OK, (new AMessage(what, mHandler))->postAndAwaitResponse(&response));
+                int32_t replyWhat;
+                ASSERT_TRUE(response->findInt32("what", &replyWhat));
+                EXPECT_EQ(what, (uint32_t)replyWhat);
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+TEST_F(ALooperTest, StopWakesUpSender) {
+    ASSERT_EQ(OK, mLooper->start());
+    status_t err = OK;
+    std::thread sender([this, &err] {
+        sp<AMessage> response;
+        err = (new AMessage(RecordingHandler::kWhatIgnoreReply, mHandler))
+                ->postAndAwaitResponse(&response);
+    });
+    mHandler->waitFor(1);
+    mLooper->stop();
+    sender.join();
+    EXPECT_EQ(-ENOENT, err);
+}
+
+TEST_F(ALooperTest, RecyclesMessages) {
+    ASSERT_EQ(OK, mLooper->start());
+    // messages freed on the looper thread come back to this one
+    for (size_t i = 0; i < 100; ++i) {
+        sp<AMessage> msg = new AMessage(i, mHandler);
+        msg->setInt32("index", i);
+        ASSERT_EQ(OK, msg->post());
+    }
+    mHandler->waitFor(100);
+    sp<AMessage> msg = new AMessage;
+    EXPECT_EQ(0u, msg->countEntries());
+    EXPECT_EQ(0u, msg->what());
+}
+
+}  // namespace android
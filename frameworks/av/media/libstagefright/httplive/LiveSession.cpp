@@ -22,6 +22,7 @@
 #include "HTTPDownloader.h"
 #include "M3UParser.h"
 #include "PlaylistFetcher.h"
+#include "SegmentPrefetcher.h"
 
 #include "mpeg2ts/AnotherPacketSource.h"
 
@@ -495,6 +496,18 @@ sp<HTTPDownloader> LiveSession::getHTTPDownloader() {
     return new HTTPDownloader(mHTTPService, mExtraHeaders);
 }
 
+sp<SegmentPrefetcher> LiveSession::getSegmentPrefetcher() {
+    // Segments downloaded ahead of the one being parsed, and the connections
+    // they are downloaded over, which also split large byte ranges.
+    int32_t numSegments = property_get_int32("media.httplive.prefetch-segments", 2);
+    int32_t numConnections = property_get_int32("media.httplive.prefetch-connections", 2);
+    if (numSegments <= 0 || numConnections <= 0) {
+        return NULL;
+    }
+    return new SegmentPrefetcher(
+            mHTTPService, mExtraHeaders, numConnections, numSegments + 1);
+}
+
 void LiveSession::setBufferingSettings(
         const BufferingSettings &buffering) {
     sp<AMessage> msg = new AMessage(kWhatSetBufferingSettings, this);
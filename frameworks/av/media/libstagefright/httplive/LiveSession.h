@@ -39,6 +39,7 @@ struct M3UParser;
 struct PlaylistFetcher;
 struct HLSTime;
 struct HTTPDownloader;
+struct SegmentPrefetcher;
 
 struct LiveSession : public AHandler {
     enum Flags {
@@ -82,6 +83,10 @@ struct LiveSession : public AHandler {
 
     sp<HTTPDownloader> getHTTPDownloader();
 
+    // Returns a prefetcher for the segments of a playlist, or NULL if
+    // prefetching is disabled by the media.httplive.prefetch-* properties.
+    sp<SegmentPrefetcher> getSegmentPrefetcher();
+
     void connectAsync(
             const char *url,
             const KeyedVector<String8, String8> *headers = NULL);
@@ -24,6 +24,7 @@
 #include "HTTPDownloader.h"
 #include "LiveSession.h"
 #include "M3UParser.h"
+#include "SegmentPrefetcher.h"
 #include "include/ID3.h"
 #include "mpeg2ts/AnotherPacketSource.h"
 #include "mpeg2ts/HlsSampleDecryptor.h"
@@ -519,12 +520,17 @@ void PlaylistFetcher::cancelMonitorQueue() {
 }
 
 void PlaylistFetcher::setStoppingThreshold(float thresholdRatio, bool disconnect) {
+    sp<SegmentPrefetcher> segmentPrefetcher;
     {
         AutoMutex _l(mThresholdLock);
         mThresholdRatio = thresholdRatio;
+        segmentPrefetcher = mSegmentPrefetcher;
     }
     if (disconnect) {
         mHTTPDownloader->disconnect();
+        if (segmentPrefetcher != NULL) {
+            segmentPrefetcher->disconnect();
+        }
     }
 }
 
@@ -535,9 +541,15 @@ void PlaylistFetcher::resetStoppingThreshold(bool disconnect) {
     }
     if (disconnect) {
         mHTTPDownloader->disconnect();
+        if (mSegmentPrefetcher != NULL) {
+            mSegmentPrefetcher->disconnect();
+        }
     } else {
         // allow reconnect
         mHTTPDownloader->reconnect();
+        if (mSegmentPrefetcher != NULL) {
+            mSegmentPrefetcher->reconnect();
+        }
     }
 }
 
@@ -779,6 +791,9 @@ status_t PlaylistFetcher::onStart(const sp<AMessage> &msg) {
         mSeqNumber = -1;
         mTimeChangeSignaled = false;
         mDownloadState->resetState();
+        if (mSegmentPrefetcher != NULL) {
+            mSegmentPrefetcher->cancel();
+        }
     }
 
     postMonitorQueue();
@@ -1364,14 +1379,35 @@ void PlaylistFetcher::onDownloadNext() {
         range_length = -1;
     }
 
-    // block-wise download
+    // A segment already partly downloaded by mHTTPDownloader is finished by it.
+    bool prefetched = false;
+    if (buffer == NULL) {
+        prefetched = prefetchSegments(
+                uri, range_offset, range_length,
+                firstSeqNumberInPlaylist, lastSeqNumberInPlaylist);
+    } else {
+        int32_t val;
+        prefetched = buffer->meta()->findInt32("prefetched", &val) && val != 0;
+    }
+
+    // block-wise download, or the whole segment at once if prefetched
     bool shouldPause = false;
     ssize_t bytesRead;
     do {
         int64_t startUs = ALooper::GetNowUs();
-        bytesRead = mHTTPDownloader->fetchBlock(
-                uri.c_str(), &buffer, range_offset, range_length, kDownloadBlockSize,
-                NULL /* actualURL */, connectHTTP);
+        if (!prefetched) {
+            bytesRead = mHTTPDownloader->fetchBlock(
+                    uri.c_str(), &buffer, range_offset, range_length, kDownloadBlockSize,
+                    NULL /* actualURL */, connectHTTP);
+        } else if (buffer == NULL) {
+            bytesRead = mSegmentPrefetcher->fetch(
+                    uri, range_offset, range_length, &buffer);
+            if (bytesRead >= 0) {
+                buffer->meta()->setInt32("prefetched", true);
+            }
+        } else {
+            bytesRead = 0;
+        }
         int64_t delayUs = ALooper::GetNowUs() - startUs;
 
         if (bytesRead == ERROR_NOT_CONNECTED) {
@@ -1384,17 +1420,24 @@ void PlaylistFetcher::onDownloadNext() {
             return;
         }
 
+        // Prefetched segments are downloaded in parallel, each at a fraction of
+        // the bandwidth, so what is measured is the throughput of all of them.
+        size_t numBytes = bytesRead;
+        if (prefetched) {
+            mSegmentPrefetcher->takeBandwidthSample(&numBytes, &delayUs);
+        }
+
         // add sample for bandwidth estimation, excluding samples from subtitles (as
         // its too small), or during startup/resumeUntil (when we could have more than
         // one connection open which affects bandwidth)
-        if (!mStartup && mStopParams == NULL && bytesRead > 0
+        if (!mStartup && mStopParams == NULL && numBytes > 0 && delayUs > 0
                 && (mStreamTypeMask
                         & (LiveSession::STREAMTYPE_AUDIO
                         | LiveSession::STREAMTYPE_VIDEO))) {
-            mSession->addBandwidthMeasurement(bytesRead, delayUs);
+            mSession->addBandwidthMeasurement(numBytes, delayUs);
             if (delayUs > 2000000LL) {
-                FLOGV("bytesRead %zd took %.2f seconds - abnormal bandwidth dip",
-                        bytesRead, (double)delayUs / 1.0e6);
+                FLOGV("%zu bytes took %.2f seconds - abnormal bandwidth dip",
+                        numBytes, (double)delayUs / 1.0e6);
             }
         }
 
@@ -1555,6 +1598,54 @@ void PlaylistFetcher::onDownloadNext() {
     }
 }
 
+bool PlaylistFetcher::prefetchSegments(
+        const AString &uri, int64_t range_offset, int64_t range_length,
+        int32_t firstSeqNumberInPlaylist, int32_t lastSeqNumberInPlaylist) {
+    // Only once playback is under way, as during startup the starting segment
+    // is still being looked for, and the same way as bandwidth is measured.
+    if (!mStartup && mStopParams == NULL
+            && (mStreamTypeMask
+                    & (LiveSession::STREAMTYPE_AUDIO
+                    | LiveSession::STREAMTYPE_VIDEO))) {
+        if (mSegmentPrefetcher == NULL) {
+            // setStoppingThreshold() may disconnect it from another thread.
+            sp<SegmentPrefetcher> segmentPrefetcher = mSession->getSegmentPrefetcher();
+            AutoMutex _l(mThresholdLock);
+            mSegmentPrefetcher = segmentPrefetcher;
+            if (mSegmentPrefetcher != NULL && mHTTPDownloader->isDisconnecting()) {
+                mSegmentPrefetcher->disconnect();
+            }
+        }
+        if (mSegmentPrefetcher != NULL) {
+            mSegmentPrefetcher->prefetch(uri, range_offset, range_length);
+            for (int32_t seqNumber = mSeqNumber + 1;
+                    seqNumber <= lastSeqNumberInPlaylist; ++seqNumber) {
+                AString nextUri;
+                sp<AMessage> nextItemMeta;
+                if (!mPlaylist->itemAt(seqNumber - firstSeqNumberInPlaylist,
+                        &nextUri, &nextItemMeta)) {
+                    break;
+                }
+                int64_t nextRangeOffset, nextRangeLength;
+                if (!nextItemMeta->findInt64("range-offset", &nextRangeOffset)
+                        || !nextItemMeta->findInt64("range-length", &nextRangeLength)) {
+                    nextRangeOffset = 0;
+                    nextRangeLength = -1;
+                }
+                if (!mSegmentPrefetcher->prefetch(
+                        nextUri, nextRangeOffset, nextRangeLength)) {
+                    break;
+                }
+            }
+            return true;
+        }
+    }
+
+    // Still use a segment prefetched before e.g. resumeUntil.
+    return mSegmentPrefetcher != NULL
+            && mSegmentPrefetcher->isQueued(uri, range_offset, range_length);
+}
+
 /*
  * returns true if we need to adjust mSeqNumber
  */
@@ -32,6 +32,7 @@ class DataSource;
 struct HTTPBase;
 struct LiveDataSource;
 struct M3UParser;
+struct SegmentPrefetcher;
 class String8;
 
 struct PlaylistFetcher : public AHandler {
@@ -118,6 +119,8 @@ private:
     sp<AMessage> mStartTimeUsNotify;
 
     sp<HTTPDownloader> mHTTPDownloader;
+    // Downloads the next segments ahead, created once playback is under way.
+    sp<SegmentPrefetcher> mSegmentPrefetcher;
     sp<LiveSession> mSession;
     AString mURI;
 
@@ -231,6 +234,11 @@ private:
             sp<AMessage> &itemMeta,
             int32_t &firstSeqNumberInPlaylist,
             int32_t &lastSeqNumberInPlaylist);
+    // Queues the segment at uri and the ones after it with mSegmentPrefetcher,
+    // and returns whether the segment is to be fetched through it.
+    bool prefetchSegments(
+            const AString &uri, int64_t range_offset, int64_t range_length,
+            int32_t firstSeqNumberInPlaylist, int32_t lastSeqNumberInPlaylist);
 
     // Resume a fetcher to continue until the stopping point stored in msg.
     status_t onResumeUntil(const sp<AMessage> &msg);
@@ -0,0 +1,364 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SegmentPrefetcher"
+#include <utils/Log.h>
+
+#include "HTTPDownloader.h"
+#include "SegmentPrefetcher.h"
+
+#include <media/MediaHTTPService.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/FoundationUtils.h>
+#include <media/stagefright/MediaErrors.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include <algorithm>
+
+namespace android {
+
+// static
+const int64_t SegmentPrefetcher::kDefaultSplitSize = 1024 * 1024;
+
+bool SegmentPrefetcher::Segment::isDone() const {
+    for (const Part &part : mParts) {
+        if (part.mState != Part::DONE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+SegmentPrefetcher::SegmentPrefetcher(
+        const sp<MediaHTTPService> &httpService,
+        const KeyedVector<String8, String8> &headers,
+        size_t numConnections,
+        size_t maxSegments,
+        int64_t splitSize)
+    : mMaxSegments(maxSegments),
+      mSplitSize(splitSize),
+      mDisconnecting(false),
+      mStopping(false),
+      mNumActiveDownloads(0),
+      mBusySinceUs(0),
+      mBusyUs(0),
+      mDownloadedBytes(0) {
+    CHECK_GT(numConnections, 0u);
+    CHECK_GT(splitSize, 0);
+    for (size_t i = 0; i < numConnections; ++i) {
+        mDownloaders.push_back(new HTTPDownloader(httpService, headers));
+    }
+    mAborted.resize(numConnections, false);
+    for (size_t i = 0; i < numConnections; ++i) {
+        mThreads.emplace_back(&SegmentPrefetcher::threadLoop, this, i);
+    }
+}
+
+SegmentPrefetcher::~SegmentPrefetcher() {
+    {
+        Mutex::Autolock autoLock(mLock);
+        mStopping = true;
+        mCondition.broadcast();
+    }
+    for (const sp<HTTPDownloader> &downloader : mDownloaders) {
+        downloader->disconnect();
+    }
+    for (std::thread &thread : mThreads) {
+        thread.join();
+    }
+}
+
+sp<SegmentPrefetcher::Segment> SegmentPrefetcher::findSegment_l(
+        const AString &url, int64_t range_offset, int64_t range_length) {
+    for (const sp<Segment> &segment : mSegments) {
+        if (segment->mUrl == url
+                && segment->mRangeOffset == range_offset
+                && segment->mRangeLength == range_length) {
+            return segment;
+        }
+    }
+    return NULL;
+}
+
+sp<SegmentPrefetcher::Segment> SegmentPrefetcher::queueSegment_l(
+        const AString &url, int64_t range_offset, int64_t range_length,
+        bool front) {
+    sp<Segment> segment = new Segment;
+    segment->mUrl = url;
+    segment->mRangeOffset = range_offset;
+    segment->mRangeLength = range_length;
+    segment->mDropped = false;
+
+    // Only a range of a known length can be split, the size of a whole file
+    // is not known before it is downloaded.
+    size_t numParts = 1;
+    if (range_length >= 2 * mSplitSize) {
+        numParts = std::min<int64_t>(mDownloaders.size(), range_length / mSplitSize);
+    }
+    const int64_t partLength = numParts > 1
+            ? (range_length + numParts - 1) / numParts : range_length;
+    for (size_t i = 0; i < numParts; ++i) {
+        Part part;
+        part.mOffset = range_offset + i * partLength;
+        part.mLength = numParts > 1
+                ? std::min(partLength, range_length - (int64_t)i * partLength)
+                : range_length;
+        part.mState = Part::QUEUED;
+        part.mError = OK;
+        segment->mParts.push_back(part);
+    }
+
+    ALOGV("queueing %zu part(s) of %s @%lld+%lld", numParts,
+            uriDebugString(url).c_str(), (long long)range_offset, (long long)range_length);
+
+    if (front) {
+        mSegments.push_front(segment);
+    } else {
+        mSegments.push_back(segment);
+    }
+    mCondition.broadcast();
+    return segment;
+}
+
+void SegmentPrefetcher::dropSegment_l(const sp<Segment> &segment) {
+    segment->mDropped = true;
+    // Nobody waits for the parts being downloaded any more, so their connections
+    // are freed up for the segments that are needed now.
+    for (const Part &part : segment->mParts) {
+        if (part.mState == Part::DOWNLOADING && !mAborted[part.mConnection]) {
+            ALOGV("aborting %s @%lld on connection %zu",
+                    uriDebugString(segment->mUrl).c_str(), (long long)part.mOffset,
+                    part.mConnection);
+            mAborted[part.mConnection] = true;
+            mDownloaders[part.mConnection]->disconnect();
+        }
+    }
+}
+
+void SegmentPrefetcher::dropSegments_l() {
+    for (const sp<Segment> &segment : mSegments) {
+        dropSegment_l(segment);
+    }
+    mSegments.clear();
+    mCondition.broadcast();
+}
+
+bool SegmentPrefetcher::prefetch(
+        const AString &url, int64_t range_offset, int64_t range_length) {
+    Mutex::Autolock autoLock(mLock);
+    if (mDisconnecting) {
+        return false;
+    }
+    if (findSegment_l(url, range_offset, range_length) != NULL) {
+        return true;
+    }
+    if (mSegments.size() >= mMaxSegments) {
+        return false;
+    }
+    queueSegment_l(url, range_offset, range_length, false /* front */);
+    return true;
+}
+
+bool SegmentPrefetcher::isQueued(
+        const AString &url, int64_t range_offset, int64_t range_length) {
+    Mutex::Autolock autoLock(mLock);
+    return findSegment_l(url, range_offset, range_length) != NULL;
+}
+
+ssize_t SegmentPrefetcher::fetch(
+        const AString &url, int64_t range_offset, int64_t range_length,
+        sp<ABuffer> *out) {
+    Mutex::Autolock autoLock(mLock);
+    if (mDisconnecting) {
+        return ERROR_NOT_CONNECTED;
+    }
+
+    sp<Segment> segment = findSegment_l(url, range_offset, range_length);
+    if (segment != NULL) {
+        while (*mSegments.begin() != segment) {
+            dropSegment_l(*mSegments.begin());
+            mSegments.erase(mSegments.begin());
+        }
+    } else {
+        // Not prefetched, but needed before the ones that are.
+        segment = queueSegment_l(url, range_offset, range_length, true /* front */);
+    }
+
+    while (!segment->isDone() && !segment->mDropped) {
+        mCondition.wait(mLock);
+    }
+    if (segment->mDropped) {
+        return ERROR_NOT_CONNECTED;
+    }
+    for (List<sp<Segment> >::iterator it = mSegments.begin(); it != mSegments.end(); ++it) {
+        if (*it == segment) {
+            mSegments.erase(it);
+            break;
+        }
+    }
+    mCondition.broadcast();
+
+    size_t size = 0;
+    for (size_t i = 0; i < segment->mParts.size(); ++i) {
+        const Part &part = segment->mParts[i];
+        if (part.mError != OK) {
+            return part.mError;
+        }
+        // The parts are contiguous, a part cut short would leave a gap.
+        if (i + 1 < segment->mParts.size()
+                && (int64_t)part.mBuffer->size() != part.mLength) {
+            ALOGE("short read of %s @%lld: %zu of %lld bytes",
+                    uriDebugString(url).c_str(), (long long)part.mOffset,
+                    part.mBuffer->size(), (long long)part.mLength);
+            return ERROR_MALFORMED;
+        }
+        size += part.mBuffer->size();
+    }
+
+    if (segment->mParts.size() == 1) {
+        *out = segment->mParts[0].mBuffer;
+        return size;
+    }
+
+    sp<ABuffer> buffer = new ABuffer(size);
+    if (buffer->data() == NULL) {
+        ALOGE("not enough memory to join %zu bytes", size);
+        return NO_MEMORY;
+    }
+    size_t offset = 0;
+    for (const Part &part : segment->mParts) {
+        memcpy(buffer->data() + offset, part.mBuffer->data(), part.mBuffer->size());
+        offset += part.mBuffer->size();
+    }
+    *out = buffer;
+    return size;
+}
+
+void SegmentPrefetcher::cancel() {
+    Mutex::Autolock autoLock(mLock);
+    dropSegments_l();
+}
+
+void SegmentPrefetcher::disconnect() {
+    {
+        Mutex::Autolock autoLock(mLock);
+        mDisconnecting = true;
+        dropSegments_l();
+    }
+    for (const sp<HTTPDownloader> &downloader : mDownloaders) {
+        downloader->disconnect();
+    }
+}
+
+void SegmentPrefetcher::reconnect() {
+    Mutex::Autolock autoLock(mLock);
+    mDisconnecting = false;
+    for (const sp<HTTPDownloader> &downloader : mDownloaders) {
+        downloader->reconnect();
+    }
+}
+
+void SegmentPrefetcher::takeBandwidthSample(size_t *numBytes, int64_t *delayUs) {
+    Mutex::Autolock autoLock(mLock);
+    int64_t busyUs = mBusyUs;
+    if (mNumActiveDownloads > 0) {
+        const int64_t nowUs = ALooper::GetNowUs();
+        busyUs += nowUs - mBusySinceUs;
+        mBusySinceUs = nowUs;
+    }
+    *numBytes = mDownloadedBytes;
+    *delayUs = busyUs;
+    mDownloadedBytes = 0;
+    mBusyUs = 0;
+}
+
+void SegmentPrefetcher::threadLoop(size_t index) {
+    const sp<HTTPDownloader> downloader = mDownloaders[index];
+
+    Mutex::Autolock autoLock(mLock);
+    for (;;) {
+        // Parts are downloaded in the order the segments are needed in.
+        sp<Segment> segment;
+        size_t partIndex = 0;
+        while (!mStopping && segment == NULL) {
+            for (const sp<Segment> &queued : mSegments) {
+                for (size_t i = 0; i < queued->mParts.size(); ++i) {
+                    if (queued->mParts[i].mState == Part::QUEUED) {
+                        segment = queued;
+                        partIndex = i;
+                        break;
+                    }
+                }
+                if (segment != NULL) {
+                    break;
+                }
+            }
+            if (segment == NULL) {
+                mCondition.wait(mLock);
+            }
+        }
+        if (mStopping) {
+            return;
+        }
+
+        Part &part = segment->mParts[partIndex];
+        part.mState = Part::DOWNLOADING;
+        part.mConnection = index;
+        if (mNumActiveDownloads++ == 0) {
+            mBusySinceUs = ALooper::GetNowUs();
+        }
+
+        const AString url = segment->mUrl;
+        const int64_t offset = part.mOffset;
+        const int64_t length = part.mLength;
+        sp<ABuffer> buffer;
+        mLock.unlock();
+        ssize_t bytesRead = downloader->fetchBlock(
+                url.c_str(), &buffer, offset, length, 0 /* block_size */,
+                NULL /* actualUrl */, true /* reconnect */);
+        mLock.lock();
+
+        if (--mNumActiveDownloads == 0) {
+            mBusyUs += ALooper::GetNowUs() - mBusySinceUs;
+        }
+        if (mAborted[index]) {
+            mAborted[index] = false;
+            if (!mDisconnecting) {
+                downloader->reconnect();
+            }
+        }
+        if (bytesRead > 0) {
+            mDownloadedBytes += bytesRead;
+        }
+        if (bytesRead < 0) {
+            ALOGV("failed to fetch %s @%lld: %zd", uriDebugString(url).c_str(),
+                    (long long)offset, bytesRead);
+            part.mError = bytesRead;
+        } else if (buffer == NULL) {
+            part.mBuffer = new ABuffer(0);
+        } else {
+            part.mBuffer = buffer;
+        }
+        part.mState = Part::DONE;
+        mCondition.broadcast();
+    }
+}
+
+}  // namespace android
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SEGMENT_PREFETCHER_H_
+
+#define SEGMENT_PREFETCHER_H_
+
+#include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/AString.h>
+#include <utils/Condition.h>
+#include <utils/KeyedVector.h>
+#include <utils/List.h>
+#include <utils/Mutex.h>
+#include <utils/RefBase.h>
+#include <utils/String8.h>
+
+#include <thread>
+#include <vector>
+
+namespace android {
+
+struct ABuffer;
+struct HTTPDownloader;
+struct MediaHTTPService;
+
+// Downloads the upcoming media segments of a playlist ahead of PlaylistFetcher,
+// over several connections at once, so that a high-latency link is not idle
+// between segments. Segments of a known length of at least 2 * splitSize are
+// further split into byte ranges downloaded in parallel.
+//
+// Segments are handed out whole, in the order fetch() is called for them, so
+// that they are decrypted and parsed exactly as if they had been downloaded
+// one at a time.
+struct SegmentPrefetcher : public RefBase {
+    static const int64_t kDefaultSplitSize;
+
+    SegmentPrefetcher(
+            const sp<MediaHTTPService> &httpService,
+            const KeyedVector<String8, String8> &headers,
+            size_t numConnections,
+            size_t maxSegments,
+            int64_t splitSize = kDefaultSplitSize);
+
+    // Queues the download of range_length bytes of url at range_offset
+    // (range_length -1: the entire file), unless it is already queued or
+    // maxSegments segments are, whether downloaded or not. Returns whether
+    // it is queued.
+    bool prefetch(const AString &url, int64_t range_offset, int64_t range_length);
+
+    // Returns whether the range was queued by prefetch(), downloaded or not.
+    bool isQueued(const AString &url, int64_t range_offset, int64_t range_length);
+
+    // Blocks until the range is downloaded, queueing it first if need be, and
+    // returns it in *out. Segments queued before it are dropped, as the caller
+    // has moved past them. Returns the size of the segment, or an error, which
+    // is ERROR_NOT_CONNECTED after disconnect().
+    ssize_t fetch(
+            const AString &url, int64_t range_offset, int64_t range_length,
+            sp<ABuffer> *out);
+
+    // Drops all the queued segments, aborting the downloads in progress.
+    void cancel();
+
+    // Like HTTPDownloader::disconnect() and reconnect(), for all connections.
+    // disconnect() also drops all the queued segments.
+    void disconnect();
+    void reconnect();
+
+    // Returns the bytes downloaded since the last call, and the time during
+    // which at least one download was in progress. As the downloads overlap,
+    // this is the throughput of the link, where the time of each download
+    // would only be its share of it.
+    void takeBandwidthSample(size_t *numBytes, int64_t *delayUs);
+
+protected:
+    virtual ~SegmentPrefetcher();
+
+private:
+    struct Part {
+        int64_t mOffset;
+        int64_t mLength;
+        enum State {
+            QUEUED,
+            DOWNLOADING,
+            DONE,
+        } mState;
+        sp<ABuffer> mBuffer;
+        status_t mError;
+        size_t mConnection;  // while DOWNLOADING.
+    };
+
+    struct Segment : public RefBase {
+        AString mUrl;
+        int64_t mRangeOffset;
+        int64_t mRangeLength;
+        std::vector<Part> mParts;
+        bool mDropped;
+
+        bool isDone() const;
+    };
+
+    const size_t mMaxSegments;
+    const int64_t mSplitSize;
+
+    std::vector<sp<HTTPDownloader>> mDownloaders;
+    std::vector<std::thread> mThreads;
+    // The connections disconnected to abort the download of a dropped segment,
+    // which are reconnected once that download has returned.
+    std::vector<bool> mAborted;
+
+    Mutex mLock;
+    Condition mCondition;
+    List<sp<Segment> > mSegments;
+    bool mDisconnecting;
+    bool mStopping;
+
+    size_t mNumActiveDownloads;
+    int64_t mBusySinceUs;
+    int64_t mBusyUs;
+    size_t mDownloadedBytes;
+
+    sp<Segment> findSegment_l(
+            const AString &url, int64_t range_offset, int64_t range_length);
+    sp<Segment> queueSegment_l(
+            const AString &url, int64_t range_offset, int64_t range_length,
+            bool front);
+    void dropSegment_l(const sp<Segment> &segment);
+    void dropSegments_l();
+    void threadLoop(size_t index);
+
+    DISALLOW_EVIL_CONSTRUCTORS(SegmentPrefetcher);
+};
+
+}  // namespace android
+
+#endif  // SEGMENT_PREFETCHER_H_
@@ -20,6 +20,7 @@
 
 #include <list>
 #include <memory>
+#include <vector>
 
 #include <stdint.h>
 
@@ -341,6 +342,28 @@ public:
      *            handled gracefully in the future, here and below).
      */
     virtual status_t queueInputBuffer(const sp<MediaCodecBuffer> &buffer) = 0;
+    /**
+     * Queue input buffers into the buffer channel, in order, stopping at the
+     * first one that cannot be queued. Implementations may hand them over to
+     * the underlying component at once.
+     *
+     * @param     numQueued the number of buffers queued.
+     * @return    OK if all the buffers were queued; otherwise the error that
+     *            queueInputBuffer() would return for the first buffer that
+     *            was not.
+     */
+    virtual status_t queueInputBuffers(
+            const std::vector<sp<MediaCodecBuffer>> &buffers, size_t *numQueued) {
+        *numQueued = 0;
+        for (const sp<MediaCodecBuffer> &buffer : buffers) {
+            status_t err = queueInputBuffer(buffer);
+            if (err != OK) {
+                return err;
+            }
+            ++*numQueued;
+        }
+        return OK;
+    }
     /**
      * Queue a secure input buffer into the buffer channel.
      *
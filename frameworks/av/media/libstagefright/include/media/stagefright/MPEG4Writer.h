@@ -70,6 +70,12 @@ public:
     status_t setInterleaveDuration(uint32_t duration);
     int32_t getTimeScale() const { return mTimeScale; }
 
+    // Write a fragmented file: an initial moov box without samples, followed by
+    // a moof and mdat box pair for about every durationUs of media. The default
+    // of 0 writes the samples' tables into a single moov box at the end.
+    // Must be called before start().
+    status_t setFragmentDuration(int64_t durationUs);
+
     status_t setGeoData(int latitudex10000, int longitudex10000);
     status_t setCaptureRate(float captureFps);
     status_t setTemporalLayerCount(uint32_t layerCount);
@@ -126,6 +132,9 @@ private:
     bool mWriteSeekErr;
     bool mFallocateErr;
     bool mPreAllocationEnabled;
+    int64_t mFragmentDurationUs;
+    uint32_t mFragmentSequenceNumber;
+    bool mHasInitMoovBox;  // The moov box of a fragmented file has been written
     // Queue to hold top long write durations
     std::priority_queue<std::chrono::microseconds, std::vector<std::chrono::microseconds>,
                         std::greater<std::chrono::microseconds>> mWriteDurationPQ;
@@ -179,6 +188,14 @@ private:
         // Max time interval between neighboring chunks
         int64_t mMaxInterChunkDurUs;
 
+        // Fragmented file only: samples not yet written in a fragment, and
+        // how many of them go in the next one
+        List<MediaBuffer *> mFragmentSamples;
+        size_t mNumFragmentSamples;
+
+        // Fragmented file only: duration of the last sample written, in ticks
+        int64_t mLastSampleDurationTicks;
+
     };
 
     bool            mIsFirstChunk;
@@ -254,6 +271,21 @@ private:
     // Actually write the given chunk to the file.
     void writeChunkToFile(Chunk* chunk);
 
+    // Fragmented file writing. The samples of the chunks "written" above are
+    // held until the lead track has enough of them for a fragment that ends
+    // right before one of its sync samples.
+    bool isFragmented() const { return mFragmentDurationUs > 0; }
+
+    // Decide whether the held samples make up a fragment, and how many of
+    // each track's go in it. Return true if a fragment is ready to be written.
+    bool findFragmentToWrite_l();
+
+    // Write the moov box if not done yet, then a moof and mdat box pair with
+    // the samples picked for the fragment.
+    void writeFragmentToFile();
+    void writeTrafBox(ChunkInfo *info, off64_t *dataOffsetPosition, uint64_t *dataSize);
+    void writeMvexBox();
+
     // Adjust other track media clock (presumably wall clock)
     // based on audio track media clock with the drift time.
     int64_t mDriftTimeUs;
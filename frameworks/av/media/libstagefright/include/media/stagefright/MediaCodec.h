@@ -159,6 +159,23 @@ struct MediaCodec : public AHandler {
             uint32_t flags,
             AString *errorDetailMsg = NULL);
 
+    // An input buffer queued by queueInputBuffers(), or an output buffer
+    // dequeued by dequeueOutputBuffers().
+    struct BufferBatchEntry {
+        size_t index;
+        size_t offset;
+        size_t size;
+        int64_t presentationTimeUs;
+        uint32_t flags;
+    };
+
+    // Queues several input buffers in one call, as queueInputBuffer() would
+    // one by one, stopping at the first one that cannot be queued. Returns OK
+    // if all were queued, otherwise the error for the first one that was not;
+    // either way *numQueued is the number of buffers queued.
+    status_t queueInputBuffers(
+            const std::vector<BufferBatchEntry> &buffers, size_t *numQueued);
+
     status_t queueSecureInputBuffer(
             size_t index,
             size_t offset,
@@ -214,6 +231,14 @@ struct MediaCodec : public AHandler {
             uint32_t *flags,
             int64_t timeoutUs = 0ll);
 
+    // Like dequeueOutputBuffer(), but returns up to maxBuffers output buffers
+    // that are available at once. Buffers in a new output format are left for
+    // the next call, which reports INFO_FORMAT_CHANGED first.
+    status_t dequeueOutputBuffers(
+            std::vector<BufferBatchEntry> *buffers,
+            size_t maxBuffers,
+            int64_t timeoutUs = 0ll);
+
     status_t renderOutputBufferAndRelease(size_t index, int64_t timestampNs);
     status_t renderOutputBufferAndRelease(size_t index);
     status_t releaseOutputBuffer(size_t index);
@@ -322,6 +347,7 @@ private:
         kWhatRelease                        = 'rele',
         kWhatDequeueInputBuffer             = 'deqI',
         kWhatQueueInputBuffer               = 'queI',
+        kWhatQueueInputBuffers              = 'qInB',
         kWhatDequeueOutputBuffer            = 'deqO',
         kWhatReleaseOutputBuffer            = 'relO',
         kWhatSignalEndOfInputStream         = 'eois',
@@ -428,6 +454,8 @@ private:
 
     int32_t mDequeueOutputTimeoutGeneration;
     sp<AReplyToken> mDequeueOutputReplyID;
+    // the most buffers the pending dequeue may return, 0 for dequeueOutputBuffer()
+    size_t mDequeueOutputMaxBuffers;
 
     sp<ICrypto> mCrypto;
 
@@ -467,6 +495,8 @@ private:
     void returnBuffersToCodecOnPort(int32_t portIndex, bool isReclaim = false);
     size_t updateBuffers(int32_t portIndex, const sp<AMessage> &msg);
     status_t onQueueInputBuffer(const sp<AMessage> &msg);
+    status_t onQueueInputBuffers(
+            const std::vector<BufferBatchEntry> &buffers, size_t *numQueued);
     status_t onReleaseOutputBuffer(const sp<AMessage> &msg);
     BufferInfo *peekNextPortBuffer(int32_t portIndex);
     ssize_t dequeuePortBuffer(int32_t portIndex);
@@ -477,6 +507,7 @@ private:
 
     bool handleDequeueInputBuffer(const sp<AReplyToken> &replyID, bool newRequest = false);
     bool handleDequeueOutputBuffer(const sp<AReplyToken> &replyID, bool newRequest = false);
+    BufferBatchEntry dequeueOutputBufferEntry();
     void cancelPendingDequeueOperations();
 
     void extractCSD(const sp<AMessage> &format);
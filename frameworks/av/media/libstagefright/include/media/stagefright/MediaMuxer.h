@@ -50,6 +50,7 @@ public:
         OUTPUT_FORMAT_THREE_GPP   = 2,
         OUTPUT_FORMAT_HEIF        = 3,
         OUTPUT_FORMAT_OGG         = 4,
+        OUTPUT_FORMAT_MPEG_4_FRAGMENTED = 5,
         OUTPUT_FORMAT_LIST_END // must be last - used to validate format type
     };
 
@@ -91,6 +92,15 @@ public:
      */
     status_t setLocation(int latitude, int longitude);
 
+    /**
+     * Set the duration of the fragments of a fragmented mp4 file.
+     * Fragments end right before a sync sample of the video track, if any,
+     * so they can be longer than that.
+     * @param durationUs The fragment duration in microseconds, greater than 0.
+     * @return OK if no error.
+     */
+    status_t setFragmentDuration(int64_t durationUs);
+
     /**
      * Stop muxing.
      * This method is a blocking call. Depending on how
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ExtractorFactoryBenchmark"
+#include <utils/Log.h>
+
+#include <benchmark/benchmark.h>
+
+#include <datasource/FileSource.h>
+#include <media/stagefright/MediaExtractorFactory.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#define RES_PATH "/data/local/tmp/ExtractorFactoryTestRes/"
+
+using namespace android;
+
+namespace {
+
+// The clips of ExtractorFactoryTest, one or two of each format.
+const std::vector<std::string> kCorpus = {
+        "loudsoftaac.aac",     "testamr.amr",          "amrwb.wav",
+        "john_cage.ogg",       "monotestgsm.wav",      "segment000001.ts",
+        "sinesweepflac.flac",  "testopus.opus",        "midi_a.mid",
+        "sinesweepvorbis.mkv", "sinesweepoggmp4.mp4",  "sinesweepmp3lame.mp3",
+        "swirl_144x136_vp9.webm", "swirl_144x136_vp8.webm", "swirl_132x130_mpeg4.mp4"};
+
+// Makes the sniffers read the source directly, as a source that caches data
+// itself does, without a shared window or recent verdicts.
+struct DirectSource : public DataSource {
+    explicit DirectSource(const sp<DataSource> &source) : mSource(source) {}
+
+    virtual status_t initCheck() const { return mSource->initCheck(); }
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        return mSource->readAt(offset, data, size);
+    }
+    virtual status_t getSize(off64_t *size) { return mSource->getSize(size); }
+    virtual uint32_t flags() { return mSource->flags() | kIsCachingDataSource; }
+
+private:
+    sp<DataSource> mSource;
+};
+
+bool createExtractor(const std::string &fileName, bool direct) {
+    int fd = open((RES_PATH + fileName).c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    off64_t size = lseek64(fd, 0, SEEK_END);
+    sp<DataSource> source = new FileSource(fd, 0, size);
+    if (direct) {
+        source = new DirectSource(source);
+    }
+    sp<IMediaExtractor> extractor = MediaExtractorFactory::CreateFromService(source);
+    return extractor != nullptr;
+}
+
+}  // namespace
+
+// Opening each clip of the corpus in turn, as a media scan does. range(0) is
+// 1 to go through the shared window and the recent verdicts, 0 to not.
+static void BM_CreateFromServiceCorpus(benchmark::State& state) {
+    MediaExtractorFactory::LoadExtractors();
+    const bool direct = state.range(0) == 0;
+    for (auto _ : state) {
+        for (const std::string &fileName : kCorpus) {
+            if (!createExtractor(fileName, direct)) {
+                state.SkipWithError(("no extractor for " + fileName).c_str());
+                return;
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kCorpus.size());
+}
+BENCHMARK(BM_CreateFromServiceCorpus)->Arg(0)->Arg(1);
+
+// Opening one clip of the corpus, range(0) is its index and range(1) as above.
+static void BM_CreateFromService(benchmark::State& state) {
+    MediaExtractorFactory::LoadExtractors();
+    const std::string &fileName = kCorpus[state.range(0)];
+    const bool direct = state.range(1) == 0;
+    state.SetLabel(fileName);
+    for (auto _ : state) {
+        if (!createExtractor(fileName, direct)) {
+            state.SkipWithError(("no extractor for " + fileName).c_str());
+            return;
+        }
+    }
+}
+BENCHMARK(BM_CreateFromService)->Apply([](benchmark::internal::Benchmark *b) {
+    for (int i = 0; i < (int)kCorpus.size(); ++i) {
+        b->Args({i, 0})->Args({i, 1});
+    }
+});
+
+BENCHMARK_MAIN();
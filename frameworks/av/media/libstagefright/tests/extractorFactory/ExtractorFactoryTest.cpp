@@ -27,6 +27,8 @@
 #include "ExtractorFactoryTestEnvironment.h"
 
 #define OUTPUT_FILE_NAME "/data/local/tmp/exFactoryLogs"
+#define TAGGED_ADTS_FILE_NAME "/data/local/tmp/exFactoryTaggedAdts"
+#define TAGGED_MP3_FILE_NAME "/data/local/tmp/exFactoryTaggedMp3"
 
 using namespace android;
 
@@ -87,6 +89,88 @@ int32_t ExtractorFactoryTest::createExtractor(bool createFromService, string inp
     return 0;
 }
 
+// Returns how many times a remembered sniff verdict was reused, as reported by
+// dump(), or -1 if it is not reported.
+static int32_t getSniffVerdictReuses() {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return -1;
+    }
+    Vector<String16> args;
+    status_t status = MediaExtractorFactory::dump(fds[1], args);
+    close(fds[1]);
+    string out;
+    char buf[4096];
+    ssize_t bytesRead;
+    while ((bytesRead = read(fds[0], buf, sizeof(buf))) > 0) {
+        out.append(buf, bytesRead);
+    }
+    close(fds[0]);
+    if (status != OK) {
+        return -1;
+    }
+
+    size_t pos = out.find("Recent sniff verdicts: ");
+    size_t numVerdicts;
+    uint32_t numReuses;
+    if (pos == string::npos ||
+        sscanf(out.c_str() + pos, "Recent sniff verdicts: %zu, reused %u times", &numVerdicts,
+               &numReuses) != 2) {
+        return -1;
+    }
+    return numReuses;
+}
+
+// Reads the clip, without the ID3v2 tags it starts with.
+static bool readUntaggedClip(string inputFileName, vector<uint8_t> *data) {
+    FILE *inputFp = fopen(inputFileName.c_str(), "rb");
+    if (!inputFp) {
+        ALOGE("Unable to open input file : %s for reading", inputFileName.c_str());
+        return false;
+    }
+    uint8_t buf[4096];
+    size_t bytesRead;
+    while ((bytesRead = fread(buf, 1, sizeof(buf), inputFp)) > 0) {
+        data->insert(data->end(), buf, buf + bytesRead);
+    }
+    fclose(inputFp);
+
+    size_t pos = 0;
+    while (data->size() >= pos + 10 && !memcmp(data->data() + pos, "ID3", 3)) {
+        const uint8_t *header = data->data() + pos;
+        pos += 10 + (((header[6] & 0x7f) << 21) | ((header[7] & 0x7f) << 14) |
+                     ((header[8] & 0x7f) << 7) | (header[9] & 0x7f));
+    }
+    data->erase(data->begin(), data->begin() + min(pos, data->size()));
+    return !data->empty();
+}
+
+// Writes size bytes of the data behind an empty ID3v2 tag of tagSize bytes.
+static bool writeTaggedFile(string outputFileName, const vector<uint8_t> &data, size_t size,
+                            uint32_t tagSize) {
+    FILE *outputFp = fopen(outputFileName.c_str(), "wb");
+    if (!outputFp) {
+        ALOGE("Unable to open output file : %s for writing", outputFileName.c_str());
+        return false;
+    }
+    const uint8_t header[10] = {'I',
+                                'D',
+                                '3',
+                                4,
+                                0,
+                                0,
+                                (uint8_t)((tagSize >> 21) & 0x7f),
+                                (uint8_t)((tagSize >> 14) & 0x7f),
+                                (uint8_t)((tagSize >> 7) & 0x7f),
+                                (uint8_t)(tagSize & 0x7f)};
+    vector<uint8_t> padding(tagSize, 0);
+    bool written = fwrite(header, 1, sizeof(header), outputFp) == sizeof(header) &&
+                   fwrite(padding.data(), 1, tagSize, outputFp) == tagSize &&
+                   fwrite(data.data(), 1, size, outputFp) == size;
+    fclose(outputFp);
+    return written;
+}
+
 TEST_F(ExtractorFactoryTest, ListExtractorsTest) {
     MediaExtractorFactory::LoadExtractors();
     vector<std::string> supportedTypes = MediaExtractorFactory::getSupportedTypes();
@@ -133,6 +217,84 @@ TEST_P(ExtractorFactoryTest, ExtractorFactoryApiTest) {
     }
 }
 
+TEST_P(ExtractorFactoryTest, ReopenTest) {
+    string inputMime = GetParam().second;
+    string inputFileName = gEnv->getRes() + GetParam().first;
+
+    MediaExtractorFactory::LoadExtractors();
+    int32_t numTracks[2];
+    int32_t numReuses[2];
+    for (int32_t i = 0; i < 2; i++) {
+        int32_t status = createDataSource(inputFileName);
+        ASSERT_EQ(status, 0) << "create data source failed";
+
+        status = createExtractor(true, inputMime);
+        ASSERT_EQ(status, 0) << "Extractor creation failed for input: " << inputFileName;
+
+        numTracks[i] = mExtractor->countTracks();
+        sp<MetaData> meta = mExtractor->getMetaData();
+        ASSERT_NE(meta, nullptr) << "getMetaData returned null";
+
+        const char *mime;
+        ASSERT_TRUE(meta->findCString(kKeyMIMEType, &mime)) << "Extractor did not provide MIME type";
+        ASSERT_EQ(mime, inputMime) << "Extractor factory returned invalid mime type";
+        mExtractor.clear();
+        mDataSource.clear();
+
+        numReuses[i] = getSniffVerdictReuses();
+        ASSERT_GE(numReuses[i], 0) << "dump() did not report the sniff verdicts";
+    }
+    ASSERT_EQ(numTracks[0], numTracks[1]) << "Reopened clip has a different number of tracks";
+    // The second time round, the content is recognized from the previous verdict.
+    ASSERT_EQ(numReuses[1], numReuses[0] + 1) << "Reopened clip did not reuse the sniff verdict";
+}
+
+TEST_F(ExtractorFactoryTest, ReopenFallbackTest) {
+    // The two files only differ past the sniff window: both start with the
+    // same large ID3v2 tag, followed by ADTS frames in one and MP3 frames in
+    // the other. The plugin remembered for the ADTS file rejects the MP3 file,
+    // which is then sniffed by all the plugins.
+    const uint32_t kTagSize = 100 * 1024;
+    vector<uint8_t> adtsData;
+    vector<uint8_t> mp3Data;
+    ASSERT_TRUE(readUntaggedClip(gEnv->getRes() + "loudsoftaac.aac", &adtsData));
+    ASSERT_TRUE(readUntaggedClip(gEnv->getRes() + "sinesweepmp3lame.mp3", &mp3Data));
+    size_t size = min(adtsData.size(), mp3Data.size());
+    ASSERT_TRUE(writeTaggedFile(TAGGED_ADTS_FILE_NAME, adtsData, size, kTagSize));
+    ASSERT_TRUE(writeTaggedFile(TAGGED_MP3_FILE_NAME, mp3Data, size, kTagSize));
+
+    MediaExtractorFactory::LoadExtractors();
+    const pair<string, string> files[] = {
+            make_pair(TAGGED_ADTS_FILE_NAME, MEDIA_MIMETYPE_AUDIO_AAC_ADTS),
+            make_pair(TAGGED_MP3_FILE_NAME, MEDIA_MIMETYPE_AUDIO_MPEG)};
+    int32_t numReuses = -1;
+    for (const pair<string, string> &file : files) {
+        int32_t status = createDataSource(file.first);
+        ASSERT_EQ(status, 0) << "create data source failed";
+
+        status = createExtractor(true, file.second);
+        ASSERT_EQ(status, 0) << "Extractor creation failed for input: " << file.first;
+
+        sp<MetaData> meta = mExtractor->getMetaData();
+        ASSERT_NE(meta, nullptr) << "getMetaData returned null";
+
+        const char *mime;
+        ASSERT_TRUE(meta->findCString(kKeyMIMEType, &mime)) << "Extractor did not provide MIME type";
+        ASSERT_EQ(mime, file.second) << "Extractor factory returned invalid mime type";
+        mExtractor.clear();
+        mDataSource.clear();
+
+        int32_t newNumReuses = getSniffVerdictReuses();
+        ASSERT_GE(newNumReuses, 0) << "dump() did not report the sniff verdicts";
+        if (numReuses >= 0) {
+            ASSERT_EQ(newNumReuses, numReuses) << "Rejected sniff verdict was counted as reused";
+        }
+        numReuses = newNumReuses;
+    }
+    remove(TAGGED_ADTS_FILE_NAME);
+    remove(TAGGED_MP3_FILE_NAME);
+}
+
 // TODO: (b/150111966)
 // Replace mime strings with appropriate definitions
 INSTANTIATE_TEST_SUITE_P(
@@ -0,0 +1,413 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SegmentPrefetcherTest"
+#include <utils/Log.h>
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <media/MediaHTTPConnection.h>
+#include <media/MediaHTTPService.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/MediaErrors.h>
+
+#include "HTTPDownloader.h"
+#include "M3UParser.h"
+#include "SegmentPrefetcher.h"
+
+using namespace android;
+
+namespace {
+
+constexpr int64_t kLatencyUs = 100000LL;
+constexpr int64_t kSplitSize = 1000;
+
+// Stands in for an HTTP server: serves canned files, Range requests included,
+// each after kLatencyUs, and records the requests made. If mReadSize is set,
+// the body is read in blocks of that size, each taking mReadDelayUs.
+struct FakeHTTPServer : public RefBase {
+    void addFile(const std::string &url, const std::string &content) {
+        std::lock_guard<std::mutex> lock(mLock);
+        mFiles[url] = content;
+    }
+
+    bool request(const std::string &url, const KeyedVector<String8, String8> *headers,
+            std::string *body) {
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mMaxConcurrentRequests = std::max(mMaxConcurrentRequests, ++mConcurrentRequests);
+        }
+        usleep(kLatencyUs);
+
+        std::lock_guard<std::mutex> lock(mLock);
+        --mConcurrentRequests;
+        auto it = mFiles.find(url);
+        if (it == mFiles.end()) {
+            return false;
+        }
+        size_t first = 0;
+        size_t last = it->second.size() - 1;
+        ssize_t index = headers != NULL ? headers->indexOfKey(String8("Range")) : -1;
+        if (index >= 0) {
+            const char *range = headers->valueAt(index).string();
+            int consumed = 0;
+            if (sscanf(range, "bytes=%zu-%n", &first, &consumed) != 1) {
+                return false;
+            }
+            if (range[consumed] != '\0') {
+                sscanf(range + consumed, "%zu", &last);
+            }
+            mRanges.push_back(range);
+        }
+        *body = it->second.substr(first, last - first + 1);
+        ++mNumRequests;
+        return true;
+    }
+
+    std::mutex mLock;
+    std::map<std::string, std::string> mFiles;
+    std::vector<std::string> mRanges;
+    size_t mNumRequests = 0;
+    size_t mConcurrentRequests = 0;
+    size_t mMaxConcurrentRequests = 0;
+
+    size_t mReadSize = 0;
+    int64_t mReadDelayUs = 0;
+    std::atomic<size_t> mBytesRead = 0;
+};
+
+struct FakeHTTPConnection : public MediaHTTPConnection {
+    explicit FakeHTTPConnection(const sp<FakeHTTPServer> &server) : mServer(server) {}
+
+    bool connect(const char *uri, const KeyedVector<String8, String8> *headers) override {
+        mUri = uri;
+        mDisconnected = false;
+        return mServer->request(uri, headers, &mBody);
+    }
+    // Like a socket that is shut down, fails the reads in progress or to come.
+    void disconnect() override {
+        mDisconnected = true;
+    }
+    ssize_t readAt(off64_t offset, void *data, size_t size) override {
+        if (mServer->mReadSize > 0) {
+            usleep(mServer->mReadDelayUs);
+            size = std::min(size, mServer->mReadSize);
+        }
+        if (mDisconnected) {
+            return ERROR_NOT_CONNECTED;
+        }
+        if (offset >= (off64_t)mBody.size()) {
+            return 0;
+        }
+        size = std::min(size, mBody.size() - (size_t)offset);
+        memcpy(data, mBody.data() + offset, size);
+        mServer->mBytesRead += size;
+        return size;
+    }
+    off64_t getSize() override {
+        return mBody.size();
+    }
+    status_t getMIMEType(String8 *mimeType) override {
+        *mimeType = "video/mp2t";
+        return OK;
+    }
+    status_t getUri(String8 *uri) override {
+        *uri = mUri.c_str();
+        return OK;
+    }
+
+private:
+    const sp<FakeHTTPServer> mServer;
+    std::string mUri;
+    std::string mBody;
+    std::atomic<bool> mDisconnected = false;
+};
+
+struct FakeHTTPService : public MediaHTTPService {
+    explicit FakeHTTPService(const sp<FakeHTTPServer> &server) : mServer(server) {}
+
+    sp<MediaHTTPConnection> makeHTTPConnection() override {
+        return new FakeHTTPConnection(mServer);
+    }
+
+private:
+    const sp<FakeHTTPServer> mServer;
+};
+
+const char *kPlaylist =
+    "#EXTM3U\n"
+    "#EXT-X-TARGETDURATION:4\n"
+    "#EXT-X-MEDIA-SEQUENCE:0\n"
+    "#EXTINF:4.0,\n"
+    "segment0.ts\n"
+    "#EXTINF:4.0,\n"
+    "segment1.ts\n"
+    "#EXTINF:4.0,\n"
+    "segment2.ts\n"
+    "#EXTINF:4.0,\n"
+    "segment3.ts\n"
+    "#EXT-X-ENDLIST\n";
+
+const char *kByteRangePlaylist =
+    "#EXTM3U\n"
+    "#EXT-X-TARGETDURATION:4\n"
+    "#EXT-X-VERSION:4\n"
+    "#EXTINF:4.0,\n"
+    "#EXT-X-BYTERANGE:4500@0\n"
+    "media.ts\n"
+    "#EXTINF:4.0,\n"
+    "#EXT-X-BYTERANGE:700\n"
+    "media.ts\n"
+    "#EXT-X-ENDLIST\n";
+
+const char *kBaseUrl = "http://example.com/hls/";
+
+std::string segmentContent(size_t index, size_t size) {
+    std::string content(size, '\0');
+    for (size_t i = 0; i < size; ++i) {
+        content[i] = (char)(index * 31 + i * 7);
+    }
+    return content;
+}
+
+std::string toString(const sp<ABuffer> &buffer) {
+    return std::string((const char *)buffer->data(), buffer->size());
+}
+
+} // namespace
+
+class SegmentPrefetcherTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        mServer = new FakeHTTPServer;
+        mService = new FakeHTTPService(mServer);
+        mServer->addFile(std::string(kBaseUrl) + "index.m3u8", kPlaylist);
+        mServer->addFile(std::string(kBaseUrl) + "byterange.m3u8", kByteRangePlaylist);
+        for (size_t i = 0; i < 4; ++i) {
+            mServer->addFile(std::string(kBaseUrl) + "segment" + std::to_string(i) + ".ts",
+                    segmentContent(i, 188 * 20));
+        }
+        mServer->addFile(std::string(kBaseUrl) + "media.ts", segmentContent(7, 5200));
+    }
+
+    // Fetches and parses a canned playlist the way PlaylistFetcher does.
+    sp<M3UParser> fetchPlaylist(const char *name) {
+        sp<HTTPDownloader> downloader = new HTTPDownloader(mService, mHeaders);
+        bool unchanged;
+        std::string url = std::string(kBaseUrl) + name;
+        return downloader->fetchPlaylist(url.c_str(), NULL /* curPlaylistHash */, &unchanged);
+    }
+
+    static void getItem(const sp<M3UParser> &playlist, size_t index,
+            AString *uri, int64_t *rangeOffset, int64_t *rangeLength) {
+        sp<AMessage> itemMeta;
+        ASSERT_TRUE(playlist->itemAt(index, uri, &itemMeta));
+        if (!itemMeta->findInt64("range-offset", rangeOffset)
+                || !itemMeta->findInt64("range-length", rangeLength)) {
+            *rangeOffset = 0;
+            *rangeLength = -1;
+        }
+    }
+
+    sp<FakeHTTPServer> mServer;
+    sp<FakeHTTPService> mService;
+    KeyedVector<String8, String8> mHeaders;
+};
+
+TEST_F(SegmentPrefetcherTest, DeliversPrefetchedSegmentsInOrder) {
+    sp<M3UParser> playlist = fetchPlaylist("index.m3u8");
+    ASSERT_TRUE(playlist != NULL);
+    ASSERT_EQ(4u, playlist->size());
+
+    sp<SegmentPrefetcher> prefetcher = new SegmentPrefetcher(
+            mService, mHeaders, 3 /* numConnections */, 3 /* maxSegments */, kSplitSize);
+    for (size_t i = 0; i < playlist->size(); ++i) {
+        AString uri;
+        int64_t rangeOffset, rangeLength;
+        getItem(playlist, i, &uri, &rangeOffset, &rangeLength);
+        // At most maxSegments are queued ahead.
+        EXPECT_EQ(i < 3, prefetcher->prefetch(uri, rangeOffset, rangeLength));
+    }
+
+    for (size_t i = 0; i < playlist->size(); ++i) {
+        AString uri;
+        int64_t rangeOffset, rangeLength;
+        getItem(playlist, i, &uri, &rangeOffset, &rangeLength);
+        if (i + 1 < playlist->size()) {
+            AString nextUri;
+            int64_t nextRangeOffset, nextRangeLength;
+            getItem(playlist, i + 1, &nextUri, &nextRangeOffset, &nextRangeLength);
+            prefetcher->prefetch(nextUri, nextRangeOffset, nextRangeLength);
+        }
+
+        sp<ABuffer> buffer;
+        ASSERT_EQ((ssize_t)(188 * 20), prefetcher->fetch(uri, rangeOffset, rangeLength, &buffer));
+        EXPECT_EQ(segmentContent(i, 188 * 20), toString(buffer));
+    }
+
+    // The three segments queued first were downloaded at the same time.
+    EXPECT_EQ(3u, mServer->mMaxConcurrentRequests);
+}
+
+TEST_F(SegmentPrefetcherTest, SplitsByteRanges) {
+    sp<M3UParser> playlist = fetchPlaylist("byterange.m3u8");
+    ASSERT_TRUE(playlist != NULL);
+    ASSERT_EQ(2u, playlist->size());
+
+    sp<SegmentPrefetcher> prefetcher = new SegmentPrefetcher(
+            mService, mHeaders, 3 /* numConnections */, 2 /* maxSegments */, kSplitSize);
+    const std::string media = segmentContent(7, 5200);
+    for (size_t i = 0; i < playlist->size(); ++i) {
+        AString uri;
+        int64_t rangeOffset, rangeLength;
+        getItem(playlist, i, &uri, &rangeOffset, &rangeLength);
+        ASSERT_TRUE(prefetcher->prefetch(uri, rangeOffset, rangeLength));
+    }
+    for (size_t i = 0; i < playlist->size(); ++i) {
+        AString uri;
+        int64_t rangeOffset, rangeLength;
+        getItem(playlist, i, &uri, &rangeOffset, &rangeLength);
+        sp<ABuffer> buffer;
+        ASSERT_EQ(rangeLength, prefetcher->fetch(uri, rangeOffset, rangeLength, &buffer));
+        EXPECT_EQ(media.substr(rangeOffset, rangeLength), toString(buffer));
+    }
+
+    // 4500 bytes in three parts, while 700 bytes are not worth splitting.
+    std::sort(mServer->mRanges.begin(), mServer->mRanges.end());
+    EXPECT_EQ((std::vector<std::string>{
+            "bytes=0-1499", "bytes=1500-2999", "bytes=3000-4499", "bytes=4500-5199"}),
+            mServer->mRanges);
+}
+
+TEST_F(SegmentPrefetcherTest, DropsSegmentsSkippedOver) {
+    sp<SegmentPrefetcher> prefetcher = new SegmentPrefetcher(
+            mService, mHeaders, 1 /* numConnections */, 4 /* maxSegments */, kSplitSize);
+    std::vector<AString> urls;
+    for (size_t i = 0; i < 4; ++i) {
+        urls.push_back(AStringPrintf("%ssegment%zu.ts", kBaseUrl, i));
+        ASSERT_TRUE(prefetcher->prefetch(urls[i], 0, -1));
+    }
+
+    sp<ABuffer> buffer;
+    ASSERT_EQ((ssize_t)(188 * 20), prefetcher->fetch(urls[2], 0, -1, &buffer));
+    EXPECT_EQ(segmentContent(2, 188 * 20), toString(buffer));
+    EXPECT_FALSE(prefetcher->isQueued(urls[0], 0, -1));
+    EXPECT_FALSE(prefetcher->isQueued(urls[1], 0, -1));
+    EXPECT_FALSE(prefetcher->isQueued(urls[2], 0, -1));
+    EXPECT_TRUE(prefetcher->isQueued(urls[3], 0, -1));
+
+    // A segment that was not queued is fetched ahead of the queued ones.
+    ASSERT_EQ((ssize_t)(188 * 20), prefetcher->fetch(urls[1], 0, -1, &buffer));
+    EXPECT_EQ(segmentContent(1, 188 * 20), toString(buffer));
+    EXPECT_TRUE(prefetcher->isQueued(urls[3], 0, -1));
+
+    prefetcher->cancel();
+    EXPECT_FALSE(prefetcher->isQueued(urls[3], 0, -1));
+}
+
+TEST_F(SegmentPrefetcherTest, ReportsErrors) {
+    sp<SegmentPrefetcher> prefetcher = new SegmentPrefetcher(
+            mService, mHeaders, 2 /* numConnections */, 2 /* maxSegments */, kSplitSize);
+    const AString missing = AStringPrintf("%smissing.ts", kBaseUrl);
+    const AString present = AStringPrintf("%ssegment0.ts", kBaseUrl);
+    sp<ABuffer> buffer;
+    EXPECT_LT(prefetcher->fetch(missing, 0, -1, &buffer), 0);
+
+    prefetcher->disconnect();
+    EXPECT_FALSE(prefetcher->prefetch(present, 0, -1));
+    EXPECT_EQ(ERROR_NOT_CONNECTED, prefetcher->fetch(present, 0, -1, &buffer));
+
+    prefetcher->reconnect();
+    EXPECT_EQ((ssize_t)(188 * 20), prefetcher->fetch(present, 0, -1, &buffer));
+}
+
+TEST_F(SegmentPrefetcherTest, MeasuresOverlappingDownloadsOnce) {
+    sp<SegmentPrefetcher> prefetcher = new SegmentPrefetcher(
+            mService, mHeaders, 4 /* numConnections */, 4 /* maxSegments */, kSplitSize);
+    std::vector<AString> urls;
+    for (size_t i = 0; i < 4; ++i) {
+        urls.push_back(AStringPrintf("%ssegment%zu.ts", kBaseUrl, i));
+        ASSERT_TRUE(prefetcher->prefetch(urls[i], 0, -1));
+    }
+    const int64_t startUs = ALooper::GetNowUs();
+    for (const AString &url : urls) {
+        sp<ABuffer> buffer;
+        ASSERT_EQ((ssize_t)(188 * 20), prefetcher->fetch(url, 0, -1, &buffer));
+    }
+    const int64_t elapsedUs = ALooper::GetNowUs() - startUs;
+
+    size_t numBytes;
+    int64_t delayUs;
+    prefetcher->takeBandwidthSample(&numBytes, &delayUs);
+    EXPECT_EQ(4u * 188 * 20, numBytes);
+    // Four downloads of kLatencyUs each, at the same time.
+    EXPECT_GE(delayUs, kLatencyUs);
+    EXPECT_LT(delayUs, 2 * kLatencyUs);
+    EXPECT_LT(elapsedUs, 2 * kLatencyUs);
+
+    prefetcher->takeBandwidthSample(&numBytes, &delayUs);
+    EXPECT_EQ(0u, numBytes);
+    EXPECT_EQ(0, delayUs);
+}
+
+TEST_F(SegmentPrefetcherTest, AbortsDownloadsOfDroppedSegments) {
+    // A segment that takes a second to download, in blocks of 10ms.
+    constexpr size_t kLargeSize = 1000 * 1000;
+    const AString large = AStringPrintf("%slarge.ts", kBaseUrl);
+    mServer->addFile(large.c_str(), segmentContent(9, kLargeSize));
+    mServer->mReadSize = 10 * 1000;
+    mServer->mReadDelayUs = 10000;
+
+    sp<SegmentPrefetcher> prefetcher = new SegmentPrefetcher(
+            mService, mHeaders, 1 /* numConnections */, 2 /* maxSegments */, kSplitSize);
+    ASSERT_TRUE(prefetcher->prefetch(large, 0, -1));
+    while (mServer->mBytesRead == 0) {
+        usleep(1000);
+    }
+
+    // Seeking cancels the large segment, and the connection is free for the next one
+    // without waiting for the rest of it.
+    prefetcher->cancel();
+    const int64_t startUs = ALooper::GetNowUs();
+    const AString next = AStringPrintf("%ssegment1.ts", kBaseUrl);
+    sp<ABuffer> buffer;
+    ASSERT_EQ((ssize_t)(188 * 20), prefetcher->fetch(next, 0, -1, &buffer));
+    EXPECT_EQ(segmentContent(1, 188 * 20), toString(buffer));
+    EXPECT_LT(ALooper::GetNowUs() - startUs, 5 * kLatencyUs);
+    EXPECT_LT(mServer->mBytesRead.load(), kLargeSize / 2);
+    EXPECT_FALSE(prefetcher->isQueued(large, 0, -1));
+
+    // A segment skipped over by fetch() is aborted the same way.
+    mServer->mBytesRead = 0;
+    ASSERT_TRUE(prefetcher->prefetch(large, 0, -1));
+    ASSERT_TRUE(prefetcher->prefetch(next, 0, -1));
+    while (mServer->mBytesRead == 0) {
+        usleep(1000);
+    }
+    ASSERT_EQ((ssize_t)(188 * 20), prefetcher->fetch(next, 0, -1, &buffer));
+    EXPECT_LT(mServer->mBytesRead.load(), kLargeSize / 2);
+}
@@ -20,12 +20,15 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <C2PlatformSupport.h>
 #include <gui/Surface.h>
 #include <mediadrm/ICrypto.h>
+#include <media/MediaCodecBuffer.h>
 #include <media/stagefright/CodecBase.h>
 #include <media/stagefright/MediaCodec.h>
 #include <media/stagefright/MediaCodecListWriter.h>
 #include <media/MediaCodecInfo.h>
+#include <media/stagefright/foundation/ABuffer.h>
 
 #include "MediaTestHelper.h"
 
@@ -38,6 +41,9 @@ public:
     MOCK_METHOD(void, setCrypto, (const sp<ICrypto> &crypto), (override));
     MOCK_METHOD(void, setDescrambler, (const sp<IDescrambler> &descrambler), (override));
     MOCK_METHOD(status_t, queueInputBuffer, (const sp<MediaCodecBuffer> &buffer), (override));
+    MOCK_METHOD(status_t, queueInputBuffers,
+            (const std::vector<sp<MediaCodecBuffer>> &buffers, size_t *numQueued),
+            (override));
     MOCK_METHOD(status_t, queueSecureInputBuffer,
             (const sp<MediaCodecBuffer> &buffer,
              bool secure,
@@ -70,6 +76,10 @@ public:
     MOCK_METHOD(status_t, discardBuffer, (const sp<MediaCodecBuffer> &buffer), (override));
     MOCK_METHOD(void, getInputBufferArray, (Vector<sp<MediaCodecBuffer>> *array), (override));
     MOCK_METHOD(void, getOutputBufferArray, (Vector<sp<MediaCodecBuffer>> *array), (override));
+
+    const std::unique_ptr<CodecBase::BufferCallback> &callback() {
+        return mCallback;
+    }
 };
 
 class MockCodec : public CodecBase {
@@ -105,6 +115,29 @@ public:
     std::shared_ptr<MockBufferChannel> mMockBufferChannel;
 };
 
+// A crypto object that only puts MediaCodec in secure input mode, it never
+// decrypts anything.
+class FakeCrypto : public ICrypto {
+public:
+    ~FakeCrypto() override = default;
+
+    status_t initCheck() const override { return OK; }
+    bool isCryptoSchemeSupported(const uint8_t[16]) override { return false; }
+    status_t createPlugin(const uint8_t[16], const void *, size_t) override { return OK; }
+    status_t destroyPlugin() override { return OK; }
+    bool requiresSecureDecoderComponent(const char *) const override { return false; }
+    void notifyResolution(uint32_t, uint32_t) override {}
+    status_t setMediaDrmSession(const Vector<uint8_t> &) override { return OK; }
+    ssize_t decrypt(const uint8_t[16], const uint8_t[16], CryptoPlugin::Mode,
+            const CryptoPlugin::Pattern &, const drm::V1_0::SharedBuffer &, size_t,
+            const CryptoPlugin::SubSample *, size_t, const drm::V1_0::DestinationBuffer &,
+            AString *) override {
+        return INVALID_OPERATION;
+    }
+    int32_t setHeap(const sp<hardware::HidlMemory> &) override { return -1; }
+    void unsetHeap(int32_t) override {}
+};
+
 class Counter {
 public:
     Counter() = default;
@@ -153,6 +186,7 @@ private:
 
 using namespace android;
 using ::testing::_;
+using ::testing::Return;
 
 static sp<MediaCodec> SetupMediaCodec(
         const AString &owner,
@@ -185,6 +219,65 @@ static sp<MediaCodec> SetupMediaCodec(
             codecName, looper, getCodecBase, getCodecInfo);
 }
 
+// Creates a mock codec that completes allocation, configuration, start and
+// shutdown right away, so that buffers can go through a started MediaCodec.
+static sp<MockCodec> CreateRunningMockCodec(
+        const AString &codecName,
+        const sp<AMessage> &outputFormat,
+        std::function<void(const std::shared_ptr<MockBufferChannel> &)> mock) {
+    sp<MockCodec> mockCodec = new MockCodec(mock);
+    ON_CALL(*mockCodec, initiateAllocateComponent(_))
+        .WillByDefault([mockCodec, codecName](const sp<AMessage> &) {
+            mockCodec->callback()->onComponentAllocated(codecName.c_str());
+        });
+    ON_CALL(*mockCodec, initiateConfigureComponent(_))
+        .WillByDefault([mockCodec, outputFormat](const sp<AMessage> &msg) {
+            mockCodec->callback()->onComponentConfigured(msg->dup(), outputFormat);
+        });
+    ON_CALL(*mockCodec, initiateStart())
+        .WillByDefault([mockCodec]() {
+            mockCodec->callback()->onStartCompleted();
+        });
+    ON_CALL(*mockCodec, initiateShutdown(_))
+        .WillByDefault([mockCodec](bool keepComponentAllocated) {
+            if (keepComponentAllocated) {
+                mockCodec->callback()->onStopCompleted();
+            } else {
+                mockCodec->callback()->onReleaseCompleted();
+            }
+        });
+    return mockCodec;
+}
+
+static const size_t kBufferCapacity = 1024;
+
+// Makes numBuffers input buffers available to the client, returned in index order.
+static std::vector<sp<MediaCodecBuffer>> GetInputBuffers(
+        const sp<MockCodec> &mockCodec, const sp<MediaCodec> &codec, size_t numBuffers) {
+    std::vector<sp<MediaCodecBuffer>> buffers;
+    for (size_t i = 0; i < numBuffers; ++i) {
+        buffers.push_back(new MediaCodecBuffer(new AMessage, new ABuffer(kBufferCapacity)));
+        mockCodec->mMockBufferChannel->callback()->onInputBufferAvailable(i, buffers.back());
+    }
+    for (size_t i = 0; i < numBuffers; ++i) {
+        size_t index = SIZE_MAX;
+        EXPECT_EQ(OK, codec->dequeueInputBuffer(&index, 1000000));
+        EXPECT_EQ(i, index);
+    }
+    return buffers;
+}
+
+static MediaCodec::BufferBatchEntry InputEntry(size_t index, int64_t timeUs) {
+    return MediaCodec::BufferBatchEntry{index, 0, kBufferCapacity / 2, timeUs, 0};
+}
+
+static sp<MediaCodecBuffer> CreateOutputBuffer(const sp<AMessage> &format, int64_t timeUs) {
+    sp<MediaCodecBuffer> buffer = new MediaCodecBuffer(format, new ABuffer(kBufferCapacity));
+    buffer->meta()->setInt64("timeUs", timeUs);
+    buffer->meta()->setInt32("flags", 0);
+    return buffer;
+}
+
 TEST(MediaCodecTest, ReclaimReleaseRace) {
     // Test scenario:
     //
@@ -393,3 +486,336 @@ TEST(MediaCodecTest, DeadWhileAsyncReleasing) {
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
     looper->stop();
 }
+
+TEST(MediaCodecTest, QueueInputBuffersStopsAtBadIndex) {
+    // Test scenario:
+    //
+    // 1) Client queues a batch of buffers where the third one has an index
+    //    out of range.
+    // 2) The buffers before it go to the buffer channel in one call, the ones
+    //    after it stay with the client.
+
+    static const AString kCodecName{"test.codec"};
+    static const AString kCodecOwner{"nobody"};
+    static const AString kMediaType{"audio/x-test"};
+    static const size_t kBadIndex = 1000;
+
+    std::vector<sp<MediaCodecBuffer>> queued;
+    sp<MockCodec> mockCodec;
+    std::function<sp<CodecBase>(const AString &name, const char *owner)> getCodecBase =
+        [&mockCodec, &queued](const AString &, const char *) {
+            mockCodec = CreateRunningMockCodec(
+                    kCodecName, new AMessage,
+                    [&queued](const std::shared_ptr<MockBufferChannel> &mockBufferChannel) {
+                        EXPECT_CALL(*mockBufferChannel, queueInputBuffer(_)).Times(0);
+                        EXPECT_CALL(*mockBufferChannel, queueInputBuffers(_, _))
+                            .Times(2)
+                            .WillRepeatedly([&queued](
+                                    const std::vector<sp<MediaCodecBuffer>> &buffers,
+                                    size_t *numQueued) {
+                                queued.insert(queued.end(), buffers.begin(), buffers.end());
+                                *numQueued = buffers.size();
+                                return OK;
+                            });
+                    });
+            return mockCodec;
+        };
+
+    sp<ALooper> looper{new ALooper};
+    sp<MediaCodec> codec = SetupMediaCodec(
+            kCodecOwner, kCodecName, kMediaType, looper, getCodecBase);
+    ASSERT_NE(nullptr, codec) << "Codec must not be null";
+    ASSERT_NE(nullptr, mockCodec) << "MockCodec must not be null";
+    ASSERT_EQ(OK, codec->configure(new AMessage, nullptr, nullptr, 0));
+    ASSERT_EQ(OK, codec->start());
+    std::vector<sp<MediaCodecBuffer>> buffers = GetInputBuffers(mockCodec, codec, 3);
+
+    // 1)
+    size_t numQueued = SIZE_MAX;
+    EXPECT_EQ(-ERANGE, codec->queueInputBuffers(
+            {InputEntry(0, 0), InputEntry(1, 1000), InputEntry(kBadIndex, 2000),
+             InputEntry(2, 3000)},
+            &numQueued));
+    // 2)
+    EXPECT_EQ(2u, numQueued);
+    EXPECT_EQ((std::vector<sp<MediaCodecBuffer>>{buffers[0], buffers[1]}), queued);
+    int64_t timeUs = 0;
+    EXPECT_TRUE(buffers[1]->meta()->findInt64("timeUs", &timeUs));
+    EXPECT_EQ(1000, timeUs);
+    EXPECT_EQ(kBufferCapacity / 2, buffers[1]->size());
+
+    // Queued buffers are no longer the client's, the one after the bad index still is.
+    EXPECT_EQ(-EACCES, codec->queueInputBuffers({InputEntry(0, 4000)}, &numQueued));
+    EXPECT_EQ(0u, numQueued);
+    EXPECT_EQ(OK, codec->queueInputBuffers({InputEntry(2, 4000)}, &numQueued));
+    EXPECT_EQ(1u, numQueued);
+    EXPECT_EQ(buffers[2], queued.back());
+
+    codec->release();
+    looper->stop();
+}
+
+TEST(MediaCodecTest, QueueInputBuffersStopsAtBufferQueuedTwice) {
+    // Test scenario:
+    //
+    // 1) Client queues a batch of buffers where the first buffer appears
+    //    again as the third one.
+    // 2) Only the first two buffers are queued, and just once.
+
+    static const AString kCodecName{"test.codec"};
+    static const AString kCodecOwner{"nobody"};
+    static const AString kMediaType{"audio/x-test"};
+
+    std::vector<sp<MediaCodecBuffer>> queued;
+    sp<MockCodec> mockCodec;
+    std::function<sp<CodecBase>(const AString &name, const char *owner)> getCodecBase =
+        [&mockCodec, &queued](const AString &, const char *) {
+            mockCodec = CreateRunningMockCodec(
+                    kCodecName, new AMessage,
+                    [&queued](const std::shared_ptr<MockBufferChannel> &mockBufferChannel) {
+                        EXPECT_CALL(*mockBufferChannel, queueInputBuffer(_)).Times(0);
+                        EXPECT_CALL(*mockBufferChannel, queueInputBuffers(_, _))
+                            .Times(2)
+                            .WillRepeatedly([&queued](
+                                    const std::vector<sp<MediaCodecBuffer>> &buffers,
+                                    size_t *numQueued) {
+                                queued.insert(queued.end(), buffers.begin(), buffers.end());
+                                *numQueued = buffers.size();
+                                return OK;
+                            });
+                    });
+            return mockCodec;
+        };
+
+    sp<ALooper> looper{new ALooper};
+    sp<MediaCodec> codec = SetupMediaCodec(
+            kCodecOwner, kCodecName, kMediaType, looper, getCodecBase);
+    ASSERT_NE(nullptr, codec) << "Codec must not be null";
+    ASSERT_NE(nullptr, mockCodec) << "MockCodec must not be null";
+    ASSERT_EQ(OK, codec->configure(new AMessage, nullptr, nullptr, 0));
+    ASSERT_EQ(OK, codec->start());
+    std::vector<sp<MediaCodecBuffer>> buffers = GetInputBuffers(mockCodec, codec, 3);
+
+    // 1)
+    size_t numQueued = SIZE_MAX;
+    EXPECT_EQ(-EINVAL, codec->queueInputBuffers(
+            {InputEntry(0, 0), InputEntry(1, 1000), InputEntry(0, 2000), InputEntry(2, 3000)},
+            &numQueued));
+    // 2)
+    EXPECT_EQ(2u, numQueued);
+    EXPECT_EQ((std::vector<sp<MediaCodecBuffer>>{buffers[0], buffers[1]}), queued);
+    int64_t timeUs = -1;
+    EXPECT_TRUE(buffers[0]->meta()->findInt64("timeUs", &timeUs));
+    EXPECT_EQ(0, timeUs);
+
+    EXPECT_EQ(OK, codec->queueInputBuffers({InputEntry(2, 3000)}, &numQueued));
+    EXPECT_EQ(1u, numQueued);
+    EXPECT_EQ(buffers[2], queued.back());
+
+    codec->release();
+    looper->stop();
+}
+
+TEST(MediaCodecTest, QueueInputBuffersWithCryptoQueuesOneByOne) {
+    // Test scenario:
+    //
+    // 1) Client configures the codec with a crypto object and queues a batch
+    //    of buffers where the third one has an index out of range.
+    // 2) The buffers before it go to the buffer channel one at a time as
+    //    secure buffers, not as a batch.
+
+    static const AString kCodecName{"test.codec"};
+    static const AString kCodecOwner{"nobody"};
+    static const AString kMediaType{"audio/x-test"};
+    static const size_t kBadIndex = 1000;
+
+    std::vector<sp<MediaCodecBuffer>> queued;
+    sp<MockCodec> mockCodec;
+    std::function<sp<CodecBase>(const AString &name, const char *owner)> getCodecBase =
+        [&mockCodec, &queued](const AString &, const char *) {
+            mockCodec = CreateRunningMockCodec(
+                    kCodecName, new AMessage,
+                    [&queued](const std::shared_ptr<MockBufferChannel> &mockBufferChannel) {
+                        EXPECT_CALL(*mockBufferChannel, queueInputBuffer(_)).Times(0);
+                        EXPECT_CALL(*mockBufferChannel, queueInputBuffers(_, _)).Times(0);
+                        EXPECT_CALL(*mockBufferChannel,
+                                    queueSecureInputBuffer(_, _, _, _, _, _, _, _, _))
+                            .Times(2)
+                            .WillRepeatedly([&queued](
+                                    const sp<MediaCodecBuffer> &buffer, bool, const uint8_t *,
+                                    const uint8_t *, CryptoPlugin::Mode, CryptoPlugin::Pattern,
+                                    const CryptoPlugin::SubSample *subSamples,
+                                    size_t numSubSamples, AString *) {
+                                // the clear subsample made up for queueInputBuffer()
+                                EXPECT_EQ(1u, numSubSamples);
+                                EXPECT_EQ(kBufferCapacity / 2, subSamples[0].mNumBytesOfClearData);
+                                queued.push_back(buffer);
+                                return OK;
+                            });
+                    });
+            return mockCodec;
+        };
+
+    sp<ALooper> looper{new ALooper};
+    sp<MediaCodec> codec = SetupMediaCodec(
+            kCodecOwner, kCodecName, kMediaType, looper, getCodecBase);
+    ASSERT_NE(nullptr, codec) << "Codec must not be null";
+    ASSERT_NE(nullptr, mockCodec) << "MockCodec must not be null";
+    sp<ICrypto> crypto = new FakeCrypto;
+    ASSERT_EQ(OK, codec->configure(new AMessage, nullptr, crypto, 0));
+    ASSERT_EQ(OK, codec->start());
+    std::vector<sp<MediaCodecBuffer>> buffers = GetInputBuffers(mockCodec, codec, 3);
+
+    // 1)
+    size_t numQueued = SIZE_MAX;
+    EXPECT_EQ(-ERANGE, codec->queueInputBuffers(
+            {InputEntry(0, 0), InputEntry(1, 1000), InputEntry(kBadIndex, 2000),
+             InputEntry(2, 3000)},
+            &numQueued));
+    // 2)
+    EXPECT_EQ(2u, numQueued);
+    EXPECT_EQ((std::vector<sp<MediaCodecBuffer>>{buffers[0], buffers[1]}), queued);
+
+    codec->release();
+    looper->stop();
+}
+
+TEST(MediaCodecTest, QueueInputBuffersAfterLeftoverQueuesOneByOne) {
+    // Test scenario:
+    //
+    // 1) Client queues a linear C2Buffer twice as large as the input buffer,
+    //    so that half of it is left over for the next input buffer.
+    // 2) Client queues a batch of two buffers.
+    // 3) The first buffer of the batch takes the leftover and the second one
+    //    takes the first entry of the batch, one at a time, not as a batch.
+
+    static const AString kCodecName{"test.codec"};
+    static const AString kCodecOwner{"nobody"};
+    static const AString kMediaType{"audio/x-test"};
+
+    std::vector<sp<MediaCodecBuffer>> queued;
+    sp<MockCodec> mockCodec;
+    std::function<sp<CodecBase>(const AString &name, const char *owner)> getCodecBase =
+        [&mockCodec, &queued](const AString &, const char *) {
+            mockCodec = CreateRunningMockCodec(
+                    kCodecName, new AMessage,
+                    [&queued](const std::shared_ptr<MockBufferChannel> &mockBufferChannel) {
+                        EXPECT_CALL(*mockBufferChannel, queueInputBuffers(_, _)).Times(0);
+                        // the C2Buffer, then its leftover
+                        EXPECT_CALL(*mockBufferChannel, attachBuffer(_, _))
+                            .Times(2)
+                            .WillRepeatedly(Return(OK));
+                        EXPECT_CALL(*mockBufferChannel, queueInputBuffer(_))
+                            .Times(3)
+                            .WillRepeatedly([&queued](const sp<MediaCodecBuffer> &buffer) {
+                                queued.push_back(buffer);
+                                return OK;
+                            });
+                    });
+            return mockCodec;
+        };
+
+    sp<ALooper> looper{new ALooper};
+    sp<MediaCodec> codec = SetupMediaCodec(
+            kCodecOwner, kCodecName, kMediaType, looper, getCodecBase);
+    ASSERT_NE(nullptr, codec) << "Codec must not be null";
+    ASSERT_NE(nullptr, mockCodec) << "MockCodec must not be null";
+    ASSERT_EQ(OK, codec->configure(new AMessage, nullptr, nullptr, 0));
+    ASSERT_EQ(OK, codec->start());
+    std::vector<sp<MediaCodecBuffer>> buffers = GetInputBuffers(mockCodec, codec, 3);
+
+    // 1)
+    std::shared_ptr<C2BlockPool> pool;
+    ASSERT_EQ(OK, GetCodec2BlockPool(C2BlockPool::BASIC_LINEAR, nullptr, &pool));
+    std::shared_ptr<C2LinearBlock> block;
+    ASSERT_EQ(C2_OK, pool->fetchLinearBlock(
+            kBufferCapacity * 2, {C2MemoryUsage::CPU_READ, C2MemoryUsage::CPU_WRITE}, &block));
+    std::shared_ptr<C2Buffer> c2Buffer = C2Buffer::CreateLinearBuffer(
+            block->share(0, kBufferCapacity * 2, C2Fence()));
+    ASSERT_EQ(OK, codec->queueBuffer(0, c2Buffer, 0, 0, new AMessage, nullptr));
+
+    // 2)
+    size_t numQueued = SIZE_MAX;
+    EXPECT_EQ(OK, codec->queueInputBuffers(
+            {InputEntry(1, 1000), InputEntry(2, 2000)}, &numQueued));
+    // 3)
+    EXPECT_EQ(2u, numQueued);
+    EXPECT_EQ((std::vector<sp<MediaCodecBuffer>>{buffers[0], buffers[1], buffers[2]}), queued);
+    int64_t timeUs = -1;
+    EXPECT_TRUE(buffers[2]->meta()->findInt64("timeUs", &timeUs));
+    EXPECT_EQ(1000, timeUs);
+
+    codec->release();
+    looper->stop();
+}
+
+TEST(MediaCodecTest, DequeueOutputBuffersStopsAtFormatChange) {
+    // Test scenario:
+    //
+    // 1) Codec produces two output buffers in the configured format, then two
+    //    in a new format.
+    // 2) Client dequeues at most one buffer, then up to eight.
+    // 3) The second batch ends before the first buffer in the new format.
+    // 4) The next call reports the format change, and the one after returns
+    //    the buffers in the new format.
+
+    static const AString kCodecName{"test.codec"};
+    static const AString kCodecOwner{"nobody"};
+    static const AString kMediaType{"audio/x-test"};
+
+    sp<AMessage> outputFormat = new AMessage;
+    sp<MockCodec> mockCodec;
+    std::function<sp<CodecBase>(const AString &name, const char *owner)> getCodecBase =
+        [&mockCodec, outputFormat](const AString &, const char *) {
+            mockCodec = CreateRunningMockCodec(
+                    kCodecName, outputFormat, [](const std::shared_ptr<MockBufferChannel> &) {
+                        // No mock setup, as we don't expect any input buffer
+                        // operations in this scenario.
+                    });
+            return mockCodec;
+        };
+
+    sp<ALooper> looper{new ALooper};
+    sp<MediaCodec> codec = SetupMediaCodec(
+            kCodecOwner, kCodecName, kMediaType, looper, getCodecBase);
+    ASSERT_NE(nullptr, codec) << "Codec must not be null";
+    ASSERT_NE(nullptr, mockCodec) << "MockCodec must not be null";
+    ASSERT_EQ(OK, codec->configure(new AMessage, nullptr, nullptr, 0));
+    ASSERT_EQ(OK, codec->start());
+
+    // 1)
+    sp<AMessage> newFormat = new AMessage;
+    const std::unique_ptr<CodecBase::BufferCallback> &callback =
+        mockCodec->mMockBufferChannel->callback();
+    callback->onOutputBufferAvailable(0, CreateOutputBuffer(outputFormat, 0));
+    callback->onOutputBufferAvailable(1, CreateOutputBuffer(outputFormat, 1000));
+    callback->onOutputBufferAvailable(2, CreateOutputBuffer(newFormat, 2000));
+    callback->onOutputBufferAvailable(3, CreateOutputBuffer(newFormat, 3000));
+
+    // 2)
+    std::vector<MediaCodec::BufferBatchEntry> entries;
+    ASSERT_EQ(OK, codec->dequeueOutputBuffers(&entries, 1, 1000000));
+    ASSERT_EQ(1u, entries.size());
+    EXPECT_EQ(0u, entries[0].index);
+    EXPECT_EQ(0, entries[0].presentationTimeUs);
+    EXPECT_EQ(kBufferCapacity, entries[0].size);
+
+    // 3)
+    ASSERT_EQ(OK, codec->dequeueOutputBuffers(&entries, 8, 1000000));
+    ASSERT_EQ(1u, entries.size());
+    EXPECT_EQ(1u, entries[0].index);
+    EXPECT_EQ(1000, entries[0].presentationTimeUs);
+
+    // 4)
+    EXPECT_EQ(INFO_FORMAT_CHANGED, codec->dequeueOutputBuffers(&entries, 8, 1000000));
+    EXPECT_TRUE(entries.empty());
+    ASSERT_EQ(OK, codec->dequeueOutputBuffers(&entries, 8, 1000000));
+    ASSERT_EQ(2u, entries.size());
+    EXPECT_EQ(2u, entries[0].index);
+    EXPECT_EQ(2000, entries[0].presentationTimeUs);
+    EXPECT_EQ(3u, entries[1].index);
+    EXPECT_EQ(3000, entries[1].presentationTimeUs);
+
+    codec->release();
+    looper->stop();
+}
@@ -25,6 +25,7 @@
 #include <iostream>
 
 #include <media/NdkMediaExtractor.h>
+#include <media/stagefright/foundation/ByteUtils.h>
 #include <media/stagefright/MediaDefs.h>
 #include <media/stagefright/MetaData.h>
 #include <media/stagefright/Utils.h>
@@ -48,6 +49,9 @@
 constexpr int32_t kMpeg4MuxToleranceTimeUs = 100;
 // Tolerance value for other writers
 constexpr int32_t kMuxToleranceTimeUs = 1;
+// Fragment duration of the fragmented mp4 files, short enough for the test
+// clips to span several fragments.
+constexpr int64_t kFragmentDurationUs = 500000;
 
 static WriterTestEnvironment *gEnv = nullptr;
 
@@ -149,7 +153,8 @@ class WriterTest {
         mDisableTest = false;
         static const std::map<std::string, standardWriters> mapWriter = {
                 {"ogg", OGG},     {"aac", AAC},      {"aac_adts", AAC_ADTS}, {"webm", WEBM},
-                {"mpeg4", MPEG4}, {"amrnb", AMR_NB}, {"amrwb", AMR_WB},      {"mpeg2Ts", MPEG2TS}};
+                {"mpeg4", MPEG4}, {"amrnb", AMR_NB}, {"amrwb", AMR_WB},      {"mpeg2Ts", MPEG2TS},
+                {"mpeg4_fragmented", MPEG4_FRAGMENTED}};
         // Find the component type
         if (mapWriter.find(writerFormat) != mapWriter.end()) {
             mWriterName = mapWriter.at(writerFormat);
@@ -180,6 +185,7 @@ class WriterTest {
         AAC_ADTS,
         WEBM,
         MPEG4,
+        MPEG4_FRAGMENTED,
         AMR_NB,
         AMR_WB,
         MPEG2TS,
@@ -250,6 +256,13 @@ int32_t WriterTest::createWriter(int32_t fd) {
             mWriter = new MPEG4Writer(fd);
             mFileMeta->setInt32(kKeyFileType, output_format::OUTPUT_FORMAT_MPEG_4);
             break;
+        case MPEG4_FRAGMENTED: {
+            sp<MPEG4Writer> mp4writer = new MPEG4Writer(fd);
+            if (mp4writer->setFragmentDuration(kFragmentDurationUs) != OK) return -1;
+            mWriter = mp4writer;
+            mFileMeta->setInt32(kKeyFileType, output_format::OUTPUT_FORMAT_MPEG_4);
+            break;
+        }
         case AMR_NB:
             mWriter = new AMRWriter(fd);
             mFileMeta->setInt32(kKeyFileType, output_format::OUTPUT_FORMAT_AMR_NB);
@@ -448,7 +461,7 @@ void WriterTest::compareParams(configFormat srcParam, configFormat dstParam,
     }
 
     int32_t toleranceValueUs = kMuxToleranceTimeUs;
-    if (mWriterName == MPEG4) {
+    if (mWriterName == MPEG4 || mWriterName == MPEG4_FRAGMENTED) {
         toleranceValueUs = kMpeg4MuxToleranceTimeUs;
     }
     for (int32_t i = 0; i < dstBufInfo.size(); i++) {
@@ -466,6 +479,80 @@ void WriterTest::compareParams(configFormat srcParam, configFormat dstParam,
     return;
 }
 
+// A moof/mdat pair of a fragmented mp4 file.
+struct FragmentInfo {
+    uint64_t mdatOffset;
+    uint64_t mdatSize;
+    int32_t numSamples[kMaxTrackCount];
+};
+
+// Reads the header of the box at offset, which must end by end. Returns false if there is no
+// whole box there.
+static bool readBoxHeader(const vector<uint8_t> &file, uint64_t offset, uint64_t end,
+                          int32_t *type, uint64_t *headerSize, uint64_t *boxSize) {
+    if (offset + 8 > end) return false;
+    *boxSize = U32_AT(&file[offset]);
+    *type = U32_AT(&file[offset + 4]);
+    *headerSize = 8;
+    if (*boxSize == 1) {
+        if (offset + 16 > end) return false;
+        *boxSize = U64_AT(&file[offset + 8]);
+        *headerSize = 16;
+    } else if (*boxSize == 0) {
+        *boxSize = end - offset;
+    }
+    return *boxSize >= *headerSize && offset + *boxSize <= end;
+}
+
+// Lists the fragments of a fragmented mp4 file, with the number of samples of each track, as
+// given by the trun boxes of its moof.
+static void getFragments(const vector<uint8_t> &file, vector<FragmentInfo> &fragments) {
+    uint64_t offset = 0;
+    int32_t type;
+    uint64_t headerSize, boxSize;
+    FragmentInfo fragment{};
+    while (readBoxHeader(file, offset, file.size(), &type, &headerSize, &boxSize)) {
+        if (type == FOURCC("moof")) {
+            fragment = {};
+            uint64_t trafOffset = offset + headerSize;
+            uint64_t moofEnd = offset + boxSize;
+            uint64_t trafHeaderSize, trafSize;
+            while (readBoxHeader(file, trafOffset, moofEnd, &type, &trafHeaderSize, &trafSize)) {
+                if (type == FOURCC("traf")) {
+                    uint32_t trackId = 0;
+                    int32_t numSamples = 0;
+                    uint64_t childOffset = trafOffset + trafHeaderSize;
+                    uint64_t trafEnd = trafOffset + trafSize;
+                    uint64_t childHeaderSize, childSize;
+                    while (readBoxHeader(file, childOffset, trafEnd, &type, &childHeaderSize,
+                                         &childSize)) {
+                        // Both start with a full box header, then the field that is read.
+                        if (childSize >= childHeaderSize + 8) {
+                            uint32_t value = U32_AT(&file[childOffset + childHeaderSize + 4]);
+                            if (type == FOURCC("tfhd")) {
+                                trackId = value;
+                            } else if (type == FOURCC("trun")) {
+                                numSamples += value;
+                            }
+                        }
+                        childOffset += childSize;
+                    }
+                    ASSERT_GE(trackId, 1u) << "traf without a valid tfhd";
+                    ASSERT_LE(trackId, kMaxTrackCount) << "Unexpected track id " << trackId;
+                    fragment.numSamples[trackId - 1] += numSamples;
+                }
+                trafOffset += trafSize;
+            }
+        } else if (type == FOURCC("mdat")) {
+            fragment.mdatOffset = offset;
+            fragment.mdatSize = boxSize;
+            fragments.push_back(fragment);
+        }
+        offset += boxSize;
+    }
+    ASSERT_EQ(offset, file.size()) << "Output file does not end with a whole box";
+}
+
 TEST_P(WriteFunctionalityTest, CreateWriterTest) {
     if (mDisableTest) return;
     ALOGV("Tests the creation of writers");
@@ -626,7 +713,8 @@ TEST_P(WriteFunctionalityTest, PauseWriterTest) {
     ASSERT_EQ((status_t)OK, status) << writerFormat << " writer failed";
 
     bool isPaused = false;
-    if ((mWriterName != standardWriters::MPEG2TS) && (mWriterName != standardWriters::MPEG4)) {
+    if ((mWriterName != standardWriters::MPEG2TS) && (mWriterName != standardWriters::MPEG4) &&
+        (mWriterName != standardWriters::MPEG4_FRAGMENTED)) {
         status = mWriter->pause();
         ASSERT_EQ((status_t)OK, status);
         isPaused = true;
@@ -896,6 +984,156 @@ TEST_P(WriteFunctionalityTest, Mpeg4WriterTest) {
     close(fd);
 }
 
+// This test is specific to fragmented mp4 files, which stay playable up to their last whole
+// fragment when the writer does not get to finish them.
+TEST_P(WriteFunctionalityTest, Mpeg4FragmentedTruncatedFileTest) {
+    if (mDisableTest) return;
+    if (mWriterName != standardWriters::MPEG4_FRAGMENTED) return;
+    ALOGV("Checks that the fragments before a truncated one are extracted intact");
+
+    string writerFormat = get<0>(GetParam());
+    string outputFile = OUTPUT_FILE_NAME;
+    int32_t fd =
+            open(outputFile.c_str(), O_CREAT | O_LARGEFILE | O_TRUNC | O_RDWR, S_IRUSR | S_IWUSR);
+    ASSERT_GE(fd, 0) << "Failed to open output file to dump writer's data";
+
+    int32_t status = createWriter(fd);
+    ASSERT_EQ((status_t)OK, status) << "Failed to create writer for output format:" << writerFormat;
+
+    inputId inpId[] = {get<1>(GetParam()), get<2>(GetParam())};
+    ASSERT_NE(inpId[0], UNUSED_ID) << "Test expects first inputId to be a valid id";
+
+    int32_t numTracks = 1;
+    if (inpId[1] != UNUSED_ID) {
+        numTracks++;
+    }
+
+    size_t fileSize[numTracks];
+    configFormat param[numTracks];
+    for (int32_t idx = 0; idx < numTracks; idx++) {
+        string inputFile = gEnv->getRes();
+        string inputInfo = gEnv->getRes();
+        bool isAudio;
+        getFileDetails(inputFile, inputInfo, param[idx], isAudio, inpId[idx]);
+        ASSERT_NE(inputFile.compare(gEnv->getRes()), 0) << "No input file specified";
+
+        struct stat buf;
+        status = stat(inputFile.c_str(), &buf);
+        ASSERT_EQ(status, 0) << "Failed to get properties of input file:" << inputFile;
+        fileSize[idx] = buf.st_size;
+
+        ASSERT_NO_FATAL_FAILURE(getInputBufferInfo(inputFile, inputInfo, idx));
+        status = addWriterSource(isAudio, param[idx], idx);
+        ASSERT_EQ((status_t)OK, status) << "Failed to add source for " << writerFormat << "Writer";
+    }
+
+    status = mWriter->start(mFileMeta.get());
+    ASSERT_EQ((status_t)OK, status);
+    float interval = get<3>(GetParam());
+    ASSERT_LE(interval, 1.0f) << "Buffer interval invalid. Should be less than or equal to 1.0";
+
+    size_t range = 0;
+    int32_t loopCount = 0;
+    int32_t offset[kMaxTrackCount]{};
+    while (loopCount < ceil(1.0 / interval)) {
+        for (int32_t idx = 0; idx < numTracks; idx++) {
+            range = mBufferInfo[idx].size() * interval;
+            status = sendBuffersToWriter(mInputStream[idx], mBufferInfo[idx], mInputFrameId[idx],
+                                         mCurrentTrack[idx], offset[idx], range);
+            ASSERT_EQ((status_t)OK, status) << writerFormat << " writer failed";
+            offset[idx] += range;
+        }
+        loopCount++;
+    }
+    for (int32_t idx = 0; idx < kMaxTrackCount; idx++) {
+        if (mCurrentTrack[idx]) {
+            mCurrentTrack[idx]->stop();
+        }
+    }
+    status = mWriter->stop();
+    ASSERT_EQ((status_t)OK, status) << "Failed to stop the writer";
+    close(fd);
+
+    // Cut the file in the middle of the data of its last fragment, as if the writer had been
+    // killed while writing it.
+    ifstream outputStream(outputFile.c_str(), ifstream::binary);
+    ASSERT_TRUE(outputStream.is_open()) << "Failed to open writer's output file";
+    vector<uint8_t> output((istreambuf_iterator<char>(outputStream)), istreambuf_iterator<char>());
+    outputStream.close();
+
+    vector<FragmentInfo> fragments;
+    ASSERT_NO_FATAL_FAILURE(getFragments(output, fragments));
+    ASSERT_GE(fragments.size(), 2u) << "Test expects the output to have several fragments";
+
+    const FragmentInfo &lastFragment = fragments.back();
+    ASSERT_GT(lastFragment.mdatSize, 16u) << "Last fragment has no data";
+    off64_t truncatedSize = lastFragment.mdatOffset + lastFragment.mdatSize / 2;
+    status = truncate(outputFile.c_str(), truncatedSize);
+    ASSERT_EQ(status, 0) << "Failed to truncate writer's output file";
+
+    int32_t numSamplesBeforeLast[kMaxTrackCount]{};
+    for (size_t i = 0; i + 1 < fragments.size(); i++) {
+        for (int32_t idx = 0; idx < numTracks; idx++) {
+            numSamplesBeforeLast[idx] += fragments[i].numSamples[idx];
+        }
+    }
+
+    configFormat extractorParams[numTracks];
+    vector<BufferInfo> extractorBufferInfo[numTracks];
+    int32_t trackCount = -1;
+
+    AMediaExtractor *extractor = AMediaExtractor_new();
+    ASSERT_NE(extractor, nullptr) << "Failed to create extractor";
+    ASSERT_NO_FATAL_FAILURE(setupExtractor(extractor, outputFile, trackCount));
+    ASSERT_EQ(trackCount, numTracks)
+            << "Tracks reported by extractor does not match with input number of tracks";
+
+    // Make sure that the file was taken for an mp4 file, and so went through MPEG4Extractor.
+    AMediaFormat *fileFormat = AMediaExtractor_getFileFormat(extractor);
+    ASSERT_NE(fileFormat, nullptr) << "File format is NULL";
+    const char *containerMime = nullptr;
+    AMediaFormat_getString(fileFormat, AMEDIAFORMAT_KEY_MIME, &containerMime);
+    ASSERT_NE(containerMime, nullptr) << "Container mime is NULL";
+    ASSERT_TRUE(!strcmp(containerMime, MEDIA_MIMETYPE_CONTAINER_MPEG4) ||
+                !strcmp(containerMime, "audio/mp4"))
+            << "Truncated file was extracted as " << containerMime;
+    AMediaFormat_delete(fileFormat);
+
+    for (int32_t idx = 0; idx < numTracks; idx++) {
+        char *inputBuffer = (char *)malloc(fileSize[idx]);
+        ASSERT_NE(inputBuffer, nullptr)
+                << "Failed to allocate the buffer of size " << fileSize[idx];
+        mInputStream[idx].seekg(0, mInputStream[idx].beg);
+        mInputStream[idx].read(inputBuffer, fileSize[idx]);
+        ASSERT_EQ(mInputStream[idx].gcount(), fileSize[idx]);
+
+        uint8_t *extractedBuffer = (uint8_t *)malloc(fileSize[idx]);
+        ASSERT_NE(extractedBuffer, nullptr)
+                << "Failed to allocate the buffer of size " << fileSize[idx];
+        size_t bytesExtracted = 0;
+
+        ASSERT_NO_FATAL_FAILURE(extract(extractor, extractorParams[idx], extractorBufferInfo[idx],
+                                        extractedBuffer, fileSize[idx], &bytesExtracted, idx));
+
+        // The samples of the whole fragments must all come back. Samples of the truncated one
+        // may too, as long as their data was not cut.
+        ASSERT_GE(extractorBufferInfo[idx].size(), mNumCsds[idx] + numSamplesBeforeLast[idx])
+                << "Samples of the fragments before the truncated one are missing";
+        ASSERT_LE(extractorBufferInfo[idx].size(), mBufferInfo[idx].size())
+                << "More samples extracted than were written";
+
+        ASSERT_NO_FATAL_FAILURE(
+                compareParams(param[idx], extractorParams[idx], extractorBufferInfo[idx], idx));
+
+        ASSERT_EQ(memcmp(extractedBuffer, (uint8_t *)inputBuffer, bytesExtracted), 0)
+                << "Extracted bit stream does not match with input bit stream";
+
+        free(inputBuffer);
+        free(extractedBuffer);
+    }
+    AMediaExtractor_delete(extractor);
+}
+
 class ListenerTest
     : public WriterTest,
       public ::testing::TestWithParam<tuple<
@@ -1066,6 +1304,12 @@ INSTANTIATE_TEST_SUITE_P(
                 make_tuple("mpeg4", H263_1, AMR_NB_1, 0.50),
                 make_tuple("mpeg4", MPEG4_1, HEVC_1, 0.75),
 
+                make_tuple("mpeg4_fragmented", AAC_1, UNUSED_ID, 1),
+                make_tuple("mpeg4_fragmented", AVC_1, UNUSED_ID, 1),
+                make_tuple("mpeg4_fragmented", HEVC_1, UNUSED_ID, 1),
+                make_tuple("mpeg4_fragmented", AAC_1, AVC_1, 0.25),
+                make_tuple("mpeg4_fragmented", AVC_1, AAC_1, 0.75),
+
                 make_tuple("ogg", OPUS_1, UNUSED_ID, 1),
 
                 make_tuple("webm", OPUS_1, UNUSED_ID, 1),
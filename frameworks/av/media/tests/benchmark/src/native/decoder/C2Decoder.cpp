@@ -72,73 +72,78 @@ int32_t C2Decoder::createCodec2Component(string compName, AMediaFormat *format)
     return status;
 }
 
-int32_t C2Decoder::decodeFrames(uint8_t *inputBuffer, vector<AMediaCodecBufferInfo> &frameInfo) {
+int32_t C2Decoder::decodeFrames(uint8_t *inputBuffer, vector<AMediaCodecBufferInfo> &frameInfo,
+                                size_t batchSize) {
     ALOGV("In %s", __func__);
     typedef std::unique_lock<std::mutex> ULock;
     c2_status_t status = C2_OK;
+    mBatchSize = batchSize;
     mStats->setStartTime();
     while (1) {
         if (mNumInputFrame == frameInfo.size()) break;
-        std::unique_ptr<C2Work> work;
-        // Prepare C2Work
+        std::list<std::unique_ptr<C2Work>> items;
+        // Take as many C2Works as are free, up to batchSize
         {
             ULock l(mQueueLock);
             if (mWorkQueue.empty()) mQueueCondition.wait_for(l, MAX_RETRY * TIME_OUT);
-            if (!mWorkQueue.empty()) {
-                mStats->addInputTime();
-                work.swap(mWorkQueue.front());
-                mWorkQueue.pop_front();
-            } else {
+            if (mWorkQueue.empty()) {
                 std::cout << "Wait for generating C2Work exceeded timeout" << std::endl;
                 return -1;
             }
+            while (!mWorkQueue.empty() && items.size() < batchSize &&
+                   mNumInputFrame + items.size() < frameInfo.size()) {
+                mStats->addInputTime();
+                items.push_back(std::move(mWorkQueue.front()));
+                mWorkQueue.pop_front();
+            }
         }
 
-        uint32_t flags = frameInfo[mNumInputFrame].flags;
-        if (flags == AMEDIACODEC_BUFFER_FLAG_CODEC_CONFIG) {
-            flags = C2FrameData::FLAG_CODEC_CONFIG;
-        }
-        if (mNumInputFrame == (frameInfo.size() - 1)) {
-            flags |= C2FrameData::FLAG_END_OF_STREAM;
-        }
-        work->input.flags = (C2FrameData::flags_t)flags;
-        work->input.ordinal.timestamp = frameInfo[mNumInputFrame].presentationTimeUs;
-        work->input.ordinal.frameIndex = mNumInputFrame;
-        work->input.buffers.clear();
-        int size = frameInfo[mNumInputFrame].size;
-        int alignedSize = ALIGN(size, PAGE_SIZE);
-        if (size) {
-            std::shared_ptr<C2LinearBlock> block;
-            status = mLinearPool->fetchLinearBlock(
-                    alignedSize, {C2MemoryUsage::CPU_READ, C2MemoryUsage::CPU_WRITE}, &block);
-            if (status != C2_OK || block == nullptr) {
-                std::cout << "C2LinearBlock::map() failed : " << status << std::endl;
-                return status;
+        // Prepare C2Works
+        for (std::unique_ptr<C2Work> &work : items) {
+            int32_t frameIndex = mNumInputFrame++;
+            uint32_t flags = frameInfo[frameIndex].flags;
+            if (flags == AMEDIACODEC_BUFFER_FLAG_CODEC_CONFIG) {
+                flags = C2FrameData::FLAG_CODEC_CONFIG;
             }
+            if (frameIndex == (frameInfo.size() - 1)) {
+                flags |= C2FrameData::FLAG_END_OF_STREAM;
+            }
+            work->input.flags = (C2FrameData::flags_t)flags;
+            work->input.ordinal.timestamp = frameInfo[frameIndex].presentationTimeUs;
+            work->input.ordinal.frameIndex = frameIndex;
+            work->input.buffers.clear();
+            int size = frameInfo[frameIndex].size;
+            int alignedSize = ALIGN(size, PAGE_SIZE);
+            if (size) {
+                std::shared_ptr<C2LinearBlock> block;
+                status = mLinearPool->fetchLinearBlock(
+                        alignedSize, {C2MemoryUsage::CPU_READ, C2MemoryUsage::CPU_WRITE}, &block);
+                if (status != C2_OK || block == nullptr) {
+                    std::cout << "C2LinearBlock::map() failed : " << status << std::endl;
+                    return status;
+                }
 
-            C2WriteView view = block->map().get();
-            if (view.error() != C2_OK) {
-                std::cout << "C2LinearBlock::map() failed : " << view.error() << std::endl;
-                return view.error();
+                C2WriteView view = block->map().get();
+                if (view.error() != C2_OK) {
+                    std::cout << "C2LinearBlock::map() failed : " << view.error() << std::endl;
+                    return view.error();
+                }
+                memcpy(view.base(), inputBuffer + mOffset, size);
+                work->input.buffers.emplace_back(new LinearBuffer(block, size));
+                mStats->addFrameSize(size);
             }
-            memcpy(view.base(), inputBuffer + mOffset, size);
-            work->input.buffers.emplace_back(new LinearBuffer(block, size));
-            mStats->addFrameSize(size);
+            work->worklets.clear();
+            work->worklets.emplace_back(new C2Worklet);
+            ALOGV("Frame #%d size = %d queued", frameIndex, size);
+            mOffset += size;
         }
-        work->worklets.clear();
-        work->worklets.emplace_back(new C2Worklet);
 
-        std::list<std::unique_ptr<C2Work>> items;
-        items.push_back(std::move(work));
         // queue() invokes process() function of C2 Plugin.
         status = mComponent->queue(&items);
         if (status != C2_OK) {
             ALOGE("queue failed");
             return status;
         }
-        ALOGV("Frame #%d size = %d queued", mNumInputFrame, size);
-        mNumInputFrame++;
-        mOffset += size;
     }
     return status;
 }
@@ -159,12 +164,13 @@ void C2Decoder::deInitCodec() {
 void C2Decoder::dumpStatistics(string inputReference, int64_t durationUs, string componentName,
                                string statsFile) {
     string operation = "c2decode";
-    string mode = "async";
+    string mode = mBatchSize > 1 ? "async-batch" + std::to_string(mBatchSize) : "async";
     mStats->dumpStatistics(operation, inputReference, durationUs, componentName, mode, statsFile);
 }
 
 void C2Decoder::resetDecoder() {
     mOffset = 0;
     mNumInputFrame = 0;
+    mEos = false;
     if (mStats) mStats->reset();
 }
@@ -23,11 +23,13 @@
 
 class C2Decoder : public BenchmarkC2Common {
   public:
-    C2Decoder() : mOffset(0), mNumInputFrame(0), mComponent(nullptr) {}
+    C2Decoder() : mOffset(0), mNumInputFrame(0), mBatchSize(1), mComponent(nullptr) {}
 
     int32_t createCodec2Component(string codecName, AMediaFormat *format);
 
-    int32_t decodeFrames(uint8_t *inputBuffer, vector<AMediaCodecBufferInfo> &frameInfo);
+    // Queues up to batchSize frames to the component in each queue() call.
+    int32_t decodeFrames(uint8_t *inputBuffer, vector<AMediaCodecBufferInfo> &frameInfo,
+                         size_t batchSize = 1);
 
     void deInitCodec();
 
@@ -39,6 +41,7 @@ class C2Decoder : public BenchmarkC2Common {
   private:
     int32_t mOffset;
     int32_t mNumInputFrame;
+    size_t mBatchSize;
     vector<AMediaCodecBufferInfo> mFrameMetaData;
 
     std::shared_ptr<android::Codec2Client::Listener> mListener;
@@ -111,9 +111,40 @@ int32_t Extractor::extract(int32_t trackId) {
     return AMEDIA_OK;
 }
 
+int32_t Extractor::seek(int32_t trackId, int32_t numSeeks) {
+    int32_t status = setupTrackFormat(trackId);
+    if (status != AMEDIA_OK) return status;
+    if (numSeeks <= 0 || mDurationUs <= 0) return AMEDIA_ERROR_INVALID_PARAMETER;
+    mOperation = "seek";
+
+    // Seek times spread over the clip in an order that jumps back and forth, the same
+    // from run to run
+    uint32_t seed = 1;
+    AMediaCodecBufferInfo frameInfo;
+    mStats->setStartTime();
+    for (int32_t idx = 0; idx < numSeeks; idx++) {
+        seed = seed * 1103515245 + 12345;
+        int64_t seekTimeUs = (int64_t)((seed >> 8) % 1000) * mDurationUs / 1000;
+        status = AMediaExtractor_seekTo(mExtractor, seekTimeUs, AMEDIAEXTRACTOR_SEEK_PREVIOUS_SYNC);
+        if (status != AMEDIA_OK) break;
+        memset(&frameInfo, 0, sizeof(AMediaCodecBufferInfo));
+        status = getFrameSample(frameInfo);
+        if (status) break;
+        mStats->addOutputTime();
+    }
+
+    if (mFormat) {
+        AMediaFormat_delete(mFormat);
+        mFormat = nullptr;
+    }
+
+    AMediaExtractor_unselectTrack(mExtractor, trackId);
+
+    return status == AMEDIA_OK ? AMEDIA_OK : AMEDIA_ERROR_UNKNOWN;
+}
+
 void Extractor::dumpStatistics(string inputReference, string componentName, string statsFile) {
-    string operation = "extract";
-    mStats->dumpStatistics(operation, inputReference, mDurationUs, componentName, "", statsFile);
+    mStats->dumpStatistics(mOperation, inputReference, mDurationUs, componentName, "", statsFile);
 }
 
 void Extractor::deInitExtractor() {
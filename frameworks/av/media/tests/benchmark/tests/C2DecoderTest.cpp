@@ -119,26 +119,29 @@ TEST_P(C2DecoderTest, Codec2Decode) {
         }
 
         AMediaFormat *format = extractor->getFormat();
-        // Decode the given input stream for all C2 codecs supported by device
+        // Decode the given input stream for all C2 codecs supported by device, queueing
+        // one frame at a time and then as many as the component has room for.
         for (string codecName : mCodecList) {
             if (codecName.find(GetParam().second) != string::npos &&
                 codecName.find("secure") == string::npos) {
-                status = mDecoder->createCodec2Component(codecName, format);
-                ASSERT_EQ(status, 0) << "Create component failed for " << codecName;
-
-                // Send the inputs to C2 Decoder and wait till all buffers are returned.
-                status = mDecoder->decodeFrames(inputBuffer, frameInfo);
-                ASSERT_EQ(status, 0) << "Decoder failed for " << codecName;
-
-                mDecoder->waitOnInputConsumption();
-                ASSERT_TRUE(mDecoder->mEos) << "Test Failed. Didn't receive EOS \n";
-
-                mDecoder->deInitCodec();
-                int64_t durationUs = extractor->getClipDuration();
-                ALOGV("codec : %s", codecName.c_str());
-                mDecoder->dumpStatistics(GetParam().first, durationUs, codecName,
-                                         gEnv->getStatsFile());
-                mDecoder->resetDecoder();
+                for (size_t batchSize : {1, MAX_INPUT_BUFFERS}) {
+                    status = mDecoder->createCodec2Component(codecName, format);
+                    ASSERT_EQ(status, 0) << "Create component failed for " << codecName;
+
+                    // Send the inputs to C2 Decoder and wait till all buffers are returned.
+                    status = mDecoder->decodeFrames(inputBuffer, frameInfo, batchSize);
+                    ASSERT_EQ(status, 0) << "Decoder failed for " << codecName;
+
+                    mDecoder->waitOnInputConsumption();
+                    ASSERT_TRUE(mDecoder->mEos) << "Test Failed. Didn't receive EOS \n";
+
+                    mDecoder->deInitCodec();
+                    int64_t durationUs = extractor->getClipDuration();
+                    ALOGV("codec : %s, batch : %zu", codecName.c_str(), batchSize);
+                    mDecoder->dumpStatistics(GetParam().first, durationUs, codecName,
+                                             gEnv->getStatsFile());
+                    mDecoder->resetDecoder();
+                }
             }
         }
         free(inputBuffer);
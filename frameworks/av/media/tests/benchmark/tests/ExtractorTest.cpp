@@ -24,6 +24,8 @@
 
 static BenchmarkTestEnvironment *gEnv = nullptr;
 
+constexpr int32_t kNumSeeks = 100;
+
 class ExtractorTest : public ::testing::TestWithParam<pair<string, int32_t>> {};
 
 TEST_P(ExtractorTest, Extract) {
@@ -54,6 +56,35 @@ TEST_P(ExtractorTest, Extract) {
     delete extractObj;
 }
 
+// Latency of seeking back and forth across the clip, as the first sample after each seek
+TEST_P(ExtractorTest, Seek) {
+    Extractor *extractObj = new Extractor();
+    ASSERT_NE(extractObj, nullptr) << "Extractor creation failed";
+
+    string inputFile = gEnv->getRes() + GetParam().first;
+    FILE *inputFp = fopen(inputFile.c_str(), "rb");
+    ASSERT_NE(inputFp, nullptr) << "Unable to open " << inputFile << " file for reading";
+
+    // Read file properties
+    struct stat buf;
+    stat(inputFile.c_str(), &buf);
+    size_t fileSize = buf.st_size;
+    int32_t fd = fileno(inputFp);
+
+    int32_t trackCount = extractObj->initExtractor(fd, fileSize);
+    ASSERT_GT(trackCount, 0) << "initExtractor failed";
+
+    int32_t trackID = GetParam().second;
+    int32_t status = extractObj->seek(trackID, kNumSeeks);
+    ASSERT_EQ(status, AMEDIA_OK) << "Seek failed \n";
+
+    extractObj->deInitExtractor();
+    extractObj->dumpStatistics(GetParam().first, "", gEnv->getStatsFile());
+
+    fclose(inputFp);
+    delete extractObj;
+}
+
 INSTANTIATE_TEST_SUITE_P(ExtractorTestAll, ExtractorTest,
                          ::testing::Values(make_pair("crowd_1920x1080_25fps_4000kbps_vp9.webm", 0),
                                            make_pair("crowd_1920x1080_25fps_6000kbps_h263.3gp", 0),
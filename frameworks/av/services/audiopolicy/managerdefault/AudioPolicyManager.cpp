@@ -31,6 +31,7 @@
 
 #include <algorithm>
 #include <inttypes.h>
+#include <iterator>
 #include <math.h>
 #include <set>
 #include <unordered_set>
@@ -136,6 +137,9 @@ status_t AudioPolicyManager::setDeviceConnectionStateInt(audio_devices_t deviceT
 status_t AudioPolicyManager::setDeviceConnectionStateInt(const sp<DeviceDescriptor> &device,
                                                          audio_policy_dev_state_t state)
 {
+    // device availability and the outputs opened for it are used by getOutputForAttr()
+    invalidateOutputSelectionCache();
+
     // handle output devices
     if (audio_is_output_device(device->type())) {
         SortedVector <audio_io_handle_t> outputs;
@@ -1031,7 +1035,17 @@ status_t AudioPolicyManager::getOutputForAttrInt(
     }
     // explicit routing managed by getDeviceForStrategy in APM is now handled by engine
     // in order to let the choice of the order to future vendor engine
-    outputDevices = mEngine->getOutputDevicesForAttributes(*resultAttr, requestedDevice, false);
+    // Only the engine choice is cached: an explicitly requested device is returned as is.
+    if (requestedDevice == nullptr) {
+        mOutputSelectionCache.setActivity(getOutputSelectionActivity());
+    }
+    if (requestedDevice != nullptr ||
+            !mOutputSelectionCache.getDevicesForAttributes(*resultAttr, &outputDevices)) {
+        outputDevices = mEngine->getOutputDevicesForAttributes(*resultAttr, requestedDevice, false);
+        if (requestedDevice == nullptr) {
+            mOutputSelectionCache.putDevicesForAttributes(*resultAttr, outputDevices);
+        }
+    }
 
     if ((resultAttr->flags & AUDIO_FLAG_HW_AV_SYNC) != 0) {
         *flags = (audio_output_flags_t)(*flags | AUDIO_OUTPUT_FLAG_HW_AV_SYNC);
@@ -1324,11 +1338,19 @@ audio_io_handle_t AudioPolicyManager::getOutputForDevices(
     if (audio_is_linear_pcm(config->format)) {
         // get which output is suitable for the specified stream. The actual
         // routing change will happen when startOutput() will be called
-        SortedVector<audio_io_handle_t> outputs = getOutputsForDevices(devices, mOutputs);
 
         // at this stage we should ignore the DIRECT flag as no direct output could be found earlier
         *flags = (audio_output_flags_t)(*flags & ~AUDIO_OUTPUT_FLAG_DIRECT);
-        output = selectOutput(outputs, *flags, config->format, channelMask, config->sample_rate);
+        if (!mOutputSelectionCache.getOutputForConfig(devices, *flags, config->format,
+                channelMask, config->sample_rate, &output)) {
+            SortedVector<audio_io_handle_t> outputs = getOutputsForDevices(devices, mOutputs);
+            output = selectOutput(outputs, *flags, config->format, channelMask,
+                    config->sample_rate);
+            if (output != AUDIO_IO_HANDLE_NONE) {
+                mOutputSelectionCache.putOutputForConfig(devices, *flags, config->format,
+                        channelMask, config->sample_rate, output);
+            }
+        }
     }
     ALOGW_IF((output == 0), "getOutputForDevices() could not find output for stream %d, "
             "sampling rate %d, format %#x, channels %#x, flags %#x",
@@ -1783,6 +1805,10 @@ status_t AudioPolicyManager::startSource(const sp<SwAudioOutputDescriptor>& outp
     // NOTE that the usage count is the same for duplicated output and hardware output which is
     // necessary for a correct control of hardware output routing by startOutput() and stopOutput()
     outputDesc->setClientActive(client, true);
+    // the engine follows the preferred device of active clients
+    if (client->hasPreferredDevice(true)) {
+        invalidateOutputSelectionCache();
+    }
 
     if (client->hasPreferredDevice(true)) {
         if (outputDesc->clientsList(true /*activeOnly*/).size() == 1 &&
@@ -1954,6 +1980,7 @@ status_t AudioPolicyManager::stopSource(const sp<SwAudioOutputDescriptor>& outpu
         if (client->hasPreferredDevice(true)) {
             checkStrategyRoute(client->strategy(), AUDIO_IO_HANDLE_NONE);
             forceDeviceUpdate = true;
+            invalidateOutputSelectionCache();
         }
 
         // decrement usage count of this stream on the output
@@ -3472,6 +3499,7 @@ void AudioPolicyManager::dump(String8 *dst) const
     mAudioPatches.dump(dst);
     mPolicyMixes.dump(dst);
     mAudioSources.dump(dst);
+    mOutputSelectionCache.dump(dst);
 
     dst->appendFormat(" AllowedCapturePolicies:\n");
     for (auto& policy : mAllowedCapturePolicies) {
@@ -4942,6 +4970,7 @@ void AudioPolicyManager::addOutput(audio_io_handle_t output,
                                    const sp<SwAudioOutputDescriptor>& outputDesc)
 {
     mOutputs.add(output, outputDesc);
+    invalidateOutputSelectionCache();
     applyStreamVolumes(outputDesc, DeviceTypeSet(), 0 /* delayMs */, true /* force */);
     updateMono(output); // update mono status when adding to output list
     selectOutputForMusicEffects();
@@ -4955,6 +4984,7 @@ void AudioPolicyManager::removeOutput(audio_io_handle_t output)
         mPrimaryOutput = nullptr;
     }
     mOutputs.removeItem(output);
+    invalidateOutputSelectionCache();
     selectOutputForMusicEffects();
 }
 
@@ -5931,6 +5961,54 @@ void AudioPolicyManager::updateDevicesAndOutputs()
 {
     mEngine->updateDeviceSelectionCache();
     mPreviousOutputs = mOutputs;
+
+    // This runs on every start and stop of music, which rarely changes the routing: only drop
+    // the cached output selection if the engine now routes a strategy differently.
+    OutputSelectionCache::RoutingState routing;
+    for (const auto &strategy : mEngine->getOrderedProductStrategies()) {
+        const AttributesVector attributes = mEngine->getAllAttributesForProductStrategy(strategy);
+        routing.push_back(attributes.empty() ? DeviceVector() :
+                mEngine->getOutputDevicesForAttributes(attributes.front(), nullptr,
+                                                       true /*fromCache*/));
+    }
+    mOutputSelectionCache.setActivity(getOutputSelectionActivity());
+    mOutputSelectionCache.updateRouting(std::move(routing));
+}
+
+void AudioPolicyManager::invalidateOutputSelectionCache()
+{
+    mOutputSelectionCache.invalidate();
+}
+
+uint32_t AudioPolicyManager::getOutputSelectionActivity() const
+{
+    // Mirrors the activity checks of the engines' device selection.
+    const bool active[] = {
+        mOutputs.isActiveLocally(toVolumeSource(AUDIO_STREAM_VOICE_CALL)),
+        mOutputs.isActive(toVolumeSource(AUDIO_STREAM_MUSIC),
+                          SONIFICATION_RESPECTFUL_AFTER_MUSIC_DELAY),
+        mOutputs.isActiveLocally(toVolumeSource(AUDIO_STREAM_MUSIC),
+                                 SONIFICATION_RESPECTFUL_AFTER_MUSIC_DELAY),
+        mOutputs.isActiveRemotely(toVolumeSource(AUDIO_STREAM_MUSIC),
+                                  SONIFICATION_RESPECTFUL_AFTER_MUSIC_DELAY),
+        mOutputs.isActiveLocally(toVolumeSource(AUDIO_STREAM_ACCESSIBILITY),
+                                 SONIFICATION_RESPECTFUL_AFTER_MUSIC_DELAY),
+        mOutputs.isActive(toVolumeSource(AUDIO_STREAM_RING)),
+        mOutputs.isActive(toVolumeSource(AUDIO_STREAM_ALARM)),
+    };
+    uint32_t activity = 0;
+    for (size_t i = 0; i < std::size(active); i++) {
+        activity |= active[i] ? 1u << i : 0;
+    }
+    // accessibility is not routed to an active compressed output
+    for (size_t i = 0; i < mOutputs.size(); i++) {
+        const sp<SwAudioOutputDescriptor> desc = mOutputs.valueAt(i);
+        if (desc->isActive() && !audio_is_linear_pcm(desc->getFormat())) {
+            activity |= 1u << std::size(active);
+            break;
+        }
+    }
+    return activity;
 }
 
 uint32_t AudioPolicyManager::checkDeviceMuteStrategies(const sp<AudioOutputDescriptor>& outputDesc,
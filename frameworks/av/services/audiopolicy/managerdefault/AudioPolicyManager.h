@@ -48,6 +48,7 @@
 #include <EffectDescriptor.h>
 #include <SoundTriggerSession.h>
 #include "EngineLibrary.h"
+#include "OutputSelectionCache.h"
 #include "TypeConverter.h"
 
 namespace android {
@@ -623,6 +624,20 @@ protected:
          */
         void updateDevicesAndOutputs();
 
+        /**
+         * @brief invalidateOutputSelectionCache: drops the device and output decisions cached
+         * by getOutputForAttr(). Must be called every time the set of opened outputs or the
+         * available devices change. Routing and stream activity changes are detected by
+         * updateDevicesAndOutputs() and getOutputForAttr().
+         */
+        void invalidateOutputSelectionCache();
+
+        /**
+         * @brief getOutputSelectionActivity: returns the activity of the streams the engine
+         * device selection depends on, as a bit mask only meant to be compared with itself.
+         */
+        uint32_t getOutputSelectionActivity() const;
+
         // selects the most appropriate device on input for current state
         sp<DeviceDescriptor> getNewInputDevice(const sp<AudioInputDescriptor>& inputDesc);
 
@@ -850,6 +865,9 @@ protected:
 
         std::unordered_map<uid_t, audio_flags_mask_t> mAllowedCapturePolicies;
 
+        // Device and output decisions of getOutputForAttr() for the current routing state
+        OutputSelectionCache mOutputSelectionCache;
+
         // Cached product strategy ID corresponding to legacy strategy STRATEGY_PHONE
         product_strategy_t mCommunnicationStrategy;
 
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <DeviceDescriptor.h>
+#include <media/AudioCommonTypes.h>
+#include <system/audio.h>
+#include <utils/String8.h>
+
+namespace android {
+
+/**
+ * Memoizes the output device and mixed output selection done by getOutputForAttr().
+ *
+ * Both decisions only depend on the routing state of the policy manager: available devices,
+ * phone state, forced usages, preferred devices, the set of opened outputs and the activity of
+ * the few streams the engine takes into account. Entries are dropped, starting a new
+ * generation, only when that state actually changes:
+ *  - invalidate() is called when devices are connected or outputs opened or closed;
+ *  - updateRouting() is given the devices the engine selects for every strategy each time the
+ *    policy manager refreshes the engine, and drops entries when they differ from the last
+ *    refresh;
+ *  - setActivity() is given the stream activity the engine looks at before every lookup, and
+ *    drops device entries when it changed. Output entries don't depend on stream activity.
+ *
+ * Entries are kept in small fixed size tables with round robin replacement: a handful of
+ * attributes and configurations cover the vast majority of track creations, and a linear
+ * scan over a few entries is cheaper than hashing DeviceVectors.
+ */
+class OutputSelectionCache {
+public:
+    static constexpr size_t kMaxEntries = 16;
+
+    using RoutingState = std::vector<DeviceVector>;
+
+    /** Drops all entries. */
+    void invalidate()
+    {
+        invalidateDevices();
+        mOutputEntries.clear();
+        mNextOutputEntry = 0;
+        // The next routing update can't tell whether something changed since the last one.
+        mRoutingValid = false;
+    }
+
+    /** Drops all entries if |routing| differs from the state given to the previous call. */
+    void updateRouting(RoutingState &&routing)
+    {
+        if (mRoutingValid && routing == mRouting) {
+            return;
+        }
+        invalidate();
+        mRouting = std::move(routing);
+        mRoutingValid = true;
+    }
+
+    /**
+     * Drops the device entries if |activity| differs from the previous call. |activity| holds
+     * the activity of the streams the engine device selection depends on, as seen by the
+     * engine: recently stopped streams may still count as active for some time.
+     */
+    void setActivity(uint32_t activity)
+    {
+        if (activity == mActivity) {
+            return;
+        }
+        invalidateDevices();
+        mActivity = activity;
+        // Routing states recorded with the previous activity can't be compared any more.
+        mRoutingValid = false;
+    }
+
+    bool getDevicesForAttributes(const audio_attributes_t &attr, DeviceVector *devices)
+    {
+        for (const auto &entry : mDevicesEntries) {
+            if (entry.attributes == attr) {
+                *devices = entry.devices;
+                mDevicesHits++;
+                return true;
+            }
+        }
+        mDevicesMisses++;
+        return false;
+    }
+
+    void putDevicesForAttributes(const audio_attributes_t &attr, const DeviceVector &devices)
+    {
+        insert(mDevicesEntries, mNextDevicesEntry, DevicesEntry{attr, devices});
+    }
+
+    bool getOutputForConfig(const DeviceVector &devices, audio_output_flags_t flags,
+                            audio_format_t format, audio_channel_mask_t channelMask,
+                            uint32_t samplingRate, audio_io_handle_t *output)
+    {
+        for (const auto &entry : mOutputEntries) {
+            if (entry.flags == flags && entry.format == format &&
+                    entry.channelMask == channelMask && entry.samplingRate == samplingRate &&
+                    entry.devices == devices) {
+                *output = entry.output;
+                mOutputHits++;
+                return true;
+            }
+        }
+        mOutputMisses++;
+        return false;
+    }
+
+    void putOutputForConfig(const DeviceVector &devices, audio_output_flags_t flags,
+                            audio_format_t format, audio_channel_mask_t channelMask,
+                            uint32_t samplingRate, audio_io_handle_t output)
+    {
+        insert(mOutputEntries, mNextOutputEntry,
+               OutputEntry{devices, flags, format, channelMask, samplingRate, output});
+    }
+
+    uint32_t getGeneration() const { return mGeneration; }
+
+    void dump(String8 *dst) const
+    {
+        dst->appendFormat(" Output selection cache: generation %u\n", mGeneration);
+        dst->appendFormat("   - devices: %zu entries, %llu hits, %llu misses\n",
+                mDevicesEntries.size(), (unsigned long long)mDevicesHits,
+                (unsigned long long)mDevicesMisses);
+        dst->appendFormat("   - outputs: %zu entries, %llu hits, %llu misses\n",
+                mOutputEntries.size(), (unsigned long long)mOutputHits,
+                (unsigned long long)mOutputMisses);
+    }
+
+private:
+    struct DevicesEntry {
+        audio_attributes_t attributes;
+        DeviceVector devices;
+    };
+
+    struct OutputEntry {
+        DeviceVector devices;
+        audio_output_flags_t flags;
+        audio_format_t format;
+        audio_channel_mask_t channelMask;
+        uint32_t samplingRate;
+        audio_io_handle_t output;
+    };
+
+    void invalidateDevices()
+    {
+        mGeneration++;
+        mDevicesEntries.clear();
+        mNextDevicesEntry = 0;
+    }
+
+    template <typename Entry>
+    static void insert(std::vector<Entry> &entries, size_t &next, Entry &&entry)
+    {
+        if (entries.size() < kMaxEntries) {
+            entries.push_back(std::move(entry));
+            return;
+        }
+        entries[next] = std::move(entry);
+        next = (next + 1) % kMaxEntries;
+    }
+
+    uint32_t mGeneration = 0;
+    RoutingState mRouting;
+    bool mRoutingValid = false;
+    uint32_t mActivity = 0;
+
+    std::vector<DevicesEntry> mDevicesEntries;
+    size_t mNextDevicesEntry = 0;
+    std::vector<OutputEntry> mOutputEntries;
+    size_t mNextOutputEntry = 0;
+
+    uint64_t mDevicesHits = 0;
+    uint64_t mDevicesMisses = 0;
+    uint64_t mOutputHits = 0;
+    uint64_t mOutputMisses = 0;
+};
+
+} // namespace android
@@ -32,7 +32,11 @@ class AudioPolicyTestManager : public AudioPolicyManager {
     using AudioPolicyManager::releaseMsdOutputPatches;
     using AudioPolicyManager::setMsdOutputPatches;
     using AudioPolicyManager::getAudioPatches;
+    using AudioPolicyManager::invalidateOutputSelectionCache;
     uint32_t getAudioPortGeneration() const { return mAudioPortGeneration; }
+    uint32_t getOutputSelectionGeneration() const {
+        return mOutputSelectionCache.getGeneration();
+    }
 };
 
 }  // namespace android
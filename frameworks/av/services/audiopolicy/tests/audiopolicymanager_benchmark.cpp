@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iterator>
+#include <memory>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "AudioPolicyManagerTestClient.h"
+#include "AudioPolicyTestManager.h"
+
+using namespace android;
+
+namespace {
+
+// Measures the cost of creating, optionally playing, and releasing a track in the policy manager,
+// as done for every AudioTrack by short lived players such as games and notifications.
+// The argument selects whether the output selection cache is dropped before each track
+// creation (0) or kept warm (1).
+class TrackCreation {
+public:
+    TrackCreation()
+            : mClient(new AudioPolicyManagerTestClient),
+              mManager(new AudioPolicyTestManager(mClient.get())) {
+        AudioPolicyConfig& config = mManager->getConfig();
+        config.setDefault();
+        sp<HwModule> primaryModule =
+                config.getHwModules().getModuleFromName(AUDIO_HARDWARE_MODULE_ID_PRIMARY);
+        const audio_output_flags_t kFlags[] = {
+                AUDIO_OUTPUT_FLAG_FAST, AUDIO_OUTPUT_FLAG_DEEP_BUFFER,
+                AUDIO_OUTPUT_FLAG_RAW, AUDIO_OUTPUT_FLAG_SYNC };
+        for (const audio_output_flags_t flags : kFlags) {
+            sp<OutputProfile> profile = new OutputProfile(
+                    std::string("output ") + std::to_string(flags));
+            profile->addAudioProfile(new AudioProfile(
+                    AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_STEREO, 48000));
+            profile->setFlags(flags);
+            profile->addSupportedDevice(config.getDefaultOutputDevice());
+            primaryModule->addOutputProfile(profile);
+        }
+        mInitStatus = mManager->initialize();
+    }
+
+    bool isInitialized() const { return mInitStatus == NO_ERROR; }
+
+    // Creates a track and releases it, optionally starting and stopping it in between.
+    status_t createAndRelease(audio_usage_t usage, audio_output_flags_t flags, bool play) {
+        audio_attributes_t attr = AUDIO_ATTRIBUTES_INITIALIZER;
+        attr.usage = usage;
+        audio_config_t config = AUDIO_CONFIG_INITIALIZER;
+        config.sample_rate = 48000;
+        config.channel_mask = AUDIO_CHANNEL_OUT_STEREO;
+        config.format = AUDIO_FORMAT_PCM_16_BIT;
+        audio_io_handle_t output = AUDIO_IO_HANDLE_NONE;
+        audio_stream_type_t stream = AUDIO_STREAM_DEFAULT;
+        audio_port_handle_t selectedDeviceId = AUDIO_PORT_HANDLE_NONE;
+        audio_port_handle_t portId = AUDIO_PORT_HANDLE_NONE;
+        AudioPolicyInterface::output_type_t outputType;
+        status_t status = mManager->getOutputForAttr(&attr, &output, AUDIO_SESSION_NONE, &stream,
+                0 /*uid*/, &config, &flags, &selectedDeviceId, &portId, nullptr, &outputType);
+        if (status != NO_ERROR) {
+            return status;
+        }
+        if (play) {
+            status = mManager->startOutput(portId);
+            if (status == NO_ERROR) {
+                status = mManager->stopOutput(portId);
+            }
+        }
+        mManager->releaseOutput(portId);
+        return status;
+    }
+
+    AudioPolicyTestManager* manager() { return mManager.get(); }
+
+private:
+    std::unique_ptr<AudioPolicyManagerTestClient> mClient;
+    std::unique_ptr<AudioPolicyTestManager> mManager;
+    status_t mInitStatus = NO_INIT;
+};
+
+const struct {
+    audio_usage_t usage;
+    audio_output_flags_t flags;
+} kTracks[] = {
+    {AUDIO_USAGE_GAME, AUDIO_OUTPUT_FLAG_FAST},
+    {AUDIO_USAGE_NOTIFICATION, AUDIO_OUTPUT_FLAG_NONE},
+    {AUDIO_USAGE_MEDIA, AUDIO_OUTPUT_FLAG_DEEP_BUFFER},
+    {AUDIO_USAGE_ASSISTANCE_SONIFICATION, AUDIO_OUTPUT_FLAG_FAST},
+};
+
+} // namespace
+
+static void runTracks(benchmark::State& state, bool play) {
+    const bool useCache = state.range(0) != 0;
+    TrackCreation tracks;
+    if (!tracks.isInitialized()) {
+        state.SkipWithError("policy manager initialization failed");
+        return;
+    }
+
+    size_t i = 0;
+    for (auto _ : state) {
+        if (!useCache) {
+            tracks.manager()->invalidateOutputSelectionCache();
+        }
+        const auto& track = kTracks[i++ % std::size(kTracks)];
+        if (tracks.createAndRelease(track.usage, track.flags, play) != NO_ERROR) {
+            state.SkipWithError("track creation failed");
+            return;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_GetOutputForAttr(benchmark::State& state) {
+    runTracks(state, false /*play*/);
+}
+
+// The full life of a short sound: getOutputForAttr, startOutput, stopOutput, releaseOutput.
+static void BM_PlayTrack(benchmark::State& state) {
+    runTracks(state, true /*play*/);
+}
+
+BENCHMARK(BM_GetOutputForAttr)->Arg(0)->Arg(1);
+BENCHMARK(BM_PlayTrack)->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
@@ -1451,3 +1451,185 @@ INSTANTIATE_TEST_CASE_P(
                 DevicesRoleForCapturePresetParam({AUDIO_SOURCE_HOTWORD, DEVICE_ROLE_PREFERRED})
                 )
         );
+
+class AudioPolicyManagerOutputSelectionCacheTest : public AudioPolicyManagerTest {
+protected:
+    struct Request {
+        audio_usage_t usage;
+        audio_output_flags_t flags;
+        audio_channel_mask_t channelMask;
+        uint32_t sampleRate;
+    };
+
+    struct Decision {
+        audio_io_handle_t output;
+        audio_port_handle_t selectedDeviceId;
+    };
+
+    void SetUpManagerConfig() override;
+    // Returns the decision of getOutputForAttr() for the request and releases the output.
+    void decide(const Request &request, Decision *decision);
+    void expectSameDecisions(const std::vector<Decision> &expected);
+
+    static const std::vector<Request> sRequests;
+};
+
+const std::vector<AudioPolicyManagerOutputSelectionCacheTest::Request>
+AudioPolicyManagerOutputSelectionCacheTest::sRequests = {
+    {AUDIO_USAGE_MEDIA, AUDIO_OUTPUT_FLAG_NONE, AUDIO_CHANNEL_OUT_STEREO, 48000},
+    {AUDIO_USAGE_MEDIA, AUDIO_OUTPUT_FLAG_DEEP_BUFFER, AUDIO_CHANNEL_OUT_STEREO, 44100},
+    {AUDIO_USAGE_GAME, AUDIO_OUTPUT_FLAG_FAST, AUDIO_CHANNEL_OUT_STEREO, 48000},
+    {AUDIO_USAGE_GAME, AUDIO_OUTPUT_FLAG_FAST, AUDIO_CHANNEL_OUT_MONO, 44100},
+    {AUDIO_USAGE_NOTIFICATION, AUDIO_OUTPUT_FLAG_NONE, AUDIO_CHANNEL_OUT_STEREO, 44100},
+    {AUDIO_USAGE_ASSISTANCE_SONIFICATION, AUDIO_OUTPUT_FLAG_FAST, AUDIO_CHANNEL_OUT_MONO, 48000},
+    {AUDIO_USAGE_ALARM, AUDIO_OUTPUT_FLAG_NONE, AUDIO_CHANNEL_OUT_STEREO, 48000},
+};
+
+void AudioPolicyManagerOutputSelectionCacheTest::SetUpManagerConfig() {
+    AudioPolicyManagerTest::SetUpManagerConfig();
+    AudioPolicyConfig& config = mManager->getConfig();
+    sp<HwModule> primaryModule =
+            config.getHwModules().getModuleFromName(AUDIO_HARDWARE_MODULE_ID_PRIMARY);
+    sp<AudioProfile> pcmProfile = new AudioProfile(
+            AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_STEREO, 48000);
+
+    sp<OutputProfile> fastOutputProfile = new OutputProfile("fast");
+    fastOutputProfile->addAudioProfile(pcmProfile);
+    fastOutputProfile->setFlags(AUDIO_OUTPUT_FLAG_FAST);
+    fastOutputProfile->addSupportedDevice(config.getDefaultOutputDevice());
+    primaryModule->addOutputProfile(fastOutputProfile);
+
+    sp<OutputProfile> deepBufferOutputProfile = new OutputProfile("deep buffer");
+    deepBufferOutputProfile->addAudioProfile(pcmProfile);
+    deepBufferOutputProfile->setFlags(AUDIO_OUTPUT_FLAG_DEEP_BUFFER);
+    deepBufferOutputProfile->addSupportedDevice(config.getDefaultOutputDevice());
+    primaryModule->addOutputProfile(deepBufferOutputProfile);
+
+    sp<OutputProfile> multichannelOutputProfile = new OutputProfile("multichannel");
+    multichannelOutputProfile->addAudioProfile(new AudioProfile(
+            AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_5POINT1, 48000));
+    multichannelOutputProfile->setFlags(AUDIO_OUTPUT_FLAG_DIRECT);
+    multichannelOutputProfile->addSupportedDevice(config.getDefaultOutputDevice());
+    primaryModule->addOutputProfile(multichannelOutputProfile);
+}
+
+void AudioPolicyManagerOutputSelectionCacheTest::decide(
+        const Request &request, Decision *decision) {
+    audio_attributes_t attr = AUDIO_ATTRIBUTES_INITIALIZER;
+    attr.usage = request.usage;
+    audio_port_handle_t portId = AUDIO_PORT_HANDLE_NONE;
+    decision->selectedDeviceId = AUDIO_PORT_HANDLE_NONE;
+    getOutputForAttr(&decision->selectedDeviceId, AUDIO_FORMAT_PCM_16_BIT, request.channelMask,
+            request.sampleRate, request.flags, &decision->output, &portId, attr);
+    mManager->releaseOutput(portId);
+}
+
+void AudioPolicyManagerOutputSelectionCacheTest::expectSameDecisions(
+        const std::vector<Decision> &expected) {
+    ASSERT_EQ(sRequests.size(), expected.size());
+    for (size_t i = 0; i < sRequests.size(); i++) {
+        Decision decision;
+        ASSERT_NO_FATAL_FAILURE(decide(sRequests[i], &decision));
+        EXPECT_EQ(expected[i].output, decision.output) << "request " << i;
+        EXPECT_EQ(expected[i].selectedDeviceId, decision.selectedDeviceId) << "request " << i;
+    }
+}
+
+TEST_F(AudioPolicyManagerOutputSelectionCacheTest, CachedDecisionsMatchUncached) {
+    std::vector<Decision> uncached(sRequests.size());
+    for (size_t i = 0; i < sRequests.size(); i++) {
+        mManager->invalidateOutputSelectionCache();
+        ASSERT_NO_FATAL_FAILURE(decide(sRequests[i], &uncached[i]));
+    }
+
+    // Creating and releasing tracks must not invalidate the cache.
+    const uint32_t generation = mManager->getOutputSelectionGeneration();
+    expectSameDecisions(uncached);
+    expectSameDecisions(uncached);
+    EXPECT_EQ(generation, mManager->getOutputSelectionGeneration());
+}
+
+TEST_F(AudioPolicyManagerOutputSelectionCacheTest, KeptAcrossStartAndStop) {
+    std::vector<Decision> uncached(sRequests.size());
+    for (size_t i = 0; i < sRequests.size(); i++) {
+        mManager->invalidateOutputSelectionCache();
+        ASSERT_NO_FATAL_FAILURE(decide(sRequests[i], &uncached[i]));
+    }
+
+    audio_attributes_t attr = AUDIO_ATTRIBUTES_INITIALIZER;
+    attr.usage = AUDIO_USAGE_GAME;
+    auto playOnce = [&]() {
+        audio_port_handle_t selectedDeviceId = AUDIO_PORT_HANDLE_NONE;
+        audio_port_handle_t portId;
+        audio_io_handle_t output;
+        getOutputForAttr(&selectedDeviceId, AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_STEREO,
+                48000, AUDIO_OUTPUT_FLAG_FAST, &output, &portId, attr);
+        ASSERT_EQ(NO_ERROR, mManager->startOutput(portId));
+        ASSERT_EQ(NO_ERROR, mManager->stopOutput(portId));
+        mManager->releaseOutput(portId);
+    };
+    // The first start makes music active, which the engine takes into account.
+    ASSERT_NO_FATAL_FAILURE(playOnce());
+    expectSameDecisions(uncached);
+
+    // Music stays active for the engine for a while after it stopped, so playing again
+    // changes nothing.
+    const uint32_t generation = mManager->getOutputSelectionGeneration();
+    for (int i = 0; i < 3; i++) {
+        ASSERT_NO_FATAL_FAILURE(playOnce());
+    }
+    expectSameDecisions(uncached);
+    EXPECT_EQ(generation, mManager->getOutputSelectionGeneration());
+}
+
+TEST_F(AudioPolicyManagerOutputSelectionCacheTest, InvalidatedWhenRingtoneStarts) {
+    std::vector<Decision> before(sRequests.size());
+    for (size_t i = 0; i < sRequests.size(); i++) {
+        ASSERT_NO_FATAL_FAILURE(decide(sRequests[i], &before[i]));
+    }
+
+    audio_attributes_t attr = AUDIO_ATTRIBUTES_INITIALIZER;
+    attr.usage = AUDIO_USAGE_NOTIFICATION_TELEPHONY_RINGTONE;
+    audio_port_handle_t selectedDeviceId = AUDIO_PORT_HANDLE_NONE;
+    audio_port_handle_t portId;
+    audio_io_handle_t output;
+    getOutputForAttr(&selectedDeviceId, AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_STEREO, 48000,
+            AUDIO_OUTPUT_FLAG_NONE, &output, &portId, attr);
+    ASSERT_EQ(NO_ERROR, mManager->startOutput(portId));
+
+    // Accessibility follows the ringtone while it plays: the next decision is not reused.
+    const uint32_t generation = mManager->getOutputSelectionGeneration();
+    // Speaker is the only output device so decisions are unchanged.
+    expectSameDecisions(before);
+    EXPECT_NE(generation, mManager->getOutputSelectionGeneration());
+
+    ASSERT_EQ(NO_ERROR, mManager->stopOutput(portId));
+    mManager->releaseOutput(portId);
+}
+
+TEST_F(AudioPolicyManagerOutputSelectionCacheTest, InvalidatedOnDirectOutputOpenAndClose) {
+    uint32_t generation = mManager->getOutputSelectionGeneration();
+    audio_port_handle_t selectedDeviceId = AUDIO_PORT_HANDLE_NONE;
+    audio_port_handle_t portId;
+    audio_io_handle_t output;
+    getOutputForAttr(&selectedDeviceId, AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_5POINT1, 48000,
+            AUDIO_OUTPUT_FLAG_NONE, &output, &portId);
+    EXPECT_NE(generation, mManager->getOutputSelectionGeneration());
+
+    generation = mManager->getOutputSelectionGeneration();
+    mManager->releaseOutput(portId);
+    EXPECT_NE(generation, mManager->getOutputSelectionGeneration());
+}
+
+TEST_F(AudioPolicyManagerOutputSelectionCacheTest, InvalidatedOnForceUse) {
+    std::vector<Decision> before(sRequests.size());
+    for (size_t i = 0; i < sRequests.size(); i++) {
+        ASSERT_NO_FATAL_FAILURE(decide(sRequests[i], &before[i]));
+    }
+
+    const uint32_t generation = mManager->getOutputSelectionGeneration();
+    mManager->setForceUse(AUDIO_POLICY_FORCE_FOR_MEDIA, AUDIO_POLICY_FORCE_SPEAKER);
+    EXPECT_NE(generation, mManager->getOutputSelectionGeneration());
+    // Speaker is the only output device so decisions are unchanged.
+    expectSameDecisions(before);
+}
@@ -17,9 +17,13 @@
 #define LOG_TAG "MediaLog"
 //#define LOG_NDEBUG 0
 
+#include <memory>
+#include <string>
 #include <sys/mman.h>
+#include <vector>
 #include <utils/Log.h>
 #include <binder/PermissionCache.h>
+#include <media/nblog/BinaryLog.h>
 #include <media/nblog/Merger.h>
 #include <media/nblog/NBLog.h>
 #include <mediautils/ServiceUtilities.h>
@@ -107,7 +111,10 @@ status_t MediaLogService::dump(int fd, const Vector<String16>& args __unused)
 
     if (args.size() > 0) {
         const String8 arg0(args[0]);
-        if (!strcmp(arg0.string(), "-r")) {
+        // "-b" writes binary data, use "adb exec-out dumpsys media.log -b > log.nblog"
+        // and decode it with nblog_decode.
+        const bool binary = !strcmp(arg0.string(), "-b");
+        if (binary || !strcmp(arg0.string(), "-r")) {
             // needed because mReaders is protected by mLock
             bool locked = dumpTryLock(mLock);
 
@@ -122,12 +129,16 @@ status_t MediaLogService::dump(int fd, const Vector<String16>& args __unused)
                 return NO_ERROR;
             }
 
-            for (const auto &dumpReader : mDumpReaders) {
-                if (fd >= 0) {
-                    dprintf(fd, "\n%s:\n", dumpReader->name().c_str());
-                    dumpReader->dump(fd, 0 /*indent*/);
-                } else {
-                    ALOGI("%s:", dumpReader->name().c_str());
+            if (binary) {
+                dumpBinaryLocked(fd);
+            } else {
+                for (const auto &dumpReader : mDumpReaders) {
+                    if (fd >= 0) {
+                        dprintf(fd, "\n%s:\n", dumpReader->name().c_str());
+                        dumpReader->dump(fd, 0 /*indent*/);
+                    } else {
+                        ALOGI("%s:", dumpReader->name().c_str());
+                    }
                 }
             }
             mLock.unlock();
@@ -138,6 +149,30 @@ status_t MediaLogService::dump(int fd, const Vector<String16>& args __unused)
     return NO_ERROR;
 }
 
+void MediaLogService::dumpBinaryLocked(int fd)
+{
+    if (fd < 0) {
+        return;
+    }
+    // The snapshots do not consume the writers' FIFOs, like the text dump.
+    std::vector<std::unique_ptr<NBLog::Snapshot>> snapshots;
+    std::vector<const NBLog::Snapshot *> snapshotPtrs;
+    std::vector<std::string> names;
+    snapshots.reserve(mDumpReaders.size());
+    for (const auto &dumpReader : mDumpReaders) {
+        snapshots.push_back(dumpReader->getSnapshot(false /*flush*/));
+        snapshotPtrs.push_back(snapshots.back().get());
+        names.push_back(dumpReader->name());
+    }
+    size_t numRecords;
+    const status_t status = NBLog::writeBinaryLog(fd, names, snapshotPtrs, &numRecords);
+    if (status != NO_ERROR) {
+        ALOGW("%s: writeBinaryLog failed: %d", __func__, status);
+    } else {
+        ALOGV("%s: wrote %zu records from %zu writers", __func__, numRecords, names.size());
+    }
+}
+
 status_t MediaLogService::onTransact(uint32_t code, const Parcel& data, Parcel* reply,
         uint32_t flags)
 {
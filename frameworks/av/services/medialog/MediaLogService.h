@@ -53,6 +53,9 @@ private:
     // Size of merge buffer, in bytes
     static const size_t kMergeBufferSize = 64 * 1024; // TODO determine good value for this
     static bool dumpTryLock(Mutex& mutex);
+    // Writes the logs of all writers as one timestamp-sorted binary log, see
+    // NBLog::writeBinaryLog(). Must be called with mLock held.
+    void dumpBinaryLocked(int fd);
 
     Mutex               mLock;
 
@@ -82,14 +82,14 @@ void VelocityTrackerState::computeCurrentVelocity(int32_t units, float maxVeloci
     BitSet32 idBits(mVelocityTracker.getCurrentPointerIdBits());
     mCalculatedIdBits = idBits;
 
-    for (uint32_t index = 0; !idBits.isEmpty(); index++) {
-        uint32_t id = idBits.clearFirstMarkedBit();
-
-        float vx, vy;
-        mVelocityTracker.getVelocity(id, &vx, &vy);
-
-        vx = vx * units / 1000;
-        vy = vy * units / 1000;
+    // Estimate all pointers at once, so that the tracker can share the work between them.
+    float velocitiesX[MAX_POINTERS], velocitiesY[MAX_POINTERS];
+    mVelocityTracker.getVelocities(idBits, velocitiesX, velocitiesY);
+
+    const uint32_t count = idBits.count();
+    for (uint32_t index = 0; index < count; index++) {
+        float vx = velocitiesX[index] * units / 1000;
+        float vy = velocitiesY[index] * units / 1000;
 
         if (vx > maxVelocity) {
             vx = maxVelocity;
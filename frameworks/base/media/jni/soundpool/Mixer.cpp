@@ -0,0 +1,414 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SoundPool::Mixer"
+#include <utils/Log.h>
+
+#include "Mixer.h"
+
+#include "Stream.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace android::soundpool {
+
+// The voices are mixed in chunks of at most kMixFrames, which is also how long
+// volume changes, starts and stops are ramped over (about 5ms at 48kHz).
+static constexpr size_t kMixFrames = 256;
+
+// The AudioTrack is paused after it has been idle for this long, so that a SoundPool
+// that is not playing anything does not keep the fast mixer busy.
+static constexpr int64_t kIdleTimeBeforePauseNs = 2 * NANOS_PER_SECOND;
+
+static constexpr float kScale8 = 1.f / (1 << 7);
+static constexpr float kScale16 = 1.f / (1 << 15);
+
+namespace {
+
+// Readers of one sample of a Sound as float, for each of the formats SoundDecoder produces.
+struct ReadU8 {
+    static float read(const void* data, size_t index) {
+        return (static_cast<const uint8_t*>(data)[index] - 0x80) * kScale8;
+    }
+};
+
+struct ReadI16 {
+    static float read(const void* data, size_t index) {
+        return static_cast<const int16_t*>(data)[index] * kScale16;
+    }
+};
+
+struct ReadFloat {
+    static float read(const void* data, size_t index) {
+        return static_cast<const float*>(data)[index];
+    }
+};
+
+// Reads count stereo frames into out, starting at the frame position (32 fractional bits)
+// and advancing by step for each frame.  The caller ensures that the integer part of the
+// position stays below frames.  Mono Sounds go to both channels, Sounds with more than
+// two channels contribute their first two.
+//
+// The unity rate case is a plain strided copy that the compiler vectorizes, the others
+// interpolate linearly between neighbouring frames.
+template <typename R>
+void readFrames(const void* data, size_t channels, size_t frames,
+        uint64_t position, uint64_t step, float* out, size_t count)
+{
+    const size_t right = channels > 1 ? 1 : 0;
+    if (step == (uint64_t(1) << 32) && (position & 0xffffffff) == 0) {
+        const size_t first = (position >> 32) * channels;
+        for (size_t i = 0; i < count; ++i) {
+            out[2 * i] = R::read(data, first + i * channels);
+            out[2 * i + 1] = R::read(data, first + i * channels + right);
+        }
+        return;
+    }
+    for (size_t i = 0; i < count; ++i, position += step) {
+        const size_t frame = position >> 32;
+        const size_t next = std::min(frame + 1, frames - 1);
+        const float fraction = (position & 0xffffffff) * (1.f / 4294967296.f);
+        const float l0 = R::read(data, frame * channels);
+        const float r0 = R::read(data, frame * channels + right);
+        const float l1 = R::read(data, next * channels);
+        const float r1 = R::read(data, next * channels + right);
+        out[2 * i] = l0 + (l1 - l0) * fraction;
+        out[2 * i + 1] = r0 + (r1 - r0) * fraction;
+    }
+}
+
+// Adds count stereo frames of in to out with the given volume, ramping linearly
+// from the start volume to the end volume.
+void accumulate(float* out, const float* in, size_t count,
+        float startLeft, float startRight, float endLeft, float endRight)
+{
+    if (startLeft == endLeft && startRight == endRight) {
+        if (endLeft == 0.f && endRight == 0.f) return;
+        for (size_t i = 0; i < count; ++i) {
+            out[2 * i] += in[2 * i] * endLeft;
+            out[2 * i + 1] += in[2 * i + 1] * endRight;
+        }
+        return;
+    }
+    const float stepLeft = (endLeft - startLeft) / count;
+    const float stepRight = (endRight - startRight) / count;
+    for (size_t i = 0; i < count; ++i) {
+        out[2 * i] += in[2 * i] * (startLeft + stepLeft * i);
+        out[2 * i + 1] += in[2 * i + 1] * (startRight + stepRight * i);
+    }
+}
+
+} // namespace
+
+Mixer::Mixer(size_t voices, const audio_attributes_t* attributes,
+        const std::string& opPackageName)
+    : mVoices(voices)
+    , mScratch(kMixFrames * kChannelCount)
+{
+    ALOGV("%s(%zu, ...)", __func__, voices);
+    mEnded.reserve(voices);
+    mReleasedSounds.reserve(voices);
+    mReleasingSounds.reserve(voices);
+
+    uint32_t sampleRate = 0;
+    const audio_stream_type_t streamType = AudioSystem::attributesToStreamType(*attributes);
+    if (AudioSystem::getOutputSamplingRate(&sampleRate, streamType) == NO_ERROR
+            && sampleRate != 0) {
+        mSampleRate = sampleRate;
+    }
+    // Use the fast mixer sample rate and the default (lowest latency) frame count,
+    // so that play() is heard as soon as it would be with a static fast AudioTrack.
+    mAudioTrack = new AudioTrack(streamType, mSampleRate, AUDIO_FORMAT_PCM_FLOAT,
+            AUDIO_CHANNEL_OUT_STEREO, 0 /*frameCount*/, AUDIO_OUTPUT_FLAG_FAST,
+            staticCallback, this,
+            0 /*default notification frames*/, AUDIO_SESSION_ALLOCATE,
+            AudioTrack::TRANSFER_CALLBACK,
+            nullptr /*offloadInfo*/, -1 /*uid*/, -1 /*pid*/,
+            attributes,
+            false /*doNotReconnect*/, 1.0f /*maxRequiredSpeed*/,
+            AUDIO_PORT_HANDLE_NONE, opPackageName);
+    // MediaMetricsConstants.h: AMEDIAMETRICS_PROP_CALLERNAME_VALUE_SOUNDPOOL
+    mAudioTrack->setCallerName("soundpool");
+    mStatus = mAudioTrack->initCheck();
+    if (mStatus != NO_ERROR) {
+        ALOGE("%s: error %d creating AudioTrack", __func__, mStatus);
+        mAudioTrack.clear();
+    }
+}
+
+Mixer::Mixer(size_t voices, uint32_t sampleRate)
+    : mSampleRate(sampleRate)
+    , mStatus(NO_ERROR)
+    , mVoices(voices)
+    , mScratch(kMixFrames * kChannelCount)
+{
+    ALOGV("%s(%zu, %u)", __func__, voices, sampleRate);
+    mEnded.reserve(voices);
+    mReleasedSounds.reserve(voices);
+    mReleasingSounds.reserve(voices);
+}
+
+Mixer::~Mixer()
+{
+    ALOGV("%s", __func__);
+    // This waits for the AudioTrack callback thread to join,
+    // so there are no more calls to the Streams afterwards.
+    mAudioTrack.clear();
+}
+
+status_t Mixer::start(size_t voice, Stream* stream, int32_t streamID,
+        const std::shared_ptr<Sound>& sound, float leftVolume, float rightVolume,
+        int32_t loop, float rate)
+{
+    ALOGV("%s(voice=%zu, streamID=%d, soundID=%d, leftVolume=%f, rightVolume=%f,"
+            " loop=%d, rate=%f)", __func__, voice, streamID, sound->getSoundID(),
+            leftVolume, rightVolume, loop, rate);
+    if (mStatus != NO_ERROR) return mStatus;
+    const audio_format_t format = sound->getFormat();
+    if (format != AUDIO_FORMAT_PCM_16_BIT && format != AUDIO_FORMAT_PCM_8_BIT
+            && format != AUDIO_FORMAT_PCM_FLOAT) {
+        ALOGE("%s: unsupported format %#x", __func__, format);
+        return BAD_VALUE;
+    }
+    const size_t frameSize = sound->getChannelCount() * audio_bytes_per_sample(format);
+    const size_t frames = sound->getSizeInBytes() / frameSize;
+    if (frames == 0) return BAD_VALUE;
+
+    std::shared_ptr<Sound> release; // release outside of lock.
+    {
+        std::lock_guard lock(mLock);
+        Voice& v = mVoices[voice];
+        if (v.mState == Voice::IDLE) ++mActiveVoices;
+        release = std::move(v.mSound);
+        v.mState = Voice::PLAYING;
+        v.mPaused = false;
+        v.mStream = stream;
+        v.mStreamID = streamID;
+        v.mSound = sound;
+        v.mLoop = loop;
+        v.mPosition = 0;
+        v.mStep = stepForRate_l(*sound, rate);
+        v.mFrames = frames;
+        // Ramp up from silence, like AudioFlinger does for a new track.
+        v.mLeftVolume = 0.f;
+        v.mRightVolume = 0.f;
+        v.mTargetLeftVolume = leftVolume;
+        v.mTargetRightVolume = rightVolume;
+    }
+    startTrack();
+    return NO_ERROR;
+}
+
+void Mixer::stop(size_t voice)
+{
+    ALOGV("%s(%zu)", __func__, voice);
+    std::lock_guard lock(mLock);
+    Voice& v = mVoices[voice];
+    if (v.mState == Voice::PLAYING) {
+        // mix() finishes the ramp down and releases the Sound.
+        v.mState = Voice::STOPPING;
+        v.mTargetLeftVolume = 0.f;
+        v.mTargetRightVolume = 0.f;
+    }
+}
+
+void Mixer::setPaused(size_t voice, bool paused)
+{
+    ALOGV("%s(%zu, %d)", __func__, voice, paused);
+    std::lock_guard lock(mLock);
+    mVoices[voice].mPaused = paused;
+}
+
+void Mixer::setVolume(size_t voice, float leftVolume, float rightVolume)
+{
+    std::lock_guard lock(mLock);
+    Voice& v = mVoices[voice];
+    if (v.mState == Voice::PLAYING) {
+        v.mTargetLeftVolume = leftVolume;
+        v.mTargetRightVolume = rightVolume;
+    }
+}
+
+void Mixer::setRate(size_t voice, float rate)
+{
+    std::lock_guard lock(mLock);
+    Voice& v = mVoices[voice];
+    if (v.mState != Voice::IDLE) {
+        v.mStep = stepForRate_l(*v.mSound, rate);
+    }
+}
+
+void Mixer::setLoop(size_t voice, int32_t loop)
+{
+    std::lock_guard lock(mLock);
+    mVoices[voice].mLoop = loop;
+}
+
+size_t Mixer::getActiveVoiceCount() const
+{
+    std::lock_guard lock(mLock);
+    return mActiveVoices;
+}
+
+uint64_t Mixer::stepForRate_l(const Sound& sound, float rate) const
+{
+    // The Sound is resampled to the output rate here, rather than by AudioFlinger.
+    const double step = double(sound.getSampleRate()) * rate / mSampleRate;
+    return std::max(uint64_t(1), uint64_t(std::llround(step * 4294967296.)));
+}
+
+size_t Mixer::read_l(Voice& v, size_t frameCount)
+{
+    const void* data = v.mSound->getData();
+    const size_t channels = v.mSound->getChannelCount();
+    const audio_format_t format = v.mSound->getFormat();
+    const uint64_t end = uint64_t(v.mFrames) << 32;
+    size_t done = 0;
+    while (done < frameCount) {
+        if (v.mPosition >= end) {
+            if (v.mLoop == 0) break;
+            if (v.mLoop > 0) --v.mLoop;
+            v.mPosition -= end;
+            continue;
+        }
+        // The number of output frames before the position reaches the end of the Sound.
+        const uint64_t left = (end - v.mPosition + v.mStep - 1) / v.mStep;
+        const size_t count = (size_t)std::min(uint64_t(frameCount - done), left);
+        float* const out = &mScratch[done * kChannelCount];
+        switch (format) {
+        case AUDIO_FORMAT_PCM_8_BIT:
+            readFrames<ReadU8>(data, channels, v.mFrames, v.mPosition, v.mStep, out, count);
+            break;
+        case AUDIO_FORMAT_PCM_FLOAT:
+            readFrames<ReadFloat>(data, channels, v.mFrames, v.mPosition, v.mStep, out, count);
+            break;
+        default:
+            readFrames<ReadI16>(data, channels, v.mFrames, v.mPosition, v.mStep, out, count);
+            break;
+        }
+        v.mPosition += v.mStep * count;
+        done += count;
+    }
+    return done;
+}
+
+void Mixer::mix(float* out, size_t frameCount, std::vector<EndedVoice>* ended)
+{
+    std::fill(out, out + frameCount * kChannelCount, 0.f);
+    {
+        std::lock_guard lock(mLock);
+        for (size_t offset = 0; offset < frameCount && mActiveVoices > 0; offset += kMixFrames) {
+            const size_t chunk = std::min(kMixFrames, frameCount - offset);
+            float* const chunkOut = out + offset * kChannelCount;
+            for (Voice& v : mVoices) {
+                if (v.mState == Voice::IDLE) continue;
+                // A paused voice is ramped down like a stopped one, and then stays silent
+                // at its position until it is resumed, when it ramps up from there.
+                const bool silent = v.mLeftVolume == 0.f && v.mRightVolume == 0.f;
+                if (v.mPaused && silent && v.mState == Voice::PLAYING) continue;
+                const float leftVolume = v.mPaused ? 0.f : v.mTargetLeftVolume;
+                const float rightVolume = v.mPaused ? 0.f : v.mTargetRightVolume;
+                // A paused voice that is stopped after its ramp down is just released.
+                const size_t read = v.mPaused && silent ? 0 : read_l(v, chunk);
+                if (read > 0) {
+                    accumulate(chunkOut, mScratch.data(), read,
+                            v.mLeftVolume, v.mRightVolume, leftVolume, rightVolume);
+                }
+                v.mLeftVolume = leftVolume;
+                v.mRightVolume = rightVolume;
+                if (read < chunk || v.mState == Voice::STOPPING) {
+                    if (v.mState == Voice::PLAYING) {
+                        ended->push_back({v.mStream, v.mStreamID});
+                    }
+                    v.mState = Voice::IDLE;
+                    v.mPaused = false;
+                    v.mStream = nullptr;
+                    mReleasedSounds.push_back(std::move(v.mSound));
+                    --mActiveVoices;
+                }
+            }
+        }
+        // Both vectors keep their capacity, so that mixing does not allocate.
+        mReleasedSounds.swap(mReleasingSounds);
+    }
+    // The Sounds are released outside of the lock; they may be the last reference.
+    mReleasingSounds.clear();
+    for (size_t i = 0; i < frameCount * kChannelCount; ++i) {
+        out[i] = std::clamp(out[i], -1.f, 1.f);
+    }
+}
+
+void Mixer::startTrack()
+{
+    if (mAudioTrack == nullptr) return;  // mixed by the caller.
+    std::lock_guard lock(mTrackLock);
+    if (!mTrackStarted) {
+        mIdleFrames = 0;
+        mAudioTrack->start();
+        mTrackStarted = true;
+    }
+}
+
+/* static */
+void Mixer::staticCallback(int event, void* user, void* info)
+{
+    static_cast<Mixer*>(user)->callback(event, info);
+}
+
+void Mixer::callback(int event, void* info)
+{
+    switch (event) {
+    case AudioTrack::EVENT_MORE_DATA: {
+        auto buffer = static_cast<AudioTrack::Buffer*>(info);
+        const size_t frameCount = buffer->size / (kChannelCount * sizeof(float));
+        mEnded.clear();
+        mix(static_cast<float*>(buffer->raw), frameCount, &mEnded);
+        buffer->size = frameCount * kChannelCount * sizeof(float);
+
+        // Report the ended voices without the lock, as the Streams call back into the Mixer.
+        for (const EndedVoice& e : mEnded) {
+            e.stream->mixerVoiceEnded(e.streamID);
+        }
+
+        if (getActiveVoiceCount() > 0) {
+            mIdleFrames = 0;
+        } else if ((mIdleFrames += frameCount) * NANOS_PER_SECOND
+                >= kIdleTimeBeforePauseNs * mSampleRate) {
+            std::lock_guard lock(mTrackLock);
+            // start() may have been called since.
+            if (mTrackStarted && getActiveVoiceCount() == 0) {
+                ALOGV("%s: pausing idle track", __func__);
+                mAudioTrack->pause();
+                mTrackStarted = false;
+            }
+        }
+        break;
+    }
+    case AudioTrack::EVENT_UNDERRUN:
+        ALOGV("%s: EVENT_UNDERRUN", __func__);
+        break;
+    case AudioTrack::EVENT_NEW_IAUDIOTRACK:
+        ALOGV("%s: NEW_IAUDIOTRACK", __func__);
+        break;
+    default:
+        ALOGV("%s: event %d", __func__, event);
+        break;
+    }
+}
+
+} // namespace android::soundpool
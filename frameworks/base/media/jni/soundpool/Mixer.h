@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Sound.h"
+
+#include <android-base/thread_annotations.h>
+#include <media/AudioTrack.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace android::soundpool {
+
+class Stream; // forward decl
+
+/**
+ * Mixer plays the Streams of a StreamManager through a single AudioTrack.
+ *
+ * Without a Mixer, every Stream plays its Sound through its own static AudioTrack.
+ * Games that fire many overlapping effects then create and recycle an AudioTrack
+ * (shared memory control block, server side track and AudioFlinger mixer slot) for
+ * nearly every play().  With a Mixer, the StreamManager owns one streaming
+ * AUDIO_OUTPUT_FLAG_FAST AudioTrack and the Sounds are mixed in process,
+ * on the AudioTrack callback thread.
+ *
+ * The Mixer has one voice for each Stream pair (only one Stream of a pair plays at a time),
+ * so the maxStreams and priority semantics are still handled entirely by the StreamManager.
+ * A voice keeps its own volume, rate, loop count and paused state.
+ *
+ * Voices are changed by the Streams under the Stream lock, and the Mixer is called
+ * without the Stream lock when a voice ends.
+ *
+ * Locking order:
+ *  Stream mLock -> Mixer mLock
+ *  Mixer mTrackLock -> Mixer mLock
+ */
+class Mixer {
+public:
+    // The Sounds are mixed to stereo float.
+    static constexpr size_t kChannelCount = 2;
+
+    Mixer(size_t voices, const audio_attributes_t* attributes, const std::string& opPackageName);
+    // A Mixer without an AudioTrack, whose output is only produced by calling mix().
+    // This is for testing.
+    Mixer(size_t voices, uint32_t sampleRate);
+    ~Mixer();
+
+    // Returns NO_ERROR if the AudioTrack could be created.
+    status_t initCheck() const { return mStatus; }
+    uint32_t getSampleRate() const { return mSampleRate; }
+
+    // Starts a Sound on a voice, replacing any Sound playing there.
+    // The stream and streamID are reported back through Stream::mixerVoiceEnded()
+    // when a Sound that is not looping forever reaches its end.
+    status_t start(size_t voice, Stream* stream, int32_t streamID,
+            const std::shared_ptr<Sound>& sound, float leftVolume, float rightVolume,
+            int32_t loop, float rate);
+    // Ramps the voice down over one buffer and releases the Sound.
+    void stop(size_t voice);
+    // Pausing ramps the voice down over one buffer and keeps its position,
+    // resuming ramps it back up from there.
+    void setPaused(size_t voice, bool paused);
+    void setVolume(size_t voice, float leftVolume, float rightVolume);
+    void setRate(size_t voice, float rate);
+    void setLoop(size_t voice, int32_t loop);
+
+    size_t getActiveVoiceCount() const;
+
+    // Adds the active voices to frameCount frames of interleaved stereo (zeroed first).
+    // Voices that end are appended to ended, so that they can be reported without the lock.
+    // This is called from the AudioTrack callback thread only, and is public for testing.
+    struct EndedVoice {
+        Stream* stream;
+        int32_t streamID;
+    };
+    void mix(float* out, size_t frameCount, std::vector<EndedVoice>* ended);
+
+private:
+    struct Voice {
+        enum state { IDLE, PLAYING, STOPPING };
+
+        int                    mState = IDLE;
+        bool                   mPaused = false;
+        Stream*                mStream = nullptr;
+        int32_t                mStreamID = 0;
+        std::shared_ptr<Sound> mSound;
+        int32_t                mLoop = 0;        // loops left, -1 is forever.
+
+        // The position is in frames of the Sound, with 32 fractional bits,
+        // and is advanced by mStep for each output frame.
+        uint64_t               mPosition = 0;
+        uint64_t               mStep = 0;
+        size_t                 mFrames = 0;      // frames in the Sound.
+
+        // The volume is ramped from the current to the target over one buffer.
+        float                  mLeftVolume = 0.f;
+        float                  mRightVolume = 0.f;
+        float                  mTargetLeftVolume = 0.f;
+        float                  mTargetRightVolume = 0.f;
+    };
+
+    static void staticCallback(int event, void* user, void* info);
+    void callback(int event, void* info);
+
+    uint64_t stepForRate_l(const Sound& sound, float rate) const REQUIRES(mLock);
+    // Returns the number of frames read into mScratch, which is less than frameCount only
+    // if the voice reached its end.
+    size_t read_l(Voice& voice, size_t frameCount) REQUIRES(mLock);
+    void startTrack();
+
+    uint32_t               mSampleRate = 48000;
+    status_t               mStatus = NO_INIT;
+    sp<AudioTrack>         mAudioTrack;
+
+    // mTrackLock serializes starting and pausing mAudioTrack, which is paused
+    // after it has been idle for a while.
+    std::mutex             mTrackLock;
+    bool                   mTrackStarted GUARDED_BY(mTrackLock) = false;
+    int64_t                mIdleFrames = 0;    // callback thread only.
+
+    mutable std::mutex     mLock;
+    std::vector<Voice>     mVoices GUARDED_BY(mLock);
+    size_t                 mActiveVoices GUARDED_BY(mLock) = 0;
+
+    // Callback thread buffers, sized on construction so that mixing never allocates.
+    std::vector<float>     mScratch GUARDED_BY(mLock);   // one voice, stereo.
+    std::vector<EndedVoice> mEnded;                      // callback thread only.
+    std::vector<std::shared_ptr<Sound>> mReleasedSounds GUARDED_BY(mLock);
+    std::vector<std::shared_ptr<Sound>> mReleasingSounds;  // callback thread only.
+};
+
+} // namespace android::soundpool
@@ -40,6 +40,25 @@ Sound::Sound(int32_t soundID, int fd, int64_t offset, int64_t length)
     ALOGW_IF(mFd == -1, "Unable to dup descriptor %d", fd);
 }
 
+Sound::Sound(int32_t soundID, const void* data, size_t sizeInBytes, uint32_t sampleRate,
+        int32_t channelCount, audio_format_t format)
+    : mSizeInBytes(sizeInBytes)
+    , mSoundID(soundID)
+    , mSampleRate(sampleRate)
+    , mChannelCount(channelCount)
+    , mFormat(format)
+    , mChannelMask(audio_channel_out_mask_from_count(channelCount))
+    , mOffset(0)
+    , mLength(sizeInBytes)
+{
+    ALOGV("%s(soundID=%d, sizeInBytes=%zu, sampleRate=%u, channelCount=%d, format=%#x)",
+            __func__, soundID, sizeInBytes, sampleRate, channelCount, format);
+    mHeap = new MemoryHeapBase(sizeInBytes);
+    memcpy(mHeap->getBase(), data, sizeInBytes);
+    mData = new MemoryBase(mHeap, 0, sizeInBytes);
+    mState = READY;  // this should be last, as it is an atomic sync point
+}
+
 Sound::~Sound()
 {
     ALOGV("%s(soundID=%d, fd=%d)", __func__, mSoundID, mFd.get());
@@ -61,6 +61,9 @@ public:
     // to either READY or DECODE_ERROR when doLoad() is called.
 
     Sound(int soundID, int fd, int64_t offset, int64_t length);
+    // A Sound that is already READY with the given PCM data, for testing.
+    Sound(int soundID, const void* data, size_t sizeInBytes, uint32_t sampleRate,
+            int32_t channelCount, audio_format_t format);
     ~Sound();
 
     int32_t getSoundID() const { return mSoundID; }
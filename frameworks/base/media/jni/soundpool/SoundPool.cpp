@@ -85,12 +85,15 @@ bool checkLoop(int32_t *loop)
 } // namespace
 
 SoundPool::SoundPool(
-        int32_t maxStreams, const audio_attributes_t* attributes, const std::string& opPackageName)
-    : mStreamManager(maxStreams, kStreamManagerThreads, attributes, opPackageName)
+        int32_t maxStreams, const audio_attributes_t* attributes, const std::string& opPackageName,
+        bool useMixer)
+    : mStreamManager(maxStreams, kStreamManagerThreads, attributes, opPackageName, useMixer)
 {
-    ALOGV("%s(maxStreams=%d, attr={ content_type=%d, usage=%d, flags=0x%x, tags=%s })",
+    ALOGV("%s(maxStreams=%d, attr={ content_type=%d, usage=%d, flags=0x%x, tags=%s },"
+            " useMixer=%d)",
             __func__, maxStreams,
-            attributes->content_type, attributes->usage, attributes->flags, attributes->tags);
+            attributes->content_type, attributes->usage, attributes->flags, attributes->tags,
+            useMixer);
 }
 
 SoundPool::~SoundPool()
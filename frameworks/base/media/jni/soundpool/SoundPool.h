@@ -31,8 +31,10 @@ namespace android {
  */
 class SoundPool {
 public:
+    // If useMixer is set, the streams are mixed in process into a single AudioTrack
+    // instead of each playing through its own AudioTrack.  See soundpool::Mixer.
     SoundPool(int32_t maxStreams, const audio_attributes_t* attributes,
-            const std::string& opPackageName = {});
+            const std::string& opPackageName = {}, bool useMixer = false);
     ~SoundPool();
 
     // SoundPool Java API support
@@ -20,6 +20,7 @@
 
 #include "Stream.h"
 
+#include "Mixer.h"
 #include "StreamManager.h"
 
 namespace android::soundpool {
@@ -38,6 +39,8 @@ void Stream::autoPause()
         mAutoPaused = true;
         if (mAudioTrack != nullptr) {
             mAudioTrack->pause();
+        } else if (mHasVoice) {
+            getMixer()->setPaused(getVoice(), true);
         }
     }
 }
@@ -51,6 +54,8 @@ void Stream::autoResume()
             mState = PLAYING;
             if (mAudioTrack != nullptr) {
                 mAudioTrack->start();
+            } else if (mHasVoice) {
+                getMixer()->setPaused(getVoice(), false);
             }
         }
         mAutoPaused = false; // New for R: always reset autopause (consistent with API spec).
@@ -67,6 +72,12 @@ void Stream::mute(bool muting)
         } else {
             mAudioTrack->setVolume(mLeftVolume, mRightVolume);
         }
+    } else if (mHasVoice) {
+        if (mMuted) {
+            getMixer()->setVolume(getVoice(), 0.0f, 0.0f);
+        } else {
+            getMixer()->setVolume(getVoice(), mLeftVolume, mRightVolume);
+        }
     }
 }
 
@@ -79,6 +90,8 @@ void Stream::pause(int32_t streamID)
             mState = PAUSED;
             if (mAudioTrack != nullptr) {
                 mAudioTrack->pause();
+            } else if (mHasVoice) {
+                getMixer()->setPaused(getVoice(), true);
             }
         }
     }
@@ -93,6 +106,8 @@ void Stream::resume(int32_t streamID)
             mState = PLAYING;
             if (mAudioTrack != nullptr) {
                 mAudioTrack->start();
+            } else if (mHasVoice) {
+                getMixer()->setPaused(getVoice(), false);
             }
             mAutoPaused = false; // TODO: is this right? (ambiguous per spec), move outside?
         }
@@ -107,6 +122,8 @@ void Stream::setRate(int32_t streamID, float rate)
         if (mAudioTrack != nullptr && mSound != nullptr) {
             const auto sampleRate = (uint32_t)lround(double(mSound->getSampleRate()) * rate);
             mAudioTrack->setSampleRate(sampleRate);
+        } else if (mHasVoice) {
+            getMixer()->setRate(getVoice(), rate);
         }
     }
 }
@@ -117,6 +134,8 @@ void Stream::setVolume_l(float leftVolume, float rightVolume)
     mRightVolume = rightVolume;
     if (mAudioTrack != nullptr && !mMuted) {
         mAudioTrack->setVolume(leftVolume, rightVolume);
+    } else if (mHasVoice && !mMuted) {
+        getMixer()->setVolume(getVoice(), leftVolume, rightVolume);
     }
 }
 
@@ -145,6 +164,8 @@ void Stream::setLoop(int32_t streamID, int32_t loop)
                 (mSound->getFormat() == AUDIO_FORMAT_PCM_16_BIT
                         ? sizeof(int16_t) : sizeof(uint8_t));
             mAudioTrack->setLoop(0, loopEnd, loop);
+        } else if (mHasVoice) {
+            getMixer()->setLoop(getVoice(), loop);
         }
         mLoop = loop;
     }
@@ -156,7 +177,8 @@ void Stream::setPlay(
 {
     std::lock_guard lock(mLock);
     // We must be idle, or we must be repurposing a pending Stream.
-    LOG_ALWAYS_FATAL_IF(mState != IDLE && mAudioTrack != nullptr, "State %d must be IDLE", mState);
+    LOG_ALWAYS_FATAL_IF(mState != IDLE && (mAudioTrack != nullptr || mHasVoice),
+            "State %d must be IDLE", mState);
     mSound = sound;
     mSoundID = soundID;
     mLeftVolume = leftVolume;
@@ -189,6 +211,11 @@ bool Stream::requestStop(int32_t streamID)
             }
             return true; // must be queued on the restart list.
         }
+        if (mHasVoice) {
+            // The Mixer ramps the voice down on stop, no need to wait.
+            mStopTimeNs = systemTime();
+            return true; // must be queued on the restart list.
+        }
         stop_l();
     }
     return false;
@@ -206,6 +233,9 @@ void Stream::stop_l()
         ALOGV("%s: track(%p) streamID: %d", __func__, mAudioTrack.get(), (int)mStreamID);
         if (mAudioTrack != nullptr) {
             mAudioTrack->stop();
+        } else if (mHasVoice) {
+            getMixer()->stop(getVoice());
+            mHasVoice = false;
         }
         mSound.reset();
         mState = IDLE;
@@ -227,6 +257,16 @@ Stream* Stream::getPairStream() const
    return mStreamManager->getPairStream(this);
 }
 
+Mixer* Stream::getMixer() const
+{
+    return mStreamManager->getMixer();
+}
+
+size_t Stream::getVoice() const
+{
+    return mStreamManager->streamPosition(this) >> 1;
+}
+
 Stream* Stream::playPairStream() {
     Stream* pairStream = getPairStream();
     LOG_ALWAYS_FATAL_IF(pairStream == nullptr, "No pair stream!");
@@ -265,7 +305,11 @@ Stream* Stream::playPairStream() {
         }
         if (pairState == PAUSED) {  // reestablish pause
             pairStream->mState = PAUSED;
-            pairStream->mAudioTrack->pause();
+            if (pairStream->mAudioTrack != nullptr) {
+                pairStream->mAudioTrack->pause();
+            } else {
+                getMixer()->setPaused(getVoice(), true);
+            }
         }
     }
     // release tracks outside of Stream lock
@@ -276,6 +320,11 @@ void Stream::play_l(const std::shared_ptr<Sound>& sound, int32_t nextStreamID,
         float leftVolume, float rightVolume, int32_t priority, int32_t loop, float rate,
         sp<AudioTrack> releaseTracks[2])
 {
+    if (Mixer* mixer = getMixer()) {
+        playOnMixer_l(mixer, sound, nextStreamID, leftVolume, rightVolume, priority, loop, rate);
+        return;
+    }
+
     // These tracks are released without the lock.
     sp<AudioTrack> &oldTrack = releaseTracks[0];
     sp<AudioTrack> &newTrack = releaseTracks[1];
@@ -383,6 +432,54 @@ exit:
     }
 }
 
+void Stream::playOnMixer_l(Mixer* mixer, const std::shared_ptr<Sound>& sound,
+        int32_t nextStreamID, float leftVolume, float rightVolume, int32_t priority,
+        int32_t loop, float rate)
+{
+    ALOGV("%s(%p)(soundID=%d, streamID=%d, leftVolume=%f, rightVolume=%f,"
+            " priority=%d, loop=%d, rate=%f)",
+            __func__, this, sound->getSoundID(), nextStreamID, leftVolume, rightVolume,
+            priority, loop, rate);
+
+    // The voice is shared by the stream pair, so this replaces whatever the pair played.
+    const status_t status = mixer->start(getVoice(), this, nextStreamID, sound,
+            mMuted ? 0.f : leftVolume, mMuted ? 0.f : rightVolume, loop, rate);
+    if (status != NO_ERROR) {
+        ALOGE("%s: error %d starting mixer voice", __func__, status);
+        mState = IDLE;
+        mSoundID = 0;
+        mSound.reset();
+        mHasVoice = false;
+        return;
+    }
+    mHasVoice = true;
+    mSound = sound;
+    mSoundID = sound->getSoundID();
+    mPriority = priority;
+    mLoop = loop;
+    mLeftVolume = leftVolume;
+    mRightVolume = rightVolume;
+    mRate = rate;
+    mState = PLAYING;
+    mStopTimeNs = 0;
+    mStreamID = nextStreamID;  // prefer this to be the last, as it is an atomic sync point
+}
+
+void Stream::mixerVoiceEnded(int32_t streamID)
+{
+    {
+        std::lock_guard lock(mLock);
+        if (streamID != mStreamID || mState == IDLE) {
+            return;
+        }
+        ALOGV("%s streamID %d", __func__, streamID);
+        mHasVoice = false;  // the Mixer has already released the voice.
+        mStopTimeNs = systemTime();
+    }
+    // Restart only if a particular streamID is still current and active.
+    mStreamManager->moveToRestartQueue(this, streamID);
+}
+
 /* static */
 void Stream::staticCallback(int event, void* user, void* info)
 {
@@ -31,6 +31,7 @@ inline constexpr int64_t kStopWaitTimeNs = 20 * NANOS_PER_MILLISECOND;
 
 inline constexpr size_t kCacheLineSize = 64; /* std::hardware_constructive_interference_size */
 
+class Mixer;         // forward decl
 class StreamManager; // forward decl
 
 /**
@@ -93,6 +94,10 @@ public:
     // returns the pair stream if successful, nullptr otherwise
     Stream* playPairStream();
 
+    // Called by the Mixer, without its lock, when the Sound of streamID reached its end.
+    // This is the Mixer equivalent of AudioTrack::EVENT_BUFFER_END.
+    void mixerVoiceEnded(int32_t streamID);
+
     // These parameters are explicitly checked in the SoundPool class
     // so never deviate from the Java API specified values.
     void setVolume(int32_t streamID, float leftVolume, float rightVolume);
@@ -128,6 +133,14 @@ private:
             sp<AudioTrack> releaseTracks[2]) REQUIRES(mLock);
     void stop_l() REQUIRES(mLock);
     void setVolume_l(float leftVolume, float rightVolume) REQUIRES(mLock);
+    void playOnMixer_l(Mixer* mixer, const std::shared_ptr<Sound>& sound, int streamID,
+            float leftVolume, float rightVolume, int priority, int loop, float rate)
+            REQUIRES(mLock);
+
+    // Returns the Mixer that plays this stream, or nullptr if the stream uses an AudioTrack.
+    Mixer* getMixer() const;
+    // The Mixer voice of the stream, shared with its pair.
+    size_t getVoice() const;
 
     // For use with AudioTrack callback.
     static void staticCallback(int event, void* user, void* info);
@@ -152,6 +165,7 @@ private:
     bool                mMuted GUARDED_BY(mLock) = false;
 
     sp<AudioTrack>      mAudioTrack GUARDED_BY(mLock);
+    bool                mHasVoice GUARDED_BY(mLock) = false; // Playing on a Mixer voice.
     int                 mToggle GUARDED_BY(mLock) = 0;
     int64_t             mStopTimeNs GUARDED_BY(mLock) = 0;  // if nonzero, time to wait for stop.
 };
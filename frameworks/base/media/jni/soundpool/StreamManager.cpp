@@ -107,13 +107,22 @@ int32_t StreamMap::getNextIdForStream(Stream* stream) const {
 
 StreamManager::StreamManager(
         int32_t streams, size_t threads, const audio_attributes_t* attributes,
-        std::string opPackageName)
+        std::string opPackageName, bool useMixer)
     : StreamMap(streams)
     , mAttributes(*attributes)
     , mOpPackageName(std::move(opPackageName))
     , mLockStreamManagerStop(streams == 1 || kForceLockStreamManagerStop)
 {
-    ALOGV("%s(%d, %zu, ...)", __func__, streams, threads);
+    ALOGV("%s(%d, %zu, ..., %d)", __func__, streams, threads, useMixer);
+    if (useMixer) {
+        // one voice for each stream pair.
+        mMixer = std::make_unique<Mixer>(
+                getStreamMapSize() >> 1, &mAttributes, mOpPackageName);
+        if (mMixer->initCheck() != NO_ERROR) {
+            ALOGW("%s: cannot create mixer, using an AudioTrack per stream", __func__);
+            mMixer.reset();
+        }
+    }
     forEach([this](Stream *stream) {
         stream->setStreamManager(this);
         if ((streamPosition(stream) & 1) == 0) { // put the first stream of pair as available.
@@ -142,6 +151,9 @@ StreamManager::~StreamManager()
     // call stop on the stream pool
     forEach([](Stream *stream) { stream->stop(); });
 
+    // This joins the Mixer AudioTrack callback thread, which calls back into the streams.
+    mMixer.reset();
+
     // This invokes the destructor on the AudioTracks -
     // we do it here to ensure that AudioTrack callbacks will not occur
     // afterwards.
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include "Mixer.h"
 #include "Stream.h"
 
 #include <condition_variable>
@@ -387,8 +388,11 @@ class StreamManager : public StreamMap {
 public:
     // Note: the SoundPool pointer is only used for stream initialization.
     // It is not stored in StreamManager.
+    //
+    // If useMixer is set, the streams are mixed into a single AudioTrack by a Mixer,
+    // otherwise each stream plays through its own AudioTrack.
     StreamManager(int32_t streams, size_t threads, const audio_attributes_t* attributes,
-            std::string opPackageName);
+            std::string opPackageName, bool useMixer = false);
     ~StreamManager();
 
     // Returns positive streamID on success, 0 on failure.  This is locked.
@@ -404,6 +408,9 @@ public:
 
     const std::string& getOpPackageName() const { return mOpPackageName; }
 
+    // Returns the Mixer if the streams are mixed, nullptr otherwise.  This never changes.
+    Mixer* getMixer() const { return mMixer.get(); }
+
     // Moves the stream to the restart queue (called upon BUFFER_END of the static track)
     // this is locked internally.
     // If activeStreamIDToMatch is nonzero, it will only move to the restart queue
@@ -447,6 +454,9 @@ private:
 
     std::unique_ptr<ThreadPool> mThreadPool;                  // locked internally
 
+    // Set in the constructor if the streams are mixed, locked internally.
+    std::unique_ptr<Mixer>      mMixer;
+
     // mStreamManagerLock is used to lock access for transitions between the
     // 4 stream queues by the Manager Thread or by the user initiated play().
     // A stream pair has exactly one stream on exactly one of the queues.
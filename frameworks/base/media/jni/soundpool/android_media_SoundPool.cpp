@@ -19,6 +19,7 @@
 //#define LOG_NDEBUG 0
 #define LOG_TAG "SoundPool-JNI"
 
+#include <cutils/properties.h>
 #include <utils/Log.h>
 #include <jni.h>
 #include <nativehelper/JNIPlatformHelp.h>
@@ -206,7 +207,9 @@ android_media_SoundPool_native_setup(JNIEnv *env, jobject thiz, jobject weakRef,
 
     ALOGV("android_media_SoundPool_native_setup");
     ScopedUtfChars opPackageNameStr(env, opPackageName);
-    auto *ap = new SoundPool(maxChannels, paa, opPackageNameStr.c_str());
+    // Mixing the streams into one AudioTrack is optional while it is evaluated.
+    const bool useMixer = property_get_bool("media.soundpool.mixer", false /* default */);
+    auto *ap = new SoundPool(maxChannels, paa, opPackageNameStr.c_str(), useMixer);
     if (ap == nullptr) {
         return -1;
     }
@@ -21,6 +21,12 @@ echo "========================================"
 echo "testing soundpool_stress"
 uidir="/product/media/audio/notifications"
 adb push $OUT/system/bin/soundpool_stress /system/bin
+adb push $OUT/system/bin/soundpool_benchmark /system/bin
+adb push $OUT/data/nativetest/soundpool_mixer_test/soundpool_mixer_test /system/bin
+
+echo "========================================"
+echo "testing soundpool_mixer_test"
+adb shell /system/bin/soundpool_mixer_test
 
 # test SoundPool playback of all the UI sound samples (loaded twice) looping 10s 1 thread.
 adb shell /system/bin/soundpool_stress -l -1 $uidir/*.ogg $uidir/*.ogg
@@ -31,3 +37,12 @@ adb shell /system/bin/soundpool_stress -l 1 -r 3 $uidir/*.ogg
 # performance test SoundPool playback of all the UI sound samples (x2)
 # 1 iterations, looping, 1 second playback, 4 threads.
 adb shell /system/bin/soundpool_stress -i 1 -l -1 -p 1 -t 4 $uidir/*.ogg $uidir/*.ogg
+
+# the same, with the streams mixed into a single AudioTrack.
+adb shell /system/bin/soundpool_stress -m -i 1 -l -1 -p 1 -t 4 $uidir/*.ogg $uidir/*.ogg
+
+echo "========================================"
+echo "testing soundpool_benchmark"
+
+# play() latency and CPU with 32 concurrent looping streams, without and with the mixer.
+adb shell /system/bin/soundpool_benchmark -s 32 $uidir/*.ogg
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "soundpool_benchmark"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <audio_utils/clock.h>
+#include <binder/ProcessState.h>
+#include <media/stagefright/MediaExtractorFactory.h>
+#include <soundpool/SoundPool.h> // direct include, this is not an NDK feature.
+#include <system/audio.h>
+#include <utils/Log.h>
+
+using namespace android;
+
+// Measures the latency of SoundPool::play() and the CPU used by this process while
+// many streams play at once, with an AudioTrack per stream and with the streams mixed
+// into a single AudioTrack.
+//
+// The CPU reported is for this process only, the audioserver load can be compared
+// with e.g. "adb shell top -p $(pidof audioserver)" while the benchmark runs.
+//
+// Errors and diagnostic messages all go to stdout.
+
+namespace {
+
+void usage(const char *name)
+{
+    printf("Usage: %s "
+            "[-i #iterations] [-p #playback_seconds] [-s #streams] <input-file>+\n", name);
+    printf("Benchmarks SoundPool play() latency and CPU with and without the mixer\n");
+    printf("    -i #iterations of play() for all streams, default 10\n");
+    printf("    -p #playback_seconds to measure CPU with all streams playing, default 5\n");
+    printf("    -s #streams for concurrent sound playback, default 32\n");
+    printf("    <input-file>+ files to be played (looping)\n");
+}
+
+int64_t cpuTimeNs()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * NANOS_PER_SECOND
+            + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000LL;
+}
+
+struct Stats {
+    std::vector<int64_t> values;
+
+    void add(int64_t value) { values.push_back(value); }
+
+    void print(const char *name) {
+        if (values.empty()) {
+            printf("  %s: no values\n", name);
+            return;
+        }
+        std::sort(values.begin(), values.end());
+        int64_t sum = 0;
+        for (int64_t value : values) sum += value;
+        printf("  %s (us): mean %.1f  median %.1f  p90 %.1f  max %.1f  (%zu values)\n", name,
+                sum / 1000. / values.size(), values[values.size() / 2] / 1000.,
+                values[values.size() * 9 / 10] / 1000., values.back() / 1000., values.size());
+    }
+};
+
+bool benchmark(const std::vector<const char *> &filenames, bool useMixer,
+        int iterations, int playSec, int streams)
+{
+    printf("\n%s, %d streams\n", useMixer ? "mixer" : "AudioTrack per stream", streams);
+    audio_attributes_t aa = {
+        .content_type = AUDIO_CONTENT_TYPE_SONIFICATION,
+        .usage = AUDIO_USAGE_GAME,
+    };
+    auto soundPool = std::make_unique<SoundPool>(streams, &aa, std::string{}, useMixer);
+
+    std::vector<int32_t> soundIDs;
+    for (auto filename : filenames) {
+        struct stat st;
+        if (stat(filename, &st) < 0) {
+            printf("ERROR: cannot stat %s\n", filename);
+            return false;
+        }
+        const int inp = open(filename, O_RDONLY);
+        if (inp < 0) {
+            printf("ERROR: cannot open %s\n", filename);
+            return false;
+        }
+        const int32_t soundID = soundPool->load(inp, 0 /*offset*/, st.st_size, 0 /*priority*/);
+        close(inp);
+        if (soundID == 0) {
+            printf("ERROR: cannot load %s\n", filename);
+            return false;
+        }
+        soundIDs.emplace_back(soundID);
+    }
+
+    // Wait for the sounds to be decoded, a silent play() succeeds once they are.
+    for (int32_t soundID : soundIDs) {
+        int32_t streamID;
+        while ((streamID = soundPool->play(soundID, 0.f, 0.f, 0 /*priority*/, 0 /*loop*/, 1.f))
+                == 0) {
+            usleep(1000);
+        }
+        soundPool->stop(streamID);
+    }
+    usleep(100 * 1000); // let the stops settle.
+
+    // Start all the streams, then play them again while they are all active,
+    // which steals the oldest streams.
+    Stats startLatency;
+    Stats stealLatency;
+    std::vector<int32_t> streamIDs;
+    const float volume = 1.f / streams;
+    for (int it = 0; it < iterations; ++it) {
+        for (int i = 0; i < streams; ++i) {
+            const int32_t soundID = soundIDs[i % soundIDs.size()];
+            const int64_t startNs = systemTime();
+            const int32_t streamID =
+                    soundPool->play(soundID, volume, volume, 1 /*priority*/, -1 /*loop*/, 1.f);
+            const int64_t latencyNs = systemTime() - startNs;
+            if (streamID == 0) {
+                printf("ERROR: play failed\n");
+                return false;
+            }
+            (it == 0 ? startLatency : stealLatency).add(latencyNs);
+            streamIDs.emplace_back(streamID);
+        }
+        usleep(20 * 1000);
+    }
+    startLatency.print("play() of an idle stream");
+    stealLatency.print("play() stealing an active stream");
+
+    const int64_t startCpuNs = cpuTimeNs();
+    const int64_t startNs = systemTime();
+    sleep(playSec);
+    const int64_t cpuNs = cpuTimeNs() - startCpuNs;
+    const int64_t elapsedNs = systemTime() - startNs;
+    printf("  CPU with %d streams playing: %.1f%% of one core\n",
+            streams, cpuNs * 100. / elapsedNs);
+
+    for (int32_t streamID : streamIDs) {
+        soundPool->stop(streamID);
+    }
+    for (int32_t soundID : soundIDs) {
+        soundPool->unload(soundID);
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const char * const me = argv[0];
+
+    int iterations = 10;
+    int playSec = 5;
+    int streams = 32;
+    for (int ch; (ch = getopt(argc, argv, "i:p:s:")) != -1; ) {
+        switch (ch) {
+        case 'i':
+            iterations = atoi(optarg);
+            break;
+        case 'p':
+            playSec = atoi(optarg);
+            break;
+        case 's':
+            streams = atoi(optarg);
+            break;
+        default:
+            usage(me);
+            return EXIT_FAILURE;
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+    if (argc <= 0 || iterations < 1 || streams < 1) {
+        usage(me);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<const char *> filenames(argv, argv + argc);
+
+    android::ProcessState::self()->startThreadPool();
+
+    // O and later requires data sniffer registration for proper file type detection
+    MediaExtractorFactory::LoadExtractors();
+
+    for (bool useMixer : { false, true }) {
+        if (!benchmark(filenames, useMixer, iterations, playSec, streams)) {
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
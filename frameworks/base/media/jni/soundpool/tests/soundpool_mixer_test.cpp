@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "soundpool_mixer_test"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../Mixer.h"
+#include "../Sound.h"
+
+using namespace android;
+using namespace android::soundpool;
+
+namespace {
+
+constexpr uint32_t kSampleRate = 48000;
+// Starts, stops, pauses and volume changes are ramped over one mix chunk.
+constexpr size_t kRampFrames = 256;
+constexpr size_t kChannels = Mixer::kChannelCount;
+constexpr float kTolerance = 1e-6f;
+
+// A stereo float Sound with constant left and right samples.
+std::shared_ptr<Sound> constantSound(size_t frames, float left, float right)
+{
+    std::vector<float> data(frames * 2);
+    for (size_t i = 0; i < frames; ++i) {
+        data[2 * i] = left;
+        data[2 * i + 1] = right;
+    }
+    return std::make_shared<Sound>(1 /* soundID */, data.data(), data.size() * sizeof(float),
+            kSampleRate, 2 /* channelCount */, AUDIO_FORMAT_PCM_FLOAT);
+}
+
+// A mono float Sound whose samples are their frame number divided by scale.
+std::shared_ptr<Sound> rampSound(size_t frames, float scale, uint32_t sampleRate = kSampleRate)
+{
+    std::vector<float> data(frames);
+    for (size_t i = 0; i < frames; ++i) {
+        data[i] = i / scale;
+    }
+    return std::make_shared<Sound>(2 /* soundID */, data.data(), data.size() * sizeof(float),
+            sampleRate, 1 /* channelCount */, AUDIO_FORMAT_PCM_FLOAT);
+}
+
+class MixerTest : public ::testing::Test {
+protected:
+    // Mixes frameCount frames, appending the ended voices to mEnded.
+    std::vector<float> mix(size_t frameCount) {
+        std::vector<float> out(frameCount * kChannels, -1.f);
+        mMixer.mix(out.data(), frameCount, &mEnded);
+        return out;
+    }
+
+    Mixer mMixer{4 /* voices */, kSampleRate};
+    std::vector<Mixer::EndedVoice> mEnded;
+};
+
+TEST_F(MixerTest, SilentWithoutVoices) {
+    const std::vector<float> out = mix(1000);
+    for (float sample : out) {
+        ASSERT_EQ(0.f, sample);
+    }
+    EXPECT_EQ(0u, mMixer.getActiveVoiceCount());
+}
+
+TEST_F(MixerTest, MixesVoicesWithTheirVolume) {
+    ASSERT_EQ(NO_ERROR, mMixer.start(0, nullptr, 1, constantSound(4096, 0.5f, 0.25f),
+            1.f /* leftVolume */, 0.5f /* rightVolume */, 0 /* loop */, 1.f /* rate */));
+
+    // A mono 16 bit Sound is played on both channels.
+    const std::vector<int16_t> data(4096, 1 << 13);  // 0.25
+    ASSERT_EQ(NO_ERROR, mMixer.start(1, nullptr, 2, std::make_shared<Sound>(3 /* soundID */,
+            data.data(), data.size() * sizeof(int16_t), kSampleRate, 1 /* channelCount */,
+            AUDIO_FORMAT_PCM_16_BIT), 0.5f, 0.5f, 0, 1.f));
+    EXPECT_EQ(2u, mMixer.getActiveVoiceCount());
+
+    // After the start ramp, the voices are added with their volume.
+    const std::vector<float> out = mix(2 * kRampFrames);
+    for (size_t i = kRampFrames; i < 2 * kRampFrames; ++i) {
+        ASSERT_NEAR(0.5f * 1.f + 0.25f * 0.5f, out[2 * i], kTolerance) << i;
+        ASSERT_NEAR(0.25f * 0.5f + 0.25f * 0.5f, out[2 * i + 1], kTolerance) << i;
+    }
+    EXPECT_TRUE(mEnded.empty());
+}
+
+TEST_F(MixerTest, ClampsTheMix) {
+    for (size_t voice = 0; voice < 3; ++voice) {
+        ASSERT_EQ(NO_ERROR, mMixer.start(voice, nullptr, voice + 1,
+                constantSound(4096, 0.5f, -0.5f), 1.f, 1.f, 0, 1.f));
+    }
+    const std::vector<float> out = mix(2 * kRampFrames);
+    for (size_t i = kRampFrames; i < 2 * kRampFrames; ++i) {
+        ASSERT_EQ(1.f, out[2 * i]) << i;
+        ASSERT_EQ(-1.f, out[2 * i + 1]) << i;
+    }
+}
+
+TEST_F(MixerTest, RampsStartAndVolumeChanges) {
+    ASSERT_EQ(NO_ERROR, mMixer.start(0, nullptr, 1, constantSound(4096, 0.5f, 0.5f),
+            1.f, 0.5f, 0, 1.f));
+
+    // The voice ramps up from silence.
+    std::vector<float> out = mix(kRampFrames);
+    for (size_t i = 0; i < kRampFrames; ++i) {
+        const float ramp = float(i) / kRampFrames;
+        ASSERT_NEAR(0.5f * ramp, out[2 * i], kTolerance) << i;
+        ASSERT_NEAR(0.5f * 0.5f * ramp, out[2 * i + 1], kTolerance) << i;
+    }
+
+    // And from the current to the new volume.
+    mMixer.setVolume(0, 0.5f, 1.f);
+    out = mix(kRampFrames);
+    for (size_t i = 0; i < kRampFrames; ++i) {
+        const float ramp = float(i) / kRampFrames;
+        ASSERT_NEAR(0.5f * (1.f - 0.5f * ramp), out[2 * i], kTolerance) << i;
+        ASSERT_NEAR(0.5f * (0.5f + 0.5f * ramp), out[2 * i + 1], kTolerance) << i;
+    }
+
+    out = mix(kRampFrames);
+    for (size_t i = 0; i < kRampFrames; ++i) {
+        ASSERT_NEAR(0.25f, out[2 * i], kTolerance) << i;
+        ASSERT_NEAR(0.5f, out[2 * i + 1], kTolerance) << i;
+    }
+}
+
+TEST_F(MixerTest, StopRampsDownAndReleasesTheVoice) {
+    std::shared_ptr<Sound> sound = constantSound(4096, 0.5f, 0.5f);
+    ASSERT_EQ(NO_ERROR, mMixer.start(0, nullptr, 1, sound, 1.f, 1.f, -1 /* loop */, 1.f));
+    mix(kRampFrames);
+    EXPECT_GT(sound.use_count(), 1);
+
+    mMixer.stop(0);
+    std::vector<float> out = mix(kRampFrames);
+    for (size_t i = 0; i < kRampFrames; ++i) {
+        ASSERT_NEAR(0.5f * (1.f - float(i) / kRampFrames), out[2 * i], kTolerance) << i;
+    }
+    EXPECT_EQ(0u, mMixer.getActiveVoiceCount());
+    // A stopped voice is not reported as ended, and its Sound is released.
+    EXPECT_TRUE(mEnded.empty());
+    EXPECT_EQ(1, sound.use_count());
+
+    out = mix(kRampFrames);
+    for (float sample : out) {
+        ASSERT_EQ(0.f, sample);
+    }
+}
+
+TEST_F(MixerTest, PauseRampsDownAndResumeRampsUpFromThePosition) {
+    constexpr float kScale = 4096.f;
+    ASSERT_EQ(NO_ERROR, mMixer.start(0, nullptr, 1, rampSound(4096, kScale), 1.f, 1.f, 0, 1.f));
+    mix(kRampFrames);
+
+    // The pause is ramped down, over frames kRampFrames to 2 * kRampFrames of the Sound.
+    mMixer.setPaused(0, true);
+    std::vector<float> out = mix(kRampFrames);
+    for (size_t i = 0; i < kRampFrames; ++i) {
+        const float sample = (kRampFrames + i) / kScale;
+        ASSERT_NEAR(sample * (1.f - float(i) / kRampFrames), out[2 * i], kTolerance) << i;
+    }
+
+    // Then the voice is silent, and stays where it was.
+    out = mix(4 * kRampFrames);
+    for (float sample : out) {
+        ASSERT_EQ(0.f, sample);
+    }
+    EXPECT_EQ(1u, mMixer.getActiveVoiceCount());
+
+    mMixer.setPaused(0, false);
+    out = mix(2 * kRampFrames);
+    for (size_t i = 0; i < 2 * kRampFrames; ++i) {
+        const float sample = (2 * kRampFrames + i) / kScale;
+        const float ramp = i < kRampFrames ? float(i) / kRampFrames : 1.f;
+        ASSERT_NEAR(sample * ramp, out[2 * i], kTolerance) << i;
+        ASSERT_NEAR(sample * ramp, out[2 * i + 1], kTolerance) << i;
+    }
+    EXPECT_TRUE(mEnded.empty());
+}
+
+TEST_F(MixerTest, StopWhilePausedReleasesTheVoice) {
+    ASSERT_EQ(NO_ERROR, mMixer.start(0, nullptr, 1, constantSound(4096, 0.5f, 0.5f),
+            1.f, 1.f, 0, 1.f));
+    mix(kRampFrames);
+    mMixer.setPaused(0, true);
+    mix(kRampFrames);
+
+    mMixer.stop(0);
+    const std::vector<float> out = mix(kRampFrames);
+    for (float sample : out) {
+        ASSERT_EQ(0.f, sample);
+    }
+    EXPECT_EQ(0u, mMixer.getActiveVoiceCount());
+    EXPECT_TRUE(mEnded.empty());
+}
+
+TEST_F(MixerTest, ReportsTheEndOfTheSound) {
+    constexpr size_t kFrames = 100;
+    ASSERT_EQ(NO_ERROR, mMixer.start(2, nullptr, 42, constantSound(kFrames, 0.5f, 0.5f),
+            1.f, 1.f, 0, 1.f));
+
+    const std::vector<float> out = mix(kRampFrames);
+    ASSERT_EQ(1u, mEnded.size());
+    EXPECT_EQ(nullptr, mEnded[0].stream);
+    EXPECT_EQ(42, mEnded[0].streamID);
+    EXPECT_EQ(0u, mMixer.getActiveVoiceCount());
+    EXPECT_GT(out[2 * (kFrames - 1)], 0.f);
+    for (size_t i = kFrames * kChannels; i < out.size(); ++i) {
+        ASSERT_EQ(0.f, out[i]) << i;
+    }
+}
+
+TEST_F(MixerTest, PlaysTheLoopsBeforeTheEnd) {
+    constexpr size_t kFrames = 300;
+    ASSERT_EQ(NO_ERROR, mMixer.start(0, nullptr, 7, constantSound(kFrames, 0.5f, 0.5f),
+            1.f, 1.f, 2 /* loop */, 1.f));
+
+    // Three times through the Sound, which ends in the fourth chunk.
+    mix(3 * kRampFrames);
+    EXPECT_TRUE(mEnded.empty());
+    const std::vector<float> out = mix(kRampFrames);
+    ASSERT_EQ(1u, mEnded.size());
+    EXPECT_EQ(7, mEnded[0].streamID);
+    const size_t last = 3 * kFrames - 3 * kRampFrames - 1;
+    EXPECT_NEAR(0.5f, out[2 * last], kTolerance);
+    EXPECT_EQ(0.f, out[2 * (last + 1)]);
+
+    // A voice looping forever does not end.
+    mEnded.clear();
+    ASSERT_EQ(NO_ERROR, mMixer.start(0, nullptr, 8, constantSound(kFrames, 0.5f, 0.5f),
+            1.f, 1.f, -1 /* loop */, 1.f));
+    mix(20 * kRampFrames);
+    EXPECT_TRUE(mEnded.empty());
+    EXPECT_EQ(1u, mMixer.getActiveVoiceCount());
+}
+
+TEST_F(MixerTest, ResamplesToTheOutputRate) {
+    // At half the output rate, every other output frame is halfway between two frames.
+    constexpr float kScale = 1024.f;
+    ASSERT_EQ(NO_ERROR, mMixer.start(0, nullptr, 1, rampSound(1024, kScale, kSampleRate / 2),
+            1.f, 1.f, 0, 1.f));
+    std::vector<float> out = mix(2 * kRampFrames);
+    for (size_t i = kRampFrames; i < 2 * kRampFrames; ++i) {
+        ASSERT_NEAR(i / 2.f / kScale, out[2 * i], kTolerance) << i;
+    }
+
+    // Doubling the rate plays the Sound at the output rate.
+    mMixer.setRate(0, 2.f);
+    out = mix(kRampFrames);
+    for (size_t i = 0; i < kRampFrames; ++i) {
+        ASSERT_NEAR((kRampFrames + i) / kScale, out[2 * i], kTolerance) << i;
+    }
+}
+
+} // namespace
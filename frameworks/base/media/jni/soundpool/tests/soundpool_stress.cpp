@@ -43,11 +43,12 @@ namespace {
 void usage(const char *name)
 {
     printf("Usage: %s "
-            "[-i #iterations] [-l #loop] [-p #playback_seconds] [-s #streams] [-t #threads] "
+            "[-i #iterations] [-l #loop] [-m] [-p #playback_seconds] [-s #streams] [-t #threads] "
             "[-z #snoozeSec] <input-file>+\n", name);
     printf("Uses soundpool to load and play a file (the first 10 seconds)\n");
     printf("    -i #iterations, default 1\n");
     printf("    -l #loop looping mode, -1 forever\n");
+    printf("    -m mix the streams into a single AudioTrack\n");
     printf("    -p #playback_seconds, default 10\n");
     printf("    -r #repeat soundIDs (0 or more times), default 0\n");
     printf("    -s #streams for concurrent sound playback, default 20\n");
@@ -226,7 +227,8 @@ int main(int argc, char *argv[])
     int repeat = 0;
     int snoozeSec = 0;
     int threadCount = 1;
-    for (int ch; (ch = getopt(argc, argv, "i:l:p:r:s:t:z:")) != -1; ) {
+    bool useMixer = false;
+    for (int ch; (ch = getopt(argc, argv, "i:l:mp:r:s:t:z:")) != -1; ) {
         switch (ch) {
         case 'i':
             iterations = atoi(optarg);
@@ -234,6 +236,9 @@ int main(int argc, char *argv[])
         case 'l':
             loop = atoi(optarg);
             break;
+        case 'm':
+            useMixer = true;
+            break;
         case 'p':
             playSec = atoi(optarg);
             break;
@@ -274,7 +279,7 @@ int main(int argc, char *argv[])
         .content_type = AUDIO_CONTENT_TYPE_MUSIC,
         .usage = AUDIO_USAGE_MEDIA,
     };
-    auto soundPool = std::make_unique<SoundPool>(maxStreams, &aa);
+    auto soundPool = std::make_unique<SoundPool>(maxStreams, &aa, std::string{}, useMixer);
 
     gCallbackManager.setSoundPool(soundPool.get());
     soundPool->setCallback(StaticCallbackManager, &gCallbackManager);
@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <time.h>
 #include <unistd.h>
 #include <zlib.h>
@@ -42,6 +43,7 @@
 #include <hidl/ServiceManagement.h>
 
 #include <pdx/default_transport/service_utility.h>
+#include <tracebuffer/TraceBuffer.h>
 #include <utils/String8.h>
 #include <utils/Timers.h>
 #include <utils/Tokenizer.h>
@@ -65,6 +67,8 @@ using std::string;
 #define MAX_SYS_FILES 12
 
 const char* k_traceTagsProperty = "debug.atrace.tags.enableflags";
+const char* k_traceBufferedTagsProperty = "debug.atrace.tags.bufferedflags";
+const char* k_traceBufferedFlushProperty = "debug.atrace.buffered.flush";
 const char* k_userInitiatedTraceProperty = "debug.atrace.user_initiated";
 
 const char* k_traceAppsNumberProperty = "debug.atrace.app_number";
@@ -277,9 +281,11 @@ static const char* g_categoriesFile = nullptr;
 static const char* g_kernelTraceFuncs = nullptr;
 static const char* g_debugAppCmdLine = "";
 static const char* g_outputFile = nullptr;
+static bool g_bufferedUserspace = false;
 
 /* Global state */
 static bool g_tracePdx = false;
+static bool g_bufferedMarkers = false;
 static bool g_traceAborted = false;
 static bool g_categoryEnables[arraysize(k_categories)] = {};
 static std::string g_traceFolder;
@@ -590,6 +596,54 @@ static bool setTagsProperty(uint64_t tags)
     return true;
 }
 
+// Set the trace tags that libtracebuffer records into per-thread buffers instead of
+// writing each event to trace_marker.
+static bool setBufferedTagsProperty(uint64_t tags)
+{
+    std::string value = android::base::StringPrintf("%#" PRIx64, tags);
+    if (!android::base::SetProperty(k_traceBufferedTagsProperty, value)) {
+        fprintf(stderr, "error setting buffered trace tags system property\n");
+        return false;
+    }
+    return true;
+}
+
+// Poke all the binder-enabled processes in the system to get them to re-read
+// their system properties.
+static void pokeBinderServices()
+{
+    sp<IServiceManager> sm = defaultServiceManager();
+    Vector<String16> services = sm->listServices();
+    for (size_t i = 0; i < services.size(); i++) {
+        sp<IBinder> obj = sm->checkService(services[i]);
+        if (obj != nullptr) {
+            Parcel data;
+            // Some services refuse the transaction, which only means they don't use
+            // buffered tracing.
+            obj->transact(IBinder::SYSPROPS_TRANSACTION, data, nullptr, 0);
+        }
+    }
+}
+
+// Ask processes using buffered tracing to write out their pending events, and give them
+// a moment to do so before the trace is read. Processes with binder services flush from
+// their property change callback, others the next time they record an event.
+static void requestBufferedFlush()
+{
+    std::string tags = android::base::GetProperty(k_traceBufferedTagsProperty, "0");
+    if (strtoull(tags.c_str(), nullptr, 0) == 0) {
+        return;
+    }
+    g_bufferedMarkers = true;
+    std::string value = android::base::StringPrintf("%" PRId64, systemTime(CLOCK_MONOTONIC));
+    if (!android::base::SetProperty(k_traceBufferedFlushProperty, value)) {
+        fprintf(stderr, "error requesting buffered trace flush\n");
+        return;
+    }
+    pokeBinderServices();
+    usleep(100 * 1000);
+}
+
 static void clearAppProperties()
 {
     if (!android::base::SetProperty(k_traceAppsNumberProperty, "")) {
@@ -806,6 +860,7 @@ static bool setUpUserspaceTracing()
         packageList += android::base::GetProperty(k_coreServicesProp, "");
     }
     ok &= setAppCmdlineProperty(&packageList[0]);
+    ok &= setBufferedTagsProperty(g_bufferedUserspace ? tags : 0);
     ok &= setTagsProperty(tags);
     if (g_tracePdx) {
         ok &= ServiceUtility::PokeServices();
@@ -817,6 +872,7 @@ static bool setUpUserspaceTracing()
 static void cleanUpUserspaceTracing()
 {
     setTagsProperty(0);
+    setBufferedTagsProperty(0);
     clearAppProperties();
 
     if (g_tracePdx) {
@@ -920,6 +976,30 @@ static void streamTrace()
     }
 }
 
+// Rewrite the markers written by buffered tracing into regular ones. Returns a file
+// holding the converted trace, or -1 on error.
+static int convertBufferedMarkers(int traceFD)
+{
+    std::string trace;
+    if (!android::base::ReadFdToString(traceFD, &trace)) {
+        fprintf(stderr, "error reading trace: %s (%d)\n", strerror(errno), errno);
+        return -1;
+    }
+    trace = android::tracebuffer::convertTrace(trace);
+
+    int fd = memfd_create("atrace_converted", MFD_CLOEXEC);
+    if (fd == -1) {
+        fprintf(stderr, "error creating converted trace: %s (%d)\n", strerror(errno), errno);
+        return -1;
+    }
+    if (!android::base::WriteStringToFd(trace, fd) || lseek(fd, 0, SEEK_SET) != 0) {
+        fprintf(stderr, "error writing converted trace: %s (%d)\n", strerror(errno), errno);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
 // Read the current kernel trace and write it to stdout.
 static void dumpTrace(int outFd)
 {
@@ -931,6 +1011,15 @@ static void dumpTrace(int outFd)
         return;
     }
 
+    if (g_bufferedMarkers) {
+        int convertedFD = convertBufferedMarkers(traceFD);
+        close(traceFD);
+        if (convertedFD == -1) {
+            return;
+        }
+        traceFD = convertedFD;
+    }
+
     if (g_compress) {
         z_stream zs;
         memset(&zs, 0, sizeof(zs));
@@ -1076,6 +1165,10 @@ static void showHelp(const char *cmd)
                     "  --async_dump    dump the current contents of circular trace buffer\n"
                     "  --async_stop    stop tracing and dump the current contents of circular\n"
                     "                    trace buffer\n"
+                    "  --buffered      have processes using libtracebuffer record userspace\n"
+                    "                    events of the enabled categories into per-thread\n"
+                    "                    buffers and write them out in batches; the events\n"
+                    "                    are only converted in dumped traces, not --stream\n"
                     "  --stream        stream trace to stdout as it enters the trace buffer\n"
                     "                    Note: this can take significant CPU time, and is best\n"
                     "                    used for measuring things that are not affected by\n"
@@ -1214,6 +1307,7 @@ int main(int argc, char **argv)
             {"only_userspace",    no_argument, nullptr,  0 },
             {"list_categories",   no_argument, nullptr,  0 },
             {"stream",            no_argument, nullptr,  0 },
+            {"buffered",          no_argument, nullptr,  0 },
             {nullptr,                       0, nullptr,  0 }
         };
 
@@ -1289,6 +1383,8 @@ int main(int argc, char **argv)
                 } else if (!strcmp(long_options[option_index].name, "stream")) {
                     traceStream = true;
                     traceDump = false;
+                } else if (!strcmp(long_options[option_index].name, "buffered")) {
+                    g_bufferedUserspace = true;
                 } else if (!strcmp(long_options[option_index].name, "list_categories")) {
                     listSupportedCategories();
                     exit(0);
@@ -1362,6 +1458,10 @@ int main(int argc, char **argv)
         }
     }
 
+    if (traceDump && !onlyUserspace) {
+        requestBufferedFlush();
+    }
+
     // Stop the trace and restore the default settings.
     if (traceStop && !onlyUserspace)
         stopTrace();
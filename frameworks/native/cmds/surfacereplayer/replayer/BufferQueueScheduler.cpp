@@ -20,11 +20,18 @@
 #include <android/native_window.h>
 #include <gui/Surface.h>
 
+#include <algorithm>
+#include <cstring>
+
 using namespace android;
 
 BufferQueueScheduler::BufferQueueScheduler(
-        const sp<SurfaceControl>& surfaceControl, const HSV& color, int id)
-      : mSurfaceControl(surfaceControl), mColor(color), mSurfaceId(id), mContinueScheduling(true) {}
+        const sp<SurfaceControl>& surfaceControl, const HSV& color, int id, ReplayStats* stats)
+      : mSurfaceControl(surfaceControl),
+        mColor(color),
+        mSurfaceId(id),
+        mStats(stats),
+        mContinueScheduling(true) {}
 
 void BufferQueueScheduler::startScheduling() {
     ALOGV("Starting Scheduler for %d Layer", mSurfaceId);
@@ -43,7 +50,7 @@ void BufferQueueScheduler::startScheduling() {
             lock.unlock();
 
             bufferUpdate(event.dimensions);
-            fillSurface(event.event);
+            fillSurface(event);
             mColor.modulate();
             lock.lock();
             mBufferEvents.pop();
@@ -77,7 +84,15 @@ void BufferQueueScheduler::bufferUpdate(const Dimensions& dimensions) {
     s->setBuffersDimensions(dimensions.width, dimensions.height);
 }
 
-void BufferQueueScheduler::fillSurface(const std::shared_ptr<Event>& event) {
+uint32_t BufferQueueScheduler::toPixel(const RGB& color) {
+    const uint8_t bytes[4] = {color.r, color.g, color.b, LAYER_ALPHA};
+    uint32_t pixel;
+    memcpy(&pixel, bytes, sizeof(pixel));
+    return pixel;
+}
+
+void BufferQueueScheduler::fillSurface(const BufferEvent& bufferEvent) {
+    const std::shared_ptr<Event>& event = bufferEvent.event;
     ANativeWindow_Buffer outBuffer;
     sp<Surface> s = mSurfaceControl->getSurface();
 
@@ -88,22 +103,25 @@ void BufferQueueScheduler::fillSurface(const std::shared_ptr<Event>& event) {
         return;
     }
 
-    auto color = mColor.getRGB();
+    const uint32_t pixel = bufferEvent.preloaded ? bufferEvent.pixel : toPixel(mColor.getRGB());
 
-    auto img = reinterpret_cast<uint8_t*>(outBuffer.bits);
-    for (int y = 0; y < outBuffer.height; y++) {
-        for (int x = 0; x < outBuffer.width; x++) {
-            uint8_t* pixel = img + (4 * (y * outBuffer.stride + x));
-            pixel[0] = color.r;
-            pixel[1] = color.g;
-            pixel[2] = color.b;
-            pixel[3] = LAYER_ALPHA;
-        }
+    // Fill the first row, then copy it to the others.
+    auto img = reinterpret_cast<uint32_t*>(outBuffer.bits);
+    if (outBuffer.height > 0) {
+        std::fill_n(img, outBuffer.width, pixel);
+    }
+    for (int y = 1; y < outBuffer.height; y++) {
+        memcpy(img + y * outBuffer.stride, img, 4 * outBuffer.width);
     }
 
     event->readyToExecute();
 
     status = s->unlockAndPost();
 
+    if (mStats != nullptr) {
+        mStats->addIncrementLatency(Increment::kBufferUpdate,
+                systemTime(SYSTEM_TIME_MONOTONIC) - event->getSignalTime());
+    }
+
     ALOGE_IF(status != NO_ERROR, "fillSurface: failed to unlock and post buffer, (%d)", status);
 }
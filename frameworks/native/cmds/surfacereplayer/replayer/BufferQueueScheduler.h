@@ -19,6 +19,7 @@
 
 #include "Color.h"
 #include "Event.h"
+#include "ReplayStats.h"
 
 #include <gui/SurfaceControl.h>
 
@@ -48,11 +49,16 @@ struct BufferEvent {
 
     std::shared_ptr<Event> event;
     Dimensions dimensions;
+
+    // Pixel the buffer is filled with, when worked out before the replay started.
+    bool preloaded = false;
+    uint32_t pixel = 0;
 };
 
 class BufferQueueScheduler {
   public:
-    BufferQueueScheduler(const sp<SurfaceControl>& surfaceControl, const HSV& color, int id);
+    BufferQueueScheduler(const sp<SurfaceControl>& surfaceControl, const HSV& color, int id,
+            ReplayStats* stats = nullptr);
 
     void startScheduling();
     void addEvent(const BufferEvent&);
@@ -60,16 +66,20 @@ class BufferQueueScheduler {
 
     void setSurfaceControl(const sp<SurfaceControl>& surfaceControl, const HSV& color);
 
+    // An RGBA_8888 pixel of the given color, as laid out in memory.
+    static uint32_t toPixel(const RGB& color);
+
   private:
     void bufferUpdate(const Dimensions& dimensions);
 
     // Lock and fill the surface, block until the event is signaled by the main loop,
     // then unlock and post the buffer.
-    void fillSurface(const std::shared_ptr<Event>& event);
+    void fillSurface(const BufferEvent& event);
 
     sp<SurfaceControl> mSurfaceControl;
     HSV mColor;
     const int mSurfaceId;
+    ReplayStats* const mStats;
 
     bool mContinueScheduling;
 
@@ -29,6 +29,10 @@ void Event::readyToExecute() {
 
 void Event::complete() {
     waitUntil(Event::EventState::Waiting);
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mSignalTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    }
     changeState(Event::EventState::Signaled);
     waitUntil(Event::EventState::Running);
 }
@@ -49,3 +53,8 @@ void Event::changeState(Event::EventState state) {
 Increment::IncrementCase Event::getIncrementType() {
     return mIncrementType;
 }
+
+nsecs_t Event::getSignalTime() {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mSignalTime;
+}
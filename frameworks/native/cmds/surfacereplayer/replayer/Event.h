@@ -19,6 +19,8 @@
 
 #include <frameworks/native/cmds/surfacereplayer/proto/src/trace.pb.h>
 
+#include <utils/Timers.h>
+
 #include <condition_variable>
 #include <mutex>
 
@@ -42,6 +44,9 @@ class Event {
 
     Increment::IncrementCase getIncrementType();
 
+    // Time at which the main thread signaled this event, valid once readyToExecute() returns.
+    nsecs_t getSignalTime();
+
   private:
     void waitUntil(EventState state);
     void changeState(EventState state);
@@ -50,6 +55,7 @@ class Event {
     std::condition_variable mCond;
 
     EventState mState = EventState::SettingUp;
+    nsecs_t mSignalTime = 0;
 
     Increment::IncrementCase mIncrementType;
 };
@@ -21,7 +21,8 @@
  * 2. Commit actions or settings based on the flags
  * 3. Initalize a replayer object with the filename passed in
  * 4. Replay
- * 5. Exit successfully or print error statement
+ * 5. Print benchmark results if requested
+ * 6. Exit successfully or print error statement
  */
 
 #include <Replayer.h>
@@ -51,6 +52,9 @@ void printHelpMenu() {
 
     std::cout << "  -l  Indefinitely loop the replayer\n";
 
+    std::cout << "  -b  Benchmark mode: pace increments against an absolute clock (or as fast as "
+                 "possible with -n) and report latency percentiles and CPU time\n";
+
     std::cout << "  -h  Display help menu\n";
 
     std::cout << std::endl;
@@ -61,11 +65,12 @@ int main(int argc, char** argv) {
     bool loop = false;
     bool wait = true;
     bool pauseBeginning = false;
+    bool benchmark = false;
     int numThreads = DEFAULT_THREADS;
     long stopHere = -1;
 
     int opt = 0;
-    while ((opt = getopt(argc, argv, "mt:s:nlh?")) != -1) {
+    while ((opt = getopt(argc, argv, "mt:s:nlbh?")) != -1) {
         switch (opt) {
             case 'm':
                 pauseBeginning = true;
@@ -82,6 +87,9 @@ int main(int argc, char** argv) {
             case 'l':
                 loop = true;
                 break;
+            case 'b':
+                benchmark = true;
+                break;
             case 'h':
             case '?':
                 printHelpMenu();
@@ -102,8 +110,11 @@ int main(int argc, char** argv) {
 
     status_t status = NO_ERROR;
     do {
-        android::Replayer r(filename, pauseBeginning, numThreads, wait, stopHere);
+        android::Replayer r(filename, pauseBeginning, numThreads, wait, stopHere, benchmark);
         status = r.replay();
+        if (benchmark && status == NO_ERROR) {
+            r.getStats().dump(std::cout);
+        }
     } while(loop);
 
     if (status == NO_ERROR) {
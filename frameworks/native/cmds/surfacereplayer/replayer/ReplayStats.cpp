@@ -0,0 +1,131 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ReplayStats.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <iomanip>
+
+using namespace android;
+
+namespace {
+
+constexpr double NS_PER_MS = 1000000.0;
+
+double toMs(nsecs_t ns) {
+    return ns / NS_PER_MS;
+}
+
+nsecs_t percentile(const std::vector<nsecs_t>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+}  // namespace
+
+void ReplayStats::start() {
+    std::lock_guard<std::mutex> lock(mLock);
+    mStartTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    mStartCpuTime = systemTime(SYSTEM_TIME_PROCESS);
+}
+
+void ReplayStats::stop() {
+    std::lock_guard<std::mutex> lock(mLock);
+    mEndTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    mEndCpuTime = systemTime(SYSTEM_TIME_PROCESS);
+}
+
+void ReplayStats::addIncrementLatency(Increment::IncrementCase type, nsecs_t latency) {
+    std::lock_guard<std::mutex> lock(mLock);
+    mIncrementLatencies[type].add(latency);
+}
+
+void ReplayStats::addFrameTime(nsecs_t frameTime) {
+    std::lock_guard<std::mutex> lock(mLock);
+    mFrameTimes.add(frameTime);
+}
+
+void ReplayStats::addPacingError(nsecs_t error) {
+    std::lock_guard<std::mutex> lock(mLock);
+    mPacingErrors.add(error);
+}
+
+void ReplayStats::Samples::dump(std::ostream& out, const std::string& name) const {
+    if (values.empty()) {
+        return;
+    }
+
+    std::vector<nsecs_t> sorted(values);
+    std::sort(sorted.begin(), sorted.end());
+
+    out << "  " << std::left << std::setw(18) << name << std::right << std::fixed
+        << std::setprecision(3) << " n=" << std::setw(6) << sorted.size()
+        << " p50=" << std::setw(8) << toMs(percentile(sorted, 0.50))
+        << " p90=" << std::setw(8) << toMs(percentile(sorted, 0.90))
+        << " p95=" << std::setw(8) << toMs(percentile(sorted, 0.95))
+        << " p99=" << std::setw(8) << toMs(percentile(sorted, 0.99))
+        << " max=" << std::setw(8) << toMs(sorted.back()) << " (ms)\n";
+}
+
+const char* ReplayStats::incrementName(Increment::IncrementCase type) {
+    switch (type) {
+        case Increment::kTransaction:
+            return "transaction";
+        case Increment::kSurfaceCreation:
+            return "surface_creation";
+        case Increment::kSurfaceDeletion:
+            return "surface_deletion";
+        case Increment::kBufferUpdate:
+            return "buffer_update";
+        case Increment::kVsyncEvent:
+            return "vsync_event";
+        case Increment::kDisplayCreation:
+            return "display_creation";
+        case Increment::kDisplayDeletion:
+            return "display_deletion";
+        case Increment::kPowerModeUpdate:
+            return "power_mode_update";
+        default:
+            return "unknown";
+    }
+}
+
+void ReplayStats::dump(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(mLock);
+
+    const nsecs_t wallTime = mEndTime - mStartTime;
+    const nsecs_t cpuTime = mEndCpuTime - mStartCpuTime;
+
+    out << "SurfaceReplayer benchmark results:\n";
+    out << std::fixed << std::setprecision(3);
+    out << "  wall time: " << toMs(wallTime) << " ms\n";
+    out << "  cpu time:  " << toMs(cpuTime) << " ms";
+    if (wallTime > 0) {
+        out << " (" << std::setprecision(1) << (100.0 * cpuTime / wallTime) << "% of wall)";
+    }
+    out << "\n";
+
+    mFrameTimes.dump(out, "frame");
+    mPacingErrors.dump(out, "pacing_error");
+    for (const auto& [type, samples] : mIncrementLatencies) {
+        samples.dump(out, incrementName(type));
+    }
+    out << std::flush;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_SURFACEREPLAYER_REPLAYSTATS_H
+#define ANDROID_SURFACEREPLAYER_REPLAYSTATS_H
+
+#include <frameworks/native/cmds/surfacereplayer/proto/src/trace.pb.h>
+
+#include <utils/Timers.h>
+
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace android {
+
+using Increment = surfaceflinger::Increment;
+
+// Collects timing samples while a trace is replayed in benchmark mode and reports
+// latency percentiles together with the CPU time consumed by the replay.
+class ReplayStats {
+  public:
+    // Called by the main thread right before the first increment is completed and
+    // right after the last one, to bracket wall clock and CPU time.
+    void start();
+    void stop();
+
+    // Time between the main thread signaling an increment and the worker finishing
+    // its time critical work (applying a transaction, posting a buffer, ...).
+    void addIncrementLatency(Increment::IncrementCase type, nsecs_t latency);
+
+    // Time the replayer spent between two consecutive VSync injections, i.e. how
+    // long it took SurfaceFlinger to accept one frame worth of increments.
+    void addFrameTime(nsecs_t frameTime);
+
+    // Difference between when an increment was scheduled to complete and when
+    // it actually did. Only recorded when replaying with timestamps.
+    void addPacingError(nsecs_t error);
+
+    void dump(std::ostream& out) const;
+
+  private:
+    struct Samples {
+        std::vector<nsecs_t> values;
+
+        void add(nsecs_t value) { values.push_back(value); }
+        void dump(std::ostream& out, const std::string& name) const;
+    };
+
+    static const char* incrementName(Increment::IncrementCase type);
+
+    mutable std::mutex mLock;
+    std::map<Increment::IncrementCase, Samples> mIncrementLatencies;
+    Samples mFrameTimes;
+    Samples mPacingErrors;
+
+    nsecs_t mStartTime = 0;
+    nsecs_t mEndTime = 0;
+    nsecs_t mStartCpuTime = 0;
+    nsecs_t mEndCpuTime = 0;
+};
+
+}  // namespace android
+#endif
@@ -51,14 +51,15 @@ using namespace android;
 std::atomic_bool Replayer::sReplayingManually(false);
 
 Replayer::Replayer(const std::string& filename, bool replayManually, int numThreads, bool wait,
-        nsecs_t stopHere)
+        nsecs_t stopHere, bool benchmark)
       : mTrace(),
         mLoaded(false),
         mIncrementIndex(0),
         mCurrentTime(0),
         mNumThreads(numThreads),
         mWaitForTimeStamps(wait),
-        mStopTimeStamp(stopHere) {
+        mStopTimeStamp(stopHere),
+        mBenchmark(benchmark) {
     srand(RAND_COLOR_SEED);
 
     std::string input;
@@ -82,14 +83,16 @@ Replayer::Replayer(const std::string& filename, bool replayManually, int numThre
     }
 }
 
-Replayer::Replayer(const Trace& t, bool replayManually, int numThreads, bool wait, nsecs_t stopHere)
+Replayer::Replayer(const Trace& t, bool replayManually, int numThreads, bool wait, nsecs_t stopHere,
+        bool benchmark)
       : mTrace(t),
         mLoaded(true),
         mIncrementIndex(0),
         mCurrentTime(0),
         mNumThreads(numThreads),
         mWaitForTimeStamps(wait),
-        mStopTimeStamp(stopHere) {
+        mStopTimeStamp(stopHere),
+        mBenchmark(benchmark) {
     srand(RAND_COLOR_SEED);
     mCurrentTime = mTrace.increment(0).time_stamp();
 
@@ -114,8 +117,18 @@ status_t Replayer::replay() {
 
     SurfaceComposerClient::enableVSyncInjections(true);
 
+    if (mBenchmark) {
+        preloadTrace();
+    }
+
     initReplay();
 
+    if (mBenchmark) {
+        mFirstTimeStamp = mTrace.increment(0).time_stamp();
+        mReplayStartTime = systemTime(SYSTEM_TIME_MONOTONIC);
+        mStats.start();
+    }
+
     ALOGV("Starting actual Replay!");
     while (!mPendingIncrements.empty()) {
         mCurrentIncrement = mTrace.increment(mIncrementIndex);
@@ -138,6 +151,14 @@ status_t Replayer::replay() {
 
         if (event->getIncrementType() == Increment::kVsyncEvent) {
             mWaitingForNextVSync = false;
+
+            if (mBenchmark) {
+                nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+                if (mLastVSyncTime != 0) {
+                    mStats.addFrameTime(now - mLastVSyncTime);
+                }
+                mLastVSyncTime = now;
+            }
         }
 
         if (mIncrementIndex + mNumThreads < mTrace.increment_size()) {
@@ -155,9 +176,32 @@ status_t Replayer::replay() {
 
     SurfaceComposerClient::enableVSyncInjections(false);
 
+    if (mBenchmark) {
+        mStats.stop();
+    }
+
     return status;
 }
 
+void Replayer::preloadTrace() {
+    // Layer colors are picked in trace order rather than in the order the layers
+    // happen to be created in, and each buffer's color follows from its layer's.
+    std::unordered_map<layer_id, HSV> colors;
+    for (int i = 0; i < mTrace.increment_size(); i++) {
+        const Increment& increment = mTrace.increment(i);
+        if (increment.increment_case() == Increment::kSurfaceCreation) {
+            auto id = increment.surface_creation().id();
+            colors[id] = HSV(rand() % 360, 1, 1);
+            mColors[id] = colors[id];
+        } else if (increment.increment_case() == Increment::kBufferUpdate) {
+            HSV& color = colors[increment.buffer_update().id()];
+            mPreloadedPixels[i] = BufferQueueScheduler::toPixel(color.getRGB());
+            color.modulate();
+        }
+    }
+    ALOGV("Preloaded %zu layers and %zu buffers", colors.size(), mPreloadedPixels.size());
+}
+
 status_t Replayer::initReplay() {
     for (int i = 0; i < mNumThreads && i < mTrace.increment_size(); i++) {
         status_t status = dispatchEvent(i);
@@ -273,17 +317,21 @@ void Replayer::waitForConsoleCommmand() {
 }
 
 status_t Replayer::dispatchEvent(int index) {
-    auto increment = mTrace.increment(index);
+    // The workers read their increment from the trace, which outlives them,
+    // rather than from a copy made here on the main thread.
+    const Increment& increment = mTrace.increment(index);
     std::shared_ptr<Event> event = std::make_shared<Event>(increment.increment_case());
     mPendingIncrements.push(event);
 
     status_t status = NO_ERROR;
     switch (increment.increment_case()) {
         case increment.kTransaction: {
-            std::thread(&Replayer::doTransaction, this, increment.transaction(), event).detach();
+            std::thread(&Replayer::doTransaction, this, std::cref(increment.transaction()), event)
+                    .detach();
         } break;
         case increment.kSurfaceCreation: {
-            std::thread(&Replayer::createSurfaceControl, this, increment.surface_creation(), event)
+            std::thread(&Replayer::createSurfaceControl, this,
+                    std::cref(increment.surface_creation()), event)
                     .detach();
         } break;
         case increment.kBufferUpdate: {
@@ -292,11 +340,17 @@ status_t Replayer::dispatchEvent(int index) {
 
             Dimensions dimensions(increment.buffer_update().w(), increment.buffer_update().h());
             BufferEvent bufferEvent(event, dimensions);
+            auto preloaded = mPreloadedPixels.find(index);
+            if (preloaded != mPreloadedPixels.end()) {
+                bufferEvent.preloaded = true;
+                bufferEvent.pixel = preloaded->second;
+            }
 
             auto layerId = increment.buffer_update().id();
             if (mBufferQueueSchedulers.count(layerId) == 0) {
                 mBufferQueueSchedulers[layerId] = std::make_shared<BufferQueueScheduler>(
-                        mLayers[layerId], mColors[layerId], layerId);
+                        mLayers[layerId], mColors[layerId], layerId,
+                        mBenchmark ? &mStats : nullptr);
                 mBufferQueueSchedulers[layerId]->addEvent(bufferEvent);
 
                 std::thread(&BufferQueueScheduler::startScheduling,
@@ -308,18 +362,20 @@ status_t Replayer::dispatchEvent(int index) {
             }
         } break;
         case increment.kVsyncEvent: {
-            std::thread(&Replayer::injectVSyncEvent, this, increment.vsync_event(), event).detach();
+            std::thread(&Replayer::injectVSyncEvent, this, std::cref(increment.vsync_event()), event)
+                    .detach();
         } break;
         case increment.kDisplayCreation: {
-            std::thread(&Replayer::createDisplay, this, increment.display_creation(), event)
-                    .detach();
+            std::thread(&Replayer::createDisplay, this, std::cref(increment.display_creation()),
+                    event).detach();
         } break;
         case increment.kDisplayDeletion: {
-            std::thread(&Replayer::deleteDisplay, this, increment.display_deletion(), event)
-                    .detach();
+            std::thread(&Replayer::deleteDisplay, this, std::cref(increment.display_deletion()),
+                    event).detach();
         } break;
         case increment.kPowerModeUpdate: {
-            std::thread(&Replayer::updatePowerMode, this, increment.power_mode_update(), event)
+            std::thread(&Replayer::updatePowerMode, this,
+                    std::cref(increment.power_mode_update()), event)
                     .detach();
         } break;
         default:
@@ -348,6 +404,7 @@ status_t Replayer::doTransaction(const Transaction& t, const std::shared_ptr<Eve
     event->readyToExecute();
 
     liveTransaction.apply(t.synchronous());
+    recordLatency(event);
 
     ALOGV("Ended Transaction");
 
@@ -629,12 +686,15 @@ status_t Replayer::createSurfaceControl(
         ALOGE("CreateSurfaceControl: unable to create surface control");
         return BAD_VALUE;
     }
+    recordLatency(event);
 
     std::lock_guard<std::mutex> lock1(mLayerLock);
     auto& layer = mLayers[create.id()];
     layer = surfaceControl;
 
-    mColors[create.id()] = HSV(rand() % 360, 1, 1);
+    if (!mBenchmark) {
+        mColors[create.id()] = HSV(rand() % 360, 1, 1);
+    }
 
     mLayerCond.notify_all();
 
@@ -654,6 +714,7 @@ status_t Replayer::injectVSyncEvent(
     event->readyToExecute();
 
     SurfaceComposerClient::injectVSync(vSyncEvent.when());
+    recordLatency(event);
 
     return NO_ERROR;
 }
@@ -668,6 +729,7 @@ void Replayer::createDisplay(const DisplayCreation& create, const std::shared_pt
     mDisplays[create.id()] = display;
 
     mDisplayCond.notify_all();
+    recordLatency(event);
 
     ALOGV("Done creating display");
 }
@@ -679,19 +741,38 @@ void Replayer::deleteDisplay(const DisplayDeletion& delete_, const std::shared_p
     std::lock_guard<std::mutex> lock(mDisplayLock);
     SurfaceComposerClient::destroyDisplay(mDisplays[delete_.id()]);
     mDisplays.erase(delete_.id());
+    recordLatency(event);
 }
 
 void Replayer::updatePowerMode(const PowerModeUpdate& pmu, const std::shared_ptr<Event>& event) {
     ALOGV("Updating power mode");
     event->readyToExecute();
     SurfaceComposerClient::setDisplayPowerMode(mDisplays[pmu.id()], pmu.mode());
+    recordLatency(event);
 }
 
 void Replayer::waitUntilTimestamp(int64_t timestamp) {
+    if (mBenchmark) {
+        const nsecs_t deadline = mReplayStartTime + (timestamp - mFirstTimeStamp);
+        const nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        if (deadline > now) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(deadline - now));
+        }
+        mStats.addPacingError(systemTime(SYSTEM_TIME_MONOTONIC) - deadline);
+        return;
+    }
+
     ALOGV("Waiting for %lld nanoseconds...", static_cast<int64_t>(timestamp - mCurrentTime));
     std::this_thread::sleep_for(std::chrono::nanoseconds(timestamp - mCurrentTime));
 }
 
+void Replayer::recordLatency(const std::shared_ptr<Event>& event) {
+    if (mBenchmark) {
+        mStats.addIncrementLatency(event->getIncrementType(),
+                systemTime(SYSTEM_TIME_MONOTONIC) - event->getSignalTime());
+    }
+}
+
 void Replayer::waitUntilDeferredTransactionLayerExists(
         const DeferredTransactionChange& dtc, std::unique_lock<std::mutex>& lock) {
     if (mLayers.count(dtc.layer_id()) == 0 || mLayers[dtc.layer_id()] == nullptr) {
@@ -20,6 +20,7 @@
 #include "BufferQueueScheduler.h"
 #include "Color.h"
 #include "Event.h"
+#include "ReplayStats.h"
 
 #include <frameworks/native/cmds/surfacereplayer/proto/src/trace.pb.h>
 
@@ -55,15 +56,23 @@ typedef google::protobuf::RepeatedPtrField<DisplayChange> DisplayChanges;
 class Replayer {
   public:
     Replayer(const std::string& filename, bool replayManually = false,
-            int numThreads = DEFAULT_THREADS, bool wait = true, nsecs_t stopHere = -1);
+            int numThreads = DEFAULT_THREADS, bool wait = true, nsecs_t stopHere = -1,
+            bool benchmark = false);
     Replayer(const Trace& trace, bool replayManually = false, int numThreads = DEFAULT_THREADS,
-            bool wait = true, nsecs_t stopHere = -1);
+            bool wait = true, nsecs_t stopHere = -1, bool benchmark = false);
 
     status_t replay();
 
+    // Only populated when the replayer was created in benchmark mode.
+    const ReplayStats& getStats() const { return mStats; }
+
   private:
     status_t initReplay();
 
+    // Benchmark mode only: work out, before the clock starts, everything that
+    // does not need SurfaceFlinger, so that it is not timed.
+    void preloadTrace();
+
     void waitForConsoleCommmand();
     static void stopAutoReplayHandler(int signal);
 
@@ -133,6 +142,7 @@ class Replayer {
             display_id id, const ProjectionChange& pc);
 
     void waitUntilTimestamp(int64_t timestamp);
+    void recordLatency(const std::shared_ptr<Event>& event);
     void waitUntilDeferredTransactionLayerExists(
             const DeferredTransactionChange& dtc, std::unique_lock<std::mutex>& lock);
     status_t loadSurfaceComposerClient();
@@ -153,6 +163,17 @@ class Replayer {
     nsecs_t mStopTimeStamp;
     bool mHasStopped;
 
+    // Benchmark mode paces increments against an absolute clock anchored at the
+    // first increment instead of sleeping relative to the previous one, so that
+    // scheduling delays don't accumulate, and records timing into mStats.
+    bool mBenchmark;
+    ReplayStats mStats;
+    int64_t mFirstTimeStamp = 0;
+    nsecs_t mReplayStartTime = 0;
+    nsecs_t mLastVSyncTime = 0;
+    // Pixel of each buffer update, by increment index.
+    std::unordered_map<int, uint32_t> mPreloadedPixels;
+
     std::mutex mLayerLock;
     std::condition_variable mLayerCond;
     std::unordered_map<layer_id, sp<SurfaceControl>> mLayers;
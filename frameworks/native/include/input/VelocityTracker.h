@@ -95,6 +95,17 @@ public:
     // about the pointer.
     bool getEstimator(uint32_t id, Estimator* outEstimator) const;
 
+    // Gets the velocities of the specified pointer ids in position units per second.
+    // The outVx and outVy arrays are in order by increasing id, like the positions
+    // passed to addMovement.  This is the same as calling getVelocity for each pointer
+    // but lets the strategy share the work between them.
+    // Returns the ids whose velocity is known; the velocities of the others are set to zero.
+    BitSet32 getVelocities(BitSet32 idBits, float* outVx, float* outVy) const;
+
+    // Gets estimators for the specified pointer ids, in order by increasing id.
+    // Returns the ids that have an estimator; the estimators of the others are cleared.
+    BitSet32 getEstimators(BitSet32 idBits, Estimator* outEstimators) const;
+
     // Gets the active pointer id, or -1 if none.
     inline int32_t getActivePointerId() const { return mActivePointerId; }
 
@@ -130,6 +141,11 @@ public:
     virtual void addMovement(nsecs_t eventTime, BitSet32 idBits,
             const VelocityTracker::Position* positions) = 0;
     virtual bool getEstimator(uint32_t id, VelocityTracker::Estimator* outEstimator) const = 0;
+
+    // Gets estimators for several pointers, in order by increasing id.  Strategies that can
+    // share work between the pointers override this; by default it calls getEstimator for each.
+    virtual BitSet32 getEstimators(BitSet32 idBits,
+            VelocityTracker::Estimator* outEstimators) const;
 };
 
 
@@ -162,6 +178,8 @@ public:
     virtual void addMovement(nsecs_t eventTime, BitSet32 idBits,
             const VelocityTracker::Position* positions);
     virtual bool getEstimator(uint32_t id, VelocityTracker::Estimator* outEstimator) const;
+    virtual BitSet32 getEstimators(BitSet32 idBits,
+            VelocityTracker::Estimator* outEstimators) const;
 
 private:
     // Sample horizon.
@@ -358,6 +358,51 @@ bool VelocityTracker::getEstimator(uint32_t id, Estimator* outEstimator) const {
     return mStrategy->getEstimator(id, outEstimator);
 }
 
+BitSet32 VelocityTracker::getVelocities(BitSet32 idBits, float* outVx, float* outVy) const {
+    while (idBits.count() > MAX_POINTERS) {
+        idBits.clearLastMarkedBit();
+    }
+
+    Estimator estimators[MAX_POINTERS];
+    BitSet32 estimatedIdBits = getEstimators(idBits, estimators);
+    BitSet32 velocityIdBits;
+    for (uint32_t index = 0; !idBits.isEmpty(); index++) {
+        uint32_t id = idBits.clearFirstMarkedBit();
+        const Estimator& estimator = estimators[index];
+        if (estimatedIdBits.hasBit(id) && estimator.degree >= 1) {
+            outVx[index] = estimator.xCoeff[1];
+            outVy[index] = estimator.yCoeff[1];
+            velocityIdBits.markBit(id);
+        } else {
+            outVx[index] = 0;
+            outVy[index] = 0;
+        }
+    }
+    return velocityIdBits;
+}
+
+BitSet32 VelocityTracker::getEstimators(BitSet32 idBits, Estimator* outEstimators) const {
+    while (idBits.count() > MAX_POINTERS) {
+        idBits.clearLastMarkedBit();
+    }
+    return mStrategy->getEstimators(idBits, outEstimators);
+}
+
+
+// --- VelocityTrackerStrategy ---
+
+BitSet32 VelocityTrackerStrategy::getEstimators(BitSet32 idBits,
+        VelocityTracker::Estimator* outEstimators) const {
+    BitSet32 estimatedIdBits;
+    for (uint32_t index = 0; !idBits.isEmpty(); index++) {
+        uint32_t id = idBits.clearFirstMarkedBit();
+        if (getEstimator(id, &outEstimators[index])) {
+            estimatedIdBits.markBit(id);
+        }
+    }
+    return estimatedIdBits;
+}
+
 
 // --- LeastSquaresVelocityTrackerStrategy ---
 
@@ -447,18 +492,31 @@ void LeastSquaresVelocityTrackerStrategy::addMovement(nsecs_t eventTime, BitSet3
  * Finally we solve the system of linear equations given by R1 B = (Qtranspose W Y)
  * to find B.
  *
+ * The decomposition only depends on X and W, so it is done by decomposeLeastSquares
+ * and can be reused by solveLeastSquares for any number of Y vectors over the same
+ * data points, such as the x and y positions of a pointer.
+ *
  * For efficiency, we lay out A and Q column-wise in memory because we frequently
  * operate on the column vectors.  Conversely, we lay out R row-wise.
  *
  * http://en.wikipedia.org/wiki/Numerical_methods_for_linear_least_squares
  * http://en.wikipedia.org/wiki/Gram-Schmidt
  */
-static bool solveLeastSquares(const float* x, const float* y,
-        const float* w, uint32_t m, uint32_t n, float* outB, float* outDet) {
+struct LeastSquaresDecomposition {
+    static const uint32_t MAX_M = 20;
+    static const uint32_t MAX_N = VelocityTracker::Estimator::MAX_DEGREE + 1;
+
+    uint32_t m;
+    uint32_t n;
+    float q[MAX_N][MAX_M]; // orthonormal basis, column-major order
+    float r[MAX_N][MAX_N]; // upper triangular matrix, row-major order
+};
+
+static bool decomposeLeastSquares(const float* x, const float* w, uint32_t m, uint32_t n,
+        LeastSquaresDecomposition* outDecomposition) {
 #if DEBUG_STRATEGY
-    ALOGD("solveLeastSquares: m=%d, n=%d, x=%s, y=%s, w=%s", int(m), int(n),
-            vectorToString(x, m).c_str(), vectorToString(y, m).c_str(),
-            vectorToString(w, m).c_str());
+    ALOGD("decomposeLeastSquares: m=%d, n=%d, x=%s, w=%s", int(m), int(n),
+            vectorToString(x, m).c_str(), vectorToString(w, m).c_str());
 #endif
 
     // Expand the X vector to a matrix A, pre-multiplied by the weights.
@@ -474,8 +532,12 @@ static bool solveLeastSquares(const float* x, const float* y,
 #endif
 
     // Apply the Gram-Schmidt process to A to obtain its QR decomposition.
-    float q[n][m]; // orthonormal basis, column-major order
-    float r[n][n]; // upper triangular matrix, row-major order
+    outDecomposition->m = m;
+    outDecomposition->n = n;
+    float (&q)[LeastSquaresDecomposition::MAX_N][LeastSquaresDecomposition::MAX_M] =
+            outDecomposition->q;
+    float (&r)[LeastSquaresDecomposition::MAX_N][LeastSquaresDecomposition::MAX_N] =
+            outDecomposition->r;
     for (uint32_t j = 0; j < n; j++) {
         for (uint32_t h = 0; h < m; h++) {
             q[j][h] = a[j][h];
@@ -505,8 +567,10 @@ static bool solveLeastSquares(const float* x, const float* y,
         }
     }
 #if DEBUG_STRATEGY
-    ALOGD("  - q=%s", matrixToString(&q[0][0], m, n, false /*rowMajor*/).c_str());
-    ALOGD("  - r=%s", matrixToString(&r[0][0], n, n, true /*rowMajor*/).c_str());
+    for (uint32_t j = 0; j < n; j++) {
+        ALOGD("  - q[%d]=%s", int(j), vectorToString(&q[j][0], m).c_str());
+        ALOGD("  - r[%d]=%s", int(j), vectorToString(&r[j][0], n).c_str());
+    }
 
     // calculate QR, if we factored A correctly then QR should equal A
     float qr[n][m];
@@ -520,6 +584,18 @@ static bool solveLeastSquares(const float* x, const float* y,
     }
     ALOGD("  - qr=%s", matrixToString(&qr[0][0], m, n, false /*rowMajor*/).c_str());
 #endif
+    return true;
+}
+
+static void solveLeastSquares(const float* x, const float* y, const float* w,
+        const LeastSquaresDecomposition& decomposition, float* outB, float* outDet) {
+    const uint32_t m = decomposition.m;
+    const uint32_t n = decomposition.n;
+    const auto& q = decomposition.q;
+    const auto& r = decomposition.r;
+#if DEBUG_STRATEGY
+    ALOGD("solveLeastSquares: m=%d, n=%d, y=%s", int(m), int(n), vectorToString(y, m).c_str());
+#endif
 
     // Solve R B = Qt W Y to find B.  This is easy because R is upper triangular.
     // We just work from bottom-right to top-left calculating B's coefficients.
@@ -568,34 +644,49 @@ static bool solveLeastSquares(const float* x, const float* y,
     ALOGD("  - sstot=%f", sstot);
     ALOGD("  - det=%f", *outDet);
 #endif
-    return true;
 }
 
+/*
+ * The sums of the powers 1 to 4 of x[0..count-1], for solveUnweightedLeastSquaresDeg2.
+ * They do not depend on y, so a single set of sums serves every fit over the same x, and
+ * the sums for all prefixes of x can be computed in one pass.
+ */
+struct PowerSums {
+    float sxi, sxi2, sxi3, sxi4;
+
+    PowerSums add(float xi) const {
+        float xi2 = xi*xi;
+        float xi3 = xi2*xi;
+        float xi4 = xi3*xi;
+
+        PowerSums sums;
+        sums.sxi = sxi + xi;
+        sums.sxi2 = sxi2 + xi2;
+        sums.sxi3 = sxi3 + xi3;
+        sums.sxi4 = sxi4 + xi4;
+        return sums;
+    }
+};
+
 /*
  * Optimized unweighted second-order least squares fit. About 2x speed improvement compared to
  * the default implementation
  */
 static std::optional<std::array<float, 3>> solveUnweightedLeastSquaresDeg2(
-        const float* x, const float* y, size_t count) {
+        const float* x, const float* y, size_t count, const PowerSums& xSums) {
     // Solving y = a*x^2 + b*x + c
-    float sxi = 0, sxiyi = 0, syi = 0, sxi2 = 0, sxi3 = 0, sxi2yi = 0, sxi4 = 0;
+    const float sxi = xSums.sxi, sxi2 = xSums.sxi2, sxi3 = xSums.sxi3, sxi4 = xSums.sxi4;
+    float sxiyi = 0, syi = 0, sxi2yi = 0;
 
     for (size_t i = 0; i < count; i++) {
         float xi = x[i];
         float yi = y[i];
-        float xi2 = xi*xi;
-        float xi3 = xi2*xi;
-        float xi4 = xi3*xi;
         float xiyi = xi*yi;
-        float xi2yi = xi2*yi;
+        float xi2yi = xi*xi*yi;
 
-        sxi += xi;
-        sxi2 += xi2;
         sxiyi += xiyi;
         sxi2yi += xi2yi;
         syi += yi;
-        sxi3 += xi3;
-        sxi4 += xi4;
     }
 
     float Sxx = sxi2 - sxi*sxi / count;
@@ -625,19 +716,27 @@ static std::optional<std::array<float, 3>> solveUnweightedLeastSquaresDeg2(
 
 bool LeastSquaresVelocityTrackerStrategy::getEstimator(uint32_t id,
         VelocityTracker::Estimator* outEstimator) const {
-    outEstimator->clear();
+    BitSet32 idBits;
+    idBits.markBit(id);
+    return !getEstimators(idBits, outEstimator).isEmpty();
+}
 
-    // Iterate over movement samples in reverse time order and collect samples.
-    float x[HISTORY_SIZE];
-    float y[HISTORY_SIZE];
+BitSet32 LeastSquaresVelocityTrackerStrategy::getEstimators(BitSet32 idBits,
+        VelocityTracker::Estimator* outEstimators) const {
+    static_assert(HISTORY_SIZE <= LeastSquaresDecomposition::MAX_M,
+            "The decomposition must have room for all samples");
+
+    // Iterate over movement samples in reverse time order and collect the times and weights
+    // once for all pointers.  Each pointer uses the leading samples that contain it.
+    uint32_t indices[HISTORY_SIZE];
     float w[HISTORY_SIZE];
     float time[HISTORY_SIZE];
-    uint32_t m = 0;
+    uint32_t samples = 0;
     uint32_t index = mIndex;
     const Movement& newestMovement = mMovements[mIndex];
     do {
         const Movement& movement = mMovements[index];
-        if (!movement.idBits.hasBit(id)) {
+        if (!(movement.idBits.value & idBits.value)) {
             break;
         }
 
@@ -646,65 +745,108 @@ bool LeastSquaresVelocityTrackerStrategy::getEstimator(uint32_t id,
             break;
         }
 
-        const VelocityTracker::Position& position = movement.getPosition(id);
-        x[m] = position.x;
-        y[m] = position.y;
-        w[m] = chooseWeight(index);
-        time[m] = -age * 0.000000001f;
+        indices[samples] = index;
+        w[samples] = chooseWeight(index);
+        time[samples] = -age * 0.000000001f;
         index = (index == 0 ? HISTORY_SIZE : index) - 1;
-    } while (++m < HISTORY_SIZE);
-
-    if (m == 0) {
-        return false; // no data
-    }
-
-    // Calculate a least squares polynomial fit.
-    uint32_t degree = mDegree;
-    if (degree > m - 1) {
-        degree = m - 1;
+    } while (++samples < HISTORY_SIZE);
+
+    // The unweighted quadratic fit only needs the sums of the powers of the times over the
+    // samples of each pointer, which are prefixes of the samples collected above.
+    const bool unweighted = mWeighting == WEIGHTING_NONE;
+    PowerSums timeSums[HISTORY_SIZE + 1];
+    if (unweighted && mDegree >= 2) {
+        timeSums[0] = {};
+        for (uint32_t i = 0; i < samples; i++) {
+            timeSums[i + 1] = timeSums[i].add(time[i]);
+        }
     }
 
-    if (degree == 2 && mWeighting == WEIGHTING_NONE) {
-        // Optimize unweighted, quadratic polynomial fit
-        std::optional<std::array<float, 3>> xCoeff = solveUnweightedLeastSquaresDeg2(time, x, m);
-        std::optional<std::array<float, 3>> yCoeff = solveUnweightedLeastSquaresDeg2(time, y, m);
-        if (xCoeff && yCoeff) {
-            outEstimator->time = newestMovement.eventTime;
-            outEstimator->degree = 2;
-            outEstimator->confidence = 1;
-            for (size_t i = 0; i <= outEstimator->degree; i++) {
-                outEstimator->xCoeff[i] = (*xCoeff)[i];
-                outEstimator->yCoeff[i] = (*yCoeff)[i];
+    // The general fit shares its decomposition between the x and y positions, and between
+    // the pointers that have the same number of samples.
+    LeastSquaresDecomposition decomposition;
+    bool haveDecomposition = false;
+    bool decomposed = false;
+
+    BitSet32 estimatedIdBits;
+    for (uint32_t i = 0; !idBits.isEmpty(); i++) {
+        uint32_t id = idBits.clearFirstMarkedBit();
+        VelocityTracker::Estimator* outEstimator = &outEstimators[i];
+        outEstimator->clear();
+
+        float x[HISTORY_SIZE];
+        float y[HISTORY_SIZE];
+        uint32_t m = 0;
+        for (; m < samples; m++) {
+            const Movement& movement = mMovements[indices[m]];
+            if (!movement.idBits.hasBit(id)) {
+                break;
             }
-            return true;
+            const VelocityTracker::Position& position = movement.getPosition(id);
+            x[m] = position.x;
+            y[m] = position.y;
         }
-    } else if (degree >= 1) {
-        // General case for an Nth degree polynomial fit
-        float xdet, ydet;
-        uint32_t n = degree + 1;
-        if (solveLeastSquares(time, x, w, m, n, outEstimator->xCoeff, &xdet)
-                && solveLeastSquares(time, y, w, m, n, outEstimator->yCoeff, &ydet)) {
-            outEstimator->time = newestMovement.eventTime;
-            outEstimator->degree = degree;
-            outEstimator->confidence = xdet * ydet;
+
+        if (m == 0) {
+            continue; // no data
+        }
+        estimatedIdBits.markBit(id);
+
+        // Calculate a least squares polynomial fit.
+        uint32_t degree = mDegree;
+        if (degree > m - 1) {
+            degree = m - 1;
+        }
+
+        if (degree == 2 && unweighted) {
+            // Optimize unweighted, quadratic polynomial fit
+            std::optional<std::array<float, 3>> xCoeff =
+                    solveUnweightedLeastSquaresDeg2(time, x, m, timeSums[m]);
+            std::optional<std::array<float, 3>> yCoeff =
+                    solveUnweightedLeastSquaresDeg2(time, y, m, timeSums[m]);
+            if (xCoeff && yCoeff) {
+                outEstimator->time = newestMovement.eventTime;
+                outEstimator->degree = 2;
+                outEstimator->confidence = 1;
+                for (size_t j = 0; j <= outEstimator->degree; j++) {
+                    outEstimator->xCoeff[j] = (*xCoeff)[j];
+                    outEstimator->yCoeff[j] = (*yCoeff)[j];
+                }
+                continue;
+            }
+        } else if (degree >= 1) {
+            // General case for an Nth degree polynomial fit
+            uint32_t n = degree + 1;
+            if (!haveDecomposition || decomposition.m != m || decomposition.n != n) {
+                decomposed = decomposeLeastSquares(time, w, m, n, &decomposition);
+                haveDecomposition = true;
+            }
+            if (decomposed) {
+                float xdet, ydet;
+                solveLeastSquares(time, x, w, decomposition, outEstimator->xCoeff, &xdet);
+                solveLeastSquares(time, y, w, decomposition, outEstimator->yCoeff, &ydet);
+                outEstimator->time = newestMovement.eventTime;
+                outEstimator->degree = degree;
+                outEstimator->confidence = xdet * ydet;
 #if DEBUG_STRATEGY
-            ALOGD("estimate: degree=%d, xCoeff=%s, yCoeff=%s, confidence=%f",
-                    int(outEstimator->degree),
-                    vectorToString(outEstimator->xCoeff, n).c_str(),
-                    vectorToString(outEstimator->yCoeff, n).c_str(),
-                    outEstimator->confidence);
+                ALOGD("estimate: degree=%d, xCoeff=%s, yCoeff=%s, confidence=%f",
+                        int(outEstimator->degree),
+                        vectorToString(outEstimator->xCoeff, n).c_str(),
+                        vectorToString(outEstimator->yCoeff, n).c_str(),
+                        outEstimator->confidence);
 #endif
-            return true;
+                continue;
+            }
         }
-    }
 
-    // No velocity data available for this pointer, but we do have its current position.
-    outEstimator->xCoeff[0] = x[0];
-    outEstimator->yCoeff[0] = y[0];
-    outEstimator->time = newestMovement.eventTime;
-    outEstimator->degree = 0;
-    outEstimator->confidence = 1;
-    return true;
+        // No velocity data available for this pointer, but we do have its current position.
+        outEstimator->xCoeff[0] = x[0];
+        outEstimator->yCoeff[0] = y[0];
+        outEstimator->time = newestMovement.eventTime;
+        outEstimator->degree = 0;
+        outEstimator->confidence = 1;
+    }
+    return estimatedIdBits;
 }
 
 float LeastSquaresVelocityTrackerStrategy::chooseWeight(uint32_t index) const {
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <input/VelocityTracker.h>
+#include <iterator>
+
+namespace android {
+
+// The strategies to measure, selected by the first argument of the benchmarks.
+static const char* const STRATEGIES[] = {"lsq2", "lsq3", "wlsq2-delta", "impulse"};
+
+// A frame every 8ms, so that the whole history is within the horizon of the strategies.
+static const nsecs_t FRAME_INTERVAL = 8 * 1000000;
+static const int FRAME_COUNT = 20;
+
+/**
+ * Fills the tracker with the given number of fingers that move in parallel along a curve.
+ */
+static void addMovements(VelocityTracker& tracker, uint32_t pointerCount, BitSet32* outIdBits) {
+    BitSet32 idBits;
+    for (uint32_t id = 0; id < pointerCount; id++) {
+        idBits.markBit(id);
+    }
+    VelocityTracker::Position positions[MAX_POINTERS];
+    for (int frame = 0; frame < FRAME_COUNT; frame++) {
+        const float t = frame;
+        for (uint32_t i = 0; i < pointerCount; i++) {
+            positions[i].x = 100 * i + 12 * t + 0.3f * t * t;
+            positions[i].y = 2000 - 25 * t - 0.1f * t * t;
+        }
+        tracker.addMovement(frame * FRAME_INTERVAL, idBits, positions);
+    }
+    *outIdBits = idBits;
+}
+
+// Every strategy, with one finger and with ten.
+static void strategiesAndPointerCounts(benchmark::internal::Benchmark* b) {
+    for (size_t strategy = 0; strategy < std::size(STRATEGIES); strategy++) {
+        b->Args({int64_t(strategy), 1});
+        b->Args({int64_t(strategy), 10});
+    }
+}
+
+static void BM_GetVelocity(benchmark::State& state) {
+    const char* strategy = STRATEGIES[state.range(0)];
+    VelocityTracker tracker(strategy);
+    BitSet32 idBits;
+    addMovements(tracker, state.range(1), &idBits);
+
+    for (auto _ : state) {
+        for (BitSet32 iterBits(idBits); !iterBits.isEmpty();) {
+            uint32_t id = iterBits.clearFirstMarkedBit();
+            float vx, vy;
+            tracker.getVelocity(id, &vx, &vy);
+            benchmark::DoNotOptimize(vx);
+            benchmark::DoNotOptimize(vy);
+        }
+    }
+    state.SetLabel(strategy);
+}
+BENCHMARK(BM_GetVelocity)->Apply(strategiesAndPointerCounts);
+
+static void BM_GetVelocities(benchmark::State& state) {
+    const char* strategy = STRATEGIES[state.range(0)];
+    VelocityTracker tracker(strategy);
+    BitSet32 idBits;
+    addMovements(tracker, state.range(1), &idBits);
+
+    for (auto _ : state) {
+        float vx[MAX_POINTERS], vy[MAX_POINTERS];
+        tracker.getVelocities(idBits, vx, vy);
+        benchmark::DoNotOptimize(vx);
+        benchmark::DoNotOptimize(vy);
+    }
+    state.SetLabel(strategy);
+}
+BENCHMARK(BM_GetVelocities)->Apply(strategiesAndPointerCounts);
+
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -230,6 +230,58 @@ static void computeAndCheckQuadraticEstimate(const std::vector<MotionEventEntry>
     }
 }
 
+/*
+ * getVelocities must give the same results as getVelocity for each pointer, including pointers
+ * that went down later than others, pointers that share their samples and unknown pointers.
+ */
+static void checkVelocitiesMatchVelocity(const char* strategy) {
+    SCOPED_TRACE(strategy);
+    VelocityTracker vt(strategy);
+
+    // Pointer 0 moves along a parabola from the start. Pointers 2 and 3 go down together
+    // halfway through and move along lines.
+    for (int i = 0; i < 12; i++) {
+        const nsecs_t eventTime = std::chrono::nanoseconds(8ms * i).count();
+        const float t = i;
+        BitSet32 idBits;
+        VelocityTracker::Position positions[3];
+        idBits.markBit(0);
+        positions[0] = {10 + 3 * t + 0.5f * t * t, 500 - 2 * t * t};
+        if (i >= 6) {
+            idBits.markBit(2);
+            idBits.markBit(3);
+            positions[1] = {300 - 7 * t, 40 + 11 * t};
+            positions[2] = {20 + 5 * t, 900 - 13 * t};
+        }
+        vt.addMovement(eventTime, idBits, positions);
+    }
+
+    BitSet32 idBits;
+    idBits.markBit(0);
+    idBits.markBit(2);
+    idBits.markBit(3);
+    idBits.markBit(5);
+    float vx[4], vy[4];
+    BitSet32 velocityIdBits = vt.getVelocities(idBits, vx, vy);
+
+    for (uint32_t index = 0; !idBits.isEmpty(); index++) {
+        uint32_t id = idBits.clearFirstMarkedBit();
+        float expectedVx, expectedVy;
+        bool expectedKnown = vt.getVelocity(id, &expectedVx, &expectedVy);
+        EXPECT_EQ(expectedKnown, velocityIdBits.hasBit(id)) << "id " << id;
+        EXPECT_EQ(expectedVx, vx[index]) << "id " << id;
+        EXPECT_EQ(expectedVy, vy[index]) << "id " << id;
+    }
+    EXPECT_FALSE(velocityIdBits.hasBit(5));
+}
+
+TEST_F(VelocityTrackerTest, GetVelocities_MatchesGetVelocity) {
+    for (const char* strategy : {"lsq1", "lsq2", "lsq3", "wlsq2-delta", "wlsq2-central",
+                                 "wlsq2-recent", "impulse", "int1", "int2", "legacy"}) {
+        checkVelocitiesMatchVelocity(strategy);
+    }
+}
+
 /*
  * ================== VelocityTracker tests generated manually =====================================
  */
@@ -0,0 +1,514 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "TraceBuffer"
+
+#include <tracebuffer/TraceBuffer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <log/log.h>
+#include <sys/system_properties.h>
+#include <unistd.h>
+#include <utils/Timers.h>
+#include <utils/misc.h>
+
+namespace android {
+namespace tracebuffer {
+
+namespace {
+
+constexpr const char* kBufferedTagsProperty = "debug.atrace.tags.bufferedflags";
+constexpr const char* kFlushRequestProperty = "debug.atrace.buffered.flush";
+
+// Number of events each thread can hold before events are dropped. Must be a power of two.
+constexpr uint32_t kRingSize = 1024;
+// A thread flushes its own buffer once it is this full, so that it rarely drops events
+// even when nobody asks for a flush.
+constexpr uint32_t kFlushWatermark = kRingSize * 3 / 4;
+// Maximum size of a single trace_marker write accepted by the kernel.
+constexpr size_t kMaxMarkerWrite = 1024;
+constexpr size_t kMaxNames = 4096;
+
+// A system property whose changes are detected by comparing serials, which only costs a
+// couple of loads on the fast path.
+class CachedProperty {
+public:
+    explicit CachedProperty(const char* name) : mName(name) {}
+
+    // Returns true if the property changed since the last call. Safe to call from any
+    // thread; when several threads observe the same change only one of them gets true.
+    bool changed() {
+        const prop_info* info = mInfo.load(std::memory_order_acquire);
+        if (info == nullptr) {
+            const uint32_t areaSerial = __system_property_area_serial();
+            uint32_t lastAreaSerial = mAreaSerial.load(std::memory_order_relaxed);
+            if (lastAreaSerial == areaSerial ||
+                !mAreaSerial.compare_exchange_strong(lastAreaSerial, areaSerial,
+                                                     std::memory_order_relaxed)) {
+                return false;
+            }
+            info = __system_property_find(mName);
+            if (info == nullptr) {
+                return false;
+            }
+            mInfo.store(info, std::memory_order_release);
+        }
+        const uint32_t serial = __system_property_serial(info);
+        uint32_t lastSerial = mSerial.load(std::memory_order_relaxed);
+        if (lastSerial == serial) {
+            return false;
+        }
+        return mSerial.compare_exchange_strong(lastSerial, serial, std::memory_order_relaxed);
+    }
+
+    uint64_t readUint64() {
+        const prop_info* info = mInfo.load(std::memory_order_acquire);
+        uint64_t value = 0;
+        if (info != nullptr) {
+            __system_property_read_callback(
+                    info,
+                    [](void* cookie, const char*, const char* value, uint32_t) {
+                        *static_cast<uint64_t*>(cookie) = strtoull(value, nullptr, 0);
+                    },
+                    &value);
+        }
+        return value;
+    }
+
+private:
+    const char* const mName;
+    std::atomic<const prop_info*> mInfo{nullptr};
+    std::atomic<uint32_t> mSerial{UINT32_MAX};
+    std::atomic<uint32_t> mAreaSerial{UINT32_MAX};
+};
+
+struct Entry {
+    nsecs_t timestamp;
+    NameId name;
+    char type;
+};
+
+// Single producer (the owning thread), single consumer (whoever holds sLock) ring.
+struct ThreadBuffer {
+    explicit ThreadBuffer(pid_t tid) : tid(tid) {}
+
+    const pid_t tid;
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+    // Only written by the owning thread, so that recording never touches shared cache lines.
+    std::atomic<uint64_t> recorded{0};
+    std::atomic<uint64_t> dropped{0};
+    Entry entries[kRingSize];
+};
+
+CachedProperty sBufferedTagsProp(kBufferedTagsProperty);
+CachedProperty sFlushRequestProp(kFlushRequestProperty);
+std::atomic<uint64_t> sBufferedTags{0};
+
+// Set by setTestingOverrides().
+std::atomic<uint64_t> sTestingTags{0};
+std::atomic<int> sTestingFd{-1};
+
+std::mutex sNameLock;
+std::unordered_map<std::string, NameId> sNameIds;
+std::atomic<const char*> sNames[kMaxNames];
+
+// Protects sBuffers and serializes draining.
+std::mutex sLock;
+std::vector<ThreadBuffer*> sBuffers;
+
+// Counters of threads that have exited, guarded by sLock.
+uint64_t sExitedRecordedEvents = 0;
+uint64_t sExitedDroppedEvents = 0;
+std::atomic<uint64_t> sFlushedEvents{0};
+std::atomic<uint64_t> sMarkerWrites{0};
+
+void drainLocked(ThreadBuffer* buffer) {
+    const uint32_t head = buffer->head.load(std::memory_order_acquire);
+    uint32_t tail = buffer->tail.load(std::memory_order_relaxed);
+    if (head == tail) {
+        return;
+    }
+
+    const pid_t pid = getpid();
+    char out[kMaxMarkerWrite];
+    size_t used = 0;
+    uint64_t flushed = 0;
+
+    const int testingFd = sTestingFd.load(std::memory_order_relaxed);
+    const int fd = testingFd >= 0 ? testingFd : atrace_marker_fd;
+
+    auto writeOut = [&]() {
+        if (used > 0 && fd >= 0) {
+            if (write(fd, out, used) == static_cast<ssize_t>(used)) {
+                sMarkerWrites.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        used = 0;
+    };
+
+    for (; tail != head; tail++) {
+        const Entry& entry = buffer->entries[tail & (kRingSize - 1)];
+        char line[256];
+        int len;
+        if (entry.type == 'B') {
+            const char* name = getName(entry.name);
+            len = snprintf(line, sizeof(line), "T|%d|%d|%" PRId64 "|B|%s\n", pid, buffer->tid,
+                           entry.timestamp, name != nullptr ? name : "");
+        } else {
+            len = snprintf(line, sizeof(line), "T|%d|%d|%" PRId64 "|E\n", pid, buffer->tid,
+                           entry.timestamp);
+        }
+        len = std::min(len, static_cast<int>(sizeof(line) - 1));
+        if (used + len > sizeof(out)) {
+            writeOut();
+        }
+        memcpy(out + used, line, len);
+        used += len;
+        flushed++;
+    }
+    writeOut();
+
+    buffer->tail.store(tail, std::memory_order_release);
+    sFlushedEvents.fetch_add(flushed, std::memory_order_relaxed);
+}
+
+// Called when atrace pokes the binder services of the process, which is how a flush request
+// reaches threads that are not recording anything.
+void onSyspropChanged() {
+    if (sFlushRequestProp.changed()) {
+        flush();
+    }
+}
+
+std::once_flag sCallbackOnce;
+
+// Owns the calling thread's buffer and hands any remaining events to trace_marker when
+// the thread exits.
+struct ThreadBufferHolder {
+    ThreadBuffer* buffer = nullptr;
+
+    ThreadBuffer* get() {
+        if (buffer == nullptr) {
+            std::call_once(sCallbackOnce, [] { add_sysprop_change_callback(onSyspropChanged, 0); });
+            buffer = new ThreadBuffer(gettid());
+            std::lock_guard<std::mutex> lock(sLock);
+            sBuffers.push_back(buffer);
+        }
+        return buffer;
+    }
+
+    ~ThreadBufferHolder() {
+        if (buffer == nullptr) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(sLock);
+        drainLocked(buffer);
+        sExitedRecordedEvents += buffer->recorded.load(std::memory_order_relaxed);
+        sExitedDroppedEvents += buffer->dropped.load(std::memory_order_relaxed);
+        sBuffers.erase(std::remove(sBuffers.begin(), sBuffers.end(), buffer), sBuffers.end());
+        delete buffer;
+    }
+};
+
+thread_local ThreadBufferHolder tBuffer;
+
+void increment(std::atomic<uint64_t>& counter) {
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+bool isTagEnabled(uint64_t tag) {
+    if (sTestingFd.load(std::memory_order_relaxed) >= 0) {
+        return (sTestingTags.load(std::memory_order_relaxed) & tag) != 0;
+    }
+    return atrace_is_tag_enabled(tag);
+}
+
+void record(char type, NameId name) {
+    // Processes without binder services never get the property change callback.
+    if (sFlushRequestProp.changed()) {
+        flush();
+    }
+
+    ThreadBuffer* buffer = tBuffer.get();
+    const uint32_t head = buffer->head.load(std::memory_order_relaxed);
+    const uint32_t tail = buffer->tail.load(std::memory_order_acquire);
+    if (head - tail >= kRingSize) {
+        increment(buffer->dropped);
+        return;
+    }
+
+    Entry& entry = buffer->entries[head & (kRingSize - 1)];
+    // atrace prefers the boot clock for ftrace, see setClock().
+    entry.timestamp = systemTime(SYSTEM_TIME_BOOTTIME);
+    entry.name = name;
+    entry.type = type;
+    buffer->head.store(head + 1, std::memory_order_release);
+    increment(buffer->recorded);
+
+    if (head + 1 - tail >= kFlushWatermark) {
+        std::lock_guard<std::mutex> lock(sLock);
+        drainLocked(buffer);
+    }
+}
+
+} // namespace
+
+NameId internName(const char* name) {
+    std::lock_guard<std::mutex> lock(sNameLock);
+    auto it = sNameIds.find(name);
+    if (it != sNameIds.end()) {
+        return it->second;
+    }
+    if (sNameIds.size() >= kMaxNames) {
+        ALOGW("Name table full, dropping events for \"%s\"", name);
+        return INVALID_NAME_ID;
+    }
+    const NameId id = static_cast<NameId>(sNameIds.size());
+    auto inserted = sNameIds.emplace(name, id).first;
+    // Keys of an unordered_map are never moved, so the c_str() stays valid.
+    sNames[id].store(inserted->first.c_str(), std::memory_order_release);
+    return id;
+}
+
+const char* getName(NameId id) {
+    if (id >= kMaxNames) {
+        return nullptr;
+    }
+    return sNames[id].load(std::memory_order_acquire);
+}
+
+bool isBufferingEnabled(uint64_t tag) {
+    if (sTestingFd.load(std::memory_order_relaxed) >= 0) {
+        return (sTestingTags.load(std::memory_order_relaxed) & tag) != 0;
+    }
+    if (sBufferedTagsProp.changed()) {
+        sBufferedTags.store(sBufferedTagsProp.readUint64(), std::memory_order_relaxed);
+    }
+    return (sBufferedTags.load(std::memory_order_relaxed) & tag) != 0;
+}
+
+void beginSection(uint64_t tag, NameId name) {
+    if (!isTagEnabled(tag)) {
+        return;
+    }
+    if (isBufferingEnabled(tag)) {
+        record('B', name);
+    } else {
+        const char* str = getName(name);
+        atrace_begin(tag, str != nullptr ? str : "");
+    }
+}
+
+void endSection(uint64_t tag) {
+    if (!isTagEnabled(tag)) {
+        return;
+    }
+    if (isBufferingEnabled(tag)) {
+        record('E', INVALID_NAME_ID);
+    } else {
+        atrace_end(tag);
+    }
+}
+
+void flush() {
+    std::lock_guard<std::mutex> lock(sLock);
+    for (ThreadBuffer* buffer : sBuffers) {
+        drainLocked(buffer);
+    }
+}
+
+Stats getStats() {
+    std::lock_guard<std::mutex> lock(sLock);
+    Stats stats{
+            .recordedEvents = sExitedRecordedEvents,
+            .droppedEvents = sExitedDroppedEvents,
+            .flushedEvents = sFlushedEvents.load(std::memory_order_relaxed),
+            .markerWrites = sMarkerWrites.load(std::memory_order_relaxed),
+    };
+    for (const ThreadBuffer* buffer : sBuffers) {
+        stats.recordedEvents += buffer->recorded.load(std::memory_order_relaxed);
+        stats.droppedEvents += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+namespace {
+
+constexpr std::string_view kMarkWrite = "tracing_mark_write: ";
+
+template <typename T>
+bool parseNumber(std::string_view str, T* out) {
+    const char* end = str.data() + str.size();
+    auto result = std::from_chars(str.data(), end, *out);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+// Finds the "<seconds>.<microseconds>: " timestamp of a line of ftrace text output. Sets
+// |start| to its offset and |timestamp| to its value in nanoseconds.
+bool findTimestamp(std::string_view line, size_t* start, nsecs_t* timestamp) {
+    for (size_t colon = line.find(": "); colon != std::string_view::npos;
+         colon = line.find(": ", colon + 1)) {
+        size_t begin = colon;
+        while (begin > 0 && (isdigit(line[begin - 1]) || line[begin - 1] == '.')) {
+            begin--;
+        }
+        if (begin == 0 || line[begin - 1] != ' ') {
+            continue;
+        }
+        const std::string_view token = line.substr(begin, colon - begin);
+        const size_t dot = token.find('.');
+        if (dot == 0 || dot == std::string_view::npos || token.size() - dot - 1 != 6) {
+            continue;
+        }
+        int64_t seconds;
+        int64_t micros;
+        if (!parseNumber(token.substr(0, dot), &seconds) ||
+            !parseNumber(token.substr(dot + 1), &micros)) {
+            continue;
+        }
+        *start = begin;
+        *timestamp = seconds * 1000000000 + micros * 1000;
+        return true;
+    }
+    return false;
+}
+
+// Converts a buffered marker into an ftrace text line carrying a standard marker. |cpuField|
+// is the "[<cpu>] <flags> " part of the line the marker was written in.
+bool convertMarker(std::string_view marker, std::string_view cpuField, std::string* out,
+                   nsecs_t* timestamp) {
+    // T|<pid>|<tid>|<timestamp ns>|<B or E>[|<name>]
+    std::string_view fields[4];
+    std::string_view rest = marker;
+    for (auto& field : fields) {
+        const size_t bar = rest.find('|');
+        if (bar == std::string_view::npos) {
+            return false;
+        }
+        field = rest.substr(0, bar);
+        rest.remove_prefix(bar + 1);
+    }
+    pid_t pid;
+    pid_t tid;
+    if (fields[0] != "T" || !parseNumber(fields[1], &pid) || !parseNumber(fields[2], &tid) ||
+        !parseNumber(fields[3], timestamp) || *timestamp < 0) {
+        return false;
+    }
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "%16s-%-5d (%5d) ", "<...>", tid, pid);
+    char time[32];
+    snprintf(time, sizeof(time), "%" PRId64 ".%06" PRId64 ": ", *timestamp / 1000000000,
+             (*timestamp / 1000) % 1000000);
+    out->assign(prefix);
+    out->append(cpuField);
+    out->append(time);
+    out->append(kMarkWrite);
+    if (rest.compare(0, 2, "B|") == 0) {
+        out->append("B|").append(fields[1]).append(rest.substr(1));
+    } else if (rest == "E") {
+        out->append("E|").append(fields[1]);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+std::string convertTrace(const std::string& trace) {
+    struct Line {
+        nsecs_t timestamp;
+        std::string text;
+    };
+    std::string header;
+    std::vector<Line> lines;
+    // The kernel prints a trace_marker write holding several markers as one event, so all
+    // but the first marker of each drained batch are on lines of their own.
+    std::string cpuField;
+    nsecs_t lastTimestamp = 0;
+    bool converted = false;
+
+    std::string_view rest = trace;
+    while (!rest.empty()) {
+        const size_t newline = rest.find('\n');
+        const std::string_view line = rest.substr(0, newline);
+        rest.remove_prefix(newline == std::string_view::npos ? rest.size() : newline + 1);
+
+        if (lines.empty() && !line.empty() && line[0] == '#') {
+            header.append(line).append("\n");
+            continue;
+        }
+
+        size_t start;
+        nsecs_t timestamp;
+        const bool hasTimestamp = findTimestamp(line, &start, &timestamp);
+        std::string_view marker;
+        const size_t markWrite = line.find(kMarkWrite);
+        if (markWrite != std::string_view::npos && hasTimestamp &&
+            line.compare(markWrite + kMarkWrite.size(), 2, "T|") == 0) {
+            marker = line.substr(markWrite + kMarkWrite.size());
+            const size_t cpu = line.rfind('[', start);
+            cpuField = cpu != std::string_view::npos ? line.substr(cpu, start - cpu) : "";
+        } else if (line.compare(0, 2, "T|") == 0) {
+            marker = line;
+        }
+
+        std::string text;
+        if (!marker.empty() && !cpuField.empty() &&
+            convertMarker(marker, cpuField, &text, &timestamp)) {
+            lines.push_back({timestamp, std::move(text)});
+            converted = true;
+            continue;
+        }
+        if (hasTimestamp) {
+            lastTimestamp = timestamp;
+        }
+        lines.push_back({lastTimestamp, std::string(line)});
+    }
+    if (!converted) {
+        return trace;
+    }
+
+    std::stable_sort(lines.begin(), lines.end(),
+                     [](const Line& a, const Line& b) { return a.timestamp < b.timestamp; });
+    std::string result = std::move(header);
+    for (const Line& line : lines) {
+        result.append(line.text).append("\n");
+    }
+    return result;
+}
+
+void setTestingOverrides(uint64_t tags, int fd) {
+    sTestingTags.store(tags, std::memory_order_relaxed);
+    sTestingFd.store(fd, std::memory_order_relaxed);
+}
+
+} // namespace tracebuffer
+} // namespace android
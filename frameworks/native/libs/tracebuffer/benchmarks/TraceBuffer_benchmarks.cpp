@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include <benchmark/benchmark.h>
+
+#include <tracebuffer/TraceBuffer.h>
+#include <utils/Trace.h>
+
+// Run with tracing enabled for the comparison to be meaningful, e.g.
+//   atrace --async_start gfx                  (direct trace_marker writes)
+//   atrace --async_start --buffered gfx       (buffered)
+// Without any tracing enabled both benchmarks measure the disabled fast path.
+
+namespace android {
+namespace tracebuffer {
+
+static void BM_DirectTraceMarker(benchmark::State& state) {
+    for (auto _ : state) {
+        ATRACE_NAME("BM_DirectTraceMarker");
+    }
+}
+BENCHMARK(BM_DirectTraceMarker)->ThreadRange(1, 8);
+
+static void BM_Buffered(benchmark::State& state) {
+    for (auto _ : state) {
+        ATRACE_BUFFERED_NAME("BM_Buffered");
+    }
+    flush();
+}
+BENCHMARK(BM_Buffered)->ThreadRange(1, 8);
+
+static void BM_BufferedFlush(benchmark::State& state) {
+    for (auto _ : state) {
+        for (int i = 0; i < state.range(0); i++) {
+            ATRACE_BUFFERED_NAME("BM_BufferedFlush");
+        }
+        flush();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BufferedFlush)->Arg(16)->Arg(128)->Arg(512);
+
+} // namespace tracebuffer
+} // namespace android
+
+BENCHMARK_MAIN();
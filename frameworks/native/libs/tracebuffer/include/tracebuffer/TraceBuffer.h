@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cutils/trace.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * Buffered userspace tracing.
+ *
+ * ATRACE_BEGIN/ATRACE_END write one string to trace_marker per event, which costs a
+ * syscall per slice. The functions here record events into a per-thread lock-free ring
+ * buffer instead, using interned names, and write them to trace_marker in batches.
+ *
+ * Buffering is enabled per tag by atrace through the debug.atrace.tags.bufferedflags
+ * property (see "atrace --buffered"). Tags that are enabled for tracing but not for
+ * buffering fall back to regular atrace_begin/atrace_end, so call sites can switch to
+ * the ATRACE_BUFFERED_* macros unconditionally.
+ *
+ * A thread's buffer is flushed when it fills past a high watermark, when flush() is called
+ * explicitly, or when atrace requests a flush before collecting the trace. The request is
+ * delivered through the system property change callback that atrace triggers by poking
+ * the binder services, so processes that are idle at that point are flushed as well.
+ *
+ * Because flushed events are written after the fact, each one carries its original
+ * CLOCK_BOOTTIME timestamp and thread id. The marker lines have the form
+ *
+ *     T|<pid>|<tid>|<timestamp ns>|B|<name>
+ *     T|<pid>|<tid>|<timestamp ns>|E
+ *
+ * which no trace parser understands. atrace rewrites them with convertTrace() into regular
+ * B|<pid>|<name> and E|<pid> markers of the right thread and time when it dumps the trace
+ * as text, so buffered tracing only works with traces collected by atrace.
+ */
+
+namespace android {
+namespace tracebuffer {
+
+using NameId = uint16_t;
+
+// Returned by internName() when the name table is full. Sections using it are still
+// recorded, but without a name.
+constexpr NameId INVALID_NAME_ID = UINT16_MAX;
+
+// Interns |name| and returns an id that stays valid for the lifetime of the process.
+// The string is copied. Interning the same string twice returns the same id.
+NameId internName(const char* name);
+
+// Returns the interned string for |id|, or nullptr if |id| is unknown.
+const char* getName(NameId id);
+
+// Returns true if events for |tag| should be recorded in the ring buffer.
+bool isBufferingEnabled(uint64_t tag);
+
+void beginSection(uint64_t tag, NameId name);
+void endSection(uint64_t tag);
+
+// Writes all pending events of all threads to trace_marker.
+void flush();
+
+struct Stats {
+    uint64_t recordedEvents;
+    uint64_t droppedEvents;
+    uint64_t flushedEvents;
+    uint64_t markerWrites;
+};
+
+Stats getStats();
+
+// Rewrites the buffered markers in |trace|, the text contents of the ftrace trace file, into
+// standard begin/end markers, and moves them to their place in time. The boot clock must be
+// the trace clock for the timestamps to line up. Lines that are not buffered markers, and
+// buffered markers that cannot be parsed, are kept as they are.
+std::string convertTrace(const std::string& trace);
+
+// For tests. Makes |tags| both enabled and buffered, and writes flushed events to |fd|
+// instead of trace_marker. Passing an |fd| of -1 restores the normal behavior.
+void setTestingOverrides(uint64_t tags, int fd);
+
+class ScopedSection {
+public:
+    ScopedSection(uint64_t tag, NameId name) : mTag(tag) { beginSection(tag, name); }
+    ~ScopedSection() { endSection(mTag); }
+
+private:
+    ScopedSection(const ScopedSection&) = delete;
+    ScopedSection& operator=(const ScopedSection&) = delete;
+
+    const uint64_t mTag;
+};
+
+} // namespace tracebuffer
+} // namespace android
+
+#define ATRACE_BUFFERED_CONCAT_(a, b) a##b
+#define ATRACE_BUFFERED_CONCAT(a, b) ATRACE_BUFFERED_CONCAT_(a, b)
+
+// Buffered equivalent of ATRACE_NAME. |name| is interned once per call site.
+#define ATRACE_BUFFERED_NAME(name)                                                        \
+    static const ::android::tracebuffer::NameId ATRACE_BUFFERED_CONCAT(__tb_id, __LINE__) = \
+            ::android::tracebuffer::internName(name);                                     \
+    ::android::tracebuffer::ScopedSection ATRACE_BUFFERED_CONCAT(__tb_scope, __LINE__)(   \
+            ATRACE_TAG, ATRACE_BUFFERED_CONCAT(__tb_id, __LINE__))
+
+#define ATRACE_BUFFERED_CALL() ATRACE_BUFFERED_NAME(__FUNCTION__)
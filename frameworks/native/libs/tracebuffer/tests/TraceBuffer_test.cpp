@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include <tracebuffer/TraceBuffer.h>
+
+#include <android-base/file.h>
+#include <android-base/properties.h>
+#include <android-base/strings.h>
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utils/Timers.h>
+#include <utils/misc.h>
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace tracebuffer {
+
+TEST(TraceBufferTest, internNameReturnsSameIdForSameString) {
+    const NameId first = internName("TraceBufferTest::same");
+    std::string copy("TraceBufferTest::same");
+    EXPECT_EQ(first, internName(copy.c_str()));
+    EXPECT_NE(first, internName("TraceBufferTest::other"));
+}
+
+TEST(TraceBufferTest, getNameReturnsInternedString) {
+    const NameId id = internName("TraceBufferTest::name");
+    ASSERT_NE(INVALID_NAME_ID, id);
+    EXPECT_STREQ("TraceBufferTest::name", getName(id));
+    EXPECT_EQ(nullptr, getName(INVALID_NAME_ID));
+}
+
+TEST(TraceBufferTest, internNameIsThreadSafe) {
+    constexpr int kThreads = 8;
+    std::vector<NameId> ids(kThreads);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; i++) {
+        threads.emplace_back([&ids, i] { ids[i] = internName("TraceBufferTest::threaded"); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(1u, std::set<NameId>(ids.begin(), ids.end()).size());
+}
+
+// Parses the buffered markers written to |fd| and checks that every thread produced
+// |sections| properly nested sections named |name|, in time order.
+static void checkMarkers(int fd, const char* name, size_t threads, int sections) {
+    std::string contents;
+    ASSERT_TRUE(base::ReadFdToString(fd, &contents));
+    std::map<pid_t, std::vector<std::string>> events;
+    std::map<pid_t, nsecs_t> lastTimestamp;
+    for (const std::string& line : base::Split(contents, "\n")) {
+        if (line.empty()) {
+            continue;
+        }
+        std::vector<std::string> fields = base::Split(line, "|");
+        ASSERT_GE(fields.size(), 5u) << line;
+        EXPECT_EQ("T", fields[0]);
+        EXPECT_EQ(std::to_string(getpid()), fields[1]);
+        const pid_t tid = std::stoi(fields[2]);
+        const nsecs_t timestamp = std::stoll(fields[3]);
+        EXPECT_LE(lastTimestamp[tid], timestamp);
+        lastTimestamp[tid] = timestamp;
+        if (fields[4] == "B") {
+            ASSERT_EQ(6u, fields.size()) << line;
+            EXPECT_EQ(name, fields[5]);
+        } else {
+            EXPECT_EQ(5u, fields.size()) << line;
+            EXPECT_EQ("E", fields[4]);
+        }
+        events[tid].push_back(fields[4]);
+    }
+
+    ASSERT_EQ(threads, events.size());
+    for (const auto& [tid, types] : events) {
+        ASSERT_EQ(2u * sections, types.size()) << "tid " << tid;
+        for (size_t i = 0; i < types.size(); i++) {
+            EXPECT_EQ(i % 2 == 0 ? "B" : "E", types[i]) << "tid " << tid << " event " << i;
+        }
+    }
+}
+
+TEST(TraceBufferTest, scopedSectionsAreBalancedAcrossThreads) {
+    TemporaryFile markers;
+    setTestingOverrides(ATRACE_TAG, markers.fd);
+    const Stats before = getStats();
+
+    constexpr int kThreads = 4;
+    constexpr int kSections = 2000;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; i++) {
+        threads.emplace_back([] {
+            for (int j = 0; j < kSections; j++) {
+                ATRACE_BUFFERED_NAME("TraceBufferTest::section");
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    flush();
+    setTestingOverrides(0, -1);
+
+    // Exited threads hand their events over, so nothing can be left pending.
+    const Stats stats = getStats();
+    EXPECT_EQ(2u * kThreads * kSections, stats.recordedEvents - before.recordedEvents);
+    EXPECT_EQ(0u, stats.droppedEvents - before.droppedEvents);
+    EXPECT_EQ(stats.recordedEvents - before.recordedEvents,
+              stats.flushedEvents - before.flushedEvents);
+    EXPECT_GT(stats.markerWrites, before.markerWrites);
+
+    ASSERT_EQ(0, lseek(markers.fd, 0, SEEK_SET));
+    checkMarkers(markers.fd, "TraceBufferTest::section", kThreads, kSections);
+}
+
+TEST(TraceBufferTest, disabledTagIsNotRecorded) {
+    TemporaryFile markers;
+    setTestingOverrides(ATRACE_TAG_AUDIO, markers.fd);
+    const Stats before = getStats();
+    {
+        ATRACE_BUFFERED_NAME("TraceBufferTest::disabled");
+    }
+    flush();
+    setTestingOverrides(0, -1);
+
+    EXPECT_EQ(before.recordedEvents, getStats().recordedEvents);
+    struct stat st;
+    ASSERT_EQ(0, fstat(markers.fd, &st));
+    EXPECT_EQ(0, st.st_size);
+}
+
+TEST(TraceBufferTest, flushRequestReachesIdleThreads) {
+    TemporaryFile markers;
+    setTestingOverrides(ATRACE_TAG, markers.fd);
+
+    std::mutex lock;
+    std::condition_variable cond;
+    bool recorded = false;
+    bool done = false;
+    std::thread idle([&] {
+        {
+            ATRACE_BUFFERED_NAME("TraceBufferTest::idle");
+        }
+        std::unique_lock<std::mutex> l(lock);
+        recorded = true;
+        cond.notify_all();
+        cond.wait(l, [&] { return done; });
+    });
+    {
+        std::unique_lock<std::mutex> l(lock);
+        cond.wait(l, [&] { return recorded; });
+    }
+
+    const Stats before = getStats();
+    const bool requested = base::SetProperty("debug.atrace.buffered.flush",
+                                             std::to_string(systemTime(SYSTEM_TIME_MONOTONIC)));
+    if (requested) {
+        // What a binder SYSPROPS_TRANSACTION from atrace does.
+        report_sysprop_change();
+    }
+    const Stats after = getStats();
+    {
+        std::lock_guard<std::mutex> l(lock);
+        done = true;
+        cond.notify_all();
+    }
+    idle.join();
+    setTestingOverrides(0, -1);
+
+    if (!requested) {
+        GTEST_SKIP() << "cannot set debug.atrace.buffered.flush";
+    }
+    EXPECT_EQ(before.flushedEvents + 2, after.flushedEvents);
+}
+
+TEST(TraceBufferTest, convertTraceRewritesBufferedMarkers) {
+    // One drained batch of two markers, printed by the kernel as a single event, between
+    // two regular events.
+    const std::string trace =
+            "# tracer: nop\n"
+            "#\n"
+            "          <idle>-0     (-----) [001] d..2   100.000050: sched_switch: prev_comm=x\n"
+            "   SurfaceFlinger-700   (  700) [002] ...1   100.000100: tracing_mark_write: "
+            "T|700|701|100000010000|B|composite|layers\n"
+            "T|700|701|100000020000|E\n"
+            "          <idle>-0     (-----) [001] d..2   100.000200: sched_switch: prev_comm=y\n";
+    const std::string expected =
+            "# tracer: nop\n"
+            "#\n"
+            "           <...>-701   (  700) [002] ...1   100.000010: tracing_mark_write: "
+            "B|700|composite|layers\n"
+            "           <...>-701   (  700) [002] ...1   100.000020: tracing_mark_write: E|700\n"
+            "          <idle>-0     (-----) [001] d..2   100.000050: sched_switch: prev_comm=x\n"
+            "          <idle>-0     (-----) [001] d..2   100.000200: sched_switch: prev_comm=y\n";
+    EXPECT_EQ(expected, convertTrace(trace));
+}
+
+TEST(TraceBufferTest, convertTraceKeepsOtherLines) {
+    const std::string trace =
+            "# tracer: nop\n"
+            "   SurfaceFlinger-700   (  700) [002] ...1   100.000100: tracing_mark_write: "
+            "B|700|onMessageReceived\n"
+            "   SurfaceFlinger-700   (  700) [002] ...1   100.000200: tracing_mark_write: E|700\n";
+    EXPECT_EQ(trace, convertTrace(trace));
+
+    // Malformed buffered markers are left alone.
+    const std::string malformed =
+            "   SurfaceFlinger-700   (  700) [002] ...1   100.000100: tracing_mark_write: "
+            "T|700|abc|100000010000|B|x\n"
+            "T|700|701|100000020000|X\n"
+            "T|700|701\n";
+    EXPECT_EQ(malformed, convertTrace(malformed));
+}
+
+} // namespace tracebuffer
+} // namespace android
@@ -59,29 +59,49 @@ static void addLoadingCount(GpuStatsInfo::Driver driver, bool isDriverLoaded,
     }
 }
 
-static void addLoadingTime(GpuStatsInfo::Driver driver, int64_t driverLoadingTime,
+// Returns false if the loading time was dropped because the record is full.
+static bool addLoadingTime(GpuStatsInfo::Driver driver, int64_t driverLoadingTime,
                            GpuStatsAppInfo* const outAppInfo) {
+    std::vector<int64_t>* loadingTimes = nullptr;
     switch (driver) {
         case GpuStatsInfo::Driver::GL:
         case GpuStatsInfo::Driver::GL_UPDATED:
-            if (outAppInfo->glDriverLoadingTime.size() < GpuStats::MAX_NUM_LOADING_TIMES) {
-                outAppInfo->glDriverLoadingTime.emplace_back(driverLoadingTime);
-            }
+            loadingTimes = &outAppInfo->glDriverLoadingTime;
             break;
         case GpuStatsInfo::Driver::VULKAN:
         case GpuStatsInfo::Driver::VULKAN_UPDATED:
-            if (outAppInfo->vkDriverLoadingTime.size() < GpuStats::MAX_NUM_LOADING_TIMES) {
-                outAppInfo->vkDriverLoadingTime.emplace_back(driverLoadingTime);
-            }
+            loadingTimes = &outAppInfo->vkDriverLoadingTime;
             break;
         case GpuStatsInfo::Driver::ANGLE:
-            if (outAppInfo->angleDriverLoadingTime.size() < GpuStats::MAX_NUM_LOADING_TIMES) {
-                outAppInfo->angleDriverLoadingTime.emplace_back(driverLoadingTime);
-            }
+            loadingTimes = &outAppInfo->angleDriverLoadingTime;
             break;
         default:
-            break;
+            return true;
     }
+
+    if (loadingTimes->size() >= GpuStats::MAX_NUM_LOADING_TIMES) {
+        return false;
+    }
+    if (loadingTimes->empty()) {
+        // Reports arrive one at a time, so reserve the whole bounded capacity up front
+        // instead of growing the vector on every report.
+        loadingTimes->reserve(GpuStats::MAX_NUM_LOADING_TIMES);
+    }
+    loadingTimes->emplace_back(driverLoadingTime);
+    return true;
+}
+
+static void mergeGlobalInfo(const GpuStatsGlobalInfo& from, GpuStatsGlobalInfo* const to) {
+    to->glLoadingCount += from.glLoadingCount;
+    to->glLoadingFailureCount += from.glLoadingFailureCount;
+    to->vkLoadingCount += from.vkLoadingCount;
+    to->vkLoadingFailureCount += from.vkLoadingFailureCount;
+    to->angleLoadingCount += from.angleLoadingCount;
+    to->angleLoadingFailureCount += from.angleLoadingFailureCount;
+}
+
+GpuStats::Shard& GpuStats::shardFor(const std::string& appPackageName) {
+    return mShards[std::hash<std::string>()(appPackageName) % NUM_SHARDS];
 }
 
 void GpuStats::insertDriverStats(const std::string& driverPackageName,
@@ -91,7 +111,6 @@ void GpuStats::insertDriverStats(const std::string& driverPackageName,
                                  bool isDriverLoaded, int64_t driverLoadingTime) {
     ATRACE_CALL();
 
-    std::lock_guard<std::mutex> lock(mLock);
     registerStatsdCallbacksIfNeeded();
     ALOGV("Received:\n"
           "\tdriverPackageName[%s]\n"
@@ -107,35 +126,48 @@ void GpuStats::insertDriverStats(const std::string& driverPackageName,
           appPackageName.c_str(), vulkanVersion, static_cast<int32_t>(driver), isDriverLoaded,
           driverLoadingTime);
 
-    if (!mGlobalStats.count(driverVersionCode)) {
+    Shard& shard = shardFor(appPackageName);
+    std::lock_guard<std::mutex> lock(shard.lock);
+
+    auto globalIt = shard.globalStats.find(driverVersionCode);
+    if (globalIt == shard.globalStats.end()) {
         GpuStatsGlobalInfo globalInfo;
-        addLoadingCount(driver, isDriverLoaded, &globalInfo);
         globalInfo.driverPackageName = driverPackageName;
         globalInfo.driverVersionName = driverVersionName;
         globalInfo.driverVersionCode = driverVersionCode;
         globalInfo.driverBuildTime = driverBuildTime;
         globalInfo.vulkanVersion = vulkanVersion;
-        mGlobalStats.insert({driverVersionCode, globalInfo});
-    } else {
-        addLoadingCount(driver, isDriverLoaded, &mGlobalStats[driverVersionCode]);
+        globalIt = shard.globalStats.emplace(driverVersionCode, std::move(globalInfo)).first;
     }
-
-    const std::string appStatsKey = appPackageName + std::to_string(driverVersionCode);
-    if (!mAppStats.count(appStatsKey)) {
-        if (mAppStats.size() >= MAX_NUM_APP_RECORDS) {
-            ALOGV("GpuStatsAppInfo has reached maximum size. Ignore new stats.");
+    addLoadingCount(driver, isDriverLoaded, &globalIt->second);
+
+    auto idIt = shard.appIds.find(appPackageName);
+    if (idIt != shard.appIds.end()) {
+        auto appIt = shard.appStats.find({idIt->second, driverVersionCode});
+        if (appIt != shard.appStats.end()) {
+            if (!addLoadingTime(driver, driverLoadingTime, &appIt->second)) {
+                mDroppedLoadingTimes++;
+            }
             return;
         }
+    }
 
-        GpuStatsAppInfo appInfo;
-        addLoadingTime(driver, driverLoadingTime, &appInfo);
-        appInfo.appPackageName = appPackageName;
-        appInfo.driverVersionCode = driverVersionCode;
-        mAppStats.insert({appStatsKey, appInfo});
+    if (mNumAppRecords.fetch_add(1) >= MAX_NUM_APP_RECORDS) {
+        mNumAppRecords--;
+        mDroppedAppRecords++;
+        ALOGV("GpuStatsAppInfo has reached maximum size. Ignore new stats.");
         return;
     }
 
-    addLoadingTime(driver, driverLoadingTime, &mAppStats[appStatsKey]);
+    if (idIt == shard.appIds.end()) {
+        idIt = shard.appIds.emplace(appPackageName, shard.appIds.size()).first;
+    }
+
+    GpuStatsAppInfo appInfo;
+    addLoadingTime(driver, driverLoadingTime, &appInfo);
+    appInfo.appPackageName = appPackageName;
+    appInfo.driverVersionCode = driverVersionCode;
+    shard.appStats.emplace(AppKey{idIt->second, driverVersionCode}, std::move(appInfo));
 }
 
 void GpuStats::insertTargetStats(const std::string& appPackageName,
@@ -143,47 +175,92 @@ void GpuStats::insertTargetStats(const std::string& appPackageName,
                                  const uint64_t /*value*/) {
     ATRACE_CALL();
 
-    const std::string appStatsKey = appPackageName + std::to_string(driverVersionCode);
-
-    std::lock_guard<std::mutex> lock(mLock);
     registerStatsdCallbacksIfNeeded();
-    if (!mAppStats.count(appStatsKey)) {
+
+    Shard& shard = shardFor(appPackageName);
+    std::lock_guard<std::mutex> lock(shard.lock);
+
+    auto idIt = shard.appIds.find(appPackageName);
+    if (idIt == shard.appIds.end()) {
+        return;
+    }
+    auto appIt = shard.appStats.find({idIt->second, driverVersionCode});
+    if (appIt == shard.appStats.end()) {
         return;
     }
 
     switch (stats) {
         case GpuStatsInfo::Stats::CPU_VULKAN_IN_USE:
-            mAppStats[appStatsKey].cpuVulkanInUse = true;
+            appIt->second.cpuVulkanInUse = true;
             break;
         case GpuStatsInfo::Stats::FALSE_PREROTATION:
-            mAppStats[appStatsKey].falsePrerotation = true;
+            appIt->second.falsePrerotation = true;
             break;
         case GpuStatsInfo::Stats::GLES_1_IN_USE:
-            mAppStats[appStatsKey].gles1InUse = true;
+            appIt->second.gles1InUse = true;
             break;
         default:
             break;
     }
 }
 
-void GpuStats::interceptSystemDriverStatsLocked() {
-    // Append cpuVulkanVersion and glesVersion to system driver stats
-    if (!mGlobalStats.count(0) || mGlobalStats[0].glesVersion) {
-        return;
-    }
-
-    mGlobalStats[0].cpuVulkanVersion = property_get_int32("ro.cpuvulkan.version", 0);
-    mGlobalStats[0].glesVersion = property_get_int32("ro.opengles.version", 0);
-}
-
 void GpuStats::registerStatsdCallbacksIfNeeded() {
-    if (!mStatsdRegistered) {
+    std::call_once(mStatsdRegisterOnce, [this] {
         AStatsManager_setPullAtomCallback(android::util::GPU_STATS_GLOBAL_INFO, nullptr,
                                          GpuStats::pullAtomCallback, this);
         AStatsManager_setPullAtomCallback(android::util::GPU_STATS_APP_INFO, nullptr,
                                          GpuStats::pullAtomCallback, this);
         mStatsdRegistered = true;
+    });
+}
+
+std::unordered_map<uint64_t, GpuStatsGlobalInfo> GpuStats::collectGlobalStats(bool clear) {
+    std::unordered_map<uint64_t, GpuStatsGlobalInfo> globalStats;
+    for (Shard& shard : mShards) {
+        std::lock_guard<std::mutex> lock(shard.lock);
+        for (const auto& [driverVersionCode, info] : shard.globalStats) {
+            auto [it, inserted] = globalStats.emplace(driverVersionCode, info);
+            if (!inserted) {
+                mergeGlobalInfo(info, &it->second);
+            }
+        }
+        if (clear) {
+            shard.globalStats.clear();
+        }
+    }
+
+    // Append cpuVulkanVersion and glesVersion to system driver stats
+    auto systemIt = globalStats.find(0);
+    if (systemIt != globalStats.end()) {
+        systemIt->second.cpuVulkanVersion = property_get_int32("ro.cpuvulkan.version", 0);
+        systemIt->second.glesVersion = property_get_int32("ro.opengles.version", 0);
     }
+
+    return globalStats;
+}
+
+void GpuStats::clearAppStatsLocked(Shard& shard) {
+    mNumAppRecords -= shard.appStats.size();
+    shard.appStats.clear();
+    shard.appIds.clear();
+}
+
+std::vector<GpuStatsAppInfo> GpuStats::collectAppStats(bool clear) {
+    std::vector<GpuStatsAppInfo> appStats;
+    for (Shard& shard : mShards) {
+        std::lock_guard<std::mutex> lock(shard.lock);
+        if (clear) {
+            for (auto& ele : shard.appStats) {
+                appStats.emplace_back(std::move(ele.second));
+            }
+            clearAppStatsLocked(shard);
+        } else {
+            for (const auto& ele : shard.appStats) {
+                appStats.emplace_back(ele.second);
+            }
+        }
+    }
+    return appStats;
 }
 
 void GpuStats::dump(const Vector<String16>& args, std::string* result) {
@@ -194,7 +271,6 @@ void GpuStats::dump(const Vector<String16>& args, std::string* result) {
         return;
     }
 
-    std::lock_guard<std::mutex> lock(mLock);
     bool dumpAll = true;
 
     std::unordered_set<std::string> argsSet;
@@ -204,57 +280,62 @@ void GpuStats::dump(const Vector<String16>& args, std::string* result) {
 
     const bool dumpGlobal = argsSet.count("--global") != 0;
     if (dumpGlobal) {
-        dumpGlobalLocked(result);
+        this->dumpGlobal(result);
         dumpAll = false;
     }
 
     const bool dumpApp = argsSet.count("--app") != 0;
     if (dumpApp) {
-        dumpAppLocked(result);
+        this->dumpApp(result);
+        dumpAll = false;
+    }
+
+    if (argsSet.count("--metrics")) {
+        dumpMetrics(result);
         dumpAll = false;
     }
 
     if (dumpAll) {
-        dumpGlobalLocked(result);
-        dumpAppLocked(result);
+        this->dumpGlobal(result);
+        this->dumpApp(result);
     }
 
     if (argsSet.count("--clear")) {
-        bool clearAll = true;
-
-        if (dumpGlobal) {
-            mGlobalStats.clear();
-            clearAll = false;
-        }
+        const bool clearAll = !dumpGlobal && !dumpApp;
 
-        if (dumpApp) {
-            mAppStats.clear();
-            clearAll = false;
-        }
-
-        if (clearAll) {
-            mGlobalStats.clear();
-            mAppStats.clear();
+        for (Shard& shard : mShards) {
+            std::lock_guard<std::mutex> lock(shard.lock);
+            if (dumpGlobal || clearAll) {
+                shard.globalStats.clear();
+            }
+            if (dumpApp || clearAll) {
+                clearAppStatsLocked(shard);
+            }
         }
     }
 }
 
-void GpuStats::dumpGlobalLocked(std::string* result) {
-    interceptSystemDriverStatsLocked();
-
-    for (const auto& ele : mGlobalStats) {
+void GpuStats::dumpGlobal(std::string* result) {
+    for (const auto& ele : collectGlobalStats(false)) {
         result->append(ele.second.toString());
         result->append("\n");
     }
 }
 
-void GpuStats::dumpAppLocked(std::string* result) {
-    for (const auto& ele : mAppStats) {
-        result->append(ele.second.toString());
+void GpuStats::dumpApp(std::string* result) {
+    for (const auto& ele : collectAppStats(false)) {
+        result->append(ele.toString());
         result->append("\n");
     }
 }
 
+void GpuStats::dumpMetrics(std::string* result) {
+    result->append("appRecords = " + std::to_string(mNumAppRecords.load()) + "/" +
+                   std::to_string(MAX_NUM_APP_RECORDS) + "\n");
+    result->append("droppedAppRecords = " + std::to_string(mDroppedAppRecords.load()) + "\n");
+    result->append("droppedLoadingTimes = " + std::to_string(mDroppedLoadingTimes.load()) + "\n");
+}
+
 static std::string protoOutputStreamToByteString(android::util::ProtoOutputStream& proto) {
     if (!proto.size()) return "";
 
@@ -287,45 +368,43 @@ static std::string int64VectorToProtoByteString(const std::vector<int64_t>& valu
 AStatsManager_PullAtomCallbackReturn GpuStats::pullAppInfoAtom(AStatsEventList* data) {
     ATRACE_CALL();
 
-    std::lock_guard<std::mutex> lock(mLock);
+    // Take the records out of the shards first so that reporters aren't blocked while the
+    // atoms are being built.
+    const std::vector<GpuStatsAppInfo> appStats = collectAppStats(true);
 
     if (data) {
-        for (const auto& ele : mAppStats) {
+        for (const auto& ele : appStats) {
             AStatsEvent* event = AStatsEventList_addStatsEvent(data);
             AStatsEvent_setAtomId(event, android::util::GPU_STATS_APP_INFO);
-            AStatsEvent_writeString(event, ele.second.appPackageName.c_str());
-            AStatsEvent_writeInt64(event, ele.second.driverVersionCode);
+            AStatsEvent_writeString(event, ele.appPackageName.c_str());
+            AStatsEvent_writeInt64(event, ele.driverVersionCode);
 
-            std::string bytes = int64VectorToProtoByteString(ele.second.glDriverLoadingTime);
+            std::string bytes = int64VectorToProtoByteString(ele.glDriverLoadingTime);
             AStatsEvent_writeByteArray(event, (const uint8_t*)bytes.c_str(), bytes.length());
 
-            bytes = int64VectorToProtoByteString(ele.second.vkDriverLoadingTime);
+            bytes = int64VectorToProtoByteString(ele.vkDriverLoadingTime);
             AStatsEvent_writeByteArray(event, (const uint8_t*)bytes.c_str(), bytes.length());
 
-            bytes = int64VectorToProtoByteString(ele.second.angleDriverLoadingTime);
+            bytes = int64VectorToProtoByteString(ele.angleDriverLoadingTime);
             AStatsEvent_writeByteArray(event, (const uint8_t*)bytes.c_str(), bytes.length());
 
-            AStatsEvent_writeBool(event, ele.second.cpuVulkanInUse);
-            AStatsEvent_writeBool(event, ele.second.falsePrerotation);
-            AStatsEvent_writeBool(event, ele.second.gles1InUse);
+            AStatsEvent_writeBool(event, ele.cpuVulkanInUse);
+            AStatsEvent_writeBool(event, ele.falsePrerotation);
+            AStatsEvent_writeBool(event, ele.gles1InUse);
             AStatsEvent_build(event);
         }
     }
 
-    mAppStats.clear();
-
     return AStatsManager_PULL_SUCCESS;
 }
 
 AStatsManager_PullAtomCallbackReturn GpuStats::pullGlobalInfoAtom(AStatsEventList* data) {
     ATRACE_CALL();
 
-    std::lock_guard<std::mutex> lock(mLock);
-    // flush cpuVulkanVersion and glesVersion to builtin driver stats
-    interceptSystemDriverStatsLocked();
+    const std::unordered_map<uint64_t, GpuStatsGlobalInfo> globalStats = collectGlobalStats(true);
 
     if (data) {
-        for (const auto& ele : mGlobalStats) {
+        for (const auto& ele : globalStats) {
             AStatsEvent* event = AStatsEventList_addStatsEvent(data);
             AStatsEvent_setAtomId(event, android::util::GPU_STATS_GLOBAL_INFO);
             AStatsEvent_writeString(event, ele.second.driverPackageName.c_str());
@@ -345,8 +424,6 @@ AStatsManager_PullAtomCallbackReturn GpuStats::pullGlobalInfoAtom(AStatsEventLis
         }
     }
 
-    mGlobalStats.clear();
-
     return AStatsManager_PULL_SUCCESS;
 }
 
@@ -17,11 +17,14 @@
 #pragma once
 
 #include <graphicsenv/GpuStatsInfo.h>
+#include <android-base/thread_annotations.h>
 #include <graphicsenv/GraphicsEnv.h>
 #include <stats_pull_atom_callback.h>
 #include <utils/String16.h>
 #include <utils/Vector.h>
 
+#include <array>
+#include <atomic>
 #include <mutex>
 #include <unordered_map>
 #include <vector>
@@ -46,6 +49,9 @@ public:
 
     // This limits the worst case number of loading times tracked.
     static const size_t MAX_NUM_LOADING_TIMES = 50;
+    // Stats are spread across this many independently locked shards, selected by app package
+    // name, so that concurrent reports from different apps rarely contend.
+    static const size_t NUM_SHARDS = 8;
 
 private:
     // Friend class for testing.
@@ -60,25 +66,60 @@ private:
     // Pull app into into app atom.
     AStatsManager_PullAtomCallbackReturn pullAppInfoAtom(AStatsEventList* data);
     // Dump global stats
-    void dumpGlobalLocked(std::string* result);
+    void dumpGlobal(std::string* result);
     // Dump app stats
-    void dumpAppLocked(std::string* result);
-    // Append cpuVulkanVersion and glesVersion to system driver stats
-    void interceptSystemDriverStatsLocked();
+    void dumpApp(std::string* result);
+    // Dump retention metrics
+    void dumpMetrics(std::string* result);
     // Registers statsd callbacks if they have not already been registered
     void registerStatsdCallbacksIfNeeded();
 
+    // Key of an app record. appId is the package name interned in the owning shard.
+    struct AppKey {
+        uint32_t appId;
+        uint64_t driverVersionCode;
+
+        bool operator==(const AppKey& other) const {
+            return appId == other.appId && driverVersionCode == other.driverVersionCode;
+        }
+    };
+
+    struct AppKeyHash {
+        size_t operator()(const AppKey& key) const {
+            return std::hash<uint64_t>()(key.driverVersionCode) * 31 + key.appId;
+        }
+    };
+
+    struct Shard {
+        std::mutex lock;
+        // Interned app package names, valid until the app stats are cleared.
+        std::unordered_map<std::string, uint32_t> appIds GUARDED_BY(lock);
+        // Partial global stats of the apps in this shard, keyed by driver version code.
+        std::unordered_map<uint64_t, GpuStatsGlobalInfo> globalStats GUARDED_BY(lock);
+        std::unordered_map<AppKey, GpuStatsAppInfo, AppKeyHash> appStats GUARDED_BY(lock);
+    };
+
+    Shard& shardFor(const std::string& appPackageName);
+    // Merge the partial global stats of all shards, optionally clearing them.
+    std::unordered_map<uint64_t, GpuStatsGlobalInfo> collectGlobalStats(bool clear);
+    // Gather the app stats of all shards, optionally clearing them.
+    std::vector<GpuStatsAppInfo> collectAppStats(bool clear);
+    // Clear the app stats and interned package names of one shard.
+    void clearAppStatsLocked(Shard& shard) REQUIRES(shard.lock);
+
     // Below limits the memory usage of GpuStats to be less than 10KB. This is
     // the preferred number for statsd while maintaining nice data quality.
     static const size_t MAX_NUM_APP_RECORDS = 100;
-    // GpuStats access should be guarded by mLock.
-    std::mutex mLock;
+    std::array<Shard, NUM_SHARDS> mShards;
+    // Number of app records across all shards, bounded by MAX_NUM_APP_RECORDS.
+    std::atomic<size_t> mNumAppRecords = 0;
+    // Reports dropped because of the bounds above, since boot.
+    std::atomic<uint64_t> mDroppedAppRecords = 0;
+    std::atomic<uint64_t> mDroppedLoadingTimes = 0;
+    // Serializes statsd callback registration.
+    std::once_flag mStatsdRegisterOnce;
     // True if statsd callbacks have been registered.
-    bool mStatsdRegistered = false;
-    // Key is driver version code.
-    std::unordered_map<uint64_t, GpuStatsGlobalInfo> mGlobalStats;
-    // Key is <app package name>+<driver version code>.
-    std::unordered_map<std::string, GpuStatsAppInfo> mAppStats;
+    std::atomic<bool> mStatsdRegistered = false;
 };
 
 } // namespace android
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <gpustats/GpuStats.h>
+
+#include <string>
+#include <vector>
+
+namespace android {
+namespace {
+
+constexpr int kNumApps = 64;
+
+// Inserting stats registers statsd pull callbacks with the GpuStats as cookie. Clearing
+// them in ~GpuStats() does not wait for a pull that statsd already started, so like in
+// gpuservice the instance lives as long as the process. Stats of the few apps above are
+// bounded, so reusing it across benchmarks doesn't change what is measured.
+GpuStats* gpuStats() {
+    static GpuStats* stats = new GpuStats();
+    return stats;
+}
+
+const std::vector<std::string>& appPackageNames() {
+    static const std::vector<std::string> names = [] {
+        std::vector<std::string> names;
+        for (int i = 0; i < kNumApps; i++) {
+            names.emplace_back("com.example.app" + std::to_string(i));
+        }
+        return names;
+    }();
+    return names;
+}
+
+// Every thread reports driver and target stats for its own slice of apps, the way
+// many apps starting up concurrently would.
+void BM_insertDriverAndTargetStats(benchmark::State& state) {
+    GpuStats* const stats = gpuStats();
+    const auto& names = appPackageNames();
+    size_t app = state.thread_index;
+    for (auto _ : state) {
+        const std::string& appPackageName = names[app % names.size()];
+        stats->insertDriverStats("system", "0", 0, 123, appPackageName, 345,
+                                 GpuStatsInfo::Driver::VULKAN, true, 678);
+        stats->insertTargetStats(appPackageName, 0, GpuStatsInfo::Stats::CPU_VULKAN_IN_USE, 0);
+        app += state.threads;
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_insertDriverAndTargetStats)->ThreadRange(1, 16)->UseRealTime();
+
+void BM_dumpWhileInserting(benchmark::State& state) {
+    GpuStats* const stats = gpuStats();
+    const auto& names = appPackageNames();
+    size_t app = state.thread_index;
+    for (auto _ : state) {
+        if (state.thread_index == 0) {
+            std::string result;
+            stats->dump(Vector<String16>(), &result);
+            benchmark::DoNotOptimize(result);
+        } else {
+            stats->insertDriverStats("system", "0", 0, 123, names[app % names.size()], 345,
+                                     GpuStatsInfo::Driver::GL, true, 678);
+            app += state.threads;
+        }
+    }
+}
+BENCHMARK(BM_dumpWhileInserting)->ThreadRange(2, 16)->UseRealTime();
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
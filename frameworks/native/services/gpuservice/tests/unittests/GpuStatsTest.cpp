@@ -26,6 +26,9 @@
 #include <utils/String16.h>
 #include <utils/Vector.h>
 
+#include <thread>
+#include <vector>
+
 #include "TestableGpuStats.h"
 
 namespace android {
@@ -56,6 +59,7 @@ enum InputCommand : int32_t {
     DUMP_ALL_THEN_CLEAR    = 3,
     DUMP_GLOBAL_THEN_CLEAR = 4,
     DUMP_APP_THEN_CLEAR    = 5,
+    DUMP_METRICS           = 6,
 };
 // clang-format on
 
@@ -109,6 +113,9 @@ std::string GpuStatsTest::inputCommand(InputCommand cmd) {
             args.push_back(String16("--app"));
             args.push_back(String16("--clear"));
             break;
+        case InputCommand::DUMP_METRICS:
+            args.push_back(String16("--metrics"));
+            break;
     }
 
     mGpuStats->dump(args, &result);
@@ -303,5 +310,67 @@ TEST_F(GpuStatsTest, canPullAppAtom) {
     EXPECT_TRUE(inputCommand(InputCommand::DUMP_APP).empty());
 }
 
+TEST_F(GpuStatsTest, canMergeGlobalStatsAcrossApps) {
+    mGpuStats->insertDriverStats(BUILTIN_DRIVER_PKG_NAME, BUILTIN_DRIVER_VER_NAME,
+                                 BUILTIN_DRIVER_VER_CODE, BUILTIN_DRIVER_BUILD_TIME, APP_PKG_NAME_1,
+                                 VULKAN_VERSION, GpuStatsInfo::Driver::GL, true,
+                                 DRIVER_LOADING_TIME_1);
+    mGpuStats->insertDriverStats(BUILTIN_DRIVER_PKG_NAME, BUILTIN_DRIVER_VER_NAME,
+                                 BUILTIN_DRIVER_VER_CODE, BUILTIN_DRIVER_BUILD_TIME, APP_PKG_NAME_2,
+                                 VULKAN_VERSION, GpuStatsInfo::Driver::GL, false,
+                                 DRIVER_LOADING_TIME_2);
+
+    EXPECT_THAT(inputCommand(InputCommand::DUMP_GLOBAL), HasSubstr("glLoadingCount = 2"));
+    EXPECT_THAT(inputCommand(InputCommand::DUMP_GLOBAL), HasSubstr("glLoadingFailureCount = 1"));
+}
+
+TEST_F(GpuStatsTest, canInsertConcurrently) {
+    constexpr int kThreads = 8;
+    constexpr int kReportsPerThread = 1000;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; i++) {
+        threads.emplace_back([this, i] {
+            const std::string appPackageName = "app" + std::to_string(i);
+            for (int j = 0; j < kReportsPerThread; j++) {
+                mGpuStats->insertDriverStats(BUILTIN_DRIVER_PKG_NAME, BUILTIN_DRIVER_VER_NAME,
+                                             BUILTIN_DRIVER_VER_CODE, BUILTIN_DRIVER_BUILD_TIME,
+                                             appPackageName, VULKAN_VERSION,
+                                             GpuStatsInfo::Driver::VULKAN, true,
+                                             DRIVER_LOADING_TIME_1);
+                mGpuStats->insertTargetStats(appPackageName, BUILTIN_DRIVER_VER_CODE,
+                                             GpuStatsInfo::Stats::CPU_VULKAN_IN_USE, 0);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    const std::string expectedResult =
+            "vkLoadingCount = " + std::to_string(kThreads * kReportsPerThread);
+    EXPECT_THAT(inputCommand(InputCommand::DUMP_GLOBAL), HasSubstr(expectedResult));
+    EXPECT_THAT(inputCommand(InputCommand::DUMP_METRICS),
+                HasSubstr("appRecords = " + std::to_string(kThreads) + "/"));
+}
+
+TEST_F(GpuStatsTest, appRecordsAreBounded) {
+    for (int i = 0; i < 200; i++) {
+        mGpuStats->insertDriverStats(BUILTIN_DRIVER_PKG_NAME, BUILTIN_DRIVER_VER_NAME,
+                                     BUILTIN_DRIVER_VER_CODE, BUILTIN_DRIVER_BUILD_TIME,
+                                     "app" + std::to_string(i), VULKAN_VERSION,
+                                     GpuStatsInfo::Driver::GL, true, DRIVER_LOADING_TIME_1);
+    }
+
+    EXPECT_THAT(inputCommand(InputCommand::DUMP_METRICS), HasSubstr("appRecords = 100/100"));
+    EXPECT_THAT(inputCommand(InputCommand::DUMP_METRICS), HasSubstr("droppedAppRecords = 100"));
+
+    // Pulling releases the records, so new apps can be tracked again.
+    TestableGpuStats testableGpuStats(mGpuStats.get());
+    EXPECT_TRUE(testableGpuStats.makePullAtomCallback(android::util::GPU_STATS_APP_INFO) ==
+                AStatsManager_PULL_SUCCESS);
+    EXPECT_THAT(inputCommand(InputCommand::DUMP_METRICS), HasSubstr("appRecords = 0/100"));
+}
+
 } // namespace
 } // namespace android
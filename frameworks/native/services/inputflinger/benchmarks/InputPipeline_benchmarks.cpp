@@ -0,0 +1,473 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Measures the whole input pipeline for a touchscreen: events from a fake EventHub go through the
+ * real InputReader, MultiTouchInputMapper, InputClassifier and InputDispatcher, and are read back
+ * from the InputPublisher of a window.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <binder/Binder.h>
+#include <input/PropertyMap.h>
+#include <linux/input.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#include "../InputClassifier.h"
+#include "../dispatcher/InputDispatcher.h"
+#include "../reader/include/EventHub.h"
+#include "../reader/include/InputReader.h"
+
+namespace android {
+
+using namespace inputdispatcher;
+
+// An arbitrary event hub device id.
+static const int32_t EVENTHUB_ID = 1;
+
+static const int32_t DISPLAY_WIDTH = 1080;
+static const int32_t DISPLAY_HEIGHT = 2340;
+static const int32_t MAX_SLOTS = 10;
+
+static constexpr std::chrono::nanoseconds DISPATCHING_TIMEOUT = 5s;
+
+static nsecs_t now() {
+    return systemTime(SYSTEM_TIME_MONOTONIC);
+}
+
+// --- FakeEventHub ---
+
+/**
+ * A multi-touch touchscreen. getEvents() blocks until the benchmark queues a frame of events,
+ * like the real EventHub blocks on the device.
+ */
+class FakeEventHub : public EventHubInterface {
+public:
+    FakeEventHub() {
+        mConfiguration.addProperty(String8("touch.deviceType"), String8("touchScreen"));
+
+        RawEvent added{};
+        added.deviceId = EVENTHUB_ID;
+        added.type = DEVICE_ADDED;
+        RawEvent scanned{};
+        scanned.type = FINISHED_DEVICE_SCAN;
+        mEvents.push_back(added);
+        mEvents.push_back(scanned);
+    }
+
+    void enqueueFrame(const std::vector<RawEvent>& frame) {
+        std::scoped_lock lock(mLock);
+        mEvents.insert(mEvents.end(), frame.begin(), frame.end());
+        mCondition.notify_all();
+    }
+
+private:
+    size_t getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSize) override {
+        std::unique_lock lock(mLock);
+        auto ready = [this] { return !mEvents.empty() || mAwoken; };
+        if (timeoutMillis < 0) {
+            mCondition.wait(lock, ready);
+        } else {
+            mCondition.wait_for(lock, std::chrono::milliseconds(timeoutMillis), ready);
+        }
+        mAwoken = false;
+
+        const nsecs_t readTime = now();
+        size_t count = 0;
+        while (count < bufferSize && !mEvents.empty()) {
+            buffer[count] = mEvents.front();
+            buffer[count].readTime = readTime;
+            mEvents.pop_front();
+            count++;
+        }
+        return count;
+    }
+
+    void wake() override {
+        std::scoped_lock lock(mLock);
+        mAwoken = true;
+        mCondition.notify_all();
+    }
+
+    uint32_t getDeviceClasses(int32_t) const override {
+        return INPUT_DEVICE_CLASS_TOUCH | INPUT_DEVICE_CLASS_TOUCH_MT;
+    }
+
+    InputDeviceIdentifier getDeviceIdentifier(int32_t) const override {
+        InputDeviceIdentifier identifier;
+        identifier.name = "Fake touchscreen";
+        identifier.location = "fake";
+        return identifier;
+    }
+
+    int32_t getDeviceControllerNumber(int32_t) const override { return 0; }
+
+    void getConfiguration(int32_t, PropertyMap* outConfiguration) const override {
+        *outConfiguration = mConfiguration;
+    }
+
+    status_t getAbsoluteAxisInfo(int32_t, int axis,
+                                 RawAbsoluteAxisInfo* outAxisInfo) const override {
+        outAxisInfo->clear();
+        switch (axis) {
+            case ABS_MT_POSITION_X:
+                outAxisInfo->maxValue = DISPLAY_WIDTH - 1;
+                break;
+            case ABS_MT_POSITION_Y:
+                outAxisInfo->maxValue = DISPLAY_HEIGHT - 1;
+                break;
+            case ABS_MT_PRESSURE:
+                outAxisInfo->maxValue = 255;
+                break;
+            case ABS_MT_TRACKING_ID:
+                outAxisInfo->maxValue = 65535;
+                break;
+            case ABS_MT_SLOT:
+                outAxisInfo->maxValue = MAX_SLOTS - 1;
+                break;
+            default:
+                return -1;
+        }
+        outAxisInfo->valid = true;
+        return OK;
+    }
+
+    bool hasRelativeAxis(int32_t, int) const override { return false; }
+    bool hasInputProperty(int32_t, int property) const override {
+        return property == INPUT_PROP_DIRECT;
+    }
+    status_t mapKey(int32_t, int32_t, int32_t, int32_t, int32_t*, int32_t*,
+                    uint32_t*) const override {
+        return NAME_NOT_FOUND;
+    }
+    status_t mapAxis(int32_t, int32_t, AxisInfo*) const override { return NAME_NOT_FOUND; }
+    void setExcludedDevices(const std::vector<std::string>&) override {}
+    std::vector<TouchVideoFrame> getVideoFrames(int32_t) override { return {}; }
+    int32_t getScanCodeState(int32_t, int32_t) const override { return AKEY_STATE_UNKNOWN; }
+    int32_t getKeyCodeState(int32_t, int32_t) const override { return AKEY_STATE_UNKNOWN; }
+    int32_t getSwitchState(int32_t, int32_t) const override { return AKEY_STATE_UNKNOWN; }
+    status_t getAbsoluteAxisValue(int32_t, int32_t, int32_t* outValue) const override {
+        *outValue = 0;
+        return OK;
+    }
+    bool markSupportedKeyCodes(int32_t, size_t, const int32_t*, uint8_t*) const override {
+        return false;
+    }
+    bool hasScanCode(int32_t, int32_t) const override { return false; }
+    bool hasLed(int32_t, int32_t) const override { return false; }
+    void setLedState(int32_t, int32_t, bool) override {}
+    void getVirtualKeyDefinitions(int32_t, std::vector<VirtualKeyDefinition>&) const override {}
+    sp<KeyCharacterMap> getKeyCharacterMap(int32_t) const override { return nullptr; }
+    bool setKeyboardLayoutOverlay(int32_t, const sp<KeyCharacterMap>&) override { return false; }
+    void vibrate(int32_t, nsecs_t) override {}
+    void cancelVibrate(int32_t) override {}
+    void requestReopenDevices() override {}
+    void dump(std::string&) override {}
+    void monitor() override {}
+    bool isDeviceEnabled(int32_t) override { return true; }
+    status_t enableDevice(int32_t) override { return OK; }
+    status_t disableDevice(int32_t) override { return OK; }
+
+    PropertyMap mConfiguration;
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    std::deque<RawEvent> mEvents;
+    bool mAwoken = false;
+};
+
+// --- FakeInputReaderPolicy ---
+
+class FakeInputReaderPolicy : public InputReaderPolicyInterface {
+public:
+    FakeInputReaderPolicy() {
+        DisplayViewport v;
+        v.displayId = ADISPLAY_ID_DEFAULT;
+        v.orientation = DISPLAY_ORIENTATION_0;
+        v.logicalRight = v.physicalRight = v.deviceWidth = DISPLAY_WIDTH;
+        v.logicalBottom = v.physicalBottom = v.deviceHeight = DISPLAY_HEIGHT;
+        v.isActive = true;
+        v.uniqueId = "local:0";
+        v.type = ViewportType::VIEWPORT_INTERNAL;
+        mConfig.setDisplayViewports({v});
+    }
+
+private:
+    void getReaderConfiguration(InputReaderConfiguration* outConfig) override {
+        *outConfig = mConfig;
+    }
+    std::shared_ptr<PointerControllerInterface> obtainPointerController(int32_t) override {
+        return nullptr;
+    }
+    void notifyInputDevicesChanged(const std::vector<InputDeviceInfo>&) override {}
+    sp<KeyCharacterMap> getKeyboardLayoutOverlay(const InputDeviceIdentifier&) override {
+        return nullptr;
+    }
+    std::string getDeviceAlias(const InputDeviceIdentifier&) override { return ""; }
+    TouchAffineTransformation getTouchAffineTransformation(const std::string&,
+                                                           int32_t) override {
+        return TouchAffineTransformation();
+    }
+
+    InputReaderConfiguration mConfig;
+};
+
+// --- FakeInputDispatcherPolicy ---
+
+class FakeInputDispatcherPolicy : public InputDispatcherPolicyInterface {
+private:
+    void notifyConfigurationChanged(nsecs_t) override {}
+    nsecs_t notifyAnr(const sp<InputApplicationHandle>&, const sp<IBinder>&,
+                      const std::string& name) override {
+        ALOGE("The window is not responding : %s", name.c_str());
+        return 0;
+    }
+    void notifyInputChannelBroken(const sp<IBinder>&) override {}
+    void notifyFocusChanged(const sp<IBinder>&, const sp<IBinder>&) override {}
+    void getDispatcherConfiguration(InputDispatcherConfiguration* outConfig) override {
+        *outConfig = mConfig;
+    }
+    bool filterInputEvent(const InputEvent*, uint32_t) override { return true; }
+    void interceptKeyBeforeQueueing(const KeyEvent*, uint32_t&) override {}
+    // Like the window manager, let touches through to the application.
+    void interceptMotionBeforeQueueing(int32_t, nsecs_t, uint32_t& policyFlags) override {
+        policyFlags |= POLICY_FLAG_PASS_TO_USER;
+    }
+    nsecs_t interceptKeyBeforeDispatching(const sp<IBinder>&, const KeyEvent*,
+                                          uint32_t) override {
+        return 0;
+    }
+    bool dispatchUnhandledKey(const sp<IBinder>&, const KeyEvent*, uint32_t,
+                              KeyEvent*) override {
+        return false;
+    }
+    void notifySwitch(nsecs_t, uint32_t, uint32_t, uint32_t) override {}
+    void pokeUserActivity(nsecs_t, int32_t) override {}
+    bool checkInjectEventsPermissionNonReentrant(int32_t, int32_t) override { return false; }
+    void onPointerDownOutsideFocus(const sp<IBinder>&) override {}
+
+    InputDispatcherConfiguration mConfig;
+};
+
+class FakeApplicationHandle : public InputApplicationHandle {
+public:
+    bool updateInfo() override {
+        mInfo.dispatchingTimeout = DISPATCHING_TIMEOUT.count();
+        return true;
+    }
+};
+
+// --- FakeWindowHandle ---
+
+/**
+ * A window that covers the whole display and receives the touches.
+ */
+class FakeWindowHandle : public InputWindowHandle {
+public:
+    FakeWindowHandle(const sp<InputApplicationHandle>& application,
+                     const sp<InputDispatcher>& dispatcher) {
+        InputChannel::openInputChannelPair("Fake Window", mServerChannel, mClientChannel);
+        mConsumer = std::make_unique<InputConsumer>(mClientChannel);
+        dispatcher->registerInputChannel(mServerChannel);
+        application->updateInfo();
+        mInfo.applicationInfo = *application->getInfo();
+    }
+
+    bool updateInfo() override {
+        mInfo.token = mServerChannel->getConnectionToken();
+        mInfo.name = "FakeWindowHandle";
+        mInfo.layoutParamsType = InputWindowInfo::TYPE_APPLICATION;
+        mInfo.dispatchingTimeout = DISPATCHING_TIMEOUT.count();
+        mInfo.frameRight = DISPLAY_WIDTH;
+        mInfo.frameBottom = DISPLAY_HEIGHT;
+        mInfo.globalScaleFactor = 1.0;
+        mInfo.touchableRegion.clear();
+        mInfo.addTouchableRegion(Rect(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT));
+        mInfo.visible = true;
+        mInfo.canReceiveKeys = true;
+        mInfo.hasFocus = true;
+        mInfo.displayId = ADISPLAY_ID_DEFAULT;
+        return true;
+    }
+
+    // Waits for the next event, like the application's Choreographer would, and finishes it.
+    bool consumeEvent() {
+        uint32_t seq;
+        InputEvent* event;
+        const nsecs_t deadline = now() + ms2ns(100);
+        status_t result;
+        do {
+            result = mConsumer->consume(&mEventFactory, true /*consumeBatches*/, -1, &seq, &event);
+        } while (result == WOULD_BLOCK && now() < deadline);
+        if (result != OK) {
+            ALOGE("Received result = %d from consume()", result);
+            return false;
+        }
+        mConsumer->sendFinishedSignal(seq, true);
+        return true;
+    }
+
+private:
+    sp<InputChannel> mServerChannel, mClientChannel;
+    std::unique_ptr<InputConsumer> mConsumer;
+    PreallocatedInputEventFactory mEventFactory;
+};
+
+// --- Touch traces ---
+
+static RawEvent rawEvent(nsecs_t when, int32_t type, int32_t code, int32_t value) {
+    RawEvent event{};
+    event.when = when;
+    event.deviceId = EVENTHUB_ID;
+    event.type = type;
+    event.code = code;
+    event.value = value;
+    return event;
+}
+
+/**
+ * Generates the frames of a gesture as a touchscreen driver reports it with protocol B:
+ * the fingers go down one after the other, move together for a while, and go up again.
+ * Every frame ends with a SYN_REPORT and yields exactly one motion event, so that the
+ * benchmark can wait for each of them.
+ */
+static std::vector<std::vector<RawEvent>> generateGesture(int32_t fingerCount) {
+    static const int32_t MOVES = 120;
+    std::vector<std::vector<RawEvent>> frames;
+    int32_t x[MAX_SLOTS], y[MAX_SLOTS];
+    int32_t nextTrackingId = 1;
+
+    auto writeFinger = [&](std::vector<RawEvent>& frame, int32_t slot) {
+        frame.push_back(rawEvent(0, EV_ABS, ABS_MT_SLOT, slot));
+        frame.push_back(rawEvent(0, EV_ABS, ABS_MT_POSITION_X, x[slot]));
+        frame.push_back(rawEvent(0, EV_ABS, ABS_MT_POSITION_Y, y[slot]));
+        frame.push_back(rawEvent(0, EV_ABS, ABS_MT_PRESSURE, 40 + slot));
+    };
+    auto sync = [](std::vector<RawEvent>& frame) {
+        frame.push_back(rawEvent(0, EV_SYN, SYN_REPORT, 0));
+    };
+
+    for (int32_t slot = 0; slot < fingerCount; slot++) {
+        x[slot] = DISPLAY_WIDTH / 4 + slot * 50;
+        y[slot] = DISPLAY_HEIGHT / 4 + slot * 80;
+        std::vector<RawEvent> frame;
+        frame.push_back(rawEvent(0, EV_ABS, ABS_MT_SLOT, slot));
+        frame.push_back(rawEvent(0, EV_ABS, ABS_MT_TRACKING_ID, nextTrackingId++));
+        writeFinger(frame, slot);
+        sync(frame);
+        frames.push_back(std::move(frame));
+    }
+    for (int32_t i = 0; i < MOVES; i++) {
+        std::vector<RawEvent> frame;
+        for (int32_t slot = 0; slot < fingerCount; slot++) {
+            // Spread the fingers apart along a diagonal, as in a zoom gesture.
+            x[slot] += 1 + slot;
+            y[slot] += 2 + slot;
+            writeFinger(frame, slot);
+        }
+        sync(frame);
+        frames.push_back(std::move(frame));
+    }
+    for (int32_t slot = fingerCount - 1; slot >= 0; slot--) {
+        std::vector<RawEvent> frame;
+        frame.push_back(rawEvent(0, EV_ABS, ABS_MT_SLOT, slot));
+        frame.push_back(rawEvent(0, EV_ABS, ABS_MT_TRACKING_ID, -1));
+        sync(frame);
+        frames.push_back(std::move(frame));
+    }
+    return frames;
+}
+
+// --- InputPipeline ---
+
+class InputPipeline {
+public:
+    InputPipeline() {
+        mDispatcher = new InputDispatcher(new FakeInputDispatcherPolicy());
+        mDispatcher->setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+        mClassifier = new InputClassifier(mDispatcher);
+        mEventHub = std::make_shared<FakeEventHub>();
+        mReader = std::make_unique<InputReader>(mEventHub, new FakeInputReaderPolicy(),
+                                                mClassifier);
+
+        sp<FakeApplicationHandle> application = new FakeApplicationHandle();
+        mWindow = new FakeWindowHandle(application, mDispatcher);
+        mDispatcher->setInputWindows({{ADISPLAY_ID_DEFAULT, {mWindow}}});
+
+        mDispatcher->start();
+        mReader->start();
+    }
+
+    ~InputPipeline() {
+        mReader->stop();
+        mDispatcher->stop();
+    }
+
+    // Sends a frame with the current time as its kernel timestamp, and waits until the
+    // window received the motion event that it produced.
+    bool sendFrame(std::vector<RawEvent>& frame) {
+        const nsecs_t when = now();
+        for (RawEvent& event : frame) {
+            event.when = when;
+        }
+        mEventHub->enqueueFrame(frame);
+        return mWindow->consumeEvent();
+    }
+
+    // The per-stage latency histograms, as reported by dumpsys input.
+    std::string dumpLatency() {
+        std::string dump;
+        mDispatcher->dump(dump);
+        const size_t start = dump.find("TouchLatency:");
+        return start == std::string::npos ? "" : dump.substr(start);
+    }
+
+private:
+    sp<InputDispatcher> mDispatcher;
+    sp<InputClassifier> mClassifier;
+    std::shared_ptr<FakeEventHub> mEventHub;
+    std::unique_ptr<InputReader> mReader;
+    sp<FakeWindowHandle> mWindow;
+};
+
+/**
+ * Time from the kernel timestamp of a frame until the application could read its motion event,
+ * for gestures with the given number of fingers.
+ */
+static void benchmarkReaderToPublish(benchmark::State& state) {
+    InputPipeline pipeline;
+    std::vector<std::vector<RawEvent>> frames = generateGesture(state.range(0));
+
+    size_t next = 0;
+    for (auto _ : state) {
+        if (!pipeline.sendFrame(frames[next])) {
+            state.SkipWithError("The window did not receive the event");
+            break;
+        }
+        next = (next + 1) % frames.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    printf("%s", pipeline.dumpLatency().c_str());
+}
+
+BENCHMARK(benchmarkReaderToPublish)->Arg(1)->Arg(2)->Arg(5)->Arg(10);
+
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -173,6 +173,10 @@ struct MotionEntry : EventEntry {
     uint32_t pointerCount;
     PointerProperties pointerProperties[MAX_POINTERS];
     PointerCoords pointerCoords[MAX_POINTERS];
+    // When the EventHub read this event, and when the dispatcher was notified of it.
+    // 0 if unknown, or once the latency has been reported.
+    nsecs_t readTime = 0;
+    nsecs_t notifyTime = 0;
 
     MotionEntry(int32_t id, nsecs_t eventTime, int32_t deviceId, uint32_t source, int32_t displayId,
                 uint32_t policyFlags, int32_t action, int32_t actionButton, int32_t flags,
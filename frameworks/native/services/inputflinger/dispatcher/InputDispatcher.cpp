@@ -2583,6 +2583,7 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
                                                      motionEntry->pointerCount,
                                                      motionEntry->pointerProperties, usingCoords);
                 reportTouchEventForStatistics(*motionEntry);
+                reportTouchLatencyLocked(*motionEntry, now());
                 break;
             }
             case EventEntry::Type::FOCUS: {
@@ -3038,6 +3039,8 @@ MotionEntry* InputDispatcher::splitMotionEvent(const MotionEntry& originalMotion
                             originalMotionEntry.xCursorPosition,
                             originalMotionEntry.yCursorPosition, originalMotionEntry.downTime,
                             splitPointerCount, splitPointerProperties, splitPointerCoords, 0, 0);
+    splitMotionEntry->readTime = originalMotionEntry.readTime;
+    splitMotionEntry->notifyTime = originalMotionEntry.notifyTime;
 
     if (originalMotionEntry.injectionState) {
         splitMotionEntry->injectionState = originalMotionEntry.injectionState;
@@ -3212,6 +3215,8 @@ void InputDispatcher::notifyMotion(const NotifyMotionArgs* args) {
                              args->pointerProperties)) {
         return;
     }
+    // The policy interception below counts towards the dispatcher stage of the latency.
+    const nsecs_t notifyTime = args->readTime != 0 ? now() : 0;
 
     uint32_t policyFlags = args->policyFlags;
     policyFlags |= POLICY_FLAG_TRUSTED;
@@ -3256,6 +3261,10 @@ void InputDispatcher::notifyMotion(const NotifyMotionArgs* args) {
                                 args->yPrecision, args->xCursorPosition, args->yCursorPosition,
                                 args->downTime, args->pointerCount, args->pointerProperties,
                                 args->pointerCoords, 0, 0);
+        if (args->readTime != 0) {
+            newEntry->readTime = args->readTime;
+            newEntry->notifyTime = notifyTime;
+        }
 
         needWake = enqueueInboundEventLocked(newEntry);
         mLock.unlock();
@@ -4319,6 +4328,8 @@ void InputDispatcher::dumpDispatchStateLocked(std::string& dump) {
     dump += StringPrintf(INDENT2 "KeyRepeatDelay: %" PRId64 "ms\n", ns2ms(mConfig.keyRepeatDelay));
     dump += StringPrintf(INDENT2 "KeyRepeatTimeout: %" PRId64 "ms\n",
                          ns2ms(mConfig.keyRepeatTimeout));
+
+    dumpTouchLatencyLocked(dump);
 }
 
 void InputDispatcher::dumpMonitors(std::string& dump, const std::vector<Monitor>& monitors) {
@@ -5073,6 +5084,31 @@ void InputDispatcher::reportTouchEventForStatistics(const MotionEntry& motionEnt
     mTouchStatistics.addValue(latencyMicros);
 }
 
+/**
+ * Record how long each stage of the pipeline took for a touch event read from a device.
+ * An event that is published to several connections is only counted for the first one.
+ */
+void InputDispatcher::reportTouchLatencyLocked(MotionEntry& entry, nsecs_t publishTime) {
+    if (entry.readTime == 0 || entry.source != AINPUT_SOURCE_TOUCHSCREEN) {
+        return;
+    }
+    mTouchLatency.kernelToRead.addValue(entry.readTime - entry.eventTime);
+    mTouchLatency.readToDispatcher.addValue(entry.notifyTime - entry.readTime);
+    mTouchLatency.dispatcherToPublish.addValue(publishTime - entry.notifyTime);
+    mTouchLatency.total.addValue(publishTime - entry.eventTime);
+    entry.readTime = 0;
+}
+
+void InputDispatcher::dumpTouchLatencyLocked(std::string& dump) {
+    dump += INDENT "TouchLatency:\n";
+    dump += StringPrintf(INDENT2 "KernelToRead: %s\n", mTouchLatency.kernelToRead.dump().c_str());
+    dump += StringPrintf(INDENT2 "ReadToDispatcher: %s\n",
+                         mTouchLatency.readToDispatcher.dump().c_str());
+    dump += StringPrintf(INDENT2 "DispatcherToPublish: %s\n",
+                         mTouchLatency.dispatcherToPublish.dump().c_str());
+    dump += StringPrintf(INDENT2 "Total: %s\n", mTouchLatency.total.dump().c_str());
+}
+
 void InputDispatcher::traceInboundQueueLengthLocked() {
     if (ATRACE_ENABLED()) {
         ATRACE_INT("iq", mInboundQueue.size());
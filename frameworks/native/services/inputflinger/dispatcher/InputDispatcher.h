@@ -27,6 +27,7 @@
 #include "InputState.h"
 #include "InputTarget.h"
 #include "InputThread.h"
+#include "LatencyHistogram.h"
 #include "Monitor.h"
 #include "TouchState.h"
 #include "TouchedWindow.h"
@@ -528,6 +529,19 @@ private:
     LatencyStatistics mTouchStatistics{TOUCH_STATS_REPORT_PERIOD};
 
     void reportTouchEventForStatistics(const MotionEntry& entry);
+
+    // Latency of each stage of the input pipeline for touch events read from a device.
+    struct TouchLatency {
+        LatencyHistogram kernelToRead;        // until the EventHub read the event
+        LatencyHistogram readToDispatcher;    // through InputReader and InputClassifier
+        LatencyHistogram dispatcherToPublish; // through InputDispatcher until InputPublisher
+        LatencyHistogram total;               // from the kernel timestamp until InputPublisher
+    };
+    TouchLatency mTouchLatency GUARDED_BY(mLock);
+
+    void reportTouchLatencyLocked(MotionEntry& entry, nsecs_t publishTime) REQUIRES(mLock);
+    void dumpTouchLatencyLocked(std::string& dump) REQUIRES(mLock);
+
     void reportDispatchStatistics(std::chrono::nanoseconds eventDuration,
                                   const Connection& connection, bool handled);
     void traceInboundQueueLengthLocked() REQUIRES(mLock);
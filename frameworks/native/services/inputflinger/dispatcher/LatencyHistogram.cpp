@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LatencyHistogram.h"
+
+#include <android-base/stringprintf.h>
+#include <algorithm>
+#include <climits>
+
+using android::base::StringPrintf;
+
+namespace android::inputdispatcher {
+
+void LatencyHistogram::addValue(nsecs_t latency) {
+    if (latency < 0) {
+        // The clocks of the stages are not always in step, e.g. for events with a
+        // timestamp from the kernel. Count those as no latency rather than dropping them.
+        latency = 0;
+    }
+    size_t bucket = 0;
+    const uint64_t units = uint64_t(latency / FIRST_BUCKET_LIMIT);
+    if (units != 0) {
+        // Bucket i holds [2^(i-1), 2^i) units.
+        bucket = std::min(size_t(64 - __builtin_clzll(units)), NUM_BUCKETS - 1);
+    }
+    mBuckets[bucket]++;
+    mCount++;
+    mSum += latency;
+    if (latency > mMax) {
+        mMax = latency;
+    }
+}
+
+void LatencyHistogram::reset() {
+    mBuckets.fill(0);
+    mCount = 0;
+    mSum = 0;
+    mMax = 0;
+}
+
+nsecs_t LatencyHistogram::getMean() const {
+    return mCount == 0 ? 0 : mSum / nsecs_t(mCount);
+}
+
+nsecs_t LatencyHistogram::getBucketLimit(size_t bucket) {
+    if (bucket >= NUM_BUCKETS - 1) {
+        return LLONG_MAX;
+    }
+    return FIRST_BUCKET_LIMIT << bucket;
+}
+
+nsecs_t LatencyHistogram::getPercentile(int percentile) const {
+    if (mCount == 0) {
+        return 0;
+    }
+    // The smallest bucket that covers at least the given share of the values.
+    const size_t target = (mCount * size_t(percentile) + 99) / 100;
+    size_t seen = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+        seen += mBuckets[i];
+        if (seen >= target && seen != 0) {
+            return std::min(getBucketLimit(i), mMax);
+        }
+    }
+    return mMax;
+}
+
+std::string LatencyHistogram::dump() const {
+    if (mCount == 0) {
+        return "<no samples>";
+    }
+    return StringPrintf("count=%zu, mean=%" PRId64 "us, p50<=%" PRId64 "us, p90<=%" PRId64
+                        "us, p99<=%" PRId64 "us, max=%" PRId64 "us",
+                        mCount, ns2us(getMean()), ns2us(getPercentile(50)),
+                        ns2us(getPercentile(90)), ns2us(getPercentile(99)), ns2us(mMax));
+}
+
+} // namespace android::inputdispatcher
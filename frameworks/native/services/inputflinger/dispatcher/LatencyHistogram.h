@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _UI_INPUT_INPUTDISPATCHER_LATENCYHISTOGRAM_H
+#define _UI_INPUT_INPUTDISPATCHER_LATENCYHISTOGRAM_H
+
+#include <utils/Timers.h>
+#include <array>
+#include <string>
+
+namespace android::inputdispatcher {
+
+/**
+ * Counts latencies in buckets that double in width, starting at 125us: bucket 0 holds
+ * latencies below 125us, bucket 1 those below 250us, and so on. The last bucket holds
+ * everything from about 1s up.
+ * Adding a value is a few instructions and never allocates, so it can be done for every event.
+ */
+class LatencyHistogram {
+public:
+    static constexpr size_t NUM_BUCKETS = 15;
+    static constexpr nsecs_t FIRST_BUCKET_LIMIT = 125000; // 125us
+
+    void addValue(nsecs_t latency);
+    void reset();
+
+    size_t getCount() const { return mCount; }
+    nsecs_t getMax() const { return mMax; }
+    nsecs_t getMean() const;
+    size_t getBucketCount(size_t bucket) const { return mBuckets[bucket]; }
+
+    // The exclusive upper limit of a bucket, or LLONG_MAX for the last one.
+    static nsecs_t getBucketLimit(size_t bucket);
+    // The upper limit of the bucket that holds the given percentile, or 0 if there are no values.
+    nsecs_t getPercentile(int percentile) const;
+
+    // One line with the count, mean, p50, p90, p99 and max, in microseconds.
+    std::string dump() const;
+
+private:
+    std::array<size_t, NUM_BUCKETS> mBuckets{};
+    size_t mCount = 0;
+    nsecs_t mSum = 0;
+    nsecs_t mMax = 0;
+};
+
+} // namespace android::inputdispatcher
+
+#endif // _UI_INPUT_INPUTDISPATCHER_LATENCYHISTOGRAM_H
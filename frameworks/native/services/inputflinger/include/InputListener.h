@@ -120,6 +120,11 @@ struct NotifyMotionArgs : public NotifyArgs {
     float yCursorPosition;
     nsecs_t downTime;
     std::vector<TouchVideoFrame> videoFrames;
+    /**
+     * When the EventHub read the raw events that produced this motion, or 0 if unknown.
+     * Only used to track the latency of the input pipeline, so it is not compared by operator==.
+     */
+    nsecs_t readTime = 0;
 
     inline NotifyMotionArgs() { }
 
@@ -30,6 +30,7 @@
 #include <sys/ioctl.h>
 #include <sys/limits.h>
 #include <unistd.h>
+#include <algorithm>
 
 #define LOG_TAG "EventHub"
 
@@ -192,6 +193,10 @@ EventHub::Device::Device(int fd, int32_t id, const std::string& path,
         ffEffectPlaying(false),
         ffEffectId(-1),
         controllerNumber(0),
+        eventCount(0),
+        rateWindowStart(0),
+        rateWindowEventCount(0),
+        eventRate(0),
         enabled(true),
         isVirtual(fd < 0) {
     memset(keyBitmask, 0, sizeof(keyBitmask));
@@ -235,6 +240,30 @@ bool EventHub::Device::hasValidFd() {
     return !isVirtual && enabled;
 }
 
+void EventHub::Device::recordEvents(nsecs_t readTime, size_t count) {
+    eventCount += count;
+    if (rateWindowStart == 0) {
+        rateWindowStart = readTime;
+    }
+    rateWindowEventCount += count;
+    const nsecs_t elapsed = readTime - rateWindowStart;
+    if (elapsed >= EVENT_RATE_WINDOW) {
+        eventRate = rateWindowEventCount * 1e9f / elapsed;
+        rateWindowStart = readTime;
+        rateWindowEventCount = 0;
+    }
+}
+
+float EventHub::Device::getEventRate(nsecs_t now) const {
+    const nsecs_t elapsed = now - rateWindowStart;
+    if (rateWindowStart == 0 || elapsed < EVENT_RATE_WINDOW) {
+        return eventRate;
+    }
+    // The device has gone quiet since the current window started, so the last complete window
+    // is out of date.
+    return rateWindowEventCount * 1e9f / elapsed;
+}
+
 /**
  * Get the capabilities for the current process.
  * Crashes the system if unable to create / check / destroy the capabilities object.
@@ -278,7 +307,9 @@ static void ensureProcessCanBlockSuspend() {
 
 // --- EventHub ---
 
+const int EventHub::EPOLL_MIN_EVENTS;
 const int EventHub::EPOLL_MAX_EVENTS;
+const size_t EventHub::MAX_READ_EVENTS;
 
 EventHub::EventHub(void)
       : mBuiltInKeyboardId(NO_BUILT_IN_KEYBOARD),
@@ -289,10 +320,13 @@ EventHub::EventHub(void)
         mNeedToSendFinishedDeviceScan(false),
         mNeedToReopenDevices(false),
         mNeedToScanDevices(true),
+        mPendingEventItems(EPOLL_MIN_EVENTS),
         mPendingEventCount(0),
         mPendingEventIndex(0),
-        mPendingINotify(false) {
+        mPendingINotify(false),
+        mReadEventIndex(0) {
     ensureProcessCanBlockSuspend();
+    mReadEvents.reserve(MAX_READ_EVENTS);
 
     mEpollFd = epoll_create1(EPOLL_CLOEXEC);
     LOG_ALWAYS_FATAL_IF(mEpollFd < 0, "Could not create epoll instance: %s", strerror(errno));
@@ -844,19 +878,37 @@ EventHub::Device* EventHub::getDeviceByFdLocked(int fd) const {
     return nullptr;
 }
 
+size_t EventHub::drainReadEventsLocked(RawEvent* buffer, size_t capacity) {
+    const size_t count = std::min(capacity, mReadEvents.size() - mReadEventIndex);
+    std::copy_n(mReadEvents.begin() + mReadEventIndex, count, buffer);
+    mReadEventIndex += count;
+    if (mReadEventIndex == mReadEvents.size()) {
+        mReadEvents.clear();
+        mReadEventIndex = 0;
+    }
+    return count;
+}
+
 size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSize) {
     ALOG_ASSERT(bufferSize >= 1);
 
     AutoMutex _l(mLock);
 
-    struct input_event readBuffer[bufferSize];
-
     RawEvent* event = buffer;
     size_t capacity = bufferSize;
     bool awoken = false;
     for (;;) {
         nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
 
+        // Return the events that have already been read first, so that the device changes below
+        // do not overtake them.  Devices are only read again once all of them have been returned.
+        const size_t drained = drainReadEventsLocked(event, capacity);
+        event += drained;
+        capacity -= drained;
+        if (capacity == 0) {
+            break;
+        }
+
         // Reopen input devices if needed.
         if (mNeedToReopenDevices) {
             mNeedToReopenDevices = false;
@@ -874,6 +926,7 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
             ALOGV("Reporting device closed: id=%d, name=%s\n", device->id, device->path.c_str());
             mClosingDevices = device->next;
             event->when = now;
+            event->readTime = now;
             event->deviceId = (device->id == mBuiltInKeyboardId)
                     ? ReservedInputDeviceId::BUILT_IN_KEYBOARD_ID
                     : device->id;
@@ -897,6 +950,7 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
             ALOGV("Reporting device opened: id=%d, name=%s\n", device->id, device->path.c_str());
             mOpeningDevices = device->next;
             event->when = now;
+            event->readTime = now;
             event->deviceId = device->id == mBuiltInKeyboardId ? 0 : device->id;
             event->type = DEVICE_ADDED;
             event += 1;
@@ -909,6 +963,7 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
         if (mNeedToSendFinishedDeviceScan) {
             mNeedToSendFinishedDeviceScan = false;
             event->when = now;
+            event->readTime = now;
             event->type = FINISHED_DEVICE_SCAN;
             event += 1;
             if (--capacity == 0) {
@@ -916,7 +971,9 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
             }
         }
 
-        // Grab the next input event.
+        // Read all of the ready devices.  The events go to mReadEvents rather than straight to
+        // the caller's buffer, so that a device with a lot of events cannot hold the others
+        // back until the next wakeup.
         bool deviceChanged = false;
         while (mPendingEventIndex < mPendingEventCount) {
             const struct epoll_event& eventItem = mPendingEventItems[mPendingEventIndex++];
@@ -974,13 +1031,19 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
             }
             // This must be an input event
             if (eventItem.events & EPOLLIN) {
+                const size_t readCapacity = MAX_READ_EVENTS - mReadEvents.size();
+                if (readCapacity == 0) {
+                    // mReadEvents is full.  Read the device again once it has been returned.
+                    mPendingEventIndex -= 1;
+                    break;
+                }
                 int32_t readSize =
-                        read(device->fd, readBuffer, sizeof(struct input_event) * capacity);
+                        read(device->fd, mReadBuffer, sizeof(struct input_event) * readCapacity);
                 if (readSize == 0 || (readSize < 0 && errno == ENODEV)) {
                     // Device was removed before INotify noticed.
                     ALOGW("could not get event, removed? (fd: %d size: %" PRId32
-                          " bufferSize: %zu capacity: %zu errno: %d)\n",
-                          device->fd, readSize, bufferSize, capacity, errno);
+                          " capacity: %zu errno: %d)\n",
+                          device->fd, readSize, readCapacity, errno);
                     deviceChanged = true;
                     closeDeviceLocked(device);
                 } else if (readSize < 0) {
@@ -991,21 +1054,23 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
                     ALOGE("could not get event (wrong size: %d)", readSize);
                 } else {
                     int32_t deviceId = device->id == mBuiltInKeyboardId ? 0 : device->id;
+                    const nsecs_t readTime = systemTime(SYSTEM_TIME_MONOTONIC);
 
                     size_t count = size_t(readSize) / sizeof(struct input_event);
                     for (size_t i = 0; i < count; i++) {
-                        struct input_event& iev = readBuffer[i];
-                        event->when = processEventTimestamp(iev);
-                        event->deviceId = deviceId;
-                        event->type = iev.type;
-                        event->code = iev.code;
-                        event->value = iev.value;
-                        event += 1;
-                        capacity -= 1;
+                        struct input_event& iev = mReadBuffer[i];
+                        RawEvent& readEvent = mReadEvents.emplace_back();
+                        readEvent.when = processEventTimestamp(iev);
+                        readEvent.deviceId = deviceId;
+                        readEvent.type = iev.type;
+                        readEvent.code = iev.code;
+                        readEvent.value = iev.value;
+                        readEvent.readTime = readTime;
                     }
-                    if (capacity == 0) {
-                        // The result buffer is full.  Reset the pending event index
-                        // so we will try to read the device again on the next iteration.
+                    device->recordEvents(readTime, count);
+                    if (count == readCapacity) {
+                        // mReadEvents is full and the device may have more events.  Reset the
+                        // pending event index so we will try to read it again.
                         mPendingEventIndex -= 1;
                         break;
                     }
@@ -1021,6 +1086,10 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
             }
         }
 
+        const size_t copied = drainReadEventsLocked(event, capacity);
+        event += copied;
+        capacity -= copied;
+
         // readNotify() will modify the list of devices so this must be done after
         // processing all other events to ensure that we read all remaining events
         // before closing the devices.
@@ -1055,7 +1124,8 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
 
         mLock.unlock(); // release lock before poll
 
-        int pollResult = epoll_wait(mEpollFd, mPendingEventItems, EPOLL_MAX_EVENTS, timeoutMillis);
+        int pollResult = epoll_wait(mEpollFd, mPendingEventItems.data(),
+                                    static_cast<int>(mPendingEventItems.size()), timeoutMillis);
 
         mLock.lock(); // reacquire lock after poll
 
@@ -1078,6 +1148,13 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
         } else {
             // Some events occurred.
             mPendingEventCount = size_t(pollResult);
+
+            // If all of the items were used, more fds may be ready than fit.  Handle more of
+            // them per wakeup from now on.
+            if (mPendingEventCount == mPendingEventItems.size() &&
+                mPendingEventItems.size() < size_t(EPOLL_MAX_EVENTS)) {
+                mPendingEventItems.resize(mPendingEventItems.size() * 2);
+            }
         }
     }
 
@@ -1921,6 +1998,8 @@ void EventHub::dump(std::string& dump) {
         AutoMutex _l(mLock);
 
         dump += StringPrintf(INDENT "BuiltInKeyboardId: %d\n", mBuiltInKeyboardId);
+        dump += StringPrintf(INDENT "EpollBatchSize: %zu\n", mPendingEventItems.size());
+        const nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
 
         dump += INDENT "Devices:\n";
 
@@ -1939,6 +2018,8 @@ void EventHub::dump(std::string& dump) {
             dump += StringPrintf(INDENT3 "Descriptor: %s\n", device->identifier.descriptor.c_str());
             dump += StringPrintf(INDENT3 "Location: %s\n", device->identifier.location.c_str());
             dump += StringPrintf(INDENT3 "ControllerNumber: %d\n", device->controllerNumber);
+            dump += StringPrintf(INDENT3 "Events: %" PRIu64 ", rate: %.1f/s\n",
+                                 device->eventCount, device->getEventRate(now));
             dump += StringPrintf(INDENT3 "UniqueId: %s\n", device->identifier.uniqueId.c_str());
             dump += StringPrintf(INDENT3 "Identifier: bus=0x%04x, vendor=0x%04x, "
                                          "product=0x%04x, version=0x%04x\n",
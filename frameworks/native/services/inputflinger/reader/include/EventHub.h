@@ -54,6 +54,8 @@ struct RawEvent {
     int32_t type;
     int32_t code;
     int32_t value;
+    // When the EventHub read the event from the device, for latency tracking.
+    nsecs_t readTime;
 };
 
 /* Describes an absolute axis. */
@@ -353,12 +355,22 @@ private:
 
         int32_t controllerNumber;
 
+        // The number of input events read from the device, and its event rate for dump().
+        // The rate is measured over windows of EVENT_RATE_WINDOW.
+        uint64_t eventCount;
+        nsecs_t rateWindowStart;
+        uint64_t rateWindowEventCount;
+        float eventRate; // events per second over the last complete window
+
         Device(int fd, int32_t id, const std::string& path,
                const InputDeviceIdentifier& identifier);
         ~Device();
 
         void close();
 
+        void recordEvents(nsecs_t readTime, size_t count);
+        float getEventRate(nsecs_t now) const;
+
         bool enabled; // initially true
         status_t enable();
         status_t disable();
@@ -386,6 +398,8 @@ private:
 
     void configureFd(Device* device);
 
+    size_t drainReadEventsLocked(RawEvent* buffer, size_t capacity);
+
     bool isDeviceEnabled(int32_t deviceId) override;
     status_t enableDevice(int32_t deviceId) override;
     status_t disableDevice(int32_t deviceId) override;
@@ -468,14 +482,29 @@ private:
     int mInputWd;
     int mVideoWd;
 
-    // Maximum number of signalled FDs to handle at a time.
-    static const int EPOLL_MAX_EVENTS = 16;
+    // Number of signalled FDs to handle at a time.  This starts at EPOLL_MIN_EVENTS and doubles,
+    // up to EPOLL_MAX_EVENTS, each time epoll_wait fills all of the items.
+    static const int EPOLL_MIN_EVENTS = 16;
+    static const int EPOLL_MAX_EVENTS = 256;
 
     // The array of pending epoll events and the index of the next event to be handled.
-    struct epoll_event mPendingEventItems[EPOLL_MAX_EVENTS];
+    std::vector<struct epoll_event> mPendingEventItems;
     size_t mPendingEventCount;
     size_t mPendingEventIndex;
     bool mPendingINotify;
+
+    // Maximum number of input events read from the devices and not yet returned by getEvents().
+    static const size_t MAX_READ_EVENTS = 1024;
+
+    // Events read from all of the ready devices in a wakeup, in order, and the index of the next
+    // one to return.  When the caller's buffer is full, the rest are returned by the next call
+    // to getEvents() before anything else.
+    std::vector<RawEvent> mReadEvents;
+    size_t mReadEventIndex;
+    struct input_event mReadBuffer[MAX_READ_EVENTS];
+
+    // Window over which the event rate of each device is measured.
+    static constexpr nsecs_t EVENT_RATE_WINDOW = 1000000000LL; // 1s
 };
 
 }; // namespace android
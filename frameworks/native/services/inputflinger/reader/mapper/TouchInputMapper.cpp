@@ -1382,6 +1382,7 @@ void TouchInputMapper::dumpAffineTransformation(std::string& dump) {
 void TouchInputMapper::updateAffineTransformation() {
     mAffineTransform = getPolicy()->getTouchAffineTransformation(getDeviceContext().getDescriptor(),
                                                                  mSurfaceOrientation);
+    updateRawToSurfaceTransform();
 }
 
 void TouchInputMapper::reset(nsecs_t when) {
@@ -1436,7 +1437,9 @@ void TouchInputMapper::process(const RawEvent* rawEvent) {
     mTouchButtonAccumulator.process(rawEvent);
 
     if (rawEvent->type == EV_SYN && rawEvent->code == SYN_REPORT) {
+        mSyncReadTime = rawEvent->readTime;
         sync(rawEvent->when);
+        mSyncReadTime = 0;
     }
 }
 
@@ -1448,7 +1451,6 @@ void TouchInputMapper::sync(nsecs_t when) {
     mRawStatesPending.emplace_back();
 
     RawState* next = &mRawStatesPending.back();
-    next->clear();
     next->when = when;
 
     // Sync button state.
@@ -2063,8 +2065,24 @@ void TouchInputMapper::cookPointerData() {
         mCurrentCookedState.buttonState = mCurrentRawState.buttonState;
     }
 
-    // Walk through the the active pointers and map device coordinates onto
-    // surface coordinates and adjust for display orientation.
+    // Map device coordinates onto surface coordinates for all pointers first. This is one
+    // multiply-add per axis with the calibration, scale and rotation folded together, and
+    // keeping it out of the loop below lets the compiler vectorize it.
+    float xTransformed[MAX_POINTERS], yTransformed[MAX_POINTERS];
+    for (uint32_t i = 0; i < currentPointerCount; i++) {
+        xTransformed[i] = mCurrentRawState.rawPointerData.pointers[i].x;
+        yTransformed[i] = mCurrentRawState.rawPointerData.pointers[i].y;
+    }
+    const TouchAffineTransformation& t = mRawToSurface;
+    for (uint32_t i = 0; i < currentPointerCount; i++) {
+        const float x = xTransformed[i];
+        const float y = yTransformed[i];
+        xTransformed[i] = x * t.x_scale + y * t.x_ymix + t.x_offset;
+        yTransformed[i] = x * t.y_xmix + y * t.y_scale + t.y_offset;
+    }
+
+    // Walk through the the active pointers and cook the remaining axes, adjusting them
+    // for display orientation.
     for (uint32_t i = 0; i < currentPointerCount; i++) {
         const RawPointerData::Pointer& in = mCurrentRawState.rawPointerData.pointers[i];
 
@@ -2218,13 +2236,10 @@ void TouchInputMapper::cookPointerData() {
                 break;
         }
 
-        // Adjust X,Y coords for device calibration
+        // X and Y were adjusted for device calibration above.
         // TODO: Adjust coverage coords?
-        float xTransformed = in.x, yTransformed = in.y;
-        mAffineTransform.applyTo(xTransformed, yTransformed);
-        rotateAndScale(xTransformed, yTransformed);
 
-        // Adjust X, Y, and coverage coords for surface orientation.
+        // Adjust coverage coords for surface orientation.
         float left, top, right, bottom;
 
         switch (mSurfaceOrientation) {
@@ -2272,39 +2287,44 @@ void TouchInputMapper::cookPointerData() {
                 break;
         }
 
-        // Write output coords.
+        // Write output coords. The axes are written in increasing order, so that every
+        // value is appended and setAxisValue never has to move the ones already stored.
+        const bool coverageBox =
+                mCalibration.coverageCalibration == Calibration::CoverageCalibration::BOX;
         PointerCoords& out = mCurrentCookedState.cookedPointerData.pointerCoords[i];
         out.clear();
-        out.setAxisValue(AMOTION_EVENT_AXIS_X, xTransformed);
-        out.setAxisValue(AMOTION_EVENT_AXIS_Y, yTransformed);
+        out.setAxisValue(AMOTION_EVENT_AXIS_X, xTransformed[i]);
+        out.setAxisValue(AMOTION_EVENT_AXIS_Y, yTransformed[i]);
         out.setAxisValue(AMOTION_EVENT_AXIS_PRESSURE, pressure);
         out.setAxisValue(AMOTION_EVENT_AXIS_SIZE, size);
         out.setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MAJOR, touchMajor);
         out.setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MINOR, touchMinor);
-        out.setAxisValue(AMOTION_EVENT_AXIS_ORIENTATION, orientation);
-        out.setAxisValue(AMOTION_EVENT_AXIS_TILT, tilt);
-        out.setAxisValue(AMOTION_EVENT_AXIS_DISTANCE, distance);
-        if (mCalibration.coverageCalibration == Calibration::CoverageCalibration::BOX) {
-            out.setAxisValue(AMOTION_EVENT_AXIS_GENERIC_1, left);
-            out.setAxisValue(AMOTION_EVENT_AXIS_GENERIC_2, top);
-            out.setAxisValue(AMOTION_EVENT_AXIS_GENERIC_3, right);
-            out.setAxisValue(AMOTION_EVENT_AXIS_GENERIC_4, bottom);
-        } else {
+        if (!coverageBox) {
             out.setAxisValue(AMOTION_EVENT_AXIS_TOOL_MAJOR, toolMajor);
             out.setAxisValue(AMOTION_EVENT_AXIS_TOOL_MINOR, toolMinor);
         }
+        out.setAxisValue(AMOTION_EVENT_AXIS_ORIENTATION, orientation);
+        out.setAxisValue(AMOTION_EVENT_AXIS_DISTANCE, distance);
+        out.setAxisValue(AMOTION_EVENT_AXIS_TILT, tilt);
 
         // Write output relative fields if applicable.
         uint32_t id = in.id;
         if (mSource == AINPUT_SOURCE_TOUCHPAD &&
             mLastCookedState.cookedPointerData.hasPointerCoordsForId(id)) {
             const PointerCoords& p = mLastCookedState.cookedPointerData.pointerCoordsForId(id);
-            float dx = xTransformed - p.getAxisValue(AMOTION_EVENT_AXIS_X);
-            float dy = yTransformed - p.getAxisValue(AMOTION_EVENT_AXIS_Y);
+            float dx = xTransformed[i] - p.getAxisValue(AMOTION_EVENT_AXIS_X);
+            float dy = yTransformed[i] - p.getAxisValue(AMOTION_EVENT_AXIS_Y);
             out.setAxisValue(AMOTION_EVENT_AXIS_RELATIVE_X, dx);
             out.setAxisValue(AMOTION_EVENT_AXIS_RELATIVE_Y, dy);
         }
 
+        if (coverageBox) {
+            out.setAxisValue(AMOTION_EVENT_AXIS_GENERIC_1, left);
+            out.setAxisValue(AMOTION_EVENT_AXIS_GENERIC_2, top);
+            out.setAxisValue(AMOTION_EVENT_AXIS_GENERIC_3, right);
+            out.setAxisValue(AMOTION_EVENT_AXIS_GENERIC_4, bottom);
+        }
+
         // Write output properties.
         PointerProperties& properties = mCurrentCookedState.cookedPointerData.pointerProperties[i];
         properties.clear();
@@ -3629,6 +3649,7 @@ void TouchInputMapper::dispatchMotion(nsecs_t when, uint32_t policyFlags, uint32
                           MotionClassification::NONE, edgeFlags, pointerCount, pointerProperties,
                           pointerCoords, xPrecision, yPrecision, xCursorPosition, yCursorPosition,
                           downTime, std::move(frames));
+    args.readTime = mSyncReadTime;
     getListener()->notifyMotion(&args);
 }
 
@@ -3667,40 +3688,49 @@ void TouchInputMapper::cancelTouch(nsecs_t when) {
     abortTouches(when, 0 /* policyFlags*/);
 }
 
-// Transform raw coordinate to surface coordinate
-void TouchInputMapper::rotateAndScale(float& x, float& y) {
-    // Scale to surface coordinate.
-    const float xScaled = float(x - mRawPointerAxes.x.minValue) * mXScale;
-    const float yScaled = float(y - mRawPointerAxes.y.minValue) * mYScale;
-
-    const float xScaledMax = float(mRawPointerAxes.x.maxValue - x) * mXScale;
-    const float yScaledMax = float(mRawPointerAxes.y.maxValue - y) * mYScale;
-
-    // Rotate to surface coordinate.
+// Fold the calibration and the transform from raw to surface coordinates into mRawToSurface.
+void TouchInputMapper::updateRawToSurfaceTransform() {
+    // Scale to surface coordinate, then rotate.
     // 0 - no swap and reverse.
     // 90 - swap x/y and reverse y.
     // 180 - reverse x, y.
     // 270 - swap x/y and reverse x.
+    // Row i of r maps the calibrated raw x and y to surface axis i.
+    const float xScaledOffset = mXTranslate - mRawPointerAxes.x.minValue * mXScale;
+    const float yScaledOffset = mYTranslate - mRawPointerAxes.y.minValue * mYScale;
+    const float xScaledMaxOffset =
+            mRawPointerAxes.x.maxValue * mXScale - (mRawSurfaceWidth - mSurfaceRight);
+    const float yScaledMaxOffset =
+            mRawPointerAxes.y.maxValue * mYScale - (mRawSurfaceHeight - mSurfaceBottom);
+
+    float r[2][3];
     switch (mSurfaceOrientation) {
-        case DISPLAY_ORIENTATION_0:
-            x = xScaled + mXTranslate;
-            y = yScaled + mYTranslate;
-            break;
         case DISPLAY_ORIENTATION_90:
-            y = xScaledMax - (mRawSurfaceWidth - mSurfaceRight);
-            x = yScaled + mYTranslate;
+            r[0][0] = 0, r[0][1] = mYScale, r[0][2] = yScaledOffset;
+            r[1][0] = -mXScale, r[1][1] = 0, r[1][2] = xScaledMaxOffset;
             break;
         case DISPLAY_ORIENTATION_180:
-            x = xScaledMax - (mRawSurfaceWidth - mSurfaceRight);
-            y = yScaledMax - (mRawSurfaceHeight - mSurfaceBottom);
+            r[0][0] = -mXScale, r[0][1] = 0, r[0][2] = xScaledMaxOffset;
+            r[1][0] = 0, r[1][1] = -mYScale, r[1][2] = yScaledMaxOffset;
             break;
         case DISPLAY_ORIENTATION_270:
-            y = xScaled + mXTranslate;
-            x = yScaledMax - (mRawSurfaceHeight - mSurfaceBottom);
+            r[0][0] = 0, r[0][1] = -mYScale, r[0][2] = yScaledMaxOffset;
+            r[1][0] = mXScale, r[1][1] = 0, r[1][2] = xScaledOffset;
             break;
         default:
-            assert(false);
+            r[0][0] = mXScale, r[0][1] = 0, r[0][2] = xScaledOffset;
+            r[1][0] = 0, r[1][1] = mYScale, r[1][2] = yScaledOffset;
+            break;
     }
+
+    // Apply the calibration first.
+    const TouchAffineTransformation& a = mAffineTransform;
+    mRawToSurface.x_scale = r[0][0] * a.x_scale + r[0][1] * a.y_xmix;
+    mRawToSurface.x_ymix = r[0][0] * a.x_ymix + r[0][1] * a.y_scale;
+    mRawToSurface.x_offset = r[0][0] * a.x_offset + r[0][1] * a.y_offset + r[0][2];
+    mRawToSurface.y_xmix = r[1][0] * a.x_scale + r[1][1] * a.y_xmix;
+    mRawToSurface.y_scale = r[1][0] * a.x_ymix + r[1][1] * a.y_scale;
+    mRawToSurface.y_offset = r[1][0] * a.x_offset + r[1][1] * a.y_offset + r[1][2];
 }
 
 bool TouchInputMapper::isPointInsideSurface(int32_t x, int32_t y) {
@@ -294,6 +294,11 @@ protected:
     // Affine location transformation/calibration
     struct TouchAffineTransformation mAffineTransform;
 
+    // The calibration above followed by the scaling and rotation from raw to surface
+    // coordinates for the current orientation, folded into one transform.
+    // Updated together with mAffineTransform.
+    struct TouchAffineTransformation mRawToSurface;
+
     RawPointerAxes mRawPointerAxes;
 
     struct RawState {
@@ -308,6 +313,9 @@ protected:
         int32_t rawVScroll;
         int32_t rawHScroll;
 
+        // Not defaulted, so that pushing a pending state does not zero all of its pointers.
+        RawState() { clear(); }
+
         void copyFrom(const RawState& other) {
             when = other.when;
             rawPointerData.copyFrom(other.rawPointerData);
@@ -377,6 +385,9 @@ protected:
     // The time the primary pointer last went down.
     nsecs_t mDownTime;
 
+    // When the EventHub read the sync being processed, or 0 outside of a sync.
+    nsecs_t mSyncReadTime = 0;
+
     // The pointer controller, or null if the device is not a pointer.
     std::shared_ptr<PointerControllerInterface> mPointerController;
 
@@ -763,7 +774,7 @@ private:
     static void assignPointerIds(const RawState* last, RawState* current);
 
     const char* modeToString(DeviceMode deviceMode);
-    void rotateAndScale(float& x, float& y);
+    void updateRawToSurfaceTransform();
 };
 
 } // namespace android
@@ -199,3 +199,47 @@ TEST_F(EventHubTest, InputEvent_TimestampIsMonotonic) {
         lastEventTime = event.when; // Ensure all returned events are monotonic
     }
 }
+
+/**
+ * Events that do not fit in the caller's buffer must be returned, in order, by the
+ * following calls to getEvents().
+ */
+TEST_F(EventHubTest, InputEvent_SmallBufferReturnsAllEventsInOrder) {
+    ASSERT_NO_FATAL_FAILURE(mKeyboard->pressAndReleaseHomeKey());
+
+    std::vector<RawEvent> events;
+    RawEvent event;
+    while (events.size() < 4) {
+        const size_t count = mEventHub->getEvents(std::chrono::milliseconds(2s).count(), &event, 1);
+        if (count == 0) {
+            break;
+        }
+        ASSERT_EQ(1U, count);
+        events.push_back(event);
+    }
+    ASSERT_EQ(4U, events.size()) << "Expected to receive 2 keys and 2 syncs, total of 4 events";
+
+    EXPECT_EQ(EV_KEY, events[0].type);
+    EXPECT_EQ(1, events[0].value);
+    EXPECT_EQ(EV_SYN, events[1].type);
+    EXPECT_EQ(EV_KEY, events[2].type);
+    EXPECT_EQ(0, events[2].value);
+    EXPECT_EQ(EV_SYN, events[3].type);
+    for (const RawEvent& e : events) {
+        EXPECT_EQ(mDeviceId, e.deviceId);
+    }
+}
+
+/**
+ * The number of events read from each device is reported in dump().
+ */
+TEST_F(EventHubTest, Dump_ReportsDeviceEventCount) {
+    ASSERT_NO_FATAL_FAILURE(mKeyboard->pressAndReleaseHomeKey());
+    ASSERT_EQ(4U, getEvents(4).size());
+
+    std::string dump;
+    mEventHub->dump(dump);
+    const size_t device = dump.find(mKeyboard->getName());
+    ASSERT_NE(std::string::npos, device) << dump;
+    EXPECT_NE(std::string::npos, dump.find("Events: 4,", device)) << dump;
+}
@@ -563,6 +563,7 @@ public:
         event.type = type;
         event.code = code;
         event.value = value;
+        event.readTime = when;
         mEvents.push_back(event);
 
         if (type == EV_ABS) {
@@ -2330,6 +2331,7 @@ protected:
         event.type = type;
         event.code = code;
         event.value = value;
+        event.readTime = when;
         mapper.process(&event);
     }
 
@@ -4764,6 +4766,32 @@ TEST_F(SingleTouchInputMapperTest, Process_XYAxes_AffineCalibration) {
             x, y, 1, 0, 0, 0, 0, 0, 0, 0));
 }
 
+TEST_F(SingleTouchInputMapperTest, Process_XYAxes_AffineCalibration_WhenOrientationAware) {
+    addConfigurationProperty("touch.deviceType", "touchScreen");
+    prepareDisplay(DISPLAY_ORIENTATION_90);
+    prepareLocationCalibration();
+    prepareButtons();
+    prepareAxes(POSITION);
+    SingleTouchInputMapper& mapper = addMapperAndConfigure<SingleTouchInputMapper>();
+
+    int32_t rawX = 100;
+    int32_t rawY = 200;
+
+    // The calibration applies to the raw coordinates, before they are rotated.
+    int32_t cookedX = toCookedX(rawX, rawY);
+    int32_t cookedY = toCookedY(rawX, rawY);
+    float x = toDisplayY(cookedY);
+    float y = toDisplayX(RAW_X_MAX - cookedX + RAW_X_MIN);
+
+    processDown(mapper, rawX, rawY);
+    processSync(mapper);
+
+    NotifyMotionArgs args;
+    ASSERT_NO_FATAL_FAILURE(mFakeListener->assertNotifyMotionWasCalled(&args));
+    ASSERT_NO_FATAL_FAILURE(assertPointerCoords(args.pointerCoords[0],
+            x, y, 1, 0, 0, 0, 0, 0, 0, 0));
+}
+
 TEST_F(SingleTouchInputMapperTest, Process_ShouldHandleAllButtons) {
     addConfigurationProperty("touch.deviceType", "touchScreen");
     prepareDisplay(DISPLAY_ORIENTATION_0);
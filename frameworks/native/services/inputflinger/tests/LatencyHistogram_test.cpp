@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../dispatcher/LatencyHistogram.h"
+
+#include <gtest/gtest.h>
+#include <climits>
+
+namespace android {
+
+namespace inputdispatcher {
+
+// --- LatencyHistogramTest ---
+
+TEST(LatencyHistogramTest, Empty) {
+    LatencyHistogram histogram;
+
+    ASSERT_EQ(0u, histogram.getCount());
+    ASSERT_EQ(0, histogram.getMean());
+    ASSERT_EQ(0, histogram.getPercentile(50));
+    ASSERT_EQ("<no samples>", histogram.dump());
+}
+
+TEST(LatencyHistogramTest, Buckets) {
+    LatencyHistogram histogram;
+
+    histogram.addValue(0);
+    histogram.addValue(us2ns(124));
+    histogram.addValue(us2ns(125));
+    histogram.addValue(us2ns(249));
+    histogram.addValue(us2ns(250));
+    histogram.addValue(ms2ns(1));
+
+    ASSERT_EQ(2u, histogram.getBucketCount(0));
+    ASSERT_EQ(2u, histogram.getBucketCount(1));
+    ASSERT_EQ(1u, histogram.getBucketCount(2));
+    // 1ms is the first value of the bucket that goes up to 2ms.
+    ASSERT_EQ(1u, histogram.getBucketCount(4));
+    ASSERT_EQ(6u, histogram.getCount());
+    ASSERT_EQ(ms2ns(1), histogram.getMax());
+}
+
+TEST(LatencyHistogramTest, LargeAndNegativeValues) {
+    LatencyHistogram histogram;
+
+    histogram.addValue(seconds_to_nanoseconds(10));
+    histogram.addValue(-1);
+
+    ASSERT_EQ(1u, histogram.getBucketCount(LatencyHistogram::NUM_BUCKETS - 1));
+    ASSERT_EQ(1u, histogram.getBucketCount(0));
+    ASSERT_EQ(LLONG_MAX, LatencyHistogram::getBucketLimit(LatencyHistogram::NUM_BUCKETS - 1));
+}
+
+TEST(LatencyHistogramTest, Percentiles) {
+    LatencyHistogram histogram;
+
+    // 90 values below 125us, 9 values in [1ms, 2ms) and one of 5ms.
+    for (int i = 0; i < 90; i++) {
+        histogram.addValue(us2ns(100));
+    }
+    for (int i = 0; i < 9; i++) {
+        histogram.addValue(us2ns(1500));
+    }
+    histogram.addValue(ms2ns(5));
+
+    ASSERT_EQ(us2ns(125), histogram.getPercentile(50));
+    ASSERT_EQ(us2ns(125), histogram.getPercentile(90));
+    ASSERT_EQ(ms2ns(2), histogram.getPercentile(99));
+    // The limit of the last bucket is past the largest value.
+    ASSERT_EQ(ms2ns(5), histogram.getPercentile(100));
+}
+
+TEST(LatencyHistogramTest, Reset) {
+    LatencyHistogram histogram;
+
+    histogram.addValue(ms2ns(3));
+    histogram.reset();
+
+    ASSERT_EQ(0u, histogram.getCount());
+    ASSERT_EQ(0, histogram.getMax());
+    ASSERT_EQ(0u, histogram.getBucketCount(5));
+}
+
+} // namespace inputdispatcher
+
+} // namespace android
@@ -40,7 +40,8 @@ extern "C" int LLVMFuzzerTestOneInput(uint8_t* data, size_t size) {
                                       fdp->ConsumeIntegral<int32_t>(),
                                       fdp->ConsumeIntegral<int32_t>(),
                                       fdp->ConsumeIntegral<int32_t>(),
-                                      fdp->ConsumeIntegral<int32_t>()};
+                                      fdp->ConsumeIntegral<int32_t>(),
+                                      fdp->ConsumeIntegral<nsecs_t>()};
                     mapper.process(&rawEvent);
                 },
                 [&]() -> void {
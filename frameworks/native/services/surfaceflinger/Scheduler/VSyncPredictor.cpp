@@ -69,13 +69,54 @@ bool VSyncPredictor::validate(nsecs_t timestamp) const {
 }
 
 nsecs_t VSyncPredictor::currentPeriod() const {
-    std::lock_guard<std::mutex> lk(mMutex);
-    return std::get<0>(mRateMap.find(mIdealPeriod)->second);
+    return readModel().slope;
+}
+
+void VSyncPredictor::publishModel() {
+    auto const [slope, intercept] = mRateMap.find(mIdealPeriod)->second;
+    auto const sequence = mModelSequence.load(std::memory_order_relaxed);
+    mModelSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    mModelIdealPeriod.store(mIdealPeriod, std::memory_order_relaxed);
+    mModelSlope.store(slope, std::memory_order_relaxed);
+    mModelIntercept.store(intercept, std::memory_order_relaxed);
+    mModelOldestTimestamp.store(mTimestamps.empty() ? 0 : mTimestamps[mOldestTimestampIndex],
+                                std::memory_order_relaxed);
+    mModelKnownTimestamp.store(mKnownTimestamp.value_or(0), std::memory_order_relaxed);
+    mModelHasKnownTimestamp.store(mKnownTimestamp.has_value(), std::memory_order_relaxed);
+    mModelNumTimestamps.store(mTimestamps.size(), std::memory_order_relaxed);
+
+    mModelSequence.store(sequence + 2, std::memory_order_release);
+}
+
+VSyncPredictor::Model VSyncPredictor::readModel() const {
+    Model model;
+    uint32_t sequence;
+    do {
+        sequence = mModelSequence.load(std::memory_order_acquire);
+        model.idealPeriod = mModelIdealPeriod.load(std::memory_order_relaxed);
+        model.slope = mModelSlope.load(std::memory_order_relaxed);
+        model.intercept = mModelIntercept.load(std::memory_order_relaxed);
+        model.oldestTimestamp = mModelOldestTimestamp.load(std::memory_order_relaxed);
+        model.knownTimestamp = mModelKnownTimestamp.load(std::memory_order_relaxed);
+        if (!mModelHasKnownTimestamp.load(std::memory_order_relaxed)) {
+            model.knownTimestamp.reset();
+        }
+        model.numTimestamps = mModelNumTimestamps.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((sequence & 1) != 0 || sequence != mModelSequence.load(std::memory_order_relaxed));
+    return model;
 }
 
 bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
     std::lock_guard<std::mutex> lk(mMutex);
+    bool const added = addVsyncTimestampLocked(timestamp);
+    publishModel();
+    return added;
+}
 
+bool VSyncPredictor::addVsyncTimestampLocked(nsecs_t timestamp) {
     if (!validate(timestamp)) {
         // VSR could elect to ignore the incongruent timestamp or resetModel(). If ts is ignored,
         // don't insert this ts into mTimestamps ringbuffer. If we are still
@@ -100,6 +141,10 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
         mTimestamps[mLastTimestampIndex] = timestamp;
     }
 
+    // normalizing to the oldest timestamp cuts down on error in calculating the intercept.
+    mOldestTimestampIndex =
+            std::min_element(mTimestamps.begin(), mTimestamps.end()) - mTimestamps.begin();
+
     if (mTimestamps.size() < kMinimumSamplesForPrediction) {
         mRateMap[mIdealPeriod] = {mIdealPeriod, 0};
         return true;
@@ -123,8 +168,7 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
     std::vector<nsecs_t> vsyncTS(mTimestamps.size());
     std::vector<nsecs_t> ordinals(mTimestamps.size());
 
-    // normalizing to the oldest timestamp cuts down on error in calculating the intercept.
-    auto const oldest_ts = *std::min_element(mTimestamps.begin(), mTimestamps.end());
+    auto const oldest_ts = mTimestamps[mOldestTimestampIndex];
     auto it = mRateMap.find(mIdealPeriod);
     auto const currentPeriod = std::get<0>(it->second);
     // TODO (b/144707443): its important that there's some precision in the mean of the ordinals
@@ -181,18 +225,18 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
 }
 
 nsecs_t VSyncPredictor::nextAnticipatedVSyncTimeFrom(nsecs_t timePoint) const {
-    std::lock_guard<std::mutex> lk(mMutex);
-
-    auto const [slope, intercept] = getVSyncPredictionModel(lk);
+    auto const model = readModel();
+    auto const slope = model.slope;
+    auto const intercept = model.intercept;
 
-    if (mTimestamps.empty()) {
+    if (model.numTimestamps == 0) {
         traceInt64If("VSP-mode", 1);
-        auto const knownTimestamp = mKnownTimestamp ? *mKnownTimestamp : timePoint;
-        auto const numPeriodsOut = ((timePoint - knownTimestamp) / mIdealPeriod) + 1;
-        return knownTimestamp + numPeriodsOut * mIdealPeriod;
+        auto const knownTimestamp = model.knownTimestamp ? *model.knownTimestamp : timePoint;
+        auto const numPeriodsOut = ((timePoint - knownTimestamp) / model.idealPeriod) + 1;
+        return knownTimestamp + numPeriodsOut * model.idealPeriod;
     }
 
-    auto const oldest = *std::min_element(mTimestamps.begin(), mTimestamps.end());
+    auto const oldest = model.oldestTimestamp;
 
     // See b/145667109, the ordinal calculation must take into account the intercept.
     auto const zeroPoint = oldest + intercept;
@@ -203,7 +247,7 @@ nsecs_t VSyncPredictor::nextAnticipatedVSyncTimeFrom(nsecs_t timePoint) const {
     traceInt64If("VSP-timePoint", timePoint);
     traceInt64If("VSP-prediction", prediction);
 
-    auto const printer = [&, slope = slope, intercept = intercept] {
+    auto const printer = [&] {
         std::stringstream str;
         str << "prediction made from: " << timePoint << "prediction: " << prediction << " (+"
             << prediction - timePoint << ") slope: " << slope << " intercept: " << intercept
@@ -219,13 +263,8 @@ nsecs_t VSyncPredictor::nextAnticipatedVSyncTimeFrom(nsecs_t timePoint) const {
 }
 
 std::tuple<nsecs_t, nsecs_t> VSyncPredictor::getVSyncPredictionModel() const {
-    std::lock_guard<std::mutex> lk(mMutex);
-    return VSyncPredictor::getVSyncPredictionModel(lk);
-}
-
-std::tuple<nsecs_t, nsecs_t> VSyncPredictor::getVSyncPredictionModel(
-        std::lock_guard<std::mutex> const&) const {
-    return mRateMap.find(mIdealPeriod)->second;
+    auto const model = readModel();
+    return {model.slope, model.intercept};
 }
 
 void VSyncPredictor::setPeriod(nsecs_t period) {
@@ -243,6 +282,7 @@ void VSyncPredictor::setPeriod(nsecs_t period) {
     }
 
     clearTimestamps();
+    publishModel();
 }
 
 void VSyncPredictor::clearTimestamps() {
@@ -256,18 +296,19 @@ void VSyncPredictor::clearTimestamps() {
 
         mTimestamps.clear();
         mLastTimestampIndex = 0;
+        mOldestTimestampIndex = 0;
     }
 }
 
 bool VSyncPredictor::needsMoreSamples() const {
-    std::lock_guard<std::mutex> lk(mMutex);
-    return mTimestamps.size() < kMinimumSamplesForPrediction;
+    return readModel().numTimestamps < kMinimumSamplesForPrediction;
 }
 
 void VSyncPredictor::resetModel() {
     std::lock_guard<std::mutex> lk(mMutex);
     mRateMap[mIdealPeriod] = {mIdealPeriod, 0};
     clearTimestamps();
+    publishModel();
 }
 
 void VSyncPredictor::dump(std::string& result) const {
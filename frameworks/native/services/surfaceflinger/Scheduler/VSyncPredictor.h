@@ -17,6 +17,7 @@
 #pragma once
 
 #include <android-base/thread_annotations.h>
+#include <atomic>
 #include <mutex>
 #include <unordered_map>
 #include <vector>
@@ -65,6 +66,7 @@ private:
     VSyncPredictor(VSyncPredictor const&) = delete;
     VSyncPredictor& operator=(VSyncPredictor const&) = delete;
     void clearTimestamps() REQUIRES(mMutex);
+    bool addVsyncTimestampLocked(nsecs_t timestamp) REQUIRES(mMutex);
 
     inline void traceInt64If(const char* name, int64_t value) const;
     bool const mTraceOn;
@@ -76,8 +78,6 @@ private:
     std::mutex mutable mMutex;
     size_t next(int i) const REQUIRES(mMutex);
     bool validate(nsecs_t timestamp) const REQUIRES(mMutex);
-    std::tuple<nsecs_t, nsecs_t> getVSyncPredictionModel(std::lock_guard<std::mutex> const&) const
-            REQUIRES(mMutex);
 
     nsecs_t mIdealPeriod GUARDED_BY(mMutex);
     std::optional<nsecs_t> mKnownTimestamp GUARDED_BY(mMutex);
@@ -86,6 +86,33 @@ private:
 
     int mLastTimestampIndex GUARDED_BY(mMutex) = 0;
     std::vector<nsecs_t> mTimestamps GUARDED_BY(mMutex);
+
+    // Where the oldest timestamp is in mTimestamps; the regression is normalized to it.
+    size_t mOldestTimestampIndex GUARDED_BY(mMutex) = 0;
+
+    // What the queries need to know about the model. It is published by the writers, under
+    // mMutex, with a sequence lock, so that nextAnticipatedVSyncTimeFrom() and the other queries
+    // from the dispatch callbacks never wait for addVsyncTimestamp().
+    struct Model {
+        nsecs_t idealPeriod = 0;
+        nsecs_t slope = 0;
+        nsecs_t intercept = 0;
+        nsecs_t oldestTimestamp = 0;
+        std::optional<nsecs_t> knownTimestamp;
+        size_t numTimestamps = 0;
+    };
+    void publishModel() REQUIRES(mMutex);
+    Model readModel() const;
+
+    // Odd while publishModel() is writing the fields below.
+    std::atomic<uint32_t> mModelSequence = 0;
+    std::atomic<nsecs_t> mModelIdealPeriod = 0;
+    std::atomic<nsecs_t> mModelSlope = 0;
+    std::atomic<nsecs_t> mModelIntercept = 0;
+    std::atomic<nsecs_t> mModelOldestTimestamp = 0;
+    std::atomic<nsecs_t> mModelKnownTimestamp = 0;
+    std::atomic<bool> mModelHasKnownTimestamp = false;
+    std::atomic<size_t> mModelNumTimestamps = 0;
 };
 
 } // namespace android::scheduler
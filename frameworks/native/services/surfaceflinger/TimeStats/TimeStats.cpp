@@ -122,7 +122,9 @@ AStatsManager_PullAtomCallbackReturn TimeStats::populateGlobalAtom(AStatsEventLi
 }
 
 AStatsManager_PullAtomCallbackReturn TimeStats::populateLayerAtom(AStatsEventList* data) {
+    const auto shardLocks = lockLayerShards();
     std::lock_guard<std::mutex> lock(mMutex);
+    flushAllStagedFramesLocked();
 
     std::vector<TimeStatsHelper::TimeStatsLayer const*> dumpStats;
     for (const auto& ele : mTimeStats.stats) {
@@ -239,7 +241,7 @@ std::string TimeStats::miniDump() {
     std::string result = "TimeStats miniDump:\n";
     std::lock_guard<std::mutex> lock(mMutex);
     android::base::StringAppendF(&result, "Number of layers currently being tracked is %zu\n",
-                                 mTimeStatsTracker.size());
+                                 mNumLayerRecords.load());
     android::base::StringAppendF(&result, "Number of layers in the stats pool is %zu\n",
                                  mTimeStats.stats.size());
     return result;
@@ -385,10 +387,37 @@ bool TimeStats::recordReadyLocked(int32_t layerId, TimeRecord* timeRecord) {
     return true;
 }
 
-void TimeStats::flushAvailableRecordsToStatsLocked(int32_t layerId) {
+TimeStats::LayerShard& TimeStats::getLayerShard(int32_t layerId) {
+    return mLayerShards[static_cast<uint32_t>(layerId) % NUM_LAYER_SHARDS];
+}
+
+TimeStats::LayerShardLocks TimeStats::lockLayerShards() {
+    LayerShardLocks locks;
+    for (size_t i = 0; i < NUM_LAYER_SHARDS; i++) {
+        locks[i] = std::unique_lock<std::mutex>(mLayerShards[i].mutex);
+    }
+    return locks;
+}
+
+bool TimeStats::layerStatsExist(const std::string& layerName) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mTimeStats.stats.count(layerName) != 0;
+}
+
+void TimeStats::eraseLayerRecordLocked(LayerShard& shard, int32_t layerId) {
+    const auto it = shard.layers.find(layerId);
+    if (it == shard.layers.end()) return;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        flushStagedFramesLocked(it->second);
+    }
+    shard.layers.erase(it);
+    mNumLayerRecords--;
+}
+
+void TimeStats::flushAvailableRecordsToStatsLocked(int32_t layerId, LayerRecord& layerRecord) {
     ATRACE_CALL();
 
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
     TimeRecord& prevTimeRecord = layerRecord.prevTimeRecord;
     std::deque<TimeRecord>& timeRecords = layerRecord.timeRecords;
     while (!timeRecords.empty()) {
@@ -397,60 +426,80 @@ void TimeStats::flushAvailableRecordsToStatsLocked(int32_t layerId) {
               timeRecords[0].frameTime.frameNumber, timeRecords[0].frameTime.presentTime);
 
         if (prevTimeRecord.ready) {
-            const std::string& layerName = layerRecord.layerName;
-            if (!mTimeStats.stats.count(layerName)) {
-                mTimeStats.stats[layerName].layerName = layerName;
-            }
-            TimeStatsHelper::TimeStatsLayer& timeStatsLayer = mTimeStats.stats[layerName];
-            timeStatsLayer.totalFrames++;
-            timeStatsLayer.droppedFrames += layerRecord.droppedFrames;
-            timeStatsLayer.lateAcquireFrames += layerRecord.lateAcquireFrames;
-            timeStatsLayer.badDesiredPresentFrames += layerRecord.badDesiredPresentFrames;
-
+            const FrameTime& frameTime = timeRecords[0].frameTime;
+            // In the order of kHistogramNames.
+            const FrameDeltas deltas = {
+                    msBetween(prevTimeRecord.frameTime.presentTime, frameTime.presentTime),
+                    msBetween(frameTime.postTime, frameTime.presentTime),
+                    msBetween(frameTime.acquireTime, frameTime.presentTime),
+                    msBetween(frameTime.latchTime, frameTime.presentTime),
+                    msBetween(frameTime.desiredTime, frameTime.presentTime),
+                    msBetween(frameTime.postTime, frameTime.acquireTime),
+            };
+            ALOGV("[%d]-[%" PRIu64 "]-present2present[%d]-post2present[%d]-acquire2present[%d]"
+                  "-latch2present[%d]-desired2present[%d]-post2acquire[%d]",
+                  layerId, frameTime.frameNumber, deltas[0], deltas[1], deltas[2], deltas[3],
+                  deltas[4], deltas[5]);
+            layerRecord.stagedFrames.push_back(deltas);
+
+            layerRecord.stagedDroppedFrames += layerRecord.droppedFrames;
+            layerRecord.stagedLateAcquireFrames += layerRecord.lateAcquireFrames;
+            layerRecord.stagedBadDesiredPresentFrames += layerRecord.badDesiredPresentFrames;
             layerRecord.droppedFrames = 0;
             layerRecord.lateAcquireFrames = 0;
             layerRecord.badDesiredPresentFrames = 0;
-
-            const int32_t postToAcquireMs = msBetween(timeRecords[0].frameTime.postTime,
-                                                      timeRecords[0].frameTime.acquireTime);
-            ALOGV("[%d]-[%" PRIu64 "]-post2acquire[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, postToAcquireMs);
-            timeStatsLayer.deltas["post2acquire"].insert(postToAcquireMs);
-
-            const int32_t postToPresentMs = msBetween(timeRecords[0].frameTime.postTime,
-                                                      timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-post2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, postToPresentMs);
-            timeStatsLayer.deltas["post2present"].insert(postToPresentMs);
-
-            const int32_t acquireToPresentMs = msBetween(timeRecords[0].frameTime.acquireTime,
-                                                         timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-acquire2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, acquireToPresentMs);
-            timeStatsLayer.deltas["acquire2present"].insert(acquireToPresentMs);
-
-            const int32_t latchToPresentMs = msBetween(timeRecords[0].frameTime.latchTime,
-                                                       timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-latch2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, latchToPresentMs);
-            timeStatsLayer.deltas["latch2present"].insert(latchToPresentMs);
-
-            const int32_t desiredToPresentMs = msBetween(timeRecords[0].frameTime.desiredTime,
-                                                         timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-desired2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, desiredToPresentMs);
-            timeStatsLayer.deltas["desired2present"].insert(desiredToPresentMs);
-
-            const int32_t presentToPresentMs = msBetween(prevTimeRecord.frameTime.presentTime,
-                                                         timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-present2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, presentToPresentMs);
-            timeStatsLayer.deltas["present2present"].insert(presentToPresentMs);
         }
         prevTimeRecord = timeRecords[0];
         timeRecords.pop_front();
         layerRecord.waitData--;
     }
+
+    if (layerRecord.stagedFrames.size() >= LAYER_STATS_BATCH_SIZE) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        flushStagedFramesLocked(layerRecord);
+    }
+}
+
+void TimeStats::flushStagedFramesLocked(LayerRecord& layerRecord) {
+    if (layerRecord.stagedFrames.empty()) return;
+
+    ATRACE_CALL();
+
+    const auto [it, inserted] = mTimeStats.stats.try_emplace(layerRecord.layerName);
+    TimeStatsHelper::TimeStatsLayer& timeStatsLayer = it->second;
+    if (inserted) {
+        timeStatsLayer.layerName = layerRecord.layerName;
+        mNumLayerStats = mTimeStats.stats.size();
+    }
+    timeStatsLayer.totalFrames += layerRecord.stagedFrames.size();
+    timeStatsLayer.droppedFrames += layerRecord.stagedDroppedFrames;
+    timeStatsLayer.lateAcquireFrames += layerRecord.stagedLateAcquireFrames;
+    timeStatsLayer.badDesiredPresentFrames += layerRecord.stagedBadDesiredPresentFrames;
+
+    static_assert(std::tuple_size<FrameDeltas>::value ==
+                  std::tuple_size<decltype(kHistogramNames)>::value);
+    std::array<TimeStatsHelper::Histogram*, std::tuple_size<FrameDeltas>::value> histograms;
+    for (size_t i = 0; i < histograms.size(); i++) {
+        histograms[i] = &timeStatsLayer.deltas[kHistogramNames[i]];
+    }
+    for (const FrameDeltas& deltas : layerRecord.stagedFrames) {
+        for (size_t i = 0; i < histograms.size(); i++) {
+            histograms[i]->insert(deltas[i]);
+        }
+    }
+
+    layerRecord.stagedFrames.clear();
+    layerRecord.stagedDroppedFrames = 0;
+    layerRecord.stagedLateAcquireFrames = 0;
+    layerRecord.stagedBadDesiredPresentFrames = 0;
+}
+
+void TimeStats::flushAllStagedFramesLocked() {
+    for (LayerShard& shard : mLayerShards) {
+        for (auto& [layerId, layerRecord] : shard.layers) {
+            flushStagedFramesLocked(layerRecord);
+        }
+    }
 }
 
 static constexpr const char* kPopupWindowPrefix = "PopupWindow";
@@ -470,20 +519,27 @@ void TimeStats::setPostTime(int32_t layerId, uint64_t frameNumber, const std::st
     ALOGV("[%d]-[%" PRIu64 "]-[%s]-PostTime[%" PRId64 "]", layerId, frameNumber, layerName.c_str(),
           postTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStats.stats.count(layerName) && mTimeStats.stats.size() >= MAX_NUM_LAYER_STATS) {
+    if (mNumLayerStats.load() >= MAX_NUM_LAYER_STATS && !layerStatsExist(layerName)) {
         return;
     }
-    if (!mTimeStatsTracker.count(layerId) && mTimeStatsTracker.size() < MAX_NUM_LAYER_RECORDS &&
-        layerNameIsValid(layerName)) {
-        mTimeStatsTracker[layerId].layerName = layerName;
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.layers.find(layerId);
+    if (it == shard.layers.end()) {
+        if (!layerNameIsValid(layerName)) return;
+        if (mNumLayerRecords.fetch_add(1) >= MAX_NUM_LAYER_RECORDS) {
+            mNumLayerRecords--;
+            return;
+        }
+        it = shard.layers.try_emplace(layerId).first;
+        it->second.layerName = layerName;
+        it->second.stagedFrames.reserve(LAYER_STATS_BATCH_SIZE);
     }
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.timeRecords.size() == MAX_NUM_TIME_RECORDS) {
         ALOGE("[%d]-[%s]-timeRecords is at its maximum size[%zu]. Ignore this when unittesting.",
               layerId, layerRecord.layerName.c_str(), MAX_NUM_TIME_RECORDS);
-        mTimeStatsTracker.erase(layerId);
+        eraseLayerRecordLocked(shard, layerId);
         return;
     }
     // For most media content, the acquireFence is invalid because the buffer is
@@ -511,9 +567,11 @@ void TimeStats::setLatchTime(int32_t layerId, uint64_t frameNumber, nsecs_t latc
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-LatchTime[%" PRId64 "]", layerId, frameNumber, latchTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.layers.find(layerId);
+    if (it == shard.layers.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -530,9 +588,11 @@ void TimeStats::incrementLatchSkipped(int32_t layerId, LatchSkipReason reason) {
     ALOGV("[%d]-LatchSkipped-Reason[%d]", layerId,
           static_cast<std::underlying_type<LatchSkipReason>::type>(reason));
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.layers.find(layerId);
+    if (it == shard.layers.end()) return;
+    LayerRecord& layerRecord = it->second;
 
     switch (reason) {
         case LatchSkipReason::LateAcquire:
@@ -547,9 +607,11 @@ void TimeStats::incrementBadDesiredPresent(int32_t layerId) {
     ATRACE_CALL();
     ALOGV("[%d]-BadDesiredPresent", layerId);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.layers.find(layerId);
+    if (it == shard.layers.end()) return;
+    LayerRecord& layerRecord = it->second;
     layerRecord.badDesiredPresentFrames++;
 }
 
@@ -559,9 +621,11 @@ void TimeStats::setDesiredTime(int32_t layerId, uint64_t frameNumber, nsecs_t de
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-DesiredTime[%" PRId64 "]", layerId, frameNumber, desiredTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.layers.find(layerId);
+    if (it == shard.layers.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -577,9 +641,11 @@ void TimeStats::setAcquireTime(int32_t layerId, uint64_t frameNumber, nsecs_t ac
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-AcquireTime[%" PRId64 "]", layerId, frameNumber, acquireTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.layers.find(layerId);
+    if (it == shard.layers.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -597,9 +663,11 @@ void TimeStats::setAcquireFence(int32_t layerId, uint64_t frameNumber,
     ALOGV("[%d]-[%" PRIu64 "]-AcquireFenceTime[%" PRId64 "]", layerId, frameNumber,
           acquireFence->getSignalTime());
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.layers.find(layerId);
+    if (it == shard.layers.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -615,9 +683,11 @@ void TimeStats::setPresentTime(int32_t layerId, uint64_t frameNumber, nsecs_t pr
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-PresentTime[%" PRId64 "]", layerId, frameNumber, presentTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.layers.find(layerId);
+    if (it == shard.layers.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -628,7 +698,7 @@ void TimeStats::setPresentTime(int32_t layerId, uint64_t frameNumber, nsecs_t pr
         layerRecord.waitData++;
     }
 
-    flushAvailableRecordsToStatsLocked(layerId);
+    flushAvailableRecordsToStatsLocked(layerId, layerRecord);
 }
 
 void TimeStats::setPresentFence(int32_t layerId, uint64_t frameNumber,
@@ -639,9 +709,11 @@ void TimeStats::setPresentFence(int32_t layerId, uint64_t frameNumber,
     ALOGV("[%d]-[%" PRIu64 "]-PresentFenceTime[%" PRId64 "]", layerId, frameNumber,
           presentFence->getSignalTime());
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.layers.find(layerId);
+    if (it == shard.layers.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -652,14 +724,15 @@ void TimeStats::setPresentFence(int32_t layerId, uint64_t frameNumber,
         layerRecord.waitData++;
     }
 
-    flushAvailableRecordsToStatsLocked(layerId);
+    flushAvailableRecordsToStatsLocked(layerId, layerRecord);
 }
 
 void TimeStats::onDestroy(int32_t layerId) {
     ATRACE_CALL();
     ALOGV("[%d]-onDestroy", layerId);
-    std::lock_guard<std::mutex> lock(mMutex);
-    mTimeStatsTracker.erase(layerId);
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    eraseLayerRecordLocked(shard, layerId);
 }
 
 void TimeStats::removeTimeRecord(int32_t layerId, uint64_t frameNumber) {
@@ -668,9 +741,11 @@ void TimeStats::removeTimeRecord(int32_t layerId, uint64_t frameNumber) {
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-removeTimeRecord", layerId, frameNumber);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.layers.find(layerId);
+    if (it == shard.layers.end()) return;
+    LayerRecord& layerRecord = it->second;
     size_t removeAt = 0;
     for (const TimeRecord& record : layerRecord.timeRecords) {
         if (record.frameTime.frameNumber == frameNumber) break;
@@ -839,6 +914,7 @@ void TimeStats::disable() {
 }
 
 void TimeStats::clearAll() {
+    const auto shardLocks = lockLayerShards();
     std::lock_guard<std::mutex> lock(mMutex);
     clearGlobalLocked();
     clearLayersLocked();
@@ -870,8 +946,12 @@ void TimeStats::clearGlobalLocked() {
 void TimeStats::clearLayersLocked() {
     ATRACE_CALL();
 
-    mTimeStatsTracker.clear();
+    for (LayerShard& shard : mLayerShards) {
+        shard.layers.clear();
+    }
+    mNumLayerRecords = 0;
     mTimeStats.stats.clear();
+    mNumLayerStats = 0;
     ALOGD("Cleared layer stats");
 }
 
@@ -882,6 +962,7 @@ bool TimeStats::isEnabled() {
 void TimeStats::dump(bool asProto, std::optional<uint32_t> maxLayers, std::string& result) {
     ATRACE_CALL();
 
+    const auto shardLocks = lockLayerShards();
     std::lock_guard<std::mutex> lock(mMutex);
     if (mTimeStats.statsStart == 0) {
         return;
@@ -889,6 +970,8 @@ void TimeStats::dump(bool asProto, std::optional<uint32_t> maxLayers, std::strin
 
     mTimeStats.statsEnd = static_cast<int64_t>(std::time(0));
 
+    flushAllStagedFramesLocked();
+
     flushPowerTimeLocked();
 
     if (asProto) {
@@ -34,11 +34,14 @@
 #include <utils/String16.h>
 #include <utils/Vector.h>
 
+#include <array>
+#include <atomic>
 #include <deque>
 #include <mutex>
 #include <optional>
 #include <unordered_map>
 #include <variant>
+#include <vector>
 
 using namespace android::surfaceflinger;
 
@@ -141,6 +144,10 @@ class TimeStats : public android::TimeStats {
         std::shared_ptr<FenceTime> presentFence;
     };
 
+    // The deltas of a presented frame in milliseconds, in the order of the
+    // layer histograms in SurfaceflingerStatsLayerInfo.
+    using FrameDeltas = std::array<int32_t, 6>;
+
     struct LayerRecord {
         std::string layerName;
         // This is the index in timeRecords, at which the timestamps for that
@@ -152,6 +159,20 @@ class TimeStats : public android::TimeStats {
         uint32_t badDesiredPresentFrames = 0;
         TimeRecord prevTimeRecord;
         std::deque<TimeRecord> timeRecords;
+        // Presented frames and their counters that are not yet in mTimeStats.
+        // They are added in batches of LAYER_STATS_BATCH_SIZE frames, so that
+        // mMutex and the per-name histograms are not looked up for every frame.
+        std::vector<FrameDeltas> stagedFrames;
+        uint32_t stagedDroppedFrames = 0;
+        uint32_t stagedLateAcquireFrames = 0;
+        uint32_t stagedBadDesiredPresentFrames = 0;
+    };
+
+    // The layer records are split by layer id, so that the buffer queue
+    // threads and the main thread updating different layers do not contend.
+    struct LayerShard {
+        std::mutex mutex;
+        std::unordered_map<int32_t, LayerRecord> layers;
     };
 
     struct PowerTime {
@@ -265,6 +286,7 @@ public:
     void setPresentFenceGlobal(const std::shared_ptr<FenceTime>& presentFence) override;
 
     static const size_t MAX_NUM_TIME_RECORDS = 64;
+    static const size_t NUM_LAYER_SHARDS = 8;
 
 private:
     static AStatsManager_PullAtomCallbackReturn pullAtomCallback(int32_t atom_tag,
@@ -272,8 +294,16 @@ private:
                                                                  void* cookie);
     AStatsManager_PullAtomCallbackReturn populateGlobalAtom(AStatsEventList* data);
     AStatsManager_PullAtomCallbackReturn populateLayerAtom(AStatsEventList* data);
+    LayerShard& getLayerShard(int32_t layerId);
+    // Locks all of the layer shards, in order. mMutex may only be taken after them.
+    using LayerShardLocks = std::array<std::unique_lock<std::mutex>, NUM_LAYER_SHARDS>;
+    LayerShardLocks lockLayerShards();
+    bool layerStatsExist(const std::string& layerName);
+    void eraseLayerRecordLocked(LayerShard& shard, int32_t layerId);
     bool recordReadyLocked(int32_t layerId, TimeRecord* timeRecord);
-    void flushAvailableRecordsToStatsLocked(int32_t layerId);
+    void flushAvailableRecordsToStatsLocked(int32_t layerId, LayerRecord& layerRecord);
+    void flushStagedFramesLocked(LayerRecord& layerRecord);
+    void flushAllStagedFramesLocked();
     void flushPowerTimeLocked();
     void flushAvailableGlobalRecordsToStatsLocked();
 
@@ -285,15 +315,22 @@ private:
     void dump(bool asProto, std::optional<uint32_t> maxLayers, std::string& result);
 
     std::atomic<bool> mEnabled = false;
+    // Guards mTimeStats, mPowerTime and mGlobalRecord. When a layer shard is
+    // locked as well, its mutex must be taken first.
     std::mutex mMutex;
     TimeStatsHelper::TimeStatsGlobal mTimeStats;
-    // Hashmap for LayerRecord with layerId as the hash key
-    std::unordered_map<int32_t, LayerRecord> mTimeStatsTracker;
+    // LayerRecords by layerId, split into shards by layerId.
+    std::array<LayerShard, NUM_LAYER_SHARDS> mLayerShards;
+    // The number of LayerRecords in all of the shards, and of layers in
+    // mTimeStats.stats, so that the limits can be checked without locking.
+    std::atomic<size_t> mNumLayerRecords = 0;
+    std::atomic<size_t> mNumLayerStats = 0;
     PowerTime mPowerTime;
     GlobalRecord mGlobalRecord;
 
     static const size_t MAX_NUM_LAYER_RECORDS = 200;
     static const size_t MAX_NUM_LAYER_STATS = 200;
+    static const size_t LAYER_STATS_BATCH_SIZE = 16;
     std::unique_ptr<StatsEventDelegate> mStatsDelegate = std::make_unique<StatsEventDelegate>();
     size_t mMaxPulledLayers = 8;
     size_t mMaxPulledHistogramBuckets = 6;
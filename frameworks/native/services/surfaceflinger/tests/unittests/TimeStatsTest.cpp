@@ -585,6 +585,36 @@ TEST_F(TimeStatsTest, canInsertMultipleLayersTimeStats) {
     EXPECT_EQ(2, globalProto.stats_size());
 }
 
+TEST_F(TimeStatsTest, canInsertManyFramesTimeStats) {
+    EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
+
+    // More frames than are staged in a layer record before they are added to the stats.
+    for (uint64_t frameNumber = 1; frameNumber <= 40; frameNumber++) {
+        insertTimeRecord(NORMAL_SEQUENCE, LAYER_ID_0, frameNumber, frameNumber * 1000000);
+    }
+    ASSERT_NO_FATAL_FAILURE(mTimeStats->incrementBadDesiredPresent(LAYER_ID_0));
+    insertTimeRecord(NORMAL_SEQUENCE, LAYER_ID_0, 41, 41000000);
+
+    SFTimeStatsGlobalProto globalProto;
+    ASSERT_TRUE(globalProto.ParseFromString(inputCommand(InputCommand::DUMP_ALL, FMT_PROTO)));
+
+    ASSERT_EQ(1, globalProto.stats_size());
+    const SFTimeStatsLayerProto& layerProto = globalProto.stats().Get(0);
+    EXPECT_EQ(40, layerProto.total_frames());
+    ASSERT_EQ(6, layerProto.deltas_size());
+    for (const SFTimeStatsDeltaProto& deltaProto : layerProto.deltas()) {
+        int32_t frames = 0;
+        for (const SFTimeStatsHistogramBucketProto& bucket : deltaProto.histograms()) {
+            frames += bucket.frame_count();
+        }
+        EXPECT_EQ(40, frames) << deltaProto.delta_name();
+    }
+
+    // The counters are not in the proto, so check them in the string dump.
+    EXPECT_THAT(inputCommand(InputCommand::DUMP_ALL, FMT_STRING),
+                HasSubstr("badDesiredPresentFrames = 1"));
+}
+
 TEST_F(TimeStatsTest, canInsertUnorderedLayerTimeStats) {
     EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
 
@@ -1186,6 +1216,56 @@ TEST_F(TimeStatsTest, layerStatsCallback_limitsLayers) {
                                               mDelegate->mCookie));
 }
 
+// Not a correctness test: reports the time it takes to record a frame of every
+// layer, with TimeStats enabled and disabled, as the "enabledNsPerFrame" and
+// "disabledNsPerFrame" properties of the test.
+TEST_F(TimeStatsTest, perFrameOverheadBenchmark) {
+    if (g_noSlowTests) {
+        GTEST_SKIP();
+    }
+
+    constexpr int32_t kNumLayers = 50;
+    constexpr uint64_t kNumFrames = 2000;
+    std::vector<std::string> layerNames;
+    for (int32_t layerId = 0; layerId < kNumLayers; layerId++) {
+        layerNames.push_back(genLayerName(layerId));
+    }
+
+    uint64_t frameNumber = 0;
+    const auto recordFrames = [&] {
+        const nsecs_t start = systemTime();
+        for (uint64_t i = 0; i < kNumFrames; i++) {
+            frameNumber++;
+            const nsecs_t ts = frameNumber * 16666667;
+            for (int32_t layerId = 0; layerId < kNumLayers; layerId++) {
+                mTimeStats->setPostTime(layerId, frameNumber, layerNames[layerId], ts);
+                mTimeStats->setAcquireTime(layerId, frameNumber, ts + 1000000);
+                mTimeStats->setLatchTime(layerId, frameNumber, ts + 2000000);
+                mTimeStats->setDesiredTime(layerId, frameNumber, ts + 3000000);
+                mTimeStats->setPresentTime(layerId, frameNumber, ts + 4000000);
+            }
+        }
+        return (systemTime() - start) / static_cast<nsecs_t>(kNumFrames);
+    };
+
+    const nsecs_t disabledNsPerFrame = recordFrames();
+    EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
+    const nsecs_t enabledNsPerFrame = recordFrames();
+
+    ALOGD("TimeStats per-frame overhead with %d layers: enabled %" PRId64 "ns, disabled %" PRId64
+          "ns",
+          kNumLayers, enabledNsPerFrame, disabledNsPerFrame);
+    RecordProperty("enabledNsPerFrame", std::to_string(enabledNsPerFrame));
+    RecordProperty("disabledNsPerFrame", std::to_string(disabledNsPerFrame));
+
+    SFTimeStatsGlobalProto globalProto;
+    ASSERT_TRUE(globalProto.ParseFromString(inputCommand(InputCommand::DUMP_ALL, FMT_PROTO)));
+    ASSERT_EQ(kNumLayers, globalProto.stats_size());
+    for (const SFTimeStatsLayerProto& layerProto : globalProto.stats()) {
+        EXPECT_EQ(static_cast<int32_t>(kNumFrames - 1), layerProto.total_frames());
+    }
+}
+
 TEST_F(TimeStatsTest, canSurviveMonkey) {
     if (g_noSlowTests) {
         GTEST_SKIP();
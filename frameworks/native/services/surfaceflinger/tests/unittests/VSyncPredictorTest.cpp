@@ -23,11 +23,15 @@
 #define LOG_NDEBUG 0
 
 #include "Scheduler/VSyncPredictor.h"
+#include "libsurfaceflinger_unittest_main.h"
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <log/log.h>
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <thread>
 #include <utility>
 
 using namespace testing;
@@ -464,6 +468,63 @@ TEST_F(VSyncPredictorTest, InconsistentVsyncValueIsFlushedEventually) {
     EXPECT_FALSE(tracker.needsMoreSamples());
 }
 
+TEST_F(VSyncPredictorTest, updateAndQueryCostAt120Hz) {
+    if (g_noSlowTests) {
+        GTEST_SKIP();
+    }
+
+    // The values the scheduler uses, with as many queries per vsync as there are callbacks in
+    // a busy VSyncDispatchTimerQueue.
+    constexpr nsecs_t kPeriod = 8333333;
+    constexpr size_t kNumVsyncs = 2000;
+    constexpr size_t kNumCallbacks = 64;
+    constexpr size_t kNumReaderThreads = 3;
+    VSyncPredictor predictor{kPeriod, 20, 6, 20};
+
+    // Other threads query the model all the time, so the updates and the queries below are
+    // measured while there is contention on it.
+    std::atomic<bool> done = false;
+    std::atomic<nsecs_t> lastVsync = 0;
+    std::vector<std::thread> readers;
+    for (size_t i = 0; i < kNumReaderThreads; i++) {
+        readers.emplace_back([&] {
+            while (!done) {
+                const nsecs_t vsync = lastVsync;
+                EXPECT_GT(predictor.nextAnticipatedVSyncTimeFrom(vsync), vsync);
+            }
+        });
+    }
+
+    nsecs_t updateTime = 0;
+    nsecs_t queryTime = 0;
+    for (size_t i = 1; i <= kNumVsyncs; i++) {
+        const nsecs_t vsync = i * kPeriod;
+        nsecs_t start = systemTime();
+        predictor.addVsyncTimestamp(vsync);
+        updateTime += systemTime() - start;
+        lastVsync = vsync;
+
+        start = systemTime();
+        for (size_t j = 0; j < kNumCallbacks; j++) {
+            const nsecs_t prediction = predictor.nextAnticipatedVSyncTimeFrom(vsync + j);
+            EXPECT_THAT(prediction, IsCloseTo(vsync + kPeriod, mMaxRoundingError));
+        }
+        queryTime += systemTime() - start;
+    }
+
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    const nsecs_t nsPerUpdate = updateTime / static_cast<nsecs_t>(kNumVsyncs);
+    const nsecs_t nsPerQuery = queryTime / static_cast<nsecs_t>(kNumVsyncs * kNumCallbacks);
+    ALOGD("VSyncPredictor at 120Hz with %zu readers: update %" PRId64 "ns, query %" PRId64 "ns",
+          kNumReaderThreads, nsPerUpdate, nsPerQuery);
+    RecordProperty("nsPerUpdate", std::to_string(nsPerUpdate));
+    RecordProperty("nsPerQuery", std::to_string(nsPerQuery));
+}
+
 } // namespace android::scheduler
 
 // TODO(b/129481165): remove the #pragma below and fix conversion issues
@@ -21,6 +21,130 @@
 namespace android {
 namespace stats_log_api_gen {
 
+// AStatsEvent encoding of pushed atoms, keep in sync with stats_event.c.
+static const int STATS_EVENT_INT32_TYPE = 0x00;
+static const int STATS_EVENT_INT64_TYPE = 0x01;
+static const int STATS_EVENT_FLOAT_TYPE = 0x04;
+static const int STATS_EVENT_BOOL_TYPE = 0x05;
+static const int STATS_EVENT_OBJECT_TYPE = 0x07;
+static const size_t STATS_EVENT_MAX_ELEMENTS = 127;
+
+/**
+ * Returns the AStatsEvent type id of a fixed-size field and sets *size to the
+ * encoded size of its value, or returns -1 for variable-length fields.
+ */
+static int fixed_size_type_id(java_type_t type, size_t* size) {
+    switch (type) {
+        case JAVA_TYPE_BOOLEAN:
+            *size = sizeof(uint8_t);
+            return STATS_EVENT_BOOL_TYPE;
+        case JAVA_TYPE_INT:  // Fall through.
+        case JAVA_TYPE_ENUM:
+            *size = sizeof(int32_t);
+            return STATS_EVENT_INT32_TYPE;
+        case JAVA_TYPE_LONG:
+            *size = sizeof(int64_t);
+            return STATS_EVENT_INT64_TYPE;
+        case JAVA_TYPE_FLOAT:
+            *size = sizeof(float);
+            return STATS_EVENT_FLOAT_TYPE;
+        default:
+            return -1;
+    }
+}
+
+bool is_fixed_size_signature(const vector<java_type_t>& signature) {
+    // The timestamp and the atom id are elements too.
+    if (signature.size() + 2 > STATS_EVENT_MAX_ELEMENTS) {
+        return false;
+    }
+    size_t size;
+    for (const java_type_t arg : signature) {
+        if (fixed_size_type_id(arg, &size) < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void write_native_fixed_size_helpers(FILE* out) {
+    fprintf(out, "namespace {\n");
+    fprintf(out, "\n");
+    fprintf(out, "// Atoms of only fixed-size fields are serialized straight into a stack buffer,\n");
+    fprintf(out, "// in the AStatsEvent encoding, at offsets computed by stats-log-api-gen.\n");
+    fprintf(out, "template <typename T>\n");
+    fprintf(out, "inline void writeFixedSizeField(uint8_t* buf, size_t pos, uint8_t typeId, "
+                 "T value) {\n");
+    fprintf(out, "    buf[pos] = typeId;\n");
+    fprintf(out, "    memcpy(&buf[pos + 1], &value, sizeof(value));\n");
+    fprintf(out, "}\n");
+    fprintf(out, "\n");
+    fprintf(out, "inline int64_t getElapsedRealtimeNs() {\n");
+    fprintf(out, "    struct timespec t = {0, 0};\n");
+    fprintf(out, "    clock_gettime(CLOCK_BOOTTIME, &t);\n");
+    fprintf(out, "    return static_cast<int64_t>(t.tv_sec) * 1000000000LL + t.tv_nsec;\n");
+    fprintf(out, "}\n");
+    fprintf(out, "\n");
+    fprintf(out, "}  // namespace\n");
+}
+
+/**
+ * Writes the one pass serialization of a fixed-size signature. Atoms with
+ * annotations, and invalid atom ids, are left to the AStatsEvent path that follows.
+ */
+static void write_native_fixed_size_body(FILE* out, const vector<java_type_t>& signature,
+                                         const FieldNumberToAtomDeclSet& fieldNumberToAtomDeclSet) {
+    AtomDeclSet annotatedAtoms;
+    for (const auto& [fieldNumber, atomDeclSet] : fieldNumberToAtomDeclSet) {
+        annotatedAtoms.insert(atomDeclSet.begin(), atomDeclSet.end());
+    }
+    fprintf(out, "    if (code > 0");
+    for (const shared_ptr<AtomDecl>& atomDecl : annotatedAtoms) {
+        fprintf(out, " && code != %s", make_constant_name(atomDecl->name).c_str());
+    }
+    fprintf(out, ") {\n");
+
+    // Object type and element count, then the timestamp and the atom id.
+    size_t pos = 2;
+    vector<string> writes;
+    char line[256];
+    snprintf(line, sizeof(line),
+             "        writeFixedSizeField(buf, %zu, %d, getElapsedRealtimeNs());\n", pos,
+             STATS_EVENT_INT64_TYPE);
+    writes.push_back(line);
+    pos += 1 + sizeof(int64_t);
+    snprintf(line, sizeof(line), "        writeFixedSizeField(buf, %zu, %d, code);\n", pos,
+             STATS_EVENT_INT32_TYPE);
+    writes.push_back(line);
+    pos += 1 + sizeof(int32_t);
+
+    int argIndex = 1;
+    for (const java_type_t arg : signature) {
+        size_t size = 0;
+        const int typeId = fixed_size_type_id(arg, &size);
+        if (arg == JAVA_TYPE_BOOLEAN) {
+            snprintf(line, sizeof(line),
+                     "        writeFixedSizeField(buf, %zu, %d, static_cast<uint8_t>(arg%d));\n",
+                     pos, typeId, argIndex);
+        } else {
+            snprintf(line, sizeof(line), "        writeFixedSizeField(buf, %zu, %d, arg%d);\n",
+                     pos, typeId, argIndex);
+        }
+        writes.push_back(line);
+        pos += 1 + size;
+        argIndex++;
+    }
+
+    fprintf(out, "        uint8_t buf[%zu];\n", pos);
+    fprintf(out, "        buf[0] = %d;\n", STATS_EVENT_OBJECT_TYPE);
+    fprintf(out, "        buf[1] = %zu;\n", signature.size() + 2);
+    for (const string& write : writes) {
+        fprintf(out, "%s", write.c_str());
+    }
+    fprintf(out, "        return AStatsSocket_write(buf, sizeof(buf), code);\n");
+    fprintf(out, "    }\n");
+}
+
 static void write_native_annotation_constants(FILE* out) {
     fprintf(out, "// Annotation constants.\n");
 
@@ -205,6 +329,9 @@ static int write_native_stats_write_methods(FILE* out, const SignatureInfoMap& s
             }
             fprintf(out, "    return event.writeToSocket();\n"); // end method body.
         } else {
+            if (minApiLevel > API_R && is_fixed_size_signature(signature)) {
+                write_native_fixed_size_body(out, signature, fieldNumberToAtomDeclSet);
+            }
             fprintf(out, "    AStatsEvent* event = AStatsEvent_obtain();\n");
             int ret = write_native_method_body(out, signature, fieldNumberToAtomDeclSet,
                                                attributionDecl, minApiLevel);
@@ -321,17 +448,22 @@ int write_stats_log_cpp(FILE* out, const Atoms& atoms, const AtomDecl& attributi
 
     if (minApiLevel > API_R) {
         fprintf(out, "#include <stats_annotations.h>\n");
+        fprintf(out, "#include <stats_socket.h>\n");
+        fprintf(out, "#include <string.h>\n");
+        fprintf(out, "#include <time.h>\n");
     }
 
     if (minApiLevel > API_Q && !atoms.pulledAtomsSignatureInfoMap.empty()) {
         fprintf(out, "#include <stats_pull_atom_callback.h>\n");
     }
-
-
-
     fprintf(out, "\n");
     write_namespace(out, cppNamespace);
 
+    if (minApiLevel > API_R) {
+        fprintf(out, "\n");
+        write_native_fixed_size_helpers(out);
+    }
+
     write_native_stats_write_methods(out, atoms.signatureInfoMap, attributionDecl, minApiLevel);
     write_native_stats_write_non_chained_methods(out, atoms.nonChainedSignatureInfoMap,
                                                  attributionDecl);
@@ -25,6 +25,9 @@
 namespace android {
 namespace stats_log_api_gen {
 
+// Returns whether stats_write can serialize the signature without an AStatsEvent.
+bool is_fixed_size_signature(const vector<java_type_t>& signature);
+
 int write_stats_log_cpp(FILE* out, const Atoms& atoms, const AtomDecl& attributionDecl,
                         const string& cppNamespace, const string& importHeader,
                         const int minApiLevel);
@@ -16,9 +16,12 @@
 
 #include <gtest/gtest.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "Collation.h"
 #include "frameworks/proto_logging/stats/stats_log_api_gen/test.pb.h"
+#include "native_writer.h"
+#include "utils.h"
 
 namespace android {
 namespace stats_log_api_gen {
@@ -42,6 +45,26 @@ static bool map_contains_vector(const SignatureInfoMap& s, int count, ...) {
     return s.find(v) != s.end();
 }
 
+/**
+ * Returns the stats_write implementations generated for the atoms.
+ */
+static string generate_stats_log_cpp(const Atoms& atoms, const int minApiLevel) {
+    AtomDecl attributionDecl;
+    vector<java_type_t> attributionSignature;
+    collate_atom(android::os::statsd::AttributionNode::descriptor(), &attributionDecl,
+                 &attributionSignature);
+
+    char* buffer = nullptr;
+    size_t size = 0;
+    FILE* out = open_memstream(&buffer, &size);
+    write_stats_log_cpp(out, atoms, attributionDecl, DEFAULT_CPP_NAMESPACE,
+                        DEFAULT_CPP_HEADER_IMPORT, minApiLevel);
+    fclose(out);
+    string cpp(buffer, size);
+    free(buffer);
+    return cpp;
+}
+
 /**
  * Expect that the provided map contains the elements provided.
  */
@@ -428,5 +451,91 @@ TEST(CollationTest, CollatePushedAndPulledAtoms) {
     EXPECT_EQ(atoms.decls.end(), atomIt);
 }
 
+TEST(CollationTest, FixedSizeSignatures) {
+    EXPECT_TRUE(is_fixed_size_signature({}));
+    EXPECT_TRUE(is_fixed_size_signature(
+            {JAVA_TYPE_INT, JAVA_TYPE_LONG, JAVA_TYPE_FLOAT, JAVA_TYPE_BOOLEAN, JAVA_TYPE_ENUM}));
+    EXPECT_FALSE(is_fixed_size_signature({JAVA_TYPE_INT, JAVA_TYPE_STRING}));
+    EXPECT_FALSE(is_fixed_size_signature({JAVA_TYPE_BYTE_ARRAY}));
+    EXPECT_FALSE(is_fixed_size_signature({JAVA_TYPE_ATTRIBUTION_CHAIN, JAVA_TYPE_INT}));
+    // The timestamp and the atom id leave room for 125 fields.
+    EXPECT_TRUE(is_fixed_size_signature(vector<java_type_t>(125, JAVA_TYPE_INT)));
+    EXPECT_FALSE(is_fixed_size_signature(vector<java_type_t>(126, JAVA_TYPE_INT)));
+}
+
+/**
+ * Test the one pass serialization of atoms with only fixed-size fields.
+ */
+TEST(CollationTest, GenerateFixedSizeWriters) {
+    Atoms atoms;
+    int errorCount = collate_atoms(Event::descriptor(), DEFAULT_MODULE_NAME, &atoms);
+    EXPECT_EQ(0, errorCount);
+
+    const string cpp = generate_stats_log_cpp(atoms, API_LEVEL_CURRENT);
+
+    // IntAtom, AnotherIntAtom
+    EXPECT_NE(string::npos,
+              cpp.find("int stats_write(int32_t code, int32_t arg1) {\n"
+                       "    if (code > 0) {\n"
+                       "        uint8_t buf[21];\n"
+                       "        buf[0] = 7;\n"
+                       "        buf[1] = 3;\n"
+                       "        writeFixedSizeField(buf, 2, 1, getElapsedRealtimeNs());\n"
+                       "        writeFixedSizeField(buf, 11, 0, code);\n"
+                       "        writeFixedSizeField(buf, 16, 0, arg1);\n"
+                       "        return AStatsSocket_write(buf, sizeof(buf), code);\n"
+                       "    }\n"
+                       "    AStatsEvent* event = AStatsEvent_obtain();\n"));
+
+    // OutOfOrderAtom
+    EXPECT_NE(string::npos,
+              cpp.find("int stats_write(int32_t code, int32_t arg1, int32_t arg2) {\n"
+                       "    if (code > 0) {\n"
+                       "        uint8_t buf[26];\n"
+                       "        buf[0] = 7;\n"
+                       "        buf[1] = 4;\n"
+                       "        writeFixedSizeField(buf, 2, 1, getElapsedRealtimeNs());\n"
+                       "        writeFixedSizeField(buf, 11, 0, code);\n"
+                       "        writeFixedSizeField(buf, 16, 0, arg1);\n"
+                       "        writeFixedSizeField(buf, 21, 0, arg2);\n"
+                       "        return AStatsSocket_write(buf, sizeof(buf), code);\n"
+                       "    }\n"));
+
+    // AllTypesAtom has an attribution chain and a string, so it is only written dynamically.
+    const size_t allTypesPos = cpp.find(
+            "int stats_write(int32_t code, const int32_t* uid, size_t uid_length, "
+            "const std::vector<char const*>& tag, float arg2,");
+    ASSERT_NE(string::npos, allTypesPos);
+    const string dynamicBody = "    AStatsEvent* event = AStatsEvent_obtain();\n";
+    const size_t bodyPos = cpp.find(") {\n", allTypesPos) + strlen(") {\n");
+    EXPECT_EQ(dynamicBody, cpp.substr(bodyPos, dynamicBody.size()));
+}
+
+TEST(CollationTest, GenerateFixedSizeWritersSkipsAnnotatedAtoms) {
+    Atoms atoms;
+    int errorCount = collate_atoms(GoodStateAtoms::descriptor(), DEFAULT_MODULE_NAME, &atoms);
+    EXPECT_EQ(0, errorCount);
+
+    const string cpp = generate_stats_log_cpp(atoms, API_LEVEL_CURRENT);
+
+    // Both atoms have state annotations, which are only written by the AStatsEvent path.
+    EXPECT_NE(string::npos,
+              cpp.find("int stats_write(int32_t code, int32_t arg1, int32_t arg2) {\n"
+                       "    if (code > 0 && code != GOOD1 && code != GOOD2) {\n"));
+}
+
+TEST(CollationTest, GenerateDynamicWritersForR) {
+    Atoms atoms;
+    int errorCount = collate_atoms(Event::descriptor(), DEFAULT_MODULE_NAME, &atoms);
+    EXPECT_EQ(0, errorCount);
+
+    // AStatsSocket_write is not available before S.
+    const string cpp = generate_stats_log_cpp(atoms, API_R);
+    EXPECT_EQ(string::npos, cpp.find("AStatsSocket_write"));
+    EXPECT_NE(string::npos,
+              cpp.find("int stats_write(int32_t code, int32_t arg1) {\n"
+                       "    AStatsEvent* event = AStatsEvent_obtain();\n"));
+}
+
 }  // namespace stats_log_api_gen
 }  // namespace android
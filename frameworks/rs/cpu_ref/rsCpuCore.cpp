@@ -28,6 +28,7 @@
 #include <sys/syscall.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #define REDUCE_ALOGV(mtls, level, ...) do { if ((mtls)->logReduce >= (level)) ALOGV(__VA_ARGS__); } while(0)
@@ -40,6 +41,27 @@ namespace android {
 namespace renderscript {
 
 bool gArchUseSIMD = false;
+#if defined(ARCH_X86_HAVE_SSSE3)
+bool gArchUseAVX2 = false;
+#endif
+
+// How long idle threads spin before going to sleep.  Launches usually come in
+// bursts, so this hides the futex wake up latency for all but the first one.
+static const int64_t kSpinTimeNs = 50 * 1000;
+
+static int64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static inline void cpuRelax() {
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__arm__) || defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
 
 RsdCpuReference::~RsdCpuReference() {
 }
@@ -98,6 +120,39 @@ RsdCpuReferenceImpl::RsdCpuReferenceImpl(Context *rsc) {
 }
 
 
+// Wait until the launch generation moves past *generation, which is then
+// updated.  The thread spins for a short while first, then sleeps on its
+// launch signal after telling launchThreads() that it needs to be woken up.
+void RsdCpuReferenceImpl::waitForLaunch(uint32_t idx, uint32_t *generation) {
+    volatile uint32_t *launchGeneration = &mWorkers.mLaunchGeneration;
+    const int64_t spinEnd = nowNs() + kSpinTimeNs;
+
+    for (uint32_t ct = 1; ; ct++) {
+        uint32_t g = __atomic_load_n(launchGeneration, __ATOMIC_ACQUIRE);
+        if (g != *generation) {
+            *generation = g;
+            return;
+        }
+        if ((ct % 64) == 0 && nowNs() > spinEnd) {
+            break;
+        }
+        cpuRelax();
+    }
+
+    while (true) {
+        __atomic_store_n(&mWorkers.mSleeping[idx], 1, __ATOMIC_SEQ_CST);
+        uint32_t g = __atomic_load_n(launchGeneration, __ATOMIC_SEQ_CST);
+        if (g != *generation) {
+            __atomic_store_n(&mWorkers.mSleeping[idx], 0, __ATOMIC_RELAXED);
+            *generation = g;
+            return;
+        }
+        // A set left over from an earlier launch, or from thread start up,
+        // only makes this return early; the generation is checked again.
+        mWorkers.mLaunchSignals[idx].wait();
+    }
+}
+
 void * RsdCpuReferenceImpl::helperThreadProc(void *vrsc) {
     RsdCpuReferenceImpl *dc = (RsdCpuReferenceImpl *)vrsc;
 
@@ -124,20 +179,39 @@ void * RsdCpuReferenceImpl::helperThreadProc(void *vrsc) {
     ALOGE("SETAFFINITY ret = %i %s", ret, EGLUtils::strerror(ret));
 #endif
 
-    while (!dc->mExit) {
-        dc->mWorkers.mLaunchSignals[idx].wait();
+    // No launch can happen before init() sees every thread check in here.
+    uint32_t generation = __atomic_load_n(&dc->mWorkers.mLaunchGeneration, __ATOMIC_ACQUIRE);
+    __sync_fetch_and_sub(&dc->mWorkers.mRunningCount, 1);
+
+    while (true) {
+        dc->waitForLaunch(idx, &generation);
+        if (dc->mExit) {
+            break;
+        }
         if (dc->mWorkers.mLaunchCallback) {
            // idx +1 is used because the calling thread is always worker 0.
            dc->mWorkers.mLaunchCallback(dc->mWorkers.mLaunchData, idx+1);
         }
-        __sync_fetch_and_sub(&dc->mWorkers.mRunningCount, 1);
-        dc->mWorkers.mCompleteSignal.set();
+        if (__sync_fetch_and_sub(&dc->mWorkers.mRunningCount, 1) == 1) {
+            dc->mWorkers.mCompleteSignal.set();
+        }
     }
 
     //ALOGV("RS helperThread exited %p idx=%i", dc, idx);
     return nullptr;
 }
 
+// Start a new launch generation and wake up the threads that went to sleep
+// waiting for it.
+void RsdCpuReferenceImpl::wakeWorkers() {
+    __atomic_add_fetch(&mWorkers.mLaunchGeneration, 1, __ATOMIC_SEQ_CST);
+    for (uint32_t ct = 0; ct < mWorkers.mCount; ct++) {
+        if (__atomic_exchange_n(&mWorkers.mSleeping[ct], 0, __ATOMIC_SEQ_CST)) {
+            mWorkers.mLaunchSignals[ct].set();
+        }
+    }
+}
+
 // Launch a kernel.
 // The callback function is called to execute the kernel.
 void RsdCpuReferenceImpl::launchThreads(WorkerCallback_t cbk, void *data) {
@@ -154,11 +228,7 @@ void RsdCpuReferenceImpl::launchThreads(WorkerCallback_t cbk, void *data) {
     }
 
     mWorkers.mRunningCount = mWorkers.mCount;
-    __sync_synchronize();
-
-    for (uint32_t ct = 0; ct < mWorkers.mCount; ct++) {
-        mWorkers.mLaunchSignals[ct].set();
-    }
+    wakeWorkers();
 
     // We use the calling thread as one of the workers so we can start without
     // the delay of the thread wakeup.
@@ -166,6 +236,14 @@ void RsdCpuReferenceImpl::launchThreads(WorkerCallback_t cbk, void *data) {
         mWorkers.mLaunchCallback(mWorkers.mLaunchData, 0);
     }
 
+    // The other workers usually finish at about the same time as this one.
+    const int64_t spinEnd = nowNs() + kSpinTimeNs;
+    for (uint32_t ct = 1; __atomic_load_n(&mWorkers.mRunningCount, __ATOMIC_ACQUIRE) != 0; ct++) {
+        if ((ct % 64) == 0 && nowNs() > spinEnd) {
+            break;
+        }
+        cpuRelax();
+    }
     while (__sync_fetch_and_or(&mWorkers.mRunningCount, 0) != 0) {
         mWorkers.mCompleteSignal.wait();
     }
@@ -203,6 +281,11 @@ static void GetCpuInfo() {
         }
     }
     fclose(cpuinfo);
+
+#if defined(ARCH_X86_HAVE_SSSE3)
+    // Also checks that the OS saves the AVX state, which /proc/cpuinfo does not tell.
+    gArchUseAVX2 = gArchUseSIMD && __builtin_cpu_supports("avx2");
+#endif
 }
 
 bool RsdCpuReferenceImpl::init(uint32_t version_major, uint32_t version_minor,
@@ -254,6 +337,8 @@ bool RsdCpuReferenceImpl::init(uint32_t version_major, uint32_t version_minor,
     mWorkers.mNativeThreadId = (pid_t *) calloc(mWorkers.mCount, sizeof(pid_t));
     mWorkers.mLaunchSignals = new Signal[mWorkers.mCount];
     mWorkers.mLaunchCallback = nullptr;
+    mWorkers.mSleeping = (volatile int *) calloc(mWorkers.mCount, sizeof(int));
+    mWorkers.mTileRanges = new TileRange[mWorkers.mCount + 1];
 
     mWorkers.mCompleteSignal.init();
 
@@ -296,10 +381,7 @@ RsdCpuReferenceImpl::~RsdCpuReferenceImpl() {
     mWorkers.mLaunchData = nullptr;
     mWorkers.mLaunchCallback = nullptr;
     mWorkers.mRunningCount = mWorkers.mCount;
-    __sync_synchronize();
-    for (uint32_t ct = 0; ct < mWorkers.mCount; ct++) {
-        mWorkers.mLaunchSignals[ct].set();
-    }
+    wakeWorkers();
     void *res;
     for (uint32_t ct = 0; ct < mWorkers.mCount; ct++) {
         pthread_join(mWorkers.mThreadId[ct], &res);
@@ -310,7 +392,9 @@ RsdCpuReferenceImpl::~RsdCpuReferenceImpl() {
     // rsAssert(__sync_fetch_and_or(&mWorkers.mRunningCount, 0) == 0);
     free(mWorkers.mThreadId);
     free(mWorkers.mNativeThreadId);
+    free((void *)mWorkers.mSleeping);
     delete[] mWorkers.mLaunchSignals;
+    delete[] mWorkers.mTileRanges;
 
     // Global structure cleanup.
     lockMutex();
@@ -388,78 +472,84 @@ static bool SelectZSlice(const MTLaunchStructCommon *mtls, RsExpandKernelDriverI
     return sliceInt(&info->current.z, sliceNum, mtls->start.z, mtls->end.z) == 0;
 }
 
-static void walk_general_foreach(void *usr, uint32_t idx) {
-    MTLaunchStructForEach *mtls = (MTLaunchStructForEach *)usr;
-    RsExpandKernelDriverInfo fep = mtls->fep;
-    fep.lid = idx;
-    ForEachFunc_t fn = mtls->kernel;
-
-    while(1) {
-        uint32_t slice = (uint32_t)__sync_fetch_and_add(&mtls->mSliceNum, 1);
+static inline uint64_t packTileRange(uint32_t begin, uint32_t end) {
+    return ((uint64_t)end << 32) | begin;
+}
 
-        if (!SelectOuterSlice(mtls, &fep, slice)) {
-            return;
+// Take the first tile of a range.  Only the worker owning the range pops from it.
+static bool popTile(TileRange *range, uint32_t *tile) {
+    uint64_t r = __atomic_load_n(&range->mRange, __ATOMIC_ACQUIRE);
+    while (true) {
+        uint32_t begin = (uint32_t)r;
+        uint32_t end = (uint32_t)(r >> 32);
+        if (begin >= end) {
+            return false;
         }
-
-        for (fep.current.y = mtls->start.y; fep.current.y < mtls->end.y;
-             fep.current.y++) {
-
-            FepPtrSetup(mtls, &fep, mtls->start.x,
-                        fep.current.y, fep.current.z, fep.current.lod,
-                        (RsAllocationCubemapFace)fep.current.face,
-                        fep.current.array[0], fep.current.array[1],
-                        fep.current.array[2], fep.current.array[3]);
-
-            fn(&fep, mtls->start.x, mtls->end.x, mtls->fep.outStride[0]);
+        if (__atomic_compare_exchange_n(&range->mRange, &r, packTileRange(begin + 1, end), true,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            *tile = begin;
+            return true;
         }
     }
 }
 
-static void walk_2d_foreach(void *usr, uint32_t idx) {
-    MTLaunchStructForEach *mtls = (MTLaunchStructForEach *)usr;
-    RsExpandKernelDriverInfo fep = mtls->fep;
-    fep.lid = idx;
-    ForEachFunc_t fn = mtls->kernel;
-
-    while (1) {
-        uint32_t slice  = (uint32_t)__sync_fetch_and_add(&mtls->mSliceNum, 1);
-        uint32_t yStart = mtls->start.y + slice * mtls->mSliceSize;
-        uint32_t yEnd   = yStart + mtls->mSliceSize;
-
-        yEnd = rsMin(yEnd, mtls->end.y);
-
-        if (yEnd <= yStart) {
-            return;
-        }
-
-        for (fep.current.y = yStart; fep.current.y < yEnd; fep.current.y++) {
-            FepPtrSetup(mtls, &fep, mtls->start.x, fep.current.y);
-
-            fn(&fep, mtls->start.x, mtls->end.x, fep.outStride[0]);
+// Steal the upper half of another worker's range once this worker ran out of
+// tiles.  The first stolen tile is returned and the rest becomes the range of
+// this worker.  A range never goes back to a value it had before, as every
+// tile is taken exactly once, so the compare-and-swap cannot be fooled.
+static bool stealTiles(const MTLaunchStructForEach *mtls, uint32_t idx, uint32_t *tile) {
+    for (uint32_t ct = 1; ct < mtls->tileRangeCount; ct++) {
+        TileRange *victim = &mtls->tileRanges[(idx + ct) % mtls->tileRangeCount];
+        uint64_t r = __atomic_load_n(&victim->mRange, __ATOMIC_ACQUIRE);
+        while (true) {
+            uint32_t begin = (uint32_t)r;
+            uint32_t end = (uint32_t)(r >> 32);
+            if (begin >= end) {
+                break;
+            }
+            uint32_t mid = begin + (end - begin) / 2;
+            if (__atomic_compare_exchange_n(&victim->mRange, &r, packTileRange(begin, mid), true,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                __atomic_store_n(&mtls->tileRanges[idx].mRange, packTileRange(mid + 1, end),
+                                 __ATOMIC_RELEASE);
+                *tile = mid;
+                return true;
+            }
         }
     }
+    return false;
 }
 
-static void walk_1d_foreach(void *usr, uint32_t idx) {
+static void walk_tiled_foreach(void *usr, uint32_t idx) {
     MTLaunchStructForEach *mtls = (MTLaunchStructForEach *)usr;
     RsExpandKernelDriverInfo fep = mtls->fep;
     fep.lid = idx;
     ForEachFunc_t fn = mtls->kernel;
+    const uint32_t tilesPerSlice = mtls->tilesX * mtls->tilesY;
 
-    while (1) {
-        uint32_t slice  = (uint32_t)__sync_fetch_and_add(&mtls->mSliceNum, 1);
-        uint32_t xStart = mtls->start.x + slice * mtls->mSliceSize;
-        uint32_t xEnd   = xStart + mtls->mSliceSize;
-
-        xEnd = rsMin(xEnd, mtls->end.x);
+    uint32_t tile;
+    while (popTile(&mtls->tileRanges[idx], &tile) || stealTiles(mtls, idx, &tile)) {
+        uint32_t slice = tile / tilesPerSlice;
+        tile -= slice * tilesPerSlice;
 
-        if (xEnd <= xStart) {
+        if (!SelectOuterSlice(mtls, &fep, slice)) {
             return;
         }
 
-        FepPtrSetup(mtls, &fep, xStart, 0);
+        uint32_t xStart = mtls->start.x + (tile % mtls->tilesX) * mtls->tileSizeX;
+        uint32_t xEnd   = rsMin(xStart + mtls->tileSizeX, mtls->end.x);
+        uint32_t yStart = mtls->start.y + (tile / mtls->tilesX) * mtls->tileSizeY;
+        uint32_t yEnd   = rsMin(yStart + mtls->tileSizeY, mtls->end.y);
 
-        fn(&fep, xStart, xEnd, fep.outStride[0]);
+        for (fep.current.y = yStart; fep.current.y < yEnd; fep.current.y++) {
+            FepPtrSetup(mtls, &fep, xStart,
+                        fep.current.y, fep.current.z, fep.current.lod,
+                        (RsAllocationCubemapFace)fep.current.face,
+                        fep.current.array[0], fep.current.array[1],
+                        fep.current.array[2], fep.current.array[3]);
+
+            fn(&fep, xStart, xEnd, fep.outStride[0]);
+        }
     }
 }
 
@@ -823,6 +913,106 @@ void RsdCpuReferenceImpl::launchReduceParallel(const Allocation ** ains,
 }
 
 
+// Returns how many bytes of input and output a tile should cover, as requested
+// through the launch options.
+static size_t tileBytesForStrategy(const RsScriptCall *sc) {
+    if (sc != nullptr) {
+        switch (sc->strategy) {
+        case RS_FOR_EACH_STRATEGY_TILE_SMALL:
+            return 4 * 1024;
+        case RS_FOR_EACH_STRATEGY_TILE_LARGE:
+            return 64 * 1024;
+        default:
+            break;
+        }
+    }
+    return 16 * 1024;
+}
+
+// Chooses the tile size of a launch.  Tiles are whole rows as long as a row
+// fits in the target number of bytes; wider rows are cut into tiles of
+// kSplitTileRows rows, so that kernels reading neighbouring rows find them in
+// the cache.  There are at least kTilesPerWorker tiles per worker when the
+// launch is big enough, so that work can be balanced between fast and slow
+// cores.
+void RsdCpuReferenceImpl::setupTiles(const RsScriptCall *sc, MTLaunchStructForEach *mtls) {
+    static const uint32_t kTilesPerWorker = 4;
+    static const uint32_t kSplitTileRows = 8;
+    static const uint32_t kMinTileWidth = 16;
+
+    const uint32_t workers = mWorkers.mCount + 1;
+    const size_t tileBytes = tileBytesForStrategy(sc);
+    const uint32_t sizeX = mtls->end.x - mtls->start.x;
+    const uint32_t sizeY = mtls->end.y - mtls->start.y;
+
+    uint32_t slices = 1;
+    if (mtls->end.z > mtls->start.z) slices *= mtls->end.z - mtls->start.z;
+    if (mtls->end.lod > mtls->start.lod) slices *= mtls->end.lod - mtls->start.lod;
+    if (mtls->end.face > mtls->start.face) slices *= mtls->end.face - mtls->start.face;
+    for (int ct = 0; ct < 4; ct++) {
+        if (mtls->end.array[ct] > mtls->start.array[ct]) {
+            slices *= mtls->end.array[ct] - mtls->start.array[ct];
+        }
+    }
+
+    // Bytes read and written per cell; zero in the launch option only case.
+    size_t cellBytes = mtls->cellBytes;
+    if (cellBytes == 0) {
+        if (mtls->aout[0] != nullptr) {
+            cellBytes += mtls->aout[0]->getType()->getElementSizeBytes();
+        }
+        for (uint32_t ct = 0; ct < mtls->fep.inLen; ct++) {
+            if (mtls->ains[ct] != nullptr) {
+                cellBytes += mtls->ains[ct]->getType()->getElementSizeBytes();
+            }
+        }
+    }
+
+    // Largest tile, in cells, that still gives every worker enough tiles.
+    const uint64_t balanced = rsMax((uint64_t)1, (uint64_t)sizeX * sizeY * slices /
+                                                 (workers * kTilesPerWorker));
+
+    mtls->tileSizeX = sizeX;
+    mtls->tileSizeY = 1;
+    if (sizeY <= 1) {
+        uint64_t cells = balanced;
+        if (cellBytes) {
+            cells = rsMin(cells, (uint64_t)rsMax(tileBytes / cellBytes, (size_t)1));
+        }
+        mtls->tileSizeX = (uint32_t)rsMin(cells, (uint64_t)sizeX);
+    } else {
+        const size_t rowBytes = cellBytes * sizeX;
+        uint64_t rows = rsMax(balanced / sizeX, (uint64_t)1);
+        if (rowBytes) {
+            rows = rsMin(rows, (uint64_t)(tileBytes / rowBytes));
+        }
+        if (rows >= 1) {
+            mtls->tileSizeY = (uint32_t)rsMin(rows, (uint64_t)sizeY);
+        } else if (!mtls->wholeRows &&
+                   (sc == nullptr || sc->strategy != RS_FOR_EACH_STRATEGY_DST_LINEAR)) {
+            mtls->tileSizeY = rsMin(kSplitTileRows, sizeY);
+            uint32_t width = tileBytes / (cellBytes * mtls->tileSizeY);
+            width = rsMax(width - width % kMinTileWidth, kMinTileWidth);
+            mtls->tileSizeX = rsMin(width, sizeX);
+        }
+    }
+
+    mtls->tilesX = (sizeX + mtls->tileSizeX - 1) / mtls->tileSizeX;
+    mtls->tilesY = (sizeY + mtls->tileSizeY - 1) / mtls->tileSizeY;
+
+    // Hand each worker an equal share of the tiles to start with.
+    const uint32_t tiles = mtls->tilesX * mtls->tilesY * slices;
+    mtls->tileRanges = mWorkers.mTileRanges;
+    mtls->tileRangeCount = workers;
+    for (uint32_t ct = 0; ct < workers; ct++) {
+        mtls->tileRanges[ct].mRange = packTileRange((uint64_t)tiles * ct / workers,
+                                                    (uint64_t)tiles * (ct + 1) / workers);
+    }
+
+    // Lets launchThreads() run a launch that is a single tile on this thread.
+    mtls->mSliceSize = slices == 1 ? mtls->tileSizeX : 0;
+}
+
 void RsdCpuReferenceImpl::launchForEach(const Allocation ** ains,
                                         uint32_t inLen,
                                         Allocation* aout,
@@ -831,67 +1021,12 @@ void RsdCpuReferenceImpl::launchForEach(const Allocation ** ains,
 
     //android::StopWatch kernel_time("kernel time");
 
-    bool outerDims = (mtls->start.z != mtls->end.z) ||
-                     (mtls->start.face != mtls->end.face) ||
-                     (mtls->start.lod != mtls->end.lod) ||
-                     (mtls->start.array[0] != mtls->end.array[0]) ||
-                     (mtls->start.array[1] != mtls->end.array[1]) ||
-                     (mtls->start.array[2] != mtls->end.array[2]) ||
-                     (mtls->start.array[3] != mtls->end.array[3]);
-
     if ((mWorkers.mCount >= 1) && mtls->isThreadable && !mInKernel) {
-        const size_t targetByteChunk = 16 * 1024;
         mInKernel = true;  // NOTE: The guard immediately above ensures this was !mInKernel
 
-        if (outerDims) {
-            // No fancy logic for chunk size
-            mtls->mSliceSize = 1;
-            launchThreads(walk_general_foreach, mtls);
-        } else if (mtls->fep.dim.y > 1) {
-            uint32_t s1 = mtls->fep.dim.y / ((mWorkers.mCount + 1) * 4);
-            uint32_t s2 = 0;
-
-            // This chooses our slice size to rate limit atomic ops to
-            // one per 16k bytes of reads/writes.
-            if ((mtls->aout[0] != nullptr) && mtls->aout[0]->mHal.drvState.lod[0].stride) {
-                s2 = targetByteChunk / mtls->aout[0]->mHal.drvState.lod[0].stride;
-            } else if (mtls->ains[0]) {
-                s2 = targetByteChunk / mtls->ains[0]->mHal.drvState.lod[0].stride;
-            } else {
-                // Launch option only case
-                // Use s1 based only on the dimensions
-                s2 = s1;
-            }
-            mtls->mSliceSize = rsMin(s1, s2);
-
-            if(mtls->mSliceSize < 1) {
-                mtls->mSliceSize = 1;
-            }
-
-            launchThreads(walk_2d_foreach, mtls);
-        } else {
-            uint32_t s1 = mtls->fep.dim.x / ((mWorkers.mCount + 1) * 4);
-            uint32_t s2 = 0;
-
-            // This chooses our slice size to rate limit atomic ops to
-            // one per 16k bytes of reads/writes.
-            if ((mtls->aout[0] != nullptr) && mtls->aout[0]->getType()->getElementSizeBytes()) {
-                s2 = targetByteChunk / mtls->aout[0]->getType()->getElementSizeBytes();
-            } else if (mtls->ains[0]) {
-                s2 = targetByteChunk / mtls->ains[0]->getType()->getElementSizeBytes();
-            } else {
-                // Launch option only case
-                // Use s1 based only on the dimensions
-                s2 = s1;
-            }
-            mtls->mSliceSize = rsMin(s1, s2);
+        setupTiles(sc, mtls);
+        launchThreads(walk_tiled_foreach, mtls);
 
-            if (mtls->mSliceSize < 1) {
-                mtls->mSliceSize = 1;
-            }
-
-            launchThreads(walk_1d_foreach, mtls);
-        }
         mInKernel = false;
 
     } else {
@@ -33,6 +33,12 @@ namespace renderscript {
 // Whether the CPU we're running on supports SIMD instructions
 extern bool gArchUseSIMD;
 
+#if defined(ARCH_X86_HAVE_SSSE3)
+// Whether the CPU we're running on also supports AVX2. The AVX2 kernels are built
+// for every x86 target and selected at runtime, so a single binary runs everywhere.
+extern bool gArchUseAVX2;
+#endif
+
 // Function types found in RenderScript code
 typedef void (*ReduceAccumulatorFunc_t)(const RsExpandKernelDriverInfo *info, uint32_t x1, uint32_t x2, uint8_t *accum);
 typedef void (*ReduceCombinerFunc_t)(uint8_t *accum, const uint8_t *other);
@@ -63,6 +69,13 @@ struct ScriptTLSStruct {
     RsdCpuScriptImpl *mImpl;
 };
 
+// A range [begin, end) of tile indices owned by one worker, packed into one
+// word so that the owner and the workers stealing from it can update it with a
+// single compare-and-swap.  Each range sits on its own cache line.
+struct alignas(64) TileRange {
+    volatile uint64_t mRange;
+};
+
 // MTLaunchStruct passes information about a multithreaded kernel launch.
 struct MTLaunchStructCommon {
     RsdCpuReferenceImpl *rs;
@@ -87,6 +100,26 @@ struct MTLaunchStructForEach : public MTLaunchStructCommon {
     ForEachFunc_t kernel;
     const Allocation *ains[RS_KERNEL_INPUT_LIMIT];
     Allocation *aout[RS_KERNEL_INPUT_LIMIT];
+
+    // Set if the kernel must be called on whole rows, e.g. because it does
+    // work per row that does not depend on the X range it is given.
+    bool wholeRows;
+
+    // The launch is split into tilesX * tilesY tiles of tileSizeX * tileSizeY
+    // cells for each outer (Z, LOD, face, array) slice.
+    uint32_t tileSizeX;
+    uint32_t tileSizeY;
+    uint32_t tilesX;
+    uint32_t tilesY;
+
+    // One range of tile indices per worker; idle workers steal from the others.
+    TileRange *tileRanges;
+    uint32_t tileRangeCount;
+
+    // Bytes read and written per cell, used to size the tiles.  Set when the
+    // kernel touches more than ains and aout, e.g. a fused ScriptGroup batch;
+    // zero to count ains and aout.
+    size_t cellBytes;
 };
 
 struct MTLaunchStructReduce : public MTLaunchStructCommon {
@@ -236,9 +269,21 @@ protected:
         Signal *mLaunchSignals;
         WorkerCallback_t mLaunchCallback;
         void *mLaunchData;
+
+        // Bumped for every launch.  Idle workers spin on it for a short while
+        // before sleeping on their launch signal.
+        volatile uint32_t mLaunchGeneration;
+        // Set by a worker that is (about to be) sleeping on its launch signal.
+        volatile int *mSleeping;
+        // Per-worker tile ranges for launchForEach, including the calling thread.
+        TileRange *mTileRanges;
     };
     Workers mWorkers;
     bool mExit;
+
+    void waitForLaunch(uint32_t idx, uint32_t *generation);
+    void wakeWorkers();
+    void setupTiles(const RsScriptCall *sc, MTLaunchStructForEach *mtls);
     sym_lookup_t mSymLookupFn;
     script_lookup_t mScriptLookupFn;
 
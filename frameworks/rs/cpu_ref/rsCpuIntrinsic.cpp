@@ -26,6 +26,7 @@ RsdCpuScriptIntrinsic::RsdCpuScriptIntrinsic(RsdCpuReferenceImpl *ctx, const Scr
 
     mID = iid;
     mElement.set(e);
+    mWholeRows = false;
 }
 
 RsdCpuScriptIntrinsic::~RsdCpuScriptIntrinsic() {
@@ -103,6 +104,7 @@ void RsdCpuScriptIntrinsic::invokeForEach(uint32_t slot,
 
         mtls.kernel = mRootPtr;
         mtls.fep.usr = this;
+        mtls.wholeRows = mWholeRows;
 
         RsdCpuScriptImpl * oldTLS = mCtx->setTLS(this);
         mCtx->launchForEach(ains, inLen, aout, sc, &mtls);
@@ -118,6 +120,7 @@ void RsdCpuScriptIntrinsic::forEachKernelSetup(uint32_t slot, MTLaunchStructForE
     mtls->fep.slot = slot;
     mtls->kernel = mRootPtr;
     mtls->fep.usr = this;
+    mtls->wholeRows = mWholeRows;
 }
 
 } // namespace renderscript
@@ -82,6 +82,8 @@ protected:
     RsScriptIntrinsicID mID;
     ForEachFunc_t mRootPtr;
     ObjectBaseRef<const Element> mElement;
+    // Set by intrinsics whose kernel must be called on whole rows.
+    bool mWholeRows;
 
 };
 
@@ -50,6 +50,12 @@ extern "C" void rsdIntrinsic3DLUT_K(void *dst, void const *in, size_t count,
                                       int32_t pitchy, int32_t pitchz,
                                       int dimx, int dimy, int dimz);
 
+#if defined(ARCH_X86_HAVE_SSSE3)
+extern "C" void rsdIntrinsic3DLUT_AVX2(void *dst, void const *in, uint32_t count8,
+                                       void const *lut, int32_t pitchy, int32_t pitchz,
+                                       const int32_t *coordMul);
+#endif
+
 
 void RsdCpuScriptIntrinsic3DLUT::kernel(const RsExpandKernelDriverInfo *info,
                                         uint32_t xstart, uint32_t xend,
@@ -90,6 +96,17 @@ void RsdCpuScriptIntrinsic3DLUT::kernel(const RsExpandKernelDriverInfo *info,
     }
 #endif
 
+#if defined(ARCH_X86_HAVE_SSSE3)
+    if (gArchUseAVX2 && (x2 - x1 >= 8)) {
+        uint32_t len = (x2 - x1) & ~7;
+        rsdIntrinsic3DLUT_AVX2(out, in, len >> 3, bp, stride_y, stride_z,
+                               (const int32_t *)&coordMul);
+        x1 += len;
+        out += len;
+        in += len;
+    }
+#endif
+
     while (x1 < x2) {
         int4 baseCoord = convert_int4(*in) * coordMul;
         int4 coord1 = baseCoord >> (int4)15;
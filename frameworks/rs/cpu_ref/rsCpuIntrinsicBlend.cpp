@@ -104,6 +104,25 @@ extern void rsdIntrinsicBlendXor_K(void *dst, const void *src, uint32_t count8);
 extern void rsdIntrinsicBlendMultiply_K(void *dst, const void *src, uint32_t count8);
 extern void rsdIntrinsicBlendAdd_K(void *dst, const void *src, uint32_t count8);
 extern void rsdIntrinsicBlendSub_K(void *dst, const void *src, uint32_t count8);
+
+extern void rsdIntrinsicBlendSrcOver_AVX2(void *dst, const void *src, uint32_t count8);
+extern void rsdIntrinsicBlendDstOver_AVX2(void *dst, const void *src, uint32_t count8);
+extern void rsdIntrinsicBlendSrcIn_AVX2(void *dst, const void *src, uint32_t count8);
+extern void rsdIntrinsicBlendDstIn_AVX2(void *dst, const void *src, uint32_t count8);
+extern void rsdIntrinsicBlendSrcOut_AVX2(void *dst, const void *src, uint32_t count8);
+extern void rsdIntrinsicBlendDstOut_AVX2(void *dst, const void *src, uint32_t count8);
+extern void rsdIntrinsicBlendSrcAtop_AVX2(void *dst, const void *src, uint32_t count8);
+extern void rsdIntrinsicBlendDstAtop_AVX2(void *dst, const void *src, uint32_t count8);
+extern void rsdIntrinsicBlendXor_AVX2(void *dst, const void *src, uint32_t count8);
+extern void rsdIntrinsicBlendMultiply_AVX2(void *dst, const void *src, uint32_t count8);
+extern void rsdIntrinsicBlendAdd_AVX2(void *dst, const void *src, uint32_t count8);
+extern void rsdIntrinsicBlendSub_AVX2(void *dst, const void *src, uint32_t count8);
+
+typedef void (*BlendKernel)(void *dst, const void *src, uint32_t count8);
+
+static inline BlendKernel selectBlend(BlendKernel ssse3, BlendKernel avx2) {
+    return android::renderscript::gArchUseAVX2 ? avx2 : ssse3;
+}
 #endif
 
 namespace android {
@@ -143,7 +162,7 @@ void RsdCpuScriptIntrinsicBlend::kernel(const RsExpandKernelDriverInfo *info,
         if (gArchUseSIMD) {
             if ((x1 + 8) < x2) {
                 uint32_t len = (x2 - x1) >> 3;
-                rsdIntrinsicBlendSrcOver_K(out, in, len);
+                selectBlend(rsdIntrinsicBlendSrcOver_K, rsdIntrinsicBlendSrcOver_AVX2)(out, in, len);
                 x1 += len << 3;
                 out += len << 3;
                 in += len << 3;
@@ -162,7 +181,7 @@ void RsdCpuScriptIntrinsicBlend::kernel(const RsExpandKernelDriverInfo *info,
         if (gArchUseSIMD) {
             if ((x1 + 8) < x2) {
                 uint32_t len = (x2 - x1) >> 3;
-                rsdIntrinsicBlendDstOver_K(out, in, len);
+                selectBlend(rsdIntrinsicBlendDstOver_K, rsdIntrinsicBlendDstOver_AVX2)(out, in, len);
                 x1 += len << 3;
                 out += len << 3;
                 in += len << 3;
@@ -181,7 +200,7 @@ void RsdCpuScriptIntrinsicBlend::kernel(const RsExpandKernelDriverInfo *info,
         if (gArchUseSIMD) {
             if ((x1 + 8) < x2) {
                 uint32_t len = (x2 - x1) >> 3;
-                rsdIntrinsicBlendSrcIn_K(out, in, len);
+                selectBlend(rsdIntrinsicBlendSrcIn_K, rsdIntrinsicBlendSrcIn_AVX2)(out, in, len);
                 x1 += len << 3;
                 out += len << 3;
                 in += len << 3;
@@ -199,7 +218,7 @@ void RsdCpuScriptIntrinsicBlend::kernel(const RsExpandKernelDriverInfo *info,
         if (gArchUseSIMD) {
             if ((x1 + 8) < x2) {
                 uint32_t len = (x2 - x1) >> 3;
-                rsdIntrinsicBlendDstIn_K(out, in, len);
+                selectBlend(rsdIntrinsicBlendDstIn_K, rsdIntrinsicBlendDstIn_AVX2)(out, in, len);
                 x1 += len << 3;
                 out += len << 3;
                 in += len << 3;
@@ -217,7 +236,7 @@ void RsdCpuScriptIntrinsicBlend::kernel(const RsExpandKernelDriverInfo *info,
         if (gArchUseSIMD) {
             if ((x1 + 8) < x2) {
                 uint32_t len = (x2 - x1) >> 3;
-                rsdIntrinsicBlendSrcOut_K(out, in, len);
+                selectBlend(rsdIntrinsicBlendSrcOut_K, rsdIntrinsicBlendSrcOut_AVX2)(out, in, len);
                 x1 += len << 3;
                 out += len << 3;
                 in += len << 3;
@@ -235,7 +254,7 @@ void RsdCpuScriptIntrinsicBlend::kernel(const RsExpandKernelDriverInfo *info,
         if (gArchUseSIMD) {
             if ((x1 + 8) < x2) {
                 uint32_t len = (x2 - x1) >> 3;
-                rsdIntrinsicBlendDstOut_K(out, in, len);
+                selectBlend(rsdIntrinsicBlendDstOut_K, rsdIntrinsicBlendDstOut_AVX2)(out, in, len);
                 x1 += len << 3;
                 out += len << 3;
                 in += len << 3;
@@ -253,7 +272,7 @@ void RsdCpuScriptIntrinsicBlend::kernel(const RsExpandKernelDriverInfo *info,
         if (gArchUseSIMD) {
             if ((x1 + 8) < x2) {
                 uint32_t len = (x2 - x1) >> 3;
-                rsdIntrinsicBlendSrcAtop_K(out, in, len);
+                selectBlend(rsdIntrinsicBlendSrcAtop_K, rsdIntrinsicBlendSrcAtop_AVX2)(out, in, len);
                 x1 += len << 3;
                 out += len << 3;
                 in += len << 3;
@@ -273,7 +292,7 @@ void RsdCpuScriptIntrinsicBlend::kernel(const RsExpandKernelDriverInfo *info,
         if (gArchUseSIMD) {
             if ((x1 + 8) < x2) {
                 uint32_t len = (x2 - x1) >> 3;
-                rsdIntrinsicBlendDstAtop_K(out, in, len);
+                selectBlend(rsdIntrinsicBlendDstAtop_K, rsdIntrinsicBlendDstAtop_AVX2)(out, in, len);
                 x1 += len << 3;
                 out += len << 3;
                 in += len << 3;
@@ -294,7 +313,7 @@ void RsdCpuScriptIntrinsicBlend::kernel(const RsExpandKernelDriverInfo *info,
         if (gArchUseSIMD) {
             if ((x1 + 8) < x2) {
                 uint32_t len = (x2 - x1) >> 3;
-                rsdIntrinsicBlendXor_K(out, in, len);
+                selectBlend(rsdIntrinsicBlendXor_K, rsdIntrinsicBlendXor_AVX2)(out, in, len);
                 x1 += len << 3;
                 out += len << 3;
                 in += len << 3;
@@ -318,7 +337,7 @@ void RsdCpuScriptIntrinsicBlend::kernel(const RsExpandKernelDriverInfo *info,
         if (gArchUseSIMD) {
             if ((x1 + 8) < x2) {
                 uint32_t len = (x2 - x1) >> 3;
-                rsdIntrinsicBlendMultiply_K(out, in, len);
+                selectBlend(rsdIntrinsicBlendMultiply_K, rsdIntrinsicBlendMultiply_AVX2)(out, in, len);
                 x1 += len << 3;
                 out += len << 3;
                 in += len << 3;
@@ -411,7 +430,7 @@ void RsdCpuScriptIntrinsicBlend::kernel(const RsExpandKernelDriverInfo *info,
         if (gArchUseSIMD) {
             if((x1 + 8) < x2) {
                 uint32_t len = (x2 - x1) >> 3;
-                rsdIntrinsicBlendAdd_K(out, in, len);
+                selectBlend(rsdIntrinsicBlendAdd_K, rsdIntrinsicBlendAdd_AVX2)(out, in, len);
                 x1 += len << 3;
                 out += len << 3;
                 in += len << 3;
@@ -432,7 +451,7 @@ void RsdCpuScriptIntrinsicBlend::kernel(const RsExpandKernelDriverInfo *info,
         if (gArchUseSIMD) {
             if((x1 + 8) < x2) {
                 uint32_t len = (x2 - x1) >> 3;
-                rsdIntrinsicBlendSub_K(out, in, len);
+                selectBlend(rsdIntrinsicBlendSub_K, rsdIntrinsicBlendSub_AVX2)(out, in, len);
                 x1 += len << 3;
                 out += len << 3;
                 in += len << 3;
@@ -452,6 +452,9 @@ RsdCpuScriptIntrinsicBlur::RsdCpuScriptIntrinsicBlur(RsdCpuReferenceImpl *ctx,
     }
     rsAssert(mRootPtr);
     mRadius = 5;
+    // The vertical pass always covers the whole row, whatever X range the
+    // kernel is called for.
+    mWholeRows = true;
 
     mScratch = new void *[mCtx->getThreadCount()];
     mScratchSize = new size_t[mCtx->getThreadCount()];
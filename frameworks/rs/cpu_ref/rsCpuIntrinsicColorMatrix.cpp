@@ -456,6 +456,10 @@ extern void rsdIntrinsicColorMatrix3x3_K(void *dst, const void *src,
                                   const int16_t *coef, uint32_t count);
 extern void rsdIntrinsicColorMatrix4x4_K(void *dst, const void *src,
                                   const int16_t *coef, uint32_t count);
+extern void rsdIntrinsicColorMatrix_AVX2(void *dst, const void *src,
+                                  const float *coef, const float *add,
+                                  bool floatIn, bool floatOut, bool zeroW,
+                                  uint32_t count4);
 
 using android::renderscript::Key_t;
 
@@ -912,6 +916,19 @@ void RsdCpuScriptIntrinsicColorMatrix::kernel(const RsExpandKernelDriverInfo *in
                 out += outstep * len;
                 in += instep * len;
             }
+#if defined(ARCH_X86_HAVE_SSSE3)
+            else if (gArchUseAVX2 && (vsin >= 2) && (vsout >= 2) && (len >= 4)) {
+                // Same float math as One(), 4 pixels at a time. 3 and 4 element
+                // vectors have the same stride; the 4th input channel is ignored
+                // for 3 element inputs.
+                rsdIntrinsicColorMatrix_AVX2(out, in, cp->tmpFp, cp->tmpFpa,
+                                             floatIn, floatOut, vsin == 2, len >> 2);
+                len &= ~3;
+                x1 += len;
+                out += outstep * len;
+                in += instep * len;
+            }
+#endif
 #if defined(ARCH_ARM64_USE_INTRINSICS)
             else {
                 if (cp->mLastKey.u.inType == RS_TYPE_FLOAT_32 || cp->mLastKey.u.outType == RS_TYPE_FLOAT_32) {
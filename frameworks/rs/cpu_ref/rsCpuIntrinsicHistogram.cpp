@@ -20,6 +20,17 @@
 namespace android {
 namespace renderscript {
 
+#if defined(ARCH_X86_HAVE_SSSE3)
+extern "C" void rsdIntrinsicHistogramDot_AVX2(int *sums, const void *in, const int *dot,
+                                              uint32_t count8);
+#endif
+
+// Each worker counts into kLanes copies of the histogram, pixel x going to
+// copy x % kLanes.  Runs of equal pixels, which are common in real images,
+// then increment different counters instead of waiting on the same one.
+static const uint32_t kLanes = 4;
+// Ints per worker: kLanes copies of 256 bins for up to 4 channels.
+static const uint32_t kWorkerSums = kLanes * 256 * 4;
 
 class RsdCpuScriptIntrinsicHistogram : public RsdCpuScriptIntrinsic {
 public:
@@ -44,8 +55,14 @@ protected:
     float mDot[4];
     int mDotI[4];
     int *mSums;
+    // Ints in one copy of the histogram: 256 bins per channel.
+    uint32_t mLaneSize;
+    // Set when a worker cleared and used its histograms in the current launch.
+    bool *mWorkerUsed;
     ObjectBaseRef<Allocation> mAllocOut;
 
+    int *workerSums(uint32_t lid);
+
     static void kernelP1U4(const RsExpandKernelDriverInfo *info,
                            uint32_t xstart, uint32_t xend,
                            uint32_t outstep);
@@ -120,6 +137,8 @@ RsdCpuScriptIntrinsicHistogram::preLaunch(uint32_t slot,
         }
         break;
     case 1:
+        // The dot product gives a single channel whatever the input.
+        vSize = 1;
         switch(ains[0]->getType()->getElement()->getVectorSize()) {
         case 1:
             mRootPtr = &kernelP1L1;
@@ -136,7 +155,18 @@ RsdCpuScriptIntrinsicHistogram::preLaunch(uint32_t slot,
         }
         break;
     }
-    memset(mSums, 0, 256 * sizeof(int32_t) * threads * vSize);
+    // The histograms are cleared by the workers that use them, see workerSums().
+    mLaneSize = 256 * vSize;
+    memset(mWorkerUsed, 0, threads * sizeof(bool));
+}
+
+int * RsdCpuScriptIntrinsicHistogram::workerSums(uint32_t lid) {
+    int *sums = &mSums[kWorkerSums * lid];
+    if (!mWorkerUsed[lid]) {
+        memset(sums, 0, kLanes * mLaneSize * sizeof(int));
+        mWorkerUsed[lid] = true;
+    }
+    return sums;
 }
 
 void
@@ -148,14 +178,20 @@ RsdCpuScriptIntrinsicHistogram::postLaunch(uint32_t slot,
 
     unsigned int *o = (unsigned int *)mAllocOut->mHal.drvState.lod[0].mallocPtr;
     uint32_t threads = mCtx->getThreadCount();
-    uint32_t vSize = mAllocOut->getType()->getElement()->getVectorSize();
 
-    if (vSize == 3) vSize = 4;
-
-    for (uint32_t ct=0; ct < (256 * vSize); ct++) {
-        o[ct] = mSums[ct];
-        for (uint32_t t=1; t < threads; t++) {
-            o[ct] += mSums[ct + (256 * vSize * t)];
+    // Only the workers that ran take part, and each copy is added as a whole
+    // so that the compiler can vectorize the sums.
+    memset(o, 0, mLaneSize * sizeof(int));
+    for (uint32_t t = 0; t < threads; t++) {
+        if (!mWorkerUsed[t]) {
+            continue;
+        }
+        const int *sums = &mSums[kWorkerSums * t];
+        for (uint32_t l = 0; l < kLanes; l++) {
+            for (uint32_t ct = 0; ct < mLaneSize; ct++) {
+                o[ct] += sums[ct];
+            }
+            sums += mLaneSize;
         }
     }
 }
@@ -166,14 +202,26 @@ void RsdCpuScriptIntrinsicHistogram::kernelP1U4(const RsExpandKernelDriverInfo *
 
     RsdCpuScriptIntrinsicHistogram *cp = (RsdCpuScriptIntrinsicHistogram *)info->usr;
     uchar *in = (uchar *)info->inPtr[0];
-    int * sums = &cp->mSums[256 * 4 * info->lid];
-
-    for (uint32_t x = xstart; x < xend; x++) {
+    int * sums = cp->workerSums(info->lid);
+    const uint32_t stride = info->inStride[0];
+
+    uint32_t x = xstart;
+    for (; x + kLanes <= xend; x += kLanes) {
+        for (uint32_t l = 0; l < kLanes; l++) {
+            int *s = &sums[256 * 4 * l];
+            s[(in[0] << 2)    ] ++;
+            s[(in[1] << 2) + 1] ++;
+            s[(in[2] << 2) + 2] ++;
+            s[(in[3] << 2) + 3] ++;
+            in += stride;
+        }
+    }
+    for (; x < xend; x++) {
         sums[(in[0] << 2)    ] ++;
         sums[(in[1] << 2) + 1] ++;
         sums[(in[2] << 2) + 2] ++;
         sums[(in[3] << 2) + 3] ++;
-        in += info->inStride[0];
+        in += stride;
     }
 }
 
@@ -183,13 +231,24 @@ void RsdCpuScriptIntrinsicHistogram::kernelP1U3(const RsExpandKernelDriverInfo *
 
     RsdCpuScriptIntrinsicHistogram *cp = (RsdCpuScriptIntrinsicHistogram *)info->usr;
     uchar *in = (uchar *)info->inPtr[0];
-    int * sums = &cp->mSums[256 * 4 * info->lid];
-
-    for (uint32_t x = xstart; x < xend; x++) {
+    int * sums = cp->workerSums(info->lid);
+    const uint32_t stride = info->inStride[0];
+
+    uint32_t x = xstart;
+    for (; x + kLanes <= xend; x += kLanes) {
+        for (uint32_t l = 0; l < kLanes; l++) {
+            int *s = &sums[256 * 4 * l];
+            s[(in[0] << 2)    ] ++;
+            s[(in[1] << 2) + 1] ++;
+            s[(in[2] << 2) + 2] ++;
+            in += stride;
+        }
+    }
+    for (; x < xend; x++) {
         sums[(in[0] << 2)    ] ++;
         sums[(in[1] << 2) + 1] ++;
         sums[(in[2] << 2) + 2] ++;
-        in += info->inStride[0];
+        in += stride;
     }
 }
 
@@ -199,12 +258,22 @@ void RsdCpuScriptIntrinsicHistogram::kernelP1U2(const RsExpandKernelDriverInfo *
 
     RsdCpuScriptIntrinsicHistogram *cp = (RsdCpuScriptIntrinsicHistogram *)info->usr;
     uchar *in = (uchar *)info->inPtr[0];
-    int * sums = &cp->mSums[256 * 2 * info->lid];
-
-    for (uint32_t x = xstart; x < xend; x++) {
+    int * sums = cp->workerSums(info->lid);
+    const uint32_t stride = info->inStride[0];
+
+    uint32_t x = xstart;
+    for (; x + kLanes <= xend; x += kLanes) {
+        for (uint32_t l = 0; l < kLanes; l++) {
+            int *s = &sums[256 * 2 * l];
+            s[(in[0] << 1)    ] ++;
+            s[(in[1] << 1) + 1] ++;
+            in += stride;
+        }
+    }
+    for (; x < xend; x++) {
         sums[(in[0] << 1)    ] ++;
         sums[(in[1] << 1) + 1] ++;
-        in += info->inStride[0];
+        in += stride;
     }
 }
 
@@ -214,15 +283,36 @@ void RsdCpuScriptIntrinsicHistogram::kernelP1L4(const RsExpandKernelDriverInfo *
 
     RsdCpuScriptIntrinsicHistogram *cp = (RsdCpuScriptIntrinsicHistogram *)info->usr;
     uchar *in = (uchar *)info->inPtr[0];
-    int * sums = &cp->mSums[256 * info->lid];
-
-    for (uint32_t x = xstart; x < xend; x++) {
+    int * sums = cp->workerSums(info->lid);
+    const uint32_t stride = info->inStride[0];
+
+#if defined(ARCH_X86_HAVE_SSSE3)
+    if (gArchUseAVX2 && (stride == 4) && (xend - xstart >= 8)) {
+        uint32_t len = (xend - xstart) & ~7;
+        rsdIntrinsicHistogramDot_AVX2(sums, in, cp->mDotI, len >> 3);
+        xstart += len;
+        in += len * 4;
+    }
+#endif
+
+    uint32_t x = xstart;
+    for (; x + kLanes <= xend; x += kLanes) {
+        for (uint32_t l = 0; l < kLanes; l++) {
+            int t = (cp->mDotI[0] * in[0]) +
+                    (cp->mDotI[1] * in[1]) +
+                    (cp->mDotI[2] * in[2]) +
+                    (cp->mDotI[3] * in[3]);
+            sums[256 * l + ((t + 0x7f) >> 8)] ++;
+            in += stride;
+        }
+    }
+    for (; x < xend; x++) {
         int t = (cp->mDotI[0] * in[0]) +
                 (cp->mDotI[1] * in[1]) +
                 (cp->mDotI[2] * in[2]) +
                 (cp->mDotI[3] * in[3]);
         sums[(t + 0x7f) >> 8] ++;
-        in += info->inStride[0];
+        in += stride;
     }
 }
 
@@ -232,14 +322,36 @@ void RsdCpuScriptIntrinsicHistogram::kernelP1L3(const RsExpandKernelDriverInfo *
 
     RsdCpuScriptIntrinsicHistogram *cp = (RsdCpuScriptIntrinsicHistogram *)info->usr;
     uchar *in = (uchar *)info->inPtr[0];
-    int * sums = &cp->mSums[256 * info->lid];
-
-    for (uint32_t x = xstart; x < xend; x++) {
+    int * sums = cp->workerSums(info->lid);
+    const uint32_t stride = info->inStride[0];
+
+#if defined(ARCH_X86_HAVE_SSSE3)
+    // uchar3 is padded to 4 bytes; the padding is ignored with a zero coefficient.
+    if (gArchUseAVX2 && (stride == 4) && (xend - xstart >= 8)) {
+        const int dot[4] = {cp->mDotI[0], cp->mDotI[1], cp->mDotI[2], 0};
+        uint32_t len = (xend - xstart) & ~7;
+        rsdIntrinsicHistogramDot_AVX2(sums, in, dot, len >> 3);
+        xstart += len;
+        in += len * 4;
+    }
+#endif
+
+    uint32_t x = xstart;
+    for (; x + kLanes <= xend; x += kLanes) {
+        for (uint32_t l = 0; l < kLanes; l++) {
+            int t = (cp->mDotI[0] * in[0]) +
+                    (cp->mDotI[1] * in[1]) +
+                    (cp->mDotI[2] * in[2]);
+            sums[256 * l + ((t + 0x7f) >> 8)] ++;
+            in += stride;
+        }
+    }
+    for (; x < xend; x++) {
         int t = (cp->mDotI[0] * in[0]) +
                 (cp->mDotI[1] * in[1]) +
                 (cp->mDotI[2] * in[2]);
         sums[(t + 0x7f) >> 8] ++;
-        in += info->inStride[0];
+        in += stride;
     }
 }
 
@@ -249,13 +361,23 @@ void RsdCpuScriptIntrinsicHistogram::kernelP1L2(const RsExpandKernelDriverInfo *
 
     RsdCpuScriptIntrinsicHistogram *cp = (RsdCpuScriptIntrinsicHistogram *)info->usr;
     uchar *in = (uchar *)info->inPtr[0];
-    int * sums = &cp->mSums[256 * info->lid];
-
-    for (uint32_t x = xstart; x < xend; x++) {
+    int * sums = cp->workerSums(info->lid);
+    const uint32_t stride = info->inStride[0];
+
+    uint32_t x = xstart;
+    for (; x + kLanes <= xend; x += kLanes) {
+        for (uint32_t l = 0; l < kLanes; l++) {
+            int t = (cp->mDotI[0] * in[0]) +
+                    (cp->mDotI[1] * in[1]);
+            sums[256 * l + ((t + 0x7f) >> 8)] ++;
+            in += stride;
+        }
+    }
+    for (; x < xend; x++) {
         int t = (cp->mDotI[0] * in[0]) +
                 (cp->mDotI[1] * in[1]);
         sums[(t + 0x7f) >> 8] ++;
-        in += info->inStride[0];
+        in += stride;
     }
 }
 
@@ -265,12 +387,21 @@ void RsdCpuScriptIntrinsicHistogram::kernelP1L1(const RsExpandKernelDriverInfo *
 
     RsdCpuScriptIntrinsicHistogram *cp = (RsdCpuScriptIntrinsicHistogram *)info->usr;
     uchar *in = (uchar *)info->inPtr[0];
-    int * sums = &cp->mSums[256 * info->lid];
-
-    for (uint32_t x = xstart; x < xend; x++) {
+    int * sums = cp->workerSums(info->lid);
+    const uint32_t stride = info->inStride[0];
+
+    uint32_t x = xstart;
+    for (; x + kLanes <= xend; x += kLanes) {
+        for (uint32_t l = 0; l < kLanes; l++) {
+            int t = (cp->mDotI[0] * in[0]);
+            sums[256 * l + ((t + 0x7f) >> 8)] ++;
+            in += stride;
+        }
+    }
+    for (; x < xend; x++) {
         int t = (cp->mDotI[0] * in[0]);
         sums[(t + 0x7f) >> 8] ++;
-        in += info->inStride[0];
+        in += stride;
     }
 }
 
@@ -280,11 +411,19 @@ void RsdCpuScriptIntrinsicHistogram::kernelP1U1(const RsExpandKernelDriverInfo *
 
     RsdCpuScriptIntrinsicHistogram *cp = (RsdCpuScriptIntrinsicHistogram *)info->usr;
     uchar *in = (uchar *)info->inPtr[0];
-    int * sums = &cp->mSums[256 * info->lid];
-
-    for (uint32_t x = xstart; x < xend; x++) {
+    int * sums = cp->workerSums(info->lid);
+    const uint32_t stride = info->inStride[0];
+
+    uint32_t x = xstart;
+    for (; x + kLanes <= xend; x += kLanes) {
+        for (uint32_t l = 0; l < kLanes; l++) {
+            sums[256 * l + in[0]] ++;
+            in += stride;
+        }
+    }
+    for (; x < xend; x++) {
         sums[in[0]] ++;
-        in += info->inStride[0];
+        in += stride;
     }
 }
 
@@ -294,7 +433,9 @@ RsdCpuScriptIntrinsicHistogram::RsdCpuScriptIntrinsicHistogram(RsdCpuReferenceIm
             : RsdCpuScriptIntrinsic(ctx, s, e, RS_SCRIPT_INTRINSIC_ID_HISTOGRAM) {
 
     mRootPtr = nullptr;
-    mSums = new int[256 * 4 * mCtx->getThreadCount()];
+    mSums = new int[kWorkerSums * mCtx->getThreadCount()];
+    mWorkerUsed = new bool[mCtx->getThreadCount()];
+    mLaneSize = 256;
     mDot[0] = 0.299f;
     mDot[1] = 0.587f;
     mDot[2] = 0.114f;
@@ -309,6 +450,7 @@ RsdCpuScriptIntrinsicHistogram::~RsdCpuScriptIntrinsicHistogram() {
     if (mSums) {
         delete []mSums;
     }
+    delete []mWorkerUsed;
 }
 
 void RsdCpuScriptIntrinsicHistogram::populateScript(Script *s) {
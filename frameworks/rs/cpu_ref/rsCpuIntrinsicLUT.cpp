@@ -46,6 +46,10 @@ void RsdCpuScriptIntrinsicLUT::setGlobalObj(uint32_t slot, ObjectBase *data) {
     lut.set(static_cast<Allocation *>(data));
 }
 
+#if defined(ARCH_X86_HAVE_SSSE3)
+extern "C" void rsdIntrinsicLUT_AVX2(void *dst, const void *src, const uchar *table,
+                                     uint32_t count8);
+#endif
 
 void RsdCpuScriptIntrinsicLUT::kernel(const RsExpandKernelDriverInfo *info,
                                       uint32_t xstart, uint32_t xend,
@@ -62,6 +66,16 @@ void RsdCpuScriptIntrinsicLUT::kernel(const RsExpandKernelDriverInfo *info,
     const uchar *tb = &tg[256];
     const uchar *ta = &tb[256];
 
+#if defined(ARCH_X86_HAVE_SSSE3)
+    if (gArchUseAVX2 && (x2 - x1 >= 8)) {
+        uint32_t len = (x2 - x1) & ~7;
+        rsdIntrinsicLUT_AVX2(out, in, tr, len >> 3);
+        x1 += len;
+        out += len * 4;
+        in += len * 4;
+    }
+#endif
+
     while (x1 < x2) {
         out[0] = tr[in[0]];
         out[1] = tg[in[1]];
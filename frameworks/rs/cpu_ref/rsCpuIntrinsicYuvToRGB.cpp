@@ -95,6 +95,11 @@ extern "C" void rsdIntrinsicYuv_K(void *dst, const uchar *Y, const uchar *uv, ui
 extern "C" void rsdIntrinsicYuvR_K(void *dst, const uchar *Y, const uchar *uv, uint32_t xstart, size_t xend);
 extern "C" void rsdIntrinsicYuv2_K(void *dst, const uchar *Y, const uchar *u, const uchar *v, size_t xstart, size_t xend);
 
+#if defined(ARCH_X86_HAVE_SSSE3)
+extern "C" void rsdIntrinsicYuvToRGB_AVX2(void *dst, const uchar *Y, const uchar *u, const uchar *v,
+                                          size_t cstep, uint32_t count8);
+#endif
+
 void RsdCpuScriptIntrinsicYuvToRGB::kernel(const RsExpandKernelDriverInfo *info,
                                            uint32_t xstart, uint32_t xend,
                                            uint32_t outstep) {
@@ -181,6 +186,19 @@ void RsdCpuScriptIntrinsicYuvToRGB::kernel(const RsExpandKernelDriverInfo *info,
     }
 #endif
 
+#if defined(ARCH_X86_HAVE_SSSE3)
+    // Interleaved chroma must be packed in pairs, as the kernel loads both
+    // planes with a single load.
+    if((x2 - x1 >= 8) && gArchUseAVX2 &&
+       ((cstep == 1) || ((cstep == 2) && ((u == v + 1) || (u == v - 1))))) {
+        uint32_t len = (x2 - x1) & ~7;
+        int cx = (x1 >> 1) * cstep;
+        rsdIntrinsicYuvToRGB_AVX2(out, Y + x1, u + cx, v + cx, cstep, len >> 3);
+        x1 += len;
+        out += len;
+    }
+#endif
+
     if(x2 > x1) {
        // ALOGE("y %i  %i  %i", info->current.y, x1, x2);
         while(x1 < x2) {
@@ -0,0 +1,528 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * AVX2 kernels for the x86 intrinsics.
+ *
+ * The library is built for the baseline x86 ABI, so every function here is
+ * compiled for AVX2 with a target attribute and must only be called when
+ * gArchUseAVX2 is set. Callers fall back to the SSSE3 kernels in
+ * rsCpuIntrinsics_x86.cpp or to the C implementation otherwise.
+ *
+ * Unless noted otherwise the kernels produce bit exact results compared to
+ * the C implementation of the intrinsic.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <x86intrin.h>
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+/* Transposes the packed 8-bit pixels of two registers of 4 pixels each,
+ * as produced by _mm256_packus_epi32 followed by _mm256_packus_epi16,
+ * back into pixel order.
+ */
+static inline AVX2_TARGET __m128i unshuffle4(__m256i x) {
+    const __m256i M = _mm256_setr_epi32(0, 4, 1, 5, 0, 4, 1, 5);
+    return _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(x, M));
+}
+
+/* Packs 8 pixels of separate 32-bit r, g, b, a channels into uchar4 pixels.
+ * The channels must already be in [0, 255].
+ */
+static inline AVX2_TARGET __m256i packRGBA(__m256i r, __m256i g, __m256i b, __m256i a) {
+    __m256i o = _mm256_or_si256(r, _mm256_slli_epi32(g, 8));
+    o = _mm256_or_si256(o, _mm256_slli_epi32(b, 16));
+    return _mm256_or_si256(o, _mm256_slli_epi32(a, 24));
+}
+
+static inline AVX2_TARGET __m256i clampU8(__m256i x) {
+    return _mm256_min_epi32(_mm256_max_epi32(x, _mm256_setzero_si256()),
+                            _mm256_set1_epi32(255));
+}
+
+/* ColorMatrix
+ *
+ * Matches the float math of the C implementation, including the order of
+ * the additions, for 4 pixels per iteration. Each 128-bit lane holds one pixel.
+ */
+template <bool floatIn, bool floatOut, bool zeroW>
+static inline AVX2_TARGET void colorMatrix(void *dst, const void *src,
+                                           const float *coef, const float *add,
+                                           uint32_t count4) {
+    const __m256 c0 = _mm256_broadcast_ps((const __m128 *)(coef + 0));
+    const __m256 c1 = _mm256_broadcast_ps((const __m128 *)(coef + 4));
+    const __m256 c2 = _mm256_broadcast_ps((const __m128 *)(coef + 8));
+    const __m256 c3 = _mm256_broadcast_ps((const __m128 *)(coef + 12));
+    const __m256 a = _mm256_broadcast_ps((const __m128 *)add);
+    const __m256 vmin = _mm256_setzero_ps();
+    const __m256 vmax = _mm256_set1_ps(255.5f);
+
+    for (uint32_t i = 0; i < count4; ++i) {
+        __m256 f[2];
+        for (int p = 0; p < 2; ++p) {
+            if (floatIn) {
+                f[p] = _mm256_loadu_ps((const float *)src + p * 8);
+            } else {
+                __m128i u = _mm_loadl_epi64((const __m128i *)((const uint8_t *)src + p * 8));
+                f[p] = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(u));
+            }
+            if (zeroW) {
+                f[p] = _mm256_blend_ps(f[p], vmin, 0x88);
+            }
+
+            __m256 sum = _mm256_mul_ps(_mm256_permute_ps(f[p], 0x00), c0);
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_permute_ps(f[p], 0x55), c1));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_permute_ps(f[p], 0xaa), c2));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_permute_ps(f[p], 0xff), c3));
+            f[p] = _mm256_add_ps(sum, a);
+        }
+
+        if (floatOut) {
+            _mm256_storeu_ps((float *)dst, f[0]);
+            _mm256_storeu_ps((float *)dst + 8, f[1]);
+        } else {
+            __m256i i0 = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(f[0], vmin), vmax));
+            __m256i i1 = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(f[1], vmin), vmax));
+            __m256i o = _mm256_packus_epi32(i0, i1);
+            o = _mm256_packus_epi16(o, o);
+            _mm_storeu_si128((__m128i *)dst, unshuffle4(o));
+        }
+
+        src = (const uint8_t *)src + (floatIn ? 64 : 16);
+        dst = (uint8_t *)dst + (floatOut ? 64 : 16);
+    }
+}
+
+AVX2_TARGET
+void rsdIntrinsicColorMatrix_AVX2(void *dst, const void *src,
+                                  const float *coef, const float *add,
+                                  bool floatIn, bool floatOut, bool zeroW,
+                                  uint32_t count4) {
+    if (floatIn) {
+        if (floatOut) {
+            zeroW ? colorMatrix<true, true, true>(dst, src, coef, add, count4)
+                  : colorMatrix<true, true, false>(dst, src, coef, add, count4);
+        } else {
+            zeroW ? colorMatrix<true, false, true>(dst, src, coef, add, count4)
+                  : colorMatrix<true, false, false>(dst, src, coef, add, count4);
+        }
+    } else {
+        if (floatOut) {
+            zeroW ? colorMatrix<false, true, true>(dst, src, coef, add, count4)
+                  : colorMatrix<false, true, false>(dst, src, coef, add, count4);
+        } else {
+            zeroW ? colorMatrix<false, false, true>(dst, src, coef, add, count4)
+                  : colorMatrix<false, false, false>(dst, src, coef, add, count4);
+        }
+    }
+}
+
+/* YuvToRGB
+ *
+ * Converts 8 pixels per iteration. pU and pV point to the chroma samples of
+ * the first (even) pixel. cstep is 1 for planar chroma, or 2 for interleaved
+ * chroma, in which case pU and pV must be adjacent.
+ */
+extern "C" AVX2_TARGET
+void rsdIntrinsicYuvToRGB_AVX2(void *dst, const uint8_t *pY,
+                               const uint8_t *pU, const uint8_t *pV,
+                               size_t cstep, uint32_t count8) {
+    const __m256i biasY = _mm256_set1_epi32(16);
+    const __m256i biasUV = _mm256_set1_epi32(128);
+    const __m256i cY = _mm256_set1_epi32(298);
+    const __m256i cVR = _mm256_set1_epi32(409);
+    const __m256i cUG = _mm256_set1_epi32(-100);
+    const __m256i cVG = _mm256_set1_epi32(-208);
+    const __m256i cUB = _mm256_set1_epi32(516);
+    const __m256i A = _mm256_set1_epi32(255);
+    const __m256i Mdup = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+    const __m256i Meven = _mm256_setr_epi32(0, 0, 2, 2, 4, 4, 6, 6);
+    const __m256i Modd = _mm256_setr_epi32(1, 1, 3, 3, 5, 5, 7, 7);
+
+    const uint8_t *pUV = pU < pV ? pU : pV;
+    const __m256i MU = pU < pV ? Meven : Modd;
+    const __m256i MV = pU < pV ? Modd : Meven;
+
+    for (uint32_t i = 0; i < count8; ++i) {
+        __m256i Y = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)pY));
+        __m256i U, V;
+        if (cstep == 1) {
+            U = _mm256_cvtepu8_epi32(_mm_cvtsi32_si128(*(const int32_t *)pU));
+            V = _mm256_cvtepu8_epi32(_mm_cvtsi32_si128(*(const int32_t *)pV));
+            U = _mm256_permutevar8x32_epi32(U, Mdup);
+            V = _mm256_permutevar8x32_epi32(V, Mdup);
+            pU += 4;
+            pV += 4;
+        } else {
+            __m256i UV = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)pUV));
+            U = _mm256_permutevar8x32_epi32(UV, MU);
+            V = _mm256_permutevar8x32_epi32(UV, MV);
+            pUV += 8;
+        }
+
+        Y = _mm256_mullo_epi32(_mm256_sub_epi32(Y, biasY), cY);
+        U = _mm256_sub_epi32(U, biasUV);
+        V = _mm256_sub_epi32(V, biasUV);
+
+        __m256i R = _mm256_add_epi32(Y, _mm256_mullo_epi32(V, cVR));
+        __m256i G = _mm256_add_epi32(Y, _mm256_mullo_epi32(U, cUG));
+        G = _mm256_add_epi32(G, _mm256_mullo_epi32(V, cVG));
+        __m256i B = _mm256_add_epi32(Y, _mm256_mullo_epi32(U, cUB));
+
+        R = clampU8(_mm256_srai_epi32(_mm256_add_epi32(R, biasUV), 8));
+        G = clampU8(_mm256_srai_epi32(_mm256_add_epi32(G, biasUV), 8));
+        B = clampU8(_mm256_srai_epi32(_mm256_add_epi32(B, biasUV), 8));
+
+        _mm256_storeu_si256((__m256i *)dst, packRGBA(R, G, B, A));
+        pY += 8;
+        dst = (uint8_t *)dst + 32;
+    }
+}
+
+/* 3DLUT
+ *
+ * Trilinear interpolation of 8 pixels per iteration. The 8 corners of each
+ * pixel's cell are fetched with gathers, then the channels are interpolated
+ * in 32-bit lanes with the same fixed point steps as the C implementation.
+ */
+static inline AVX2_TARGET __m256i channel(__m256i v, int c) {
+    return _mm256_and_si256(_mm256_srli_epi32(v, c * 8), _mm256_set1_epi32(0xff));
+}
+
+static inline AVX2_TARGET __m256i lerp(__m256i v1, __m256i v2, __m256i w1, __m256i w2,
+                                       int shift) {
+    __m256i v = _mm256_add_epi32(_mm256_mullo_epi32(v1, w1), _mm256_mullo_epi32(v2, w2));
+    return _mm256_srli_epi32(v, shift);
+}
+
+extern "C" AVX2_TARGET
+void rsdIntrinsic3DLUT_AVX2(void *dst, const void *src, uint32_t count8,
+                            const void *lut, int32_t pitchy, int32_t pitchz,
+                            const int32_t *coordMul) {
+    const int *const base = (const int *)lut;
+    const __m256i mulX = _mm256_set1_epi32(coordMul[0]);
+    const __m256i mulY = _mm256_set1_epi32(coordMul[1]);
+    const __m256i mulZ = _mm256_set1_epi32(coordMul[2]);
+    const __m256i vPitchY = _mm256_set1_epi32(pitchy);
+    const __m256i vPitchZ = _mm256_set1_epi32(pitchz);
+    const __m256i mask8 = _mm256_set1_epi32(0xff);
+    const __m256i weightMask = _mm256_set1_epi32(0x7fff);
+    const __m256i one = _mm256_set1_epi32(0x8000);
+    const __m256i round = _mm256_set1_epi32(0x7f);
+    const __m256i alphaMask = _mm256_set1_epi32(0xff000000);
+
+    for (uint32_t i = 0; i < count8; ++i) {
+        const __m256i in = _mm256_loadu_si256((const __m256i *)src);
+
+        __m256i bx = _mm256_mullo_epi32(_mm256_and_si256(in, mask8), mulX);
+        __m256i by = _mm256_mullo_epi32(channel(in, 1), mulY);
+        __m256i bz = _mm256_mullo_epi32(channel(in, 2), mulZ);
+
+        __m256i w2x = _mm256_and_si256(bx, weightMask);
+        __m256i w2y = _mm256_and_si256(by, weightMask);
+        __m256i w2z = _mm256_and_si256(bz, weightMask);
+        __m256i w1x = _mm256_sub_epi32(one, w2x);
+        __m256i w1y = _mm256_sub_epi32(one, w2y);
+        __m256i w1z = _mm256_sub_epi32(one, w2z);
+
+        __m256i offset = _mm256_slli_epi32(_mm256_srai_epi32(bx, 15), 2);
+        offset = _mm256_add_epi32(offset,
+                                  _mm256_mullo_epi32(_mm256_srai_epi32(by, 15), vPitchY));
+        offset = _mm256_add_epi32(offset,
+                                  _mm256_mullo_epi32(_mm256_srai_epi32(bz, 15), vPitchZ));
+        const __m256i offset10 = _mm256_add_epi32(offset, vPitchY);
+        const __m256i offset01 = _mm256_add_epi32(offset, vPitchZ);
+        const __m256i offset11 = _mm256_add_epi32(offset10, vPitchZ);
+
+        const __m256i v000 = _mm256_i32gather_epi32(base, offset, 1);
+        const __m256i v100 = _mm256_i32gather_epi32(base + 1, offset, 1);
+        const __m256i v010 = _mm256_i32gather_epi32(base, offset10, 1);
+        const __m256i v110 = _mm256_i32gather_epi32(base + 1, offset10, 1);
+        const __m256i v001 = _mm256_i32gather_epi32(base, offset01, 1);
+        const __m256i v101 = _mm256_i32gather_epi32(base + 1, offset01, 1);
+        const __m256i v011 = _mm256_i32gather_epi32(base, offset11, 1);
+        const __m256i v111 = _mm256_i32gather_epi32(base + 1, offset11, 1);
+
+        __m256i out = _mm256_and_si256(in, alphaMask);
+        for (int c = 0; c < 3; ++c) {
+            __m256i yz00 = lerp(channel(v000, c), channel(v100, c), w1x, w2x, 7);
+            __m256i yz10 = lerp(channel(v010, c), channel(v110, c), w1x, w2x, 7);
+            __m256i yz01 = lerp(channel(v001, c), channel(v101, c), w1x, w2x, 7);
+            __m256i yz11 = lerp(channel(v011, c), channel(v111, c), w1x, w2x, 7);
+            __m256i z0 = lerp(yz00, yz10, w1y, w2y, 15);
+            __m256i z1 = lerp(yz01, yz11, w1y, w2y, 15);
+            __m256i v = lerp(z0, z1, w1z, w2z, 15);
+            v = _mm256_srli_epi32(_mm256_add_epi32(v, round), 8);
+            out = _mm256_or_si256(out, _mm256_slli_epi32(_mm256_and_si256(v, mask8), c * 8));
+        }
+
+        _mm256_storeu_si256((__m256i *)dst, out);
+        src = (const uint8_t *)src + 32;
+        dst = (uint8_t *)dst + 32;
+    }
+}
+
+/* LUT
+ *
+ * table holds the 4 consecutive 256 entry tables for r, g, b and a. The
+ * gathers load 4 bytes per lookup: the r, g and b lookups use the low byte,
+ * the a lookup loads the bytes ending at its entry so that no lookup reads
+ * outside of the tables.
+ */
+extern "C" AVX2_TARGET
+void rsdIntrinsicLUT_AVX2(void *dst, const void *src, const uint8_t *table,
+                          uint32_t count8) {
+    const int *const tr = (const int *)table;
+    const int *const tg = (const int *)(table + 256);
+    const int *const tb = (const int *)(table + 512);
+    const int *const ta = (const int *)(table + 768 - 3);
+    const __m256i mask8 = _mm256_set1_epi32(0xff);
+
+    for (uint32_t i = 0; i < count8; ++i) {
+        const __m256i in = _mm256_loadu_si256((const __m256i *)src);
+
+        __m256i r = _mm256_i32gather_epi32(tr, _mm256_and_si256(in, mask8), 1);
+        __m256i g = _mm256_i32gather_epi32(tg, channel(in, 1), 1);
+        __m256i b = _mm256_i32gather_epi32(tb, channel(in, 2), 1);
+        __m256i a = _mm256_i32gather_epi32(ta, _mm256_srli_epi32(in, 24), 1);
+
+        r = _mm256_and_si256(r, mask8);
+        g = _mm256_and_si256(g, mask8);
+        b = _mm256_and_si256(b, mask8);
+        a = _mm256_srli_epi32(a, 24);
+
+        _mm256_storeu_si256((__m256i *)dst, packRGBA(r, g, b, a));
+        src = (const uint8_t *)src + 32;
+        dst = (uint8_t *)dst + 32;
+    }
+}
+
+/* Histogram
+ *
+ * Computes the luminance bucket of 8 uchar4 pixels per iteration. The
+ * increments themselves stay scalar: a histogram has no useful vector form
+ * as neighbouring pixels often fall in the same bucket. sums holds 4 copies
+ * of the 256 buckets and consecutive pixels go to different copies, so that
+ * such runs do not serialize on a single counter.
+ */
+extern "C" AVX2_TARGET
+void rsdIntrinsicHistogramDot_AVX2(int32_t *sums, const void *src,
+                                   const int32_t *dot, uint32_t count8) {
+    const __m256i d = _mm256_setr_epi32(dot[0], dot[1], dot[2], dot[3],
+                                        dot[0], dot[1], dot[2], dot[3]);
+    // The coefficients are at most 256, so they fit the 16-bit multiplies of madd.
+    const __m256i dots16 = _mm256_packs_epi32(d, d);
+    const __m256i round = _mm256_set1_epi32(0x7f);
+    alignas(32) int32_t idx[8];
+
+    for (uint32_t i = 0; i < count8; ++i) {
+        const __m256i in = _mm256_loadu_si256((const __m256i *)src);
+        // Two pixels per 128-bit lane after widening to 16 bits, so madd
+        // leaves (x*d0 + y*d1, z*d2 + w*d3) pairs that hadd sums per pixel.
+        __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi8(in, _mm256_setzero_si256()), dots16);
+        __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi8(in, _mm256_setzero_si256()), dots16);
+        __m256i t = _mm256_hadd_epi32(lo, hi);
+        t = _mm256_srai_epi32(_mm256_add_epi32(t, round), 8);
+        _mm256_store_si256((__m256i *)idx, t);
+
+        sums[idx[0]]++;
+        sums[idx[1] + 256]++;
+        sums[idx[2] + 512]++;
+        sums[idx[3] + 768]++;
+        sums[idx[4]]++;
+        sums[idx[5] + 256]++;
+        sums[idx[6] + 512]++;
+        sums[idx[7] + 768]++;
+        src = (const uint8_t *)src + 32;
+    }
+}
+
+/* Blend
+ *
+ * Same arithmetic as the SSSE3 kernels, 8 pixels per iteration in a single
+ * register. The unpack and pack instructions work within 128-bit lanes, so
+ * the pixel order is preserved without any permutation.
+ */
+template <typename Op>
+static inline AVX2_TARGET void blend(void *dst, const void *src, uint32_t count8) {
+    const __m256i zero = _mm256_setzero_si256();
+    for (uint32_t i = 0; i < count8; ++i) {
+        const __m256i in = _mm256_loadu_si256((const __m256i *)src);
+        const __m256i out = _mm256_loadu_si256((const __m256i *)dst);
+        __m256i lo = Op::apply(_mm256_unpacklo_epi8(in, zero), _mm256_unpacklo_epi8(out, zero));
+        __m256i hi = Op::apply(_mm256_unpackhi_epi8(in, zero), _mm256_unpackhi_epi8(out, zero));
+        _mm256_storeu_si256((__m256i *)dst, _mm256_packus_epi16(lo, hi));
+        src = (const uint8_t *)src + 32;
+        dst = (uint8_t *)dst + 32;
+    }
+}
+
+/* Broadcasts the alpha of each pixel of 16-bit channels to all its channels. */
+static inline AVX2_TARGET __m256i alpha(__m256i x) {
+    return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(x, 0xff), 0xff);
+}
+
+/* (x * y) >> 8 on unsigned 16-bit channels */
+static inline AVX2_TARGET __m256i mul8(__m256i x, __m256i y) {
+    return _mm256_srli_epi16(_mm256_mullo_epi16(x, y), 8);
+}
+
+static inline AVX2_TARGET __m256i inv(__m256i x) {
+    return _mm256_sub_epi16(_mm256_set1_epi16(255), x);
+}
+
+/* Mask of the alpha channel of 16-bit channels */
+static inline AVX2_TARGET __m256i alphaMask16() {
+    return _mm256_set1_epi64x(0xffff000000000000ll);
+}
+
+struct SrcOver {
+    static inline AVX2_TARGET __m256i apply(__m256i in, __m256i out) {
+        return _mm256_add_epi16(mul8(out, inv(alpha(in))), in);
+    }
+};
+
+struct DstOver {
+    static inline AVX2_TARGET __m256i apply(__m256i in, __m256i out) {
+        return _mm256_add_epi16(mul8(in, inv(alpha(out))), out);
+    }
+};
+
+struct SrcIn {
+    static inline AVX2_TARGET __m256i apply(__m256i in, __m256i out) {
+        return mul8(in, alpha(out));
+    }
+};
+
+struct DstIn {
+    static inline AVX2_TARGET __m256i apply(__m256i in, __m256i out) {
+        return mul8(out, alpha(in));
+    }
+};
+
+struct SrcOut {
+    static inline AVX2_TARGET __m256i apply(__m256i in, __m256i out) {
+        return mul8(in, inv(alpha(out)));
+    }
+};
+
+struct DstOut {
+    static inline AVX2_TARGET __m256i apply(__m256i in, __m256i out) {
+        return mul8(out, inv(alpha(in)));
+    }
+};
+
+struct SrcAtop {
+    static inline AVX2_TARGET __m256i apply(__m256i in, __m256i out) {
+        __m256i t = _mm256_mullo_epi16(inv(alpha(in)), out);
+        t = _mm256_adds_epu16(t, _mm256_mullo_epi16(alpha(out), in));
+        return _mm256_blendv_epi8(_mm256_srli_epi16(t, 8), out, alphaMask16());
+    }
+};
+
+struct DstAtop {
+    static inline AVX2_TARGET __m256i apply(__m256i in, __m256i out) {
+        __m256i t = _mm256_mullo_epi16(inv(alpha(out)), in);
+        t = _mm256_adds_epu16(t, _mm256_mullo_epi16(alpha(in), out));
+        return _mm256_blendv_epi8(_mm256_srli_epi16(t, 8), in, alphaMask16());
+    }
+};
+
+struct Multiply {
+    static inline AVX2_TARGET __m256i apply(__m256i in, __m256i out) {
+        return mul8(in, out);
+    }
+};
+
+AVX2_TARGET
+void rsdIntrinsicBlendSrcOver_AVX2(void *dst, const void *src, uint32_t count8) {
+    blend<SrcOver>(dst, src, count8);
+}
+
+AVX2_TARGET
+void rsdIntrinsicBlendDstOver_AVX2(void *dst, const void *src, uint32_t count8) {
+    blend<DstOver>(dst, src, count8);
+}
+
+AVX2_TARGET
+void rsdIntrinsicBlendSrcIn_AVX2(void *dst, const void *src, uint32_t count8) {
+    blend<SrcIn>(dst, src, count8);
+}
+
+AVX2_TARGET
+void rsdIntrinsicBlendDstIn_AVX2(void *dst, const void *src, uint32_t count8) {
+    blend<DstIn>(dst, src, count8);
+}
+
+AVX2_TARGET
+void rsdIntrinsicBlendSrcOut_AVX2(void *dst, const void *src, uint32_t count8) {
+    blend<SrcOut>(dst, src, count8);
+}
+
+AVX2_TARGET
+void rsdIntrinsicBlendDstOut_AVX2(void *dst, const void *src, uint32_t count8) {
+    blend<DstOut>(dst, src, count8);
+}
+
+AVX2_TARGET
+void rsdIntrinsicBlendSrcAtop_AVX2(void *dst, const void *src, uint32_t count8) {
+    blend<SrcAtop>(dst, src, count8);
+}
+
+AVX2_TARGET
+void rsdIntrinsicBlendDstAtop_AVX2(void *dst, const void *src, uint32_t count8) {
+    blend<DstAtop>(dst, src, count8);
+}
+
+AVX2_TARGET
+void rsdIntrinsicBlendMultiply_AVX2(void *dst, const void *src, uint32_t count8) {
+    blend<Multiply>(dst, src, count8);
+}
+
+AVX2_TARGET
+void rsdIntrinsicBlendXor_AVX2(void *dst, const void *src, uint32_t count8) {
+    for (uint32_t i = 0; i < count8; ++i) {
+        __m256i in = _mm256_loadu_si256((const __m256i *)src);
+        __m256i out = _mm256_loadu_si256((const __m256i *)dst);
+        _mm256_storeu_si256((__m256i *)dst, _mm256_xor_si256(out, in));
+        src = (const uint8_t *)src + 32;
+        dst = (uint8_t *)dst + 32;
+    }
+}
+
+AVX2_TARGET
+void rsdIntrinsicBlendAdd_AVX2(void *dst, const void *src, uint32_t count8) {
+    for (uint32_t i = 0; i < count8; ++i) {
+        __m256i in = _mm256_loadu_si256((const __m256i *)src);
+        __m256i out = _mm256_loadu_si256((const __m256i *)dst);
+        _mm256_storeu_si256((__m256i *)dst, _mm256_adds_epu8(out, in));
+        src = (const uint8_t *)src + 32;
+        dst = (uint8_t *)dst + 32;
+    }
+}
+
+AVX2_TARGET
+void rsdIntrinsicBlendSub_AVX2(void *dst, const void *src, uint32_t count8) {
+    for (uint32_t i = 0; i < count8; ++i) {
+        __m256i in = _mm256_loadu_si256((const __m256i *)src);
+        __m256i out = _mm256_loadu_si256((const __m256i *)dst);
+        _mm256_storeu_si256((__m256i *)dst, _mm256_subs_epu8(out, in));
+        src = (const uint8_t *)src + 32;
+        dst = (uint8_t *)dst + 32;
+    }
+}
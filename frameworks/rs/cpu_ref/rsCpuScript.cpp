@@ -780,6 +780,7 @@ void RsdCpuScriptImpl::forEachKernelSetup(uint32_t slot, MTLaunchStructForEach *
     mtls->script = this;
     mtls->fep.slot = slot;
     mtls->kernel = mScriptExec->getForEachFunction(slot);
+    mtls->wholeRows = false;
     rsAssert(mtls->kernel != nullptr);
 }
 
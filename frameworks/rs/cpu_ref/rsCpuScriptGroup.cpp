@@ -280,6 +280,8 @@ void CpuScriptGroupImpl::execute() {
             mtls.script = nullptr;
             mtls.kernel = &scriptGroupRoot;
             mtls.fep.usr = &sl;
+            // scriptGroupRoot() points the kernels at the start of the row.
+            mtls.wholeRows = true;
 
             mCtx->launchForEach(ains, inLen, outs[0], nullptr, &mtls);
         }
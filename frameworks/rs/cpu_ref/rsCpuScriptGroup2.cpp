@@ -86,6 +86,18 @@ void groupRoot(const RsExpandKernelDriverInfo *kinfo, uint32_t xstart,
     memcpy(&mutable_kinfo->inStride, &oldInStride, sizeof(oldInStride));
 }
 
+// groupRoot() addresses every closure of a batch with the coordinates of the
+// launch, so they all have to cover the same cells.
+bool sameDimensions(const Closure* c1, const Closure* c2) {
+    if (c1->mReturnValue == nullptr || c2->mReturnValue == nullptr) {
+        return false;
+    }
+    const Type* t1 = c1->mReturnValue->getType();
+    const Type* t2 = c2->mReturnValue->getType();
+    return t1->getDimX() == t2->getDimX() && t1->getDimY() == t2->getDimY() &&
+           t1->getDimZ() == t2->getDimZ();
+}
+
 }  // namespace
 
 Batch::Batch(CpuScriptGroup2Impl* group, const char* name) :
@@ -100,7 +112,7 @@ Batch::~Batch() {
     free(mName);
 }
 
-bool Batch::conflict(CPUClosure* cpuClosure) const {
+bool Batch::conflict(CPUClosure* cpuClosure, bool fuseAtRuntime) const {
     if (mClosures.empty()) {
         return false;
     }
@@ -132,6 +144,13 @@ bool Batch::conflict(CPUClosure* cpuClosure) const {
         }
     }
 
+    if (fuseAtRuntime) {
+        // groupRoot() runs the closures of a batch one after the other on each
+        // row, so a closure may read the output of any closure before it at the
+        // same cell, through any of its arguments.
+        return !sameDimensions(closure, mClosures.front()->mClosure);
+    }
+
     // The compiler fusion pass in bcc expects that kernels chained up through
     // (1st) input and output.
 
@@ -161,6 +180,7 @@ CpuScriptGroup2Impl::CpuScriptGroup2Impl(RsdCpuReferenceImpl *cpuRefImpl,
     rsAssert(!mGroup->mClosures.empty());
 
     mCpuRefImpl->lockMutex();
+    const bool fuseAtRuntime = !canCompile();
     Batch* batch = new Batch(this, "Batch0");
     int i = 0;
     for (Closure* closure: mGroup->mClosures) {
@@ -171,12 +191,12 @@ CpuScriptGroup2Impl::CpuScriptGroup2Impl(RsdCpuReferenceImpl *cpuRefImpl,
         if (closure->mIsKernel) {
             MTLaunchStructForEach mtls;
             si->forEachKernelSetup(funcID->mSlot, &mtls);
-            cc = new CPUClosure(closure, si, (ExpandFuncTy)mtls.kernel);
+            cc = new CPUClosure(closure, si, (ExpandFuncTy)mtls.kernel, mtls.wholeRows);
         } else {
             cc = new CPUClosure(closure, si);
         }
 
-        if (batch->conflict(cc)) {
+        if (batch->conflict(cc, fuseAtRuntime)) {
             mBatches.push_back(batch);
             std::stringstream ss;
             ss << "Batch" << ++i;
@@ -210,6 +230,23 @@ void Batch::resolveFuncPtr(void* sharedObj) {
     rsAssert (mFunc != nullptr);
 }
 
+bool CpuScriptGroup2Impl::canCompile() const {
+#ifndef RS_COMPATIBILITY_LIB
+    if (mGroup->mClosures.size() < 2 ||
+        getCpuRefImpl()->getContext()->getOptLevel() == 0) {
+        return false;
+    }
+    for (Closure* closure : mGroup->mClosures) {
+        if (closure->mFunctionID.get()->mScript->isIntrinsic()) {
+            return false;
+        }
+    }
+    return true;
+#else
+    return false;
+#endif  // RS_COMPATIBILITY_LIB
+}
+
 CpuScriptGroup2Impl::~CpuScriptGroup2Impl() {
     for (Batch* batch : mBatches) {
         delete batch;
@@ -689,6 +726,18 @@ void Batch::run() {
         mtls.kernel = &groupRoot;
         mtls.fep.usr = &mClosures;
 
+        // Size the tiles so that what every closure of the batch reads and
+        // writes for a tile stays in the cache until the next closure uses it.
+        for (const CPUClosure* batched : mClosures) {
+            const Closure* c = batched->mClosure;
+            for (size_t i = 0; i < c->mNumArg; i++) {
+                const Allocation* a = (const Allocation*)c->mArgs[i];
+                mtls.cellBytes += a->mHal.state.elementSizeBytes;
+            }
+            mtls.cellBytes += c->mReturnValue->mHal.state.elementSizeBytes;
+            mtls.wholeRows |= batched->mWholeRows;
+        }
+
         mGroup->getCpuRefImpl()->launchForEach(nullptr, 0, nullptr, nullptr, &mtls);
     }
 
@@ -21,17 +21,20 @@ typedef void (*InvokeFuncTy)(const void*, uint32_t);
 
 class CPUClosure {
 public:
-    CPUClosure(const Closure* closure, RsdCpuScriptImpl* si, ExpandFuncTy func) :
-        mClosure(closure), mSi(si), mFunc(func) {}
+    CPUClosure(const Closure* closure, RsdCpuScriptImpl* si, ExpandFuncTy func,
+               bool wholeRows) :
+        mClosure(closure), mSi(si), mFunc(func), mWholeRows(wholeRows) {}
 
     CPUClosure(const Closure* closure, RsdCpuScriptImpl* si) :
-        mClosure(closure), mSi(si), mFunc(nullptr) {}
+        mClosure(closure), mSi(si), mFunc(nullptr), mWholeRows(false) {}
 
     // It's important to do forwarding here than inheritance for unbound value
     // binding to work.
     const Closure* mClosure;
     RsdCpuScriptImpl* mSi;
     const ExpandFuncTy mFunc;
+    // The kernel must be called on whole rows, see MTLaunchStructForEach.
+    const bool mWholeRows;
 };
 
 class CpuScriptGroup2Impl;
@@ -41,9 +44,11 @@ public:
     Batch(CpuScriptGroup2Impl* group, const char* name);
     ~Batch();
 
-    // Returns true if closure depends on any closure in this batch for a global
-    // variable
-    bool conflict(CPUClosure* closure) const;
+    // Returns true if closure cannot be run in the same pass as the closures
+    // in this batch.  With fuseAtRuntime, the batch is run by groupRoot(), which
+    // accepts any closure reading the outputs of the batch element-wise.
+    // Otherwise the rules of the bcc fusion pass apply.
+    bool conflict(CPUClosure* closure, bool fuseAtRuntime) const;
 
     void resolveFuncPtr(void* sharedObj);
     void setGlobalsForBatch();
@@ -71,6 +76,9 @@ public:
     void compile(const char* cacheDir);
 
 private:
+    // Returns true if compile() may fuse the kernels with bcc.
+    bool canCompile() const;
+
     RsdCpuReferenceImpl* mCpuRefImpl;
     const ScriptGroup2* mGroup;
     List<Batch*> mBatches;
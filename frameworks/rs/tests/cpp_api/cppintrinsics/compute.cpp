@@ -0,0 +1,322 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Runs the intrinsics on the CPU driver and compares them with reference
+// implementations, so that the SIMD kernels of each architecture are checked
+// against the same results. The element count is deliberately not a multiple
+// of the SIMD widths so that the scalar tails run too.
+
+#include "RenderScript.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+static const uint32_t kDefaultNumElems = 4099;
+
+static bool check(const char *name, const uint8_t *ref, const uint8_t *out, size_t count,
+                  int tolerance) {
+    for (size_t i = 0; i < count; i++) {
+        if (abs(ref[i] - out[i]) > tolerance) {
+            printf("%s: mismatch at byte %zu: expected %d, got %d\n", name, i, ref[i], out[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void fill(std::vector<uint8_t> &buf, int mask) {
+    for (size_t i = 0; i < buf.size(); i++) {
+        buf[i] = rand() & mask;
+    }
+}
+
+static sp<Allocation> createU8_4(sp<RS> rs, uint32_t numElems, const std::vector<uint8_t> &data) {
+    sp<Allocation> a = Allocation::createSized(rs, Element::U8_4(rs), numElems);
+    a->copy1DFrom(data.data());
+    return a;
+}
+
+static bool testBlend(sp<RS> rs, uint32_t numElems) {
+    // The reference kernels use 16-bit intermediates, which only hold the
+    // products of channels below 128.
+    std::vector<uint8_t> src(numElems * 4), dst(numElems * 4), ref(numElems * 4);
+    fill(src, 0x7f);
+    fill(dst, 0x7f);
+
+    sp<ScriptIntrinsicBlend> sc = ScriptIntrinsicBlend::create(rs, Element::U8_4(rs));
+    bool ok = true;
+    for (int mode = 0; mode < 4; mode++) {
+        sp<Allocation> ain = createU8_4(rs, numElems, src);
+        sp<Allocation> aout = createU8_4(rs, numElems, dst);
+        const char *name = nullptr;
+        switch (mode) {
+        case 0:
+            name = "blend src over";
+            sc->forEachSrcOver(ain, aout);
+            break;
+        case 1:
+            name = "blend dst in";
+            sc->forEachDstIn(ain, aout);
+            break;
+        case 2:
+            name = "blend multiply";
+            sc->forEachMultiply(ain, aout);
+            break;
+        case 3:
+            name = "blend add";
+            sc->forEachAdd(ain, aout);
+            break;
+        }
+        for (uint32_t i = 0; i < numElems * 4; i++) {
+            int in = src[i];
+            int out = dst[i];
+            int inA = src[(i & ~3) + 3];
+            switch (mode) {
+            case 0: ref[i] = in + ((out * (255 - inA)) >> 8); break;
+            case 1: ref[i] = (out * inA) >> 8; break;
+            case 2: ref[i] = (in * out) >> 8; break;
+            case 3: ref[i] = in + out > 255 ? 255 : in + out; break;
+            }
+        }
+        std::vector<uint8_t> result(numElems * 4);
+        aout->copy1DTo(result.data());
+        ok &= check(name, ref.data(), result.data(), ref.size(), 0);
+    }
+    return ok;
+}
+
+static bool testLUT(sp<RS> rs, uint32_t numElems) {
+    std::vector<uint8_t> src(numElems * 4), table(1024), ref(numElems * 4);
+    fill(src, 0xff);
+    fill(table, 0xff);
+
+    sp<ScriptIntrinsicLUT> sc = ScriptIntrinsicLUT::create(rs, Element::U8_4(rs));
+    sc->setRed(0, 256, &table[0]);
+    sc->setGreen(0, 256, &table[256]);
+    sc->setBlue(0, 256, &table[512]);
+    sc->setAlpha(0, 256, &table[768]);
+
+    sp<Allocation> ain = createU8_4(rs, numElems, src);
+    sp<Allocation> aout = Allocation::createSized(rs, Element::U8_4(rs), numElems);
+    sc->forEach(ain, aout);
+
+    for (uint32_t i = 0; i < numElems * 4; i++) {
+        ref[i] = table[(i & 3) * 256 + src[i]];
+    }
+    std::vector<uint8_t> result(numElems * 4);
+    aout->copy1DTo(result.data());
+    return check("lut", ref.data(), result.data(), ref.size(), 0);
+}
+
+static bool testColorMatrix(sp<RS> rs, uint32_t numElems) {
+    float m[16];
+    float add[4];
+    for (int i = 0; i < 16; i++) {
+        m[i] = (rand() % 2001 - 1000) / 1000.f;
+    }
+    for (int i = 0; i < 4; i++) {
+        add[i] = (rand() % 201 - 100) / 1000.f;
+    }
+    sp<ScriptIntrinsicColorMatrix> sc = ScriptIntrinsicColorMatrix::create(rs);
+    sc->setColorMatrix4(m);
+    sc->setAdd(add);
+
+    // uchar4 to uchar4: the additive vector is scaled to the 0-255 range.
+    std::vector<uint8_t> src(numElems * 4), ref(numElems * 4), result(numElems * 4);
+    fill(src, 0xff);
+    sp<Allocation> ain = createU8_4(rs, numElems, src);
+    sp<Allocation> aout = Allocation::createSized(rs, Element::U8_4(rs), numElems);
+    sc->forEach(ain, aout);
+    for (uint32_t p = 0; p < numElems; p++) {
+        const uint8_t *in = &src[p * 4];
+        for (int c = 0; c < 4; c++) {
+            float sum = in[0] * m[c] + in[1] * m[4 + c] + in[2] * m[8 + c] + in[3] * m[12 + c];
+            sum += add[c] * 255.f;
+            ref[p * 4 + c] = sum < 0.f ? 0 : (sum > 255.f ? 255 : (uint8_t)sum);
+        }
+    }
+    aout->copy1DTo(result.data());
+    // Allow for rounding differences of fused multiply-adds.
+    bool ok = check("color matrix uchar4", ref.data(), result.data(), ref.size(), 1);
+
+    // float4 to float4
+    std::vector<float> fsrc(numElems * 4), fresult(numElems * 4);
+    for (size_t i = 0; i < fsrc.size(); i++) {
+        fsrc[i] = (rand() % 20001 - 10000) / 1000.f;
+    }
+    ain = Allocation::createSized(rs, Element::F32_4(rs), numElems);
+    aout = Allocation::createSized(rs, Element::F32_4(rs), numElems);
+    ain->copy1DFrom(fsrc.data());
+    sc->forEach(ain, aout);
+    aout->copy1DTo(fresult.data());
+    for (uint32_t p = 0; p < numElems && ok; p++) {
+        const float *in = &fsrc[p * 4];
+        for (int c = 0; c < 4; c++) {
+            float sum = in[0] * m[c] + in[1] * m[4 + c] + in[2] * m[8 + c] + in[3] * m[12 + c];
+            sum += add[c];
+            if (fabsf(sum - fresult[p * 4 + c]) > 1e-4f * (1.f + fabsf(sum))) {
+                printf("color matrix float4: mismatch at %u: expected %f, got %f\n",
+                       p * 4 + c, sum, fresult[p * 4 + c]);
+                ok = false;
+                break;
+            }
+        }
+    }
+    return ok;
+}
+
+static bool test3DLUT(sp<RS> rs, uint32_t numElems) {
+    const int dimX = 17, dimY = 9, dimZ = 33;
+    std::vector<uint8_t> lut(dimX * dimY * dimZ * 4);
+    std::vector<uint8_t> src(numElems * 4), ref(numElems * 4), result(numElems * 4);
+    fill(lut, 0xff);
+    fill(src, 0xff);
+
+    sp<const Type> t = Type::create(rs, Element::U8_4(rs), dimX, dimY, dimZ);
+    sp<Allocation> alut = Allocation::createTyped(rs, t);
+    alut->copy3DRangeFrom(0, 0, 0, dimX, dimY, dimZ, lut.data());
+
+    sp<ScriptIntrinsic3DLUT> sc = ScriptIntrinsic3DLUT::create(rs, Element::U8_4(rs));
+    sc->setLUT(alut);
+    sp<Allocation> ain = createU8_4(rs, numElems, src);
+    sp<Allocation> aout = Allocation::createSized(rs, Element::U8_4(rs), numElems);
+    sc->forEach(ain, aout);
+    aout->copy1DTo(result.data());
+
+    const int dims[3] = {dimX, dimY, dimZ};
+    const int strides[3] = {4, dimX * 4, dimX * dimY * 4};
+    for (uint32_t p = 0; p < numElems; p++) {
+        const uint8_t *in = &src[p * 4];
+        int coord[3];
+        uint32_t w1[3], w2[3];
+        for (int i = 0; i < 3; i++) {
+            int mul = (int)((1.f / 255.f) * (dims[i] - 1) * (float)0x8000);
+            int base = in[i] * mul;
+            coord[i] = base >> 15;
+            w2[i] = base & 0x7fff;
+            w1[i] = 0x8000 - w2[i];
+        }
+        const uint8_t *bp = &lut[coord[0] * strides[0] + coord[1] * strides[1] +
+                                 coord[2] * strides[2]];
+        for (int c = 0; c < 3; c++) {
+            uint32_t v[8];
+            for (int k = 0; k < 8; k++) {
+                v[k] = bp[(k & 1) * strides[0] + ((k >> 1) & 1) * strides[1] +
+                          (k >> 2) * strides[2] + c];
+            }
+            uint32_t yz00 = (v[0] * w1[0] + v[1] * w2[0]) >> 7;
+            uint32_t yz10 = (v[2] * w1[0] + v[3] * w2[0]) >> 7;
+            uint32_t yz01 = (v[4] * w1[0] + v[5] * w2[0]) >> 7;
+            uint32_t yz11 = (v[6] * w1[0] + v[7] * w2[0]) >> 7;
+            uint32_t z0 = (yz00 * w1[1] + yz10 * w2[1]) >> 15;
+            uint32_t z1 = (yz01 * w1[1] + yz11 * w2[1]) >> 15;
+            ref[p * 4 + c] = (((z0 * w1[2] + z1 * w2[2]) >> 15) + 0x7f) >> 8;
+        }
+        ref[p * 4 + 3] = in[3];
+    }
+    return check("3dlut", ref.data(), result.data(), ref.size(), 1);
+}
+
+static bool checkHistogram(const char *name, const std::vector<int32_t> &ref,
+                           const std::vector<int32_t> &result) {
+    for (size_t i = 0; i < ref.size(); i++) {
+        if (ref[i] != result[i]) {
+            printf("%s: mismatch in bucket %zu: expected %d, got %d\n", name, i, ref[i],
+                   result[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// A mask of 0 gives a flat image, where every pixel falls in the same bucket.
+static bool testHistogram(sp<RS> rs, uint32_t numElems, int mask) {
+    const float dot[4] = {0.299f, 0.587f, 0.114f, 0.f};
+    std::vector<uint8_t> src(numElems * 4);
+    fill(src, mask);
+    sp<Allocation> ain = createU8_4(rs, numElems, src);
+
+    sp<ScriptIntrinsicHistogram> sc = ScriptIntrinsicHistogram::create(rs, Element::U8_4(rs));
+    sp<Allocation> aout = Allocation::createSized(rs, Element::I32(rs), 256);
+    sc->setOutput(aout);
+    sc->setDotCoefficients(dot[0], dot[1], dot[2], dot[3]);
+    sc->forEach_dot(ain);
+
+    int dotI[4];
+    for (int i = 0; i < 4; i++) {
+        dotI[i] = (int)(dot[i] * 256.f + 0.5f);
+    }
+    std::vector<int32_t> ref(256), result(256);
+    for (uint32_t p = 0; p < numElems; p++) {
+        const uint8_t *in = &src[p * 4];
+        int t = dotI[0] * in[0] + dotI[1] * in[1] + dotI[2] * in[2] + dotI[3] * in[3];
+        ref[(t + 0x7f) >> 8]++;
+    }
+    aout->copy1DTo(result.data());
+    if (!checkHistogram("histogram dot", ref, result)) {
+        return false;
+    }
+
+    // One histogram per channel, interleaved in the output.
+    sp<Allocation> aout4 = Allocation::createSized(rs, Element::I32_4(rs), 256);
+    sc->setOutput(aout4);
+    sc->forEach(ain);
+
+    std::vector<int32_t> ref4(256 * 4), result4(256 * 4);
+    for (uint32_t i = 0; i < numElems * 4; i++) {
+        ref4[src[i] * 4 + (i & 3)]++;
+    }
+    aout4->copy1DTo(result4.data());
+    return checkHistogram("histogram", ref4, result4);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numElems = kDefaultNumElems;
+
+    if (argc >= 2) {
+        int tempNumElems = atoi(argv[1]);
+        if (tempNumElems < 1) {
+            printf("numElems must be greater than 0\n");
+            return 1;
+        }
+        numElems = (uint32_t) tempNumElems;
+    }
+
+    sp<RS> rs = new RS();
+
+    // Prefer the CPU driver, which runs the kernels under test.
+    if (!rs->init("/system/bin", RS_INIT_LOW_LATENCY | RS_INIT_SYNCHRONOUS)) {
+        printf("Could not initialize RenderScript\n");
+        return 1;
+    }
+
+    srand(1);
+    bool ok = testBlend(rs, numElems);
+    ok &= testLUT(rs, numElems);
+    ok &= testColorMatrix(rs, numElems);
+    ok &= test3DLUT(rs, numElems);
+    ok &= testHistogram(rs, numElems, 0xff);
+    ok &= testHistogram(rs, numElems, 0);
+
+    if (!ok) {
+        printf("Test failed!\n");
+        return 1;
+    }
+    printf("Test successful with %u elems!\n", numElems);
+    return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures how the CPU driver schedules kernels over images of different
+// shapes, and how long a launch too small to be split takes.  Also checks
+// that every cell of a launch is run exactly once.
+//
+// usage: rstest-scheduler [iters]
+
+#include "RenderScript.h"
+#include <string.h>
+#include <sys/time.h>
+
+#include <functional>
+
+#include "ScriptC_scheduler.h"
+
+static long long nowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+static void measure(sp<RS> rs, const char *name, int iters, uint32_t pixels,
+                    const std::function<void()> &run) {
+    // Warm up, so that the first launch setup is not measured.
+    run();
+    rs->finish();
+
+    long long start = nowUs();
+    for (int i = 0; i < iters; i++) {
+        run();
+    }
+    rs->finish();
+    long long elapsed = nowUs() - start;
+
+    printf("  %-16s %10.1f us/iter %10.1f Mpixels/s\n", name, (double)elapsed / iters,
+           (double)pixels * iters / elapsed);
+}
+
+static bool runShape(sp<RS> rs, sp<ScriptC_scheduler> sc, int iters,
+                     uint32_t width, uint32_t height) {
+    printf("%ux%u\n", width, height);
+
+    const uint32_t pixels = width * height;
+    sp<const Element> e = Element::U8_4(rs);
+    sp<const Type> t = Type::create(rs, e, width, height, 0);
+    sp<Allocation> ain = Allocation::createTyped(rs, t);
+    sp<Allocation> aout = Allocation::createTyped(rs, t);
+
+    uint8_t *buf = new uint8_t[pixels * 4];
+    for (uint32_t i = 0; i < pixels * 4; i++) {
+        buf[i] = (uint8_t)(i * 7 + (i >> 10));
+    }
+    ain->copy2DRangeFrom(0, 0, width, height, buf);
+    delete [] buf;
+
+    measure(rs, "user kernel", iters, pixels, [&] { sc->forEach_brighten(ain, aout); });
+
+    sp<ScriptIntrinsicConvolve3x3> convolve = ScriptIntrinsicConvolve3x3::create(rs, e);
+    float coefs[9] = {0.f, -1.f, 0.f, -1.f, 5.f, -1.f, 0.f, -1.f, 0.f};
+    convolve->setCoefficients(coefs);
+    convolve->setInput(ain);
+    measure(rs, "Convolve3x3", iters, pixels, [&] { convolve->forEach(aout); });
+
+    sp<ScriptIntrinsicBlur> blur = ScriptIntrinsicBlur::create(rs, e);
+    blur->setRadius(5.f);
+    blur->setInput(ain);
+    measure(rs, "Blur r=5", iters, pixels, [&] { blur->forEach(aout); });
+
+    // Each cell writes its own index, so a cell that is skipped or run twice
+    // with the wrong coordinates shows up.
+    sp<const Type> ti = Type::create(rs, Element::U32(rs), width, height, 0);
+    sp<Allocation> indexIn = Allocation::createTyped(rs, ti);
+    sp<Allocation> indexOut = Allocation::createTyped(rs, ti);
+    uint32_t *index = new uint32_t[pixels];
+    memset(index, 0xff, pixels * sizeof(uint32_t));
+    indexOut->copy2DRangeFrom(0, 0, width, height, index);
+    sc->set_width(width);
+    sc->forEach_index(indexIn, indexOut);
+    indexOut->copy2DRangeTo(0, 0, width, height, index);
+    bool failed = false;
+    for (uint32_t i = 0; i < pixels; i++) {
+        if (index[i] != i) {
+            printf("  index mismatch at (%u, %u): %u\n", i % width, i / width, index[i]);
+            failed = true;
+            break;
+        }
+    }
+    delete [] index;
+    return !failed;
+}
+
+int main(int argc, char** argv)
+{
+    int iters = 100;
+
+    if (argc >= 2) {
+        iters = atoi(argv[1]);
+        if (iters <= 0) {
+            printf("iters must be positive\n");
+            return 1;
+        }
+    }
+
+    sp<RS> rs = new RS();
+
+    if (!rs->init("/system/bin", RS_INIT_LOW_LATENCY)) {
+        printf("Could not initialize RenderScript\n");
+        return 1;
+    }
+
+    sp<ScriptC_scheduler> sc = new ScriptC_scheduler(rs);
+
+    // Launches small enough to run on the calling thread, and ones just big
+    // enough to wake up the other threads.
+    for (uint32_t count : {64u, 16384u}) {
+        sp<Allocation> a = Allocation::createSized(rs, Element::U32(rs), count);
+        char name[32];
+        snprintf(name, sizeof(name), "empty x %u", count);
+        measure(rs, name, iters * 10, count, [&] { sc->forEach_empty(a); });
+    }
+
+    // A typical frame, wide and tall images, and a long 1D launch.
+    static const uint32_t kShapes[][2] = {
+        {1920, 1080}, {8192, 256}, {256, 8192}, {1 << 20, 1},
+    };
+
+    bool failed = false;
+    for (const auto &shape : kShapes) {
+        if (!runShape(rs, sc, iters, shape[0], shape[1])) {
+            failed = true;
+        }
+    }
+
+    if (failed) {
+        printf("FAILED\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,25 @@
+LOCAL_PATH:= $(call my-dir)
+include $(CLEAR_VARS)
+
+LOCAL_MODULE:= rstest-scriptgroup2
+LOCAL_LICENSE_KINDS:= SPDX-license-identifier-Apache-2.0
+LOCAL_LICENSE_CONDITIONS:= notice
+
+LOCAL_SDK_VERSION := 21
+LOCAL_NDK_STL_VARIANT := c++_static
+
+LOCAL_SRC_FILES:= \
+	pipeline.rscript \
+	scriptgroup2.cpp
+
+LOCAL_STATIC_LIBRARIES := \
+	libRScpp_static
+
+# The C++ API has no ScriptGroup2 wrapper, the test calls the driver through
+# the dispatch table.
+LOCAL_C_INCLUDES += \
+	frameworks/rs \
+	frameworks/rs/cpp
+
+include frameworks/rs/tests/cpp_api/common.mk
+include $(BUILD_EXECUTABLE)
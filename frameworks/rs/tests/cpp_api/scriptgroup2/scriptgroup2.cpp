@@ -0,0 +1,306 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Runs multi-stage pipelines of intrinsics and user kernels as a ScriptGroup2
+// and as separate launches, checks that both give the same result, and prints
+// how long each takes.
+//
+//   fused:  brighten -> ColorMatrix -> LUT -> mix(LUT, brighten)
+//           Every stage reads the previous ones element-wise, so the CPU
+//           driver runs them in one pass.
+//   split:  brighten -> Convolve3x3 -> mix(Convolve3x3, brighten)
+//           Convolve3x3 reads neighbouring cells of its input, so the driver
+//           has to finish brighten first.
+//
+// usage: rstest-scriptgroup2 [iters] [width] [height]
+
+#include "RenderScript.h"
+#include "rsDispatch.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <functional>
+#include <vector>
+
+#include "ScriptC_pipeline.h"
+
+// Slot 0 is reserved for root(), the kernels follow in source order.
+static const int kSlotBrighten = 1;
+static const int kSlotMix = 2;
+
+// Signatures as reflected for the kernel IDs: input, output and, for the
+// user kernels, the RS_KERNEL flag.
+static const int kSigIn = 0x01;
+static const int kSigOut = 0x02;
+static const int kSigKernel = 0x20;
+
+static long long nowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+static void measure(sp<RS> rs, const char *name, int iters, uint32_t pixels,
+                    const std::function<void()> &run) {
+    // Warm up, so that the first launch setup is not measured.
+    run();
+    rs->finish();
+
+    long long start = nowUs();
+    for (int i = 0; i < iters; i++) {
+        run();
+    }
+    rs->finish();
+    long long elapsed = nowUs() - start;
+
+    printf("  %-16s %10.1f us/iter %10.1f Mpixels/s\n", name, (double)elapsed / iters,
+           (double)pixels * iters / elapsed);
+}
+
+// An argument or global of a closure: either a plain allocation, or the
+// return value of an earlier closure.
+struct Value {
+    sp<Allocation> alloc;
+    RsClosure dep;
+};
+
+class Group {
+public:
+    explicit Group(sp<RS> rs) : mRS(rs) {}
+
+    ~Group() {
+        if (mGroup != nullptr) {
+            RS::dispatch->ObjDestroy(mRS->getContext(), mGroup);
+        }
+        for (void *id : mObjects) {
+            RS::dispatch->ObjDestroy(mRS->getContext(), id);
+        }
+    }
+
+    RsScriptKernelID kernelID(const sp<Script> &s, int slot, int sig) {
+        RsScriptKernelID id = RS::dispatch->ScriptKernelIDCreate(mRS->getContext(), s->getID(),
+                                                                 slot, sig);
+        mObjects.push_back(id);
+        return id;
+    }
+
+    RsScriptFieldID fieldID(const sp<Script> &s, int slot) {
+        RsScriptFieldID id = RS::dispatch->ScriptFieldIDCreate(mRS->getContext(), s->getID(),
+                                                               slot);
+        mObjects.push_back(id);
+        return id;
+    }
+
+    RsClosure add(RsScriptKernelID kernel, const sp<Allocation> &ret,
+                  const std::vector<Value> &args,
+                  RsScriptFieldID global = nullptr, Value globalValue = Value()) {
+        std::vector<RsScriptFieldID> fieldIDs(args.size(), nullptr);
+        std::vector<int64_t> values;
+        std::vector<int> sizes(args.size(), -1);
+        std::vector<RsClosure> deps;
+        for (const Value &v : args) {
+            values.push_back((int64_t)(uintptr_t)v.alloc->getID());
+            deps.push_back(v.dep);
+        }
+        if (global != nullptr) {
+            fieldIDs.push_back(global);
+            values.push_back((int64_t)(uintptr_t)globalValue.alloc->getID());
+            sizes.push_back(-1);
+            deps.push_back(globalValue.dep);
+        }
+        std::vector<RsScriptFieldID> depFieldIDs(fieldIDs.size(), nullptr);
+
+        RsClosure c = RS::dispatch->ClosureCreate(
+                mRS->getContext(), kernel, ret->getID(), fieldIDs.data(), fieldIDs.size(),
+                values.data(), values.size(), sizes.data(), sizes.size(), deps.data(),
+                deps.size(), depFieldIDs.data(), depFieldIDs.size());
+        mClosures.push_back(c);
+        mObjects.push_back(c);
+        return c;
+    }
+
+    void create(const char *name) {
+        const char *cacheDir = "/data/local/tmp";
+        mGroup = RS::dispatch->ScriptGroup2Create(mRS->getContext(), name, strlen(name),
+                                                  cacheDir, strlen(cacheDir),
+                                                  mClosures.data(), mClosures.size());
+    }
+
+    void execute() {
+        RS::dispatch->ScriptGroupExecute(mRS->getContext(), (RsScriptGroup)mGroup);
+    }
+
+private:
+    sp<RS> mRS;
+    std::vector<RsClosure> mClosures;
+    std::vector<void *> mObjects;
+    RsScriptGroup2 mGroup = nullptr;
+};
+
+static bool compare(const char *name, const sp<Allocation> &a, const sp<Allocation> &b,
+                    uint32_t width, uint32_t height) {
+    std::vector<uint8_t> bufA(width * height * 4);
+    std::vector<uint8_t> bufB(width * height * 4);
+    a->copy2DRangeTo(0, 0, width, height, bufA.data());
+    b->copy2DRangeTo(0, 0, width, height, bufB.data());
+    for (size_t i = 0; i < bufA.size(); i++) {
+        if (bufA[i] != bufB[i]) {
+            printf("%s: mismatch at (%zu, %zu) channel %zu: %u != %u\n", name,
+                   (i / 4) % width, (i / 4) / width, i % 4, bufA[i], bufB[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    int iters = 50;
+    uint32_t width = 1920;
+    uint32_t height = 1080;
+
+    if (argc >= 2) {
+        iters = atoi(argv[1]);
+        if (iters <= 0) {
+            printf("iters must be positive\n");
+            return 1;
+        }
+    }
+    if (argc >= 4) {
+        int w = atoi(argv[2]);
+        int h = atoi(argv[3]);
+        if (w <= 0 || h <= 0) {
+            printf("width and height must be positive\n");
+            return 1;
+        }
+        width = w;
+        height = h;
+    }
+
+    printf("iters = %d, %ux%u\n", iters, width, height);
+
+    sp<RS> rs = new RS();
+
+    // ScriptGroup2 needs API 23.
+    if (!rs->init("/system/bin", RS_INIT_LOW_LATENCY, 23)) {
+        printf("Could not initialize RenderScript\n");
+        return 1;
+    }
+
+    const uint32_t pixels = width * height;
+    sp<const Element> e = Element::U8_4(rs);
+    sp<const Type> t = Type::create(rs, e, width, height, 0);
+    auto alloc = [&] { return Allocation::createTyped(rs, t); };
+
+    std::vector<uint8_t> buf(pixels * 4);
+    for (uint32_t i = 0; i < pixels * 4; i++) {
+        buf[i] = (uint8_t)(i * 7 + (i >> 10));
+    }
+    sp<Allocation> ain = alloc();
+    ain->copy2DRangeFrom(0, 0, width, height, buf.data());
+
+    sp<ScriptC_pipeline> sc = new ScriptC_pipeline(rs);
+
+    sp<ScriptIntrinsicColorMatrix> colorMatrix = ScriptIntrinsicColorMatrix::create(rs);
+    colorMatrix->setYUVtoRGB();
+
+    sp<ScriptIntrinsicLUT> lut = ScriptIntrinsicLUT::create(rs, e);
+    unsigned char table[256];
+    for (int i = 0; i < 256; i++) {
+        table[i] = 255 - i;
+    }
+    lut->setRed(0, 256, table);
+    lut->setBlue(0, 256, table);
+
+    sp<ScriptIntrinsicConvolve3x3> convolve = ScriptIntrinsicConvolve3x3::create(rs, e);
+    float coefs[9] = {0.f, -1.f, 0.f, -1.f, 5.f, -1.f, 0.f, -1.f, 0.f};
+    convolve->setCoefficients(coefs);
+
+    bool failed = false;
+
+    {
+        sp<Allocation> bright = alloc(), cm = alloc(), lo = alloc(), out = alloc();
+        auto separate = [&] {
+            sc->forEach_brighten(ain, bright);
+            colorMatrix->forEach(bright, cm);
+            lut->forEach(cm, lo);
+            sc->forEach_mix(lo, bright, out);
+        };
+        separate();
+        rs->finish();
+
+        sp<Allocation> gBright = alloc(), gCm = alloc(), gLut = alloc(), gOut = alloc();
+        Group g(rs);
+        RsClosure c1 = g.add(g.kernelID(sc, kSlotBrighten, kSigIn | kSigOut | kSigKernel),
+                             gBright, {{ain, nullptr}});
+        RsClosure c2 = g.add(g.kernelID(colorMatrix, 0, kSigIn | kSigOut),
+                             gCm, {{gBright, c1}});
+        RsClosure c3 = g.add(g.kernelID(lut, 0, kSigIn | kSigOut), gLut, {{gCm, c2}});
+        g.add(g.kernelID(sc, kSlotMix, kSigIn | kSigOut | kSigKernel),
+              gOut, {{gLut, c3}, {gBright, c1}});
+        g.create("fused");
+        g.execute();
+        rs->finish();
+
+        if (!compare("fused", out, gOut, width, height)) {
+            failed = true;
+        }
+
+        printf("fused\n");
+        measure(rs, "separate", iters, pixels, separate);
+        measure(rs, "ScriptGroup2", iters, pixels, [&] { g.execute(); });
+    }
+
+    {
+        sp<Allocation> bright = alloc(), conv = alloc(), out = alloc();
+        auto separate = [&] {
+            sc->forEach_brighten(ain, bright);
+            convolve->setInput(bright);
+            convolve->forEach(conv);
+            sc->forEach_mix(conv, bright, out);
+        };
+        separate();
+        rs->finish();
+
+        sp<Allocation> gBright = alloc(), gConv = alloc(), gOut = alloc();
+        Group g(rs);
+        RsClosure c1 = g.add(g.kernelID(sc, kSlotBrighten, kSigIn | kSigOut | kSigKernel),
+                             gBright, {{ain, nullptr}});
+        RsClosure c2 = g.add(g.kernelID(convolve, 0, kSigOut), gConv, {},
+                             g.fieldID(convolve, 1), {gBright, c1});
+        g.add(g.kernelID(sc, kSlotMix, kSigIn | kSigOut | kSigKernel),
+              gOut, {{gConv, c2}, {gBright, c1}});
+        g.create("split");
+        g.execute();
+        rs->finish();
+
+        if (!compare("split", out, gOut, width, height)) {
+            failed = true;
+        }
+
+        printf("split\n");
+        measure(rs, "separate", iters, pixels, separate);
+        measure(rs, "ScriptGroup2", iters, pixels, [&] { g.execute(); });
+    }
+
+    if (failed) {
+        printf("FAILED\n");
+        return 1;
+    }
+    printf("PASSED\n");
+    return 0;
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the throughput of each intrinsic on a full image, in megapixels
+// per second.
+//
+// usage: rstest-throughput [iters] [width] [height]
+//
+// e.g. rstest-throughput 20 4000 3000 for a 12 megapixel image.
+
+#include "RenderScript.h"
+#include <string.h>
+#include <sys/time.h>
+
+#include <functional>
+
+static long long nowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+static void measure(sp<RS> rs, const char *name, int iters, uint32_t pixels,
+                    const std::function<void()> &run) {
+    // Warm up, so that the first launch setup is not measured.
+    run();
+    rs->finish();
+
+    long long start = nowUs();
+    for (int i = 0; i < iters; i++) {
+        run();
+    }
+    rs->finish();
+    long long elapsed = nowUs() - start;
+
+    printf("%-20s %10.1f us/iter %10.1f Mpixels/s\n", name, (double)elapsed / iters,
+           (double)pixels * iters / elapsed);
+}
+
+int main(int argc, char** argv)
+{
+    int iters = 100;
+    uint32_t width = 1920;
+    uint32_t height = 1080;
+
+    if (argc >= 2) {
+        iters = atoi(argv[1]);
+        if (iters <= 0) {
+            printf("iters must be positive\n");
+            return 1;
+        }
+    }
+    if (argc >= 4) {
+        int w = atoi(argv[2]);
+        int h = atoi(argv[3]);
+        if (w <= 0 || h <= 0) {
+            printf("width and height must be positive\n");
+            return 1;
+        }
+        width = w;
+        height = h;
+    }
+
+    printf("iters = %d, %ux%u\n", iters, width, height);
+
+    sp<RS> rs = new RS();
+
+    if (!rs->init("/system/bin", RS_INIT_LOW_LATENCY)) {
+        printf("Could not initialize RenderScript\n");
+        return 1;
+    }
+
+    const uint32_t pixels = width * height;
+    sp<const Element> e = Element::U8_4(rs);
+    sp<const Type> t = Type::create(rs, e, width, height, 0);
+    sp<Allocation> ain = Allocation::createTyped(rs, t);
+    sp<Allocation> aout = Allocation::createTyped(rs, t);
+
+    uint8_t *buf = new uint8_t[pixels * 4];
+    for (uint32_t i = 0; i < pixels * 4; i++) {
+        buf[i] = (uint8_t)(i * 7 + (i >> 10));
+    }
+    ain->copy2DRangeFrom(0, 0, width, height, buf);
+    aout->copy2DRangeFrom(0, 0, width, height, buf);
+
+    sp<ScriptIntrinsicColorMatrix> colorMatrix = ScriptIntrinsicColorMatrix::create(rs);
+    colorMatrix->setYUVtoRGB();
+    measure(rs, "ColorMatrix", iters, pixels, [&] { colorMatrix->forEach(ain, aout); });
+
+    sp<ScriptIntrinsicBlend> blend = ScriptIntrinsicBlend::create(rs, e);
+    measure(rs, "Blend SrcOver", iters, pixels, [&] { blend->forEachSrcOver(ain, aout); });
+    measure(rs, "Blend SrcAtop", iters, pixels, [&] { blend->forEachSrcAtop(ain, aout); });
+    measure(rs, "Blend Multiply", iters, pixels, [&] { blend->forEachMultiply(ain, aout); });
+
+    sp<ScriptIntrinsicLUT> lut = ScriptIntrinsicLUT::create(rs, e);
+    unsigned char table[256];
+    for (int i = 0; i < 256; i++) {
+        table[i] = 255 - i;
+    }
+    lut->setRed(0, 256, table);
+    lut->setBlue(0, 256, table);
+    measure(rs, "LUT", iters, pixels, [&] { lut->forEach(ain, aout); });
+
+    sp<ScriptIntrinsic3DLUT> lut3d = ScriptIntrinsic3DLUT::create(rs, e);
+    sp<Allocation> cube = Allocation::createTyped(rs, Type::create(rs, e, 32, 32, 32));
+    cube->copy3DRangeFrom(0, 0, 0, 32, 32, 32, buf);
+    lut3d->setLUT(cube);
+    measure(rs, "3DLUT", iters, pixels, [&] { lut3d->forEach(ain, aout); });
+
+    sp<ScriptIntrinsicHistogram> histogram = ScriptIntrinsicHistogram::create(rs, e);
+    sp<Allocation> sums = Allocation::createSized(rs, Element::I32(rs), 256);
+    histogram->setOutput(sums);
+    histogram->setDotCoefficients(0.299f, 0.587f, 0.114f, 0.f);
+    measure(rs, "Histogram dot", iters, pixels, [&] { histogram->forEach_dot(ain); });
+    sp<Allocation> sums4 = Allocation::createSized(rs, Element::I32_4(rs), 256);
+    histogram->setOutput(sums4);
+    measure(rs, "Histogram", iters, pixels, [&] { histogram->forEach(ain); });
+
+    // Every pixel in the same bucket, the worst case for the counters.
+    sp<Allocation> flat = Allocation::createTyped(rs, t);
+    memset(buf, 0x80, pixels * 4);
+    flat->copy2DRangeFrom(0, 0, width, height, buf);
+    measure(rs, "Histogram flat", iters, pixels, [&] { histogram->forEach(flat); });
+    histogram->setOutput(sums);
+    measure(rs, "Histogram dot flat", iters, pixels, [&] { histogram->forEach_dot(flat); });
+
+    Type::Builder yuvBuilder(rs, Element::YUV(rs));
+    yuvBuilder.setX(width);
+    yuvBuilder.setY(height);
+    yuvBuilder.setYuvFormat(RS_YUV_NV21);
+    sp<Allocation> yuv = Allocation::createTyped(rs, yuvBuilder.create());
+    sp<ScriptIntrinsicYuvToRGB> yuvToRGB = ScriptIntrinsicYuvToRGB::create(rs, e);
+    yuvToRGB->setInput(yuv);
+    measure(rs, "YuvToRGB", iters, pixels, [&] { yuvToRGB->forEach(aout); });
+
+    sp<ScriptIntrinsicConvolve3x3> convolve = ScriptIntrinsicConvolve3x3::create(rs, e);
+    float coefs[9] = {0.f, -1.f, 0.f, -1.f, 5.f, -1.f, 0.f, -1.f, 0.f};
+    convolve->setCoefficients(coefs);
+    convolve->setInput(ain);
+    measure(rs, "Convolve3x3", iters, pixels, [&] { convolve->forEach(aout); });
+
+    sp<ScriptIntrinsicBlur> blur = ScriptIntrinsicBlur::create(rs, e);
+    blur->setRadius(10.f);
+    blur->setInput(ain);
+    measure(rs, "Blur r=10", iters, pixels, [&] { blur->forEach(aout); });
+
+    delete [] buf;
+    return 0;
+}
@@ -25,6 +25,8 @@ extern "C" {
 void stats_log_close();
 int stats_log_is_closed();
 int write_buffer_to_statsd(void* buffer, size_t size, uint32_t atomId);
+void stats_log_set_buffering(size_t maxBytes, uint32_t maxDelayMillis);
+int stats_log_flush();
 #ifdef __cplusplus
 }
 #endif  // __CPLUSPLUS
@@ -20,6 +20,9 @@
  * Helpers to manage the statsd socket.
  **/
 
+#include <stddef.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif  // __CPLUSPLUS
@@ -28,6 +31,41 @@ extern "C" {
  * Closes the statsd socket file descriptor.
  **/
 void AStatsSocket_close();
+
+/**
+ * Writes an atom that is already serialized in the AStatsEvent encoding, as
+ * the AStatsEvent it was built from would be written by AStatsEvent_write().
+ * This is used by the stats_write functions generated for atoms of only
+ * fixed-size fields, which serialize them without an AStatsEvent.
+ *
+ * Returns the number of bytes written, or -errno on failure.
+ **/
+int AStatsSocket_write(const uint8_t* buffer, size_t size, uint32_t atomId);
+
+/**
+ * Buffers the atoms written by this process and sends them to statsd in
+ * multi-atom datagrams, so that a burst of atoms costs one socket write (and
+ * one statsd wakeup) per batch instead of one per atom.
+ *
+ * Buffered atoms are sent once they fill maxBytes, once the oldest of them
+ * has been buffered for maxDelayMillis, or on AStatsSocket_flush(). Atoms
+ * that do not fit in maxBytes are sent alone. A batch that cannot be sent is
+ * counted as that many dropped atoms. maxBytes is capped to the datagram
+ * payload size, and 0 sends the buffered atoms and stops buffering.
+ *
+ * Forked children keep buffering, but discard the atoms the parent had buffered.
+ *
+ * While buffering, AStatsEvent_write() returns the number of bytes buffered.
+ * Buffering must not be enabled by processes that write atoms from signal
+ * handlers.
+ **/
+void AStatsSocket_setBuffering(size_t maxBytes, uint32_t maxDelayMillis);
+
+/**
+ * Sends the atoms buffered since the last batch.
+ * Returns the number of bytes sent, 0 if none were buffered, or -errno.
+ **/
+int AStatsSocket_flush();
 #ifdef __cplusplus
 }
 #endif  // __CPLUSPLUS
@@ -16,12 +16,30 @@
 
 #include "include/stats_buffer_writer.h"
 #include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
 #include <sys/time.h>
 #include <sys/uio.h>
+#include <time.h>
 #include "statsd_writer.h"
 
+#define LOGGER_ENTRY_MAX_PAYLOAD 4068
+
 static const uint32_t kStatsEventTag = 1937006964;
 
+/*
+ * Atoms buffered by stats_log_set_buffering() are sent as one datagram:
+ *   |kStatsEventBatchTag|size|atom|size|atom|...
+ * where each size is the uint32_t length of the atom that follows it.
+ * (*FORMAT MUST BE IN SYNC WITH statsd StatsSocketListener*)
+ */
+static const uint32_t kStatsEventBatchTag = 1937006946;
+#define MAX_BATCH_PAYLOAD (LOGGER_ENTRY_MAX_PAYLOAD - sizeof(kStatsEventBatchTag))
+// Every atom takes at least its size in the batch.
+#define MAX_BATCH_ATOMS (MAX_BATCH_PAYLOAD / sizeof(uint32_t))
+
 extern struct android_log_transport_write statsdLoggerWrite;
 
 static int __write_to_statsd_init(struct iovec* vec, size_t nr);
@@ -32,6 +50,7 @@ void note_log_drop(int error, int atomId) {
 }
 
 void stats_log_close() {
+    stats_log_flush();
     statsd_writer_init_lock();
     __write_to_statsd = __write_to_statsd_init;
     if (statsdLoggerWrite.close) {
@@ -44,9 +63,179 @@ int stats_log_is_closed() {
     return statsdLoggerWrite.isClosed && (*statsdLoggerWrite.isClosed)();
 }
 
+/* batch_lock guards all of the batch state below. */
+static pthread_mutex_t batch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t batch_cond;
+static pthread_once_t batch_once = PTHREAD_ONCE_INIT;
+static atomic_bool batch_enabled = false;  // also read without the lock.
+static bool batch_flusher_started = false;  // cleared in forked children.
+static size_t batch_max_bytes = 0;
+static int64_t batch_max_delay_ns = 0;
+static int64_t batch_deadline_ns = 0;
+static uint8_t batch_buffer[MAX_BATCH_PAYLOAD];
+static size_t batch_size = 0;
+static int batch_count = 0;
+static uint32_t batch_atom_ids[MAX_BATCH_ATOMS];
+
+static int64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* batch_lock assumed */
+static int flush_batch_locked() {
+    if (batch_count == 0) {
+        return 0;
+    }
+
+    struct iovec vecs[2];
+    vecs[0].iov_base = (void*)&kStatsEventBatchTag;
+    vecs[0].iov_len = sizeof(kStatsEventBatchTag);
+    vecs[1].iov_base = batch_buffer;
+    vecs[1].iov_len = batch_size;
+
+    int ret = __write_to_statsd(vecs, 2);
+
+    if (ret < 0) {
+        // Every atom of the batch is reported as dropped under its own id, as if it had been
+        // written alone.
+        for (int i = 0; i < batch_count; i++) {
+            note_log_drop(ret, batch_atom_ids[i]);
+        }
+    }
+
+    batch_size = 0;
+    batch_count = 0;
+    return ret;
+}
+
+static void* batch_flusher(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&batch_lock);
+    for (;;) {
+        if (batch_count == 0) {
+            pthread_cond_wait(&batch_cond, &batch_lock);
+            continue;
+        }
+        const int64_t now = monotonic_ns();
+        if (now >= batch_deadline_ns) {
+            flush_batch_locked();
+            continue;
+        }
+        struct timespec deadline;
+        deadline.tv_sec = batch_deadline_ns / 1000000000LL;
+        deadline.tv_nsec = batch_deadline_ns % 1000000000LL;
+        pthread_cond_timedwait(&batch_cond, &batch_lock, &deadline);
+    }
+    return NULL;
+}
+
+static void batch_before_fork() {
+    pthread_mutex_lock(&batch_lock);
+}
+
+static void batch_after_fork_parent() {
+    pthread_mutex_unlock(&batch_lock);
+}
+
+static void batch_after_fork_child() {
+    // The parent sends the atoms it buffered. The flusher thread is not forked, so the child
+    // starts its own when it buffers an atom.
+    batch_size = 0;
+    batch_count = 0;
+    batch_flusher_started = false;
+    pthread_mutex_unlock(&batch_lock);
+}
+
+static void batch_init_once() {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&batch_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_atfork(batch_before_fork, batch_after_fork_parent, batch_after_fork_child);
+}
+
+void stats_log_set_buffering(size_t maxBytes, uint32_t maxDelayMillis) {
+    pthread_once(&batch_once, batch_init_once);
+    pthread_mutex_lock(&batch_lock);
+    flush_batch_locked();
+    batch_enabled = maxBytes > 0;
+    batch_max_bytes = maxBytes < MAX_BATCH_PAYLOAD ? maxBytes : MAX_BATCH_PAYLOAD;
+    batch_max_delay_ns = maxDelayMillis * 1000000LL;
+    pthread_mutex_unlock(&batch_lock);
+}
+
+/* batch_lock assumed */
+static bool start_flusher_locked() {
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    batch_flusher_started = pthread_create(&thread, &attr, batch_flusher, NULL) == 0;
+    pthread_attr_destroy(&attr);
+    return batch_flusher_started;
+}
+
+int stats_log_flush() {
+    pthread_mutex_lock(&batch_lock);
+    int ret = flush_batch_locked();
+    pthread_mutex_unlock(&batch_lock);
+    return ret;
+}
+
+/*
+ * Appends the atom to the batch, flushing first if it does not fit.
+ * Returns 0 if buffering is disabled or the atom is too large to be batched,
+ * in which case the caller writes it alone.
+ */
+static int append_to_batch(void* buffer, size_t size, uint32_t atomId) {
+    pthread_mutex_lock(&batch_lock);
+    if (!batch_enabled) {
+        pthread_mutex_unlock(&batch_lock);
+        return 0;
+    }
+    if (!batch_flusher_started && !start_flusher_locked()) {
+        // Without the flusher atoms could be held forever, so don't buffer at all.
+        batch_enabled = false;
+        pthread_mutex_unlock(&batch_lock);
+        return 0;
+    }
+
+    const uint32_t atomSize = size;
+    const size_t recordSize = sizeof(atomSize) + size;
+    if (batch_size + recordSize > batch_max_bytes) {
+        flush_batch_locked();
+        if (recordSize > batch_max_bytes) {
+            // The batch is now empty, so writing the atom alone keeps the order.
+            pthread_mutex_unlock(&batch_lock);
+            return 0;
+        }
+    }
+
+    memcpy(batch_buffer + batch_size, &atomSize, sizeof(atomSize));
+    memcpy(batch_buffer + batch_size + sizeof(atomSize), buffer, size);
+    batch_size += recordSize;
+    batch_atom_ids[batch_count] = atomId;
+    if (batch_count++ == 0) {
+        batch_deadline_ns = monotonic_ns() + batch_max_delay_ns;
+        pthread_cond_signal(&batch_cond);
+    }
+    pthread_mutex_unlock(&batch_lock);
+    return size;
+}
+
 int write_buffer_to_statsd(void* buffer, size_t size, uint32_t atomId) {
     int ret = 1;
 
+    if (atomic_load_explicit(&batch_enabled, memory_order_relaxed)) {
+        ret = append_to_batch(buffer, size, atomId);
+        if (ret > 0) {
+            return ret;
+        }
+    }
+
     struct iovec vecs[2];
     vecs[0].iov_base = (void*)&kStatsEventTag;
     vecs[0].iov_len = sizeof(kStatsEventTag);
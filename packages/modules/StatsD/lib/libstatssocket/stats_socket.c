@@ -20,3 +20,15 @@
 void AStatsSocket_close() {
     stats_log_close();
 }
+
+int AStatsSocket_write(const uint8_t* buffer, size_t size, uint32_t atomId) {
+    return write_buffer_to_statsd((void*)buffer, size, atomId);
+}
+
+void AStatsSocket_setBuffering(size_t maxBytes, uint32_t maxDelayMillis) {
+    stats_log_set_buffering(maxBytes, maxDelayMillis);
+}
+
+int AStatsSocket_flush() {
+    return stats_log_flush();
+}
@@ -15,6 +15,8 @@
  */
 
 #include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include "stats_buffer_writer.h"
 #include "stats_event.h"
 #include "stats_socket.h"
@@ -34,3 +36,65 @@ TEST(StatsWriterTest, TestSocketClose) {
 
     EXPECT_TRUE(stats_log_is_closed());
 }
+
+TEST(StatsWriterTest, TestBuffering) {
+    AStatsSocket_setBuffering(1024, 10000 /* maxDelayMillis */);
+
+    int bufferedBytes = 0;
+    for (int i = 0; i < 3; i++) {
+        AStatsEvent* event = AStatsEvent_obtain();
+        AStatsEvent_setAtomId(event, 100);
+        AStatsEvent_writeInt32(event, i);
+        int result = AStatsEvent_write(event);
+        AStatsEvent_release(event);
+
+        // A buffered atom returns its size without being written.
+        EXPECT_GT(result, 0);
+        bufferedBytes += result + sizeof(uint32_t);
+    }
+
+    // The three atoms are written as one datagram, after the tag of the batch.
+    EXPECT_EQ(bufferedBytes + (int)sizeof(uint32_t), AStatsSocket_flush());
+    EXPECT_EQ(0, AStatsSocket_flush());
+
+    AStatsSocket_setBuffering(0, 0);
+}
+
+TEST(StatsWriterTest, TestBufferingAfterFork) {
+    AStatsSocket_setBuffering(1024, 10 /* maxDelayMillis */);
+
+    pid_t pid = fork();
+    ASSERT_NE(-1, pid);
+    if (pid == 0) {
+        // The flusher thread of the parent is not forked, the child must still send its
+        // buffered atoms after maxDelayMillis.
+        AStatsEvent* event = AStatsEvent_obtain();
+        AStatsEvent_setAtomId(event, 100);
+        AStatsEvent_writeInt32(event, 5);
+        int result = AStatsEvent_write(event);
+        AStatsEvent_release(event);
+
+        usleep(500 * 1000);
+        _exit(result > 0 && AStatsSocket_flush() == 0 ? 0 : 1);
+    }
+
+    int status;
+    ASSERT_EQ(pid, TEMP_FAILURE_RETRY(waitpid(pid, &status, 0)));
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(0, WEXITSTATUS(status));
+
+    AStatsSocket_setBuffering(0, 0);
+}
+
+TEST(StatsWriterTest, TestWriteSerializedAtom) {
+    AStatsEvent* event = AStatsEvent_obtain();
+    AStatsEvent_setAtomId(event, 100);
+    AStatsEvent_writeInt32(event, 5);
+    AStatsEvent_build(event);
+    size_t size;
+    const uint8_t* buffer = AStatsEvent_getBuffer(event, &size);
+
+    // The StatsEventTag is written before the atom.
+    EXPECT_EQ((int)(size + sizeof(uint32_t)), AStatsSocket_write(buffer, size, 100));
+    AStatsEvent_release(event);
+}
@@ -15,12 +15,14 @@
  */
 #include "benchmark/benchmark.h"
 #include <statslog.h>
+#include <stats_event.h>
+#include <stats_socket.h>
 
 namespace android {
 namespace os {
 namespace statsd {
 
-static void BM_StatsWrite(benchmark::State& state) {
+static void writeBootSequence(benchmark::State& state) {
     const char* reason = "test";
     int64_t boot_end_time = 1234567;
     int64_t total_duration = 100;
@@ -32,8 +34,48 @@ static void BM_StatsWrite(benchmark::State& state) {
                 boot_end_time, total_duration, bootloader_duration, time_since_last_boot);
         total_duration++;
     }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// One datagram per atom. The CPU is measured for the whole process so that it
+// compares with the buffered writes, which can be flushed on another thread.
+static void BM_StatsWrite(benchmark::State& state) {
+    writeBootSequence(state);
+}
+BENCHMARK(BM_StatsWrite)->MeasureProcessCPUTime();
+
+// Atoms coalesced into datagrams of up to state.range(0) bytes.
+static void BM_StatsWriteBuffered(benchmark::State& state) {
+    AStatsSocket_setBuffering(state.range(0), 100 /* maxDelayMillis */);
+    writeBootSequence(state);
+    AStatsSocket_setBuffering(0, 0);
+}
+BENCHMARK(BM_StatsWriteBuffered)->Arg(512)->Arg(4064)->MeasureProcessCPUTime();
+
+// An atom of only fixed-size fields, which the generated stats_write serializes
+// into a stack buffer in one pass.
+static void BM_StatsWriteFixedSize(benchmark::State& state) {
+    int32_t level = 0;
+    while (state.KeepRunning()) {
+        android::util::stats_write(android::util::SCREEN_BRIGHTNESS_CHANGED, level++ & 0xff);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StatsWriteFixedSize)->MeasureProcessCPUTime();
+
+// The same atom built through an AStatsEvent, as stats_write does for other atoms.
+static void BM_StatsWriteFixedSizeDynamic(benchmark::State& state) {
+    int32_t level = 0;
+    while (state.KeepRunning()) {
+        AStatsEvent* event = AStatsEvent_obtain();
+        AStatsEvent_setAtomId(event, android::util::SCREEN_BRIGHTNESS_CHANGED);
+        AStatsEvent_writeInt32(event, level++ & 0xff);
+        AStatsEvent_write(event);
+        AStatsEvent_release(event);
+    }
+    state.SetItemsProcessed(state.iterations());
 }
-BENCHMARK(BM_StatsWrite);
+BENCHMARK(BM_StatsWriteFixedSizeDynamic)->MeasureProcessCPUTime();
 
 }  //  namespace statsd
 }  //  namespace os
@@ -19,6 +19,7 @@
 #include <ctype.h>
 #include <limits.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/cdefs.h>
 #include <sys/prctl.h>
 #include <sys/socket.h>
@@ -119,21 +120,58 @@ bool StatsSocketListener::onDataAvailable(SocketClient* cli) {
         }
     }
 
+    processMessage(ptr, n, cred->uid, cred->pid, mQueue.get());
+    return true;
+}
+
+int StatsSocketListener::processMessage(uint8_t* ptr, uint32_t n, uint32_t uid, uint32_t pid,
+                                        LogEventQueue* queue) {
+    if (n < sizeof(uint32_t)) {
+        return 0;
+    }
+
+    uint32_t tag;
+    memcpy(&tag, ptr, sizeof(tag));
     // move past the 4-byte StatsEventTag
     uint8_t* msg = ptr + sizeof(uint32_t);
     uint32_t len = n - sizeof(uint32_t);
-    uint32_t uid = cred->uid;
-    uint32_t pid = cred->pid;
 
+    if (tag != kStatsEventBatchTag) {
+        pushEvent(msg, len, uid, pid, queue);
+        return 1;
+    }
+
+    // Atoms buffered by libstatssocket are sent as |size|atom|size|atom|...
+    // where each size is the uint32_t length of the atom that follows it.
+    // (*FORMAT MUST BE IN SYNC WITH libstatssocket stats_buffer_writer.c*)
+    int count = 0;
+    while (len >= sizeof(uint32_t)) {
+        uint32_t atomLen;
+        memcpy(&atomLen, msg, sizeof(atomLen));
+        msg += sizeof(uint32_t);
+        len -= sizeof(uint32_t);
+        if (atomLen > len) {
+            ALOGE("Truncated atom batch from uid %d: atom of %u bytes, %u left", uid, atomLen,
+                  len);
+            break;
+        }
+        pushEvent(msg, atomLen, uid, pid, queue);
+        msg += atomLen;
+        len -= atomLen;
+        count++;
+    }
+    return count;
+}
+
+void StatsSocketListener::pushEvent(uint8_t* msg, uint32_t len, uint32_t uid, uint32_t pid,
+                                    LogEventQueue* queue) {
     int64_t oldestTimestamp;
     std::unique_ptr<LogEvent> logEvent = std::make_unique<LogEvent>(uid, pid);
     logEvent->parseBuffer(msg, len);
 
-    if (!mQueue->push(std::move(logEvent), &oldestTimestamp)) {
+    if (!queue->push(std::move(logEvent), &oldestTimestamp)) {
         StatsdStats::getInstance().noteEventQueueOverflow(oldestTimestamp);
     }
-
-    return true;
 }
 
 int StatsSocketListener::getLogSocket() {
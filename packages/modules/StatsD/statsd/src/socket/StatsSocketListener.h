@@ -39,11 +39,28 @@ public:
 
     virtual ~StatsSocketListener();
 
+    /**
+     * Parses the atoms of a datagram received on the statsdw socket and pushes
+     * them on the queue. msg points right after the android_log_header_t, at
+     * the StatsEventTag of a single atom or the StatsEventBatchTag of atoms
+     * coalesced by libstatssocket.
+     *
+     * \return the number of atoms found
+     */
+    static int processMessage(uint8_t* msg, uint32_t len, uint32_t uid, uint32_t pid,
+                              LogEventQueue* queue);
+
+    // Keep in sync with libstatssocket stats_buffer_writer.c
+    static constexpr uint32_t kStatsEventBatchTag = 1937006946;
+
 protected:
     virtual bool onDataAvailable(SocketClient* cli);
 
 private:
     static int getLogSocket();
+
+    static void pushEvent(uint8_t* msg, uint32_t len, uint32_t uid, uint32_t pid,
+                          LogEventQueue* queue);
     /**
      * Who is going to get the events when they're read.
      */
@@ -0,0 +1,105 @@
+// Copyright (C) 2020 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "socket/StatsSocketListener.h"
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <vector>
+
+#include "stats_event.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+namespace {
+
+const uint32_t kStatsEventTag = 1937006964;
+
+void appendUint32(std::vector<uint8_t>* msg, uint32_t value) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    msg->insert(msg->end(), bytes, bytes + sizeof(value));
+}
+
+// Appends an atom with one int32 field, preceded by its size if sized is true.
+void appendAtom(std::vector<uint8_t>* msg, int32_t atomId, int32_t value, bool sized) {
+    AStatsEvent* event = AStatsEvent_obtain();
+    AStatsEvent_setAtomId(event, atomId);
+    AStatsEvent_writeInt32(event, value);
+    AStatsEvent_build(event);
+    size_t size;
+    uint8_t* buf = AStatsEvent_getBuffer(event, &size);
+    if (sized) {
+        appendUint32(msg, size);
+    }
+    msg->insert(msg->end(), buf, buf + size);
+    AStatsEvent_release(event);
+}
+
+}  // anonymous namespace
+
+TEST(StatsSocketListenerTest, TestProcessSingleAtom) {
+    LogEventQueue queue(10);
+    std::vector<uint8_t> msg;
+    appendUint32(&msg, kStatsEventTag);
+    appendAtom(&msg, 100, 5, /*sized=*/false);
+
+    EXPECT_EQ(1, StatsSocketListener::processMessage(msg.data(), msg.size(), /*uid=*/1000,
+                                                     /*pid=*/42, &queue));
+
+    std::unique_ptr<LogEvent> event = queue.waitPop();
+    EXPECT_EQ(100, event->GetTagId());
+    EXPECT_EQ(1000, event->GetUid());
+    EXPECT_EQ(42, event->GetPid());
+    EXPECT_TRUE(event->isValid());
+}
+
+TEST(StatsSocketListenerTest, TestProcessBatch) {
+    LogEventQueue queue(10);
+    std::vector<uint8_t> msg;
+    appendUint32(&msg, StatsSocketListener::kStatsEventBatchTag);
+    for (int i = 0; i < 3; i++) {
+        appendAtom(&msg, 100 + i, i, /*sized=*/true);
+    }
+
+    EXPECT_EQ(3, StatsSocketListener::processMessage(msg.data(), msg.size(), /*uid=*/1000,
+                                                     /*pid=*/42, &queue));
+
+    for (int i = 0; i < 3; i++) {
+        std::unique_ptr<LogEvent> event = queue.waitPop();
+        EXPECT_EQ(100 + i, event->GetTagId());
+        EXPECT_EQ(1000, event->GetUid());
+        EXPECT_TRUE(event->isValid());
+    }
+}
+
+TEST(StatsSocketListenerTest, TestProcessTruncatedBatch) {
+    LogEventQueue queue(10);
+    std::vector<uint8_t> msg;
+    appendUint32(&msg, StatsSocketListener::kStatsEventBatchTag);
+    appendAtom(&msg, 100, 1, /*sized=*/true);
+    appendAtom(&msg, 101, 2, /*sized=*/true);
+    // Cut the second atom short, only the first one can be parsed.
+    msg.resize(msg.size() - 2);
+
+    EXPECT_EQ(1, StatsSocketListener::processMessage(msg.data(), msg.size(), /*uid=*/1000,
+                                                     /*pid=*/42, &queue));
+    EXPECT_EQ(100, queue.waitPop()->GetTagId());
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android